@@ -142,6 +142,8 @@ static void printTemplate() {
         "accessid = \"aws access id\"\n"
         "threadnum = 4\n"
         "chunksize = 67108864\n"
+        "prefetch_keys = 1\n"
+        "split_size = 0\n"
         "low_speed_limit = 10240\n"
         "low_speed_time = 60\n"
         "encryption = true\n"
@@ -38,6 +38,9 @@ class GPReader : public Reader {
     S3Params params;
     S3BucketReader bucketReader;
     S3CommonReader commonReader;
+
+    // Readers for the keys prefetched after the one commonReader is serving.
+    vector<std::shared_ptr<S3CommonReader> > prefetchReaders;
     S3RESTfulService restfulService;
 
     S3InterfaceService s3InterfaceService;
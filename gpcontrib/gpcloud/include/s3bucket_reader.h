@@ -6,7 +6,32 @@
 #include "s3exception.h"
 #include "s3interface.h"
 
+// chunk size to read the rest of a line running past the end of a key part
+#define S3_LINE_TAIL_CHUNKSIZE (1024 * 1024)
+
+// A byte range [offset, end) of a key, read by one segment. A key that is not
+// split has one part covering all of it.
+struct BucketKeyPart {
+    uint64_t keyIndex;  // BucketContent index of keylist->contents.
+    uint64_t offset;
+    uint64_t end;
+};
+
 // S3BucketReader read multiple files in a bucket.
+//
+// Every segment lists the same keys and runs the same bin packing to decide
+// which of them it reads: keys are placed largest first on the segment with
+// the fewest bytes so far. With 'split_size' set, uncompressed keys larger than
+// it are first cut into parts of at most that size, which may be read by
+// different segments. A part owns the lines starting in it, it skips the partial
+// line at its beginning and reads past its end to finish its last line.
+//
+// Keys are read one after another, but with more than one upstream reader and
+// 'prefetch_keys' set above one, the keys after the current one are opened
+// ahead of time so their downloading threads run while the current key is
+// being consumed. Each open key holds a reservation of chunks in the shared
+// S3MemoryContext, so a window of keys never needs more memory than a single
+// key reading with all threads.
 class S3BucketReader : public Reader {
    public:
     S3BucketReader();
@@ -21,22 +46,49 @@ class S3BucketReader : public Reader {
     }
 
     void setUpstreamReader(Reader *reader) {
-        this->upstreamReader = reader;
+        this->idleReaders.clear();
+        if (reader != NULL) {
+            this->idleReaders.push_back(reader);
+        }
+    }
+
+    // Add one more reader, allowing one more key to be downloaded at once.
+    void addUpstreamReader(Reader *reader) {
+        this->idleReaders.push_back(reader);
     }
 
     const ListBucketResult &getKeyList() {
         return keyList;
     }
 
+    const vector<BucketKeyPart> &getKeyParts() {
+        return keyParts;
+    }
+
    private:
     S3Params params;
 
     S3Interface *s3Interface;
 
-    // upstreamReader is where we get data from.
+    // upstreamReader is where we get data from, it serves the first key in the window.
     Reader *upstreamReader;
     bool needNewReader;
 
+    struct PrefetchedKey {
+        Reader *reader;
+        BucketKeyPart part;
+        uint64_t numOfChunks;  // chunks reserved in the memory context
+    };
+
+    // Keys opened but not finished yet, in the order they are read.
+    std::deque<PrefetchedKey> prefetchWindow;
+
+    // Readers not serving any key.
+    vector<Reader *> idleReaders;
+
+    void fillPrefetchWindow();
+    void finishCurrentKey();
+
     // when load multiple files on one segment and each of them has a header line,
     // we should read header line only for the 1st file and ignore remainings.
     bool isFirstFile;
@@ -45,11 +97,29 @@ class S3BucketReader : public Reader {
     // copy valid data into buf and return its size.
     uint64_t readWithoutHeaderLine(char *buf, uint64_t count);
 
-    ListBucketResult keyList;  // List of matched keys/files.
-    uint64_t keyIndex;         // BucketContent index of keylist->contents.
+    // Number of eolString chars matched at the end of the data seen so far.
+    uint64_t eolMatched;
+    const char *matchEOL(const char *begin, const char *end);
+
+    // Whether a line starts in the current part, if not, the part has nothing to read
+    // past its end either.
+    bool partHasLine;
+
+    // Reading the rest of the last line of the current part, after its end.
+    bool readingLineTail;
+    bool lineTailDone;
+    uint64_t lineTailSkip;  // bytes at the start of the tail that were returned already
+
+    void openLineTail();
+    uint64_t readLineTail(char *buf, uint64_t count);
+
+    ListBucketResult keyList;        // List of matched keys/files.
+    vector<BucketKeyPart> keyParts;  // Parts of keys read by this segment.
+    uint64_t partIndex;              // Index of the next part of keyParts to open.
 
-    BucketContent &getNextKey();
-    S3Params constructReaderParams(BucketContent &key);
+    void assignKeyParts();
+    bool isSplittable(BucketContent &key);
+    S3Params constructReaderParams(BucketContent &key, uint64_t offset, uint64_t end);
 };
 
 #endif
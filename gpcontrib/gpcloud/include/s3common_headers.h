@@ -13,8 +13,10 @@
 #include <algorithm>
 #include <csignal>
 #include <cstring>
+#include <deque>
 #include <map>
 #include <memory>
+#include <queue>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -73,6 +73,8 @@ class S3KeyReader : public Reader {
           numOfChunks(0),
           curReadingChunk(0),
           transferredKeyLen(0),
+          rangeSize(0),
+          rangeReachesKeyEnd(true),
           s3Interface(NULL),
           hasEol(false),
           eolAppended(false) {
@@ -152,6 +154,8 @@ class S3KeyReader : public Reader {
     uint64_t numOfChunks;
     uint64_t curReadingChunk;
     uint64_t transferredKeyLen;
+    uint64_t rangeSize;        // bytes of the key to read
+    bool rangeReachesKeyEnd;  // whether the bytes to read run to the end of the key
     string region;
     OffsetMgr offsetMgr;
 
@@ -35,4 +35,10 @@ extern uint64_t S3_ZIP_COMPRESS_CHUNKSIZE;
 // to enable zlib and gzip decoding with automatic header detection.
 #define S3_INFLATE_WINDOWSBITS (MAX_WBITS + 16 + 16)
 
+// Extension of keys compressed with zstd, keys with it are read with ZstdDecompressReader.
+#define S3_ZSTD_EXTENSION ".zst"
+
+// zstd level used by ZstdCompressWriter, the library's default.
+#define S3_ZSTD_COMPRESSION_LEVEL 3
+
 #endif
@@ -10,7 +10,7 @@ void S3Free(void*);
 
 class PreAllocatedMemory {
    public:
-    PreAllocatedMemory(size_t chunkSize, size_t numOfChunk) {
+    PreAllocatedMemory(size_t chunkSize, size_t numOfChunk) : reserved(0) {
         maxSize = chunkSize * numOfChunk;
         // we will have no more than 9 chunks, 8 for thread thunk, one for main buffer.
         // Each chunk is limited to 128MB.
@@ -73,6 +73,26 @@ class PreAllocatedMemory {
         S3_DIE(S3RuntimeError, ss.str());
     }
 
+    // Reserve chunks ahead of time for a group of downloads, so that several
+    // readers sharing this memory never ask for more chunks than it holds.
+    // One chunk is always kept out of reservations, for requests that are not
+    // part of any download, such as probing the compression type of a key.
+    bool Reserve(size_t numOfChunk) {
+        UniqueLock lock(&memLock);
+        if (reserved + numOfChunk + 1 > chunks.size()) {
+            return false;
+        }
+        reserved += numOfChunk;
+        return true;
+    }
+
+    void Unreserve(size_t numOfChunk) {
+        UniqueLock lock(&memLock);
+        S3_CHECK_OR_DIE(numOfChunk <= reserved, S3RuntimeError,
+                        "Released more chunks than reserved");
+        reserved -= numOfChunk;
+    }
+
    private:
     PreAllocatedMemory(const PreAllocatedMemory&);
     PreAllocatedMemory& operator=(const PreAllocatedMemory&);
@@ -80,6 +100,7 @@ class PreAllocatedMemory {
     size_t maxSize;
     vector<bool> used;
     vector<void*> chunks;
+    size_t reserved;
     pthread_mutex_t memLock;
 };
 
@@ -142,6 +163,17 @@ struct PGAllocator {
         }
     }
 
+    // Without preallocated memory there is nothing to run out of.
+    bool reserve(size_t numOfChunk) {
+        return prealloc ? prealloc->Reserve(numOfChunk) : true;
+    }
+
+    void unreserve(size_t numOfChunk) {
+        if (prealloc) {
+            prealloc->Unreserve(numOfChunk);
+        }
+    }
+
     void prepare(size_t chunkSize, size_t numOfChunk) {
         prealloc.reset();
         prealloc.reset(new PreAllocatedMemory(chunkSize, numOfChunk));
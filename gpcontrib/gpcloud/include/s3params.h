@@ -7,19 +7,29 @@
 
 enum S3SSEType { SSE_NONE, SSE_S3 };
 
+enum S3CompressionType {
+    S3_COMPRESSION_GZIP,
+    S3_COMPRESSION_PLAIN,
+    S3_COMPRESSION_ZSTD,
+};
+
 class S3Params {
    public:
     S3Params(const string& sourceUrl = "", bool useHttps = true, const string& version = "",
              const string& region = "")
         : s3Url(sourceUrl, useHttps, version, region),
           keySize(0),
+          keyOffset(0),
+          keyEnd(UINT64_MAX),
           chunkSize(0),
           numOfChunks(0),
+          prefetchKeys(1),
+          splitSize(0),
           lowSpeedLimit(0),
           lowSpeedTime(0),
           proxy(""),
           debugCurl(false),
-          autoCompress(false),
+          compression(S3_COMPRESSION_PLAIN),
           verifyCert(false),
           sseType(SSE_NONE),
           gpcheckcloud_newline("") {
@@ -64,6 +74,14 @@ class S3Params {
         this->numOfChunks = numOfChunks;
     }
 
+    uint64_t getPrefetchKeys() const {
+        return prefetchKeys;
+    }
+
+    void setPrefetchKeys(uint64_t prefetchKeys) {
+        this->prefetchKeys = prefetchKeys;
+    }
+
     uint64_t getKeySize() const {
         return keySize;
     }
@@ -72,6 +90,29 @@ class S3Params {
         this->keySize = size;
     }
 
+    uint64_t getKeyOffset() const {
+        return keyOffset;
+    }
+
+    // End of the bytes to read, never past the end of the key.
+    uint64_t getKeyEnd() const {
+        return std::min(keyEnd, keySize);
+    }
+
+    // Read only the bytes in [offset, end) of the key.
+    void setKeyRange(uint64_t offset, uint64_t end) {
+        this->keyOffset = offset;
+        this->keyEnd = end;
+    }
+
+    uint64_t getSplitSize() const {
+        return splitSize;
+    }
+
+    void setSplitSize(uint64_t splitSize) {
+        this->splitSize = splitSize;
+    }
+
     uint64_t getLowSpeedLimit() const {
         return lowSpeedLimit;
     }
@@ -97,7 +138,7 @@ class S3Params {
     }
 
     bool isAutoCompress() const {
-        return autoCompress;
+        return compression != S3_COMPRESSION_PLAIN;
     }
 
     bool isVerifyCert() const {
@@ -108,7 +149,15 @@ class S3Params {
     }
 
     void setAutoCompress(bool autoCompress) {
-        this->autoCompress = autoCompress;
+        this->compression = autoCompress ? S3_COMPRESSION_GZIP : S3_COMPRESSION_PLAIN;
+    }
+
+    S3CompressionType getCompression() const {
+        return compression;
+    }
+
+    void setCompression(S3CompressionType compression) {
+        this->compression = compression;
     }
 
     const S3MemoryContext& getMemoryContext() const {
@@ -152,18 +201,26 @@ class S3Params {
 
     uint64_t keySize;  // key/file size.
 
+    uint64_t keyOffset;  // first byte of the key to read.
+    uint64_t keyEnd;     // end of the bytes to read.
+
     S3Credential cred;  // S3 credential.
 
     uint64_t chunkSize;    // chunk size
     uint64_t numOfChunks;  // number of chunks(threads).
 
+    uint64_t prefetchKeys;  // number of keys a bucket reader downloads at once
+    uint64_t splitSize;     // keys larger than this are read by several segments, 0 to disable
+
     uint64_t lowSpeedLimit;  // low speed limit
     uint64_t lowSpeedTime;   // low speed timeout
 
     string proxy;  // proxy
 
-    bool debugCurl;     // debug curl or not
-    bool autoCompress;  // whether to compress data before uploading
+    bool debugCurl;  // debug curl or not
+
+    S3CompressionType compression;  // codec to compress data with before uploading
+
     bool verifyCert;  // This option determines whether curl verifies the authenticity of the peer's
                       // certificate.
 
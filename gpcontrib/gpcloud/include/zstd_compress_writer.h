@@ -0,0 +1,44 @@
+#ifndef INCLUDE_ZSTD_COMPRESS_WRITER_H_
+#define INCLUDE_ZSTD_COMPRESS_WRITER_H_
+
+#ifdef HAVE_LIBZSTD
+
+#include <zstd.h>
+
+#include "s3common_headers.h"
+#include "s3exception.h"
+#include "s3macros.h"
+#include "writer.h"
+
+// ZstdCompressWriter compresses data into a single zstd frame at S3_ZSTD_COMPRESSION_LEVEL and
+// passes it to the underlying writer.
+class ZstdCompressWriter : public Writer {
+   public:
+    ZstdCompressWriter();
+    virtual ~ZstdCompressWriter();
+
+    virtual void open(const S3Params &params);
+
+    // write() attempts to write up to count bytes from the buffer.
+    // Throw exception if encounters errors.
+    virtual uint64_t write(const char *buf, uint64_t count);
+
+    // This should be reentrant, has no side effects when called multiple times.
+    virtual void close();
+
+    void setWriter(Writer *writer);
+
+   private:
+    Writer *writer;
+
+    // zstd related variables.
+    ZSTD_CStream *cstream;
+    char *out;  // Output buffer for compression.
+
+    // add this flag to make close() reentrant
+    bool isClosed;
+};
+
+#endif /* HAVE_LIBZSTD */
+
+#endif /* INCLUDE_ZSTD_COMPRESS_WRITER_H_ */
@@ -0,0 +1,50 @@
+#ifndef INCLUDE_ZSTD_DECOMPRESS_READER_H_
+#define INCLUDE_ZSTD_DECOMPRESS_READER_H_
+
+#ifdef HAVE_LIBZSTD
+
+#include <zstd.h>
+
+#include "reader.h"
+#include "s3common_headers.h"
+#include "s3exception.h"
+#include "s3macros.h"
+#include "s3params.h"
+
+// ZstdDecompressReader decodes a zstd stream, possibly made of several frames, read from the
+// underlying reader. Decoded data goes straight to the caller's buffer, so unlike DecompressReader
+// only the compressed input is buffered.
+class ZstdDecompressReader : public Reader {
+   public:
+    ZstdDecompressReader();
+    virtual ~ZstdDecompressReader();
+
+    virtual void open(const S3Params &params);
+
+    // read() attempts to read up to count bytes into the buffer.
+    // Return 0 if EOF. Throw exception if encounters errors.
+    virtual uint64_t read(char *buf, uint64_t count);
+
+    // This should be reentrant, has no side effects when called multiple times.
+    virtual void close();
+
+    void setReader(Reader *reader);
+
+   private:
+    Reader *reader;
+
+    // zstd related variables.
+    ZSTD_DStream *dstream;
+    ZSTD_inBuffer input;
+    char *in;  // Input buffer for decompression.
+
+    bool readerEOF;       // underlying reader has no more data
+    size_t framePending;  // zstd hint of input still needed, 0 at the end of a frame
+    uint64_t compressedBytes;
+
+    bool isClosed;
+};
+
+#endif /* HAVE_LIBZSTD */
+
+#endif /* INCLUDE_ZSTD_DECOMPRESS_READER_H_ */
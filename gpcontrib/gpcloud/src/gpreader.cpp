@@ -68,6 +68,14 @@ void GPReader::open(const S3Params& params) {
     this->bucketReader.setS3InterfaceService(&this->s3InterfaceService);
     this->bucketReader.setUpstreamReader(&this->commonReader);
     this->commonReader.setS3InterfaceService(&this->s3InterfaceService);
+
+    for (uint64_t i = 1; i < this->params.getPrefetchKeys(); i++) {
+        std::shared_ptr<S3CommonReader> reader(new S3CommonReader());
+        reader->setS3InterfaceService(&this->s3InterfaceService);
+        this->bucketReader.addUpstreamReader(reader.get());
+        this->prefetchReaders.push_back(reader);
+    }
+
     this->bucketReader.open(this->params);
 }
 
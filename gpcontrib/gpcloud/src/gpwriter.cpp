@@ -80,7 +80,12 @@ GPWriter* writer_init(const char* url_with_options, const char* format) {
         // Prepare memory to be used for thread chunk buffer.
         PrepareS3MemContext(params);
 
-        string extName = params.isAutoCompress() ? string(format) + ".gz" : format;
+        string extName = format;
+        if (params.getCompression() == S3_COMPRESSION_GZIP) {
+            extName += ".gz";
+        } else if (params.getCompression() == S3_COMPRESSION_ZSTD) {
+            extName += S3_ZSTD_EXTENSION;
+        }
         writer = new GPWriter(params, extName);
         if (writer == NULL) {
             return NULL;
@@ -1,13 +1,19 @@
 #include "s3bucket_reader.h"
 
 S3BucketReader::S3BucketReader() : Reader() {
-    this->keyIndex = 0;  // doesn't matter, be set in open()
+    this->partIndex = 0;  // doesn't matter, be set in open()
 
     this->s3Interface = NULL;
     this->upstreamReader = NULL;
 
     this->needNewReader = true;
     this->isFirstFile = true;
+
+    this->eolMatched = 0;
+    this->partHasLine = true;
+    this->readingLineTail = false;
+    this->lineTailDone = false;
+    this->lineTailSkip = 0;
 }
 
 S3BucketReader::~S3BucketReader() {
@@ -17,8 +23,6 @@ S3BucketReader::~S3BucketReader() {
 void S3BucketReader::open(const S3Params& params) {
     this->params = params;
 
-    this->keyIndex = s3ext_segid;  // we may change it in unit tests
-
     S3_CHECK_OR_DIE(this->s3Interface != NULL, S3RuntimeError, "s3Interface is NULL");
 
     S3Url& s3Url = this->params.getS3Url();
@@ -27,15 +31,102 @@ void S3BucketReader::open(const S3Params& params) {
                     s3Url.getFullUrlForCurl());
 
     this->keyList = this->s3Interface->listBucket(s3Url);
+
+    this->assignKeyParts();
+    this->partIndex = 0;
+}
+
+struct SegmentLoad {
+    uint64_t bytes;
+    uint64_t numOfParts;
+    int32_t segid;
+
+    bool operator>(const SegmentLoad& other) const {
+        if (this->bytes != other.bytes) {
+            return this->bytes > other.bytes;
+        }
+        if (this->numOfParts != other.numOfParts) {
+            return this->numOfParts > other.numOfParts;
+        }
+        return this->segid > other.segid;
+    }
+};
+
+static bool CompareKeyPartSize(const BucketKeyPart& a, const BucketKeyPart& b) {
+    return (a.end - a.offset) > (b.end - b.offset);
+}
+
+static bool CompareKeyPartPosition(const BucketKeyPart& a, const BucketKeyPart& b) {
+    if (a.keyIndex != b.keyIndex) {
+        return a.keyIndex < b.keyIndex;
+    }
+    return a.offset < b.offset;
+}
+
+// Every segment runs the same greedy bin packing over the same key list, so each
+// part is read by exactly one segment without any coordination: parts are placed
+// largest first on the segment with the fewest bytes, then the fewest parts.
+void S3BucketReader::assignKeyParts() {
+    vector<BucketKeyPart> parts;
+
+    // A header line is only in the first part of a key, and every segment expects
+    // to find one at the start of its data, so keys with headers are never split.
+    uint64_t splitSize = hasHeader ? 0 : this->params.getSplitSize();
+
+    for (uint64_t i = 0; i < this->keyList.contents.size(); i++) {
+        BucketContent& key = this->keyList.contents[i];
+        uint64_t keySize = key.getSize();
+
+        uint64_t numOfParts = 1;
+        if (splitSize > 0 && keySize > splitSize && this->isSplittable(key)) {
+            numOfParts = (keySize + splitSize - 1) / splitSize;
+        }
+
+        uint64_t partSize = (keySize + numOfParts - 1) / numOfParts;
+        for (uint64_t j = 0; j < numOfParts; j++) {
+            BucketKeyPart part = {i, j * partSize, std::min((j + 1) * partSize, keySize)};
+            if (part.offset < part.end || j == 0) {
+                parts.push_back(part);
+            }
+        }
+    }
+
+    std::stable_sort(parts.begin(), parts.end(), CompareKeyPartSize);
+
+    std::priority_queue<SegmentLoad, vector<SegmentLoad>, std::greater<SegmentLoad> > loads;
+    for (int32_t i = 0; i < s3ext_segnum; i++) {
+        SegmentLoad load = {0, 0, i};
+        loads.push(load);
+    }
+
+    this->keyParts.clear();
+    for (uint64_t i = 0; i < parts.size(); i++) {
+        SegmentLoad load = loads.top();
+        loads.pop();
+
+        if (load.segid == s3ext_segid) {
+            this->keyParts.push_back(parts[i]);
+        }
+
+        load.bytes += parts[i].end - parts[i].offset;
+        load.numOfParts++;
+        loads.push(load);
+    }
+
+    // Read keys in the order they are listed.
+    std::sort(this->keyParts.begin(), this->keyParts.end(), CompareKeyPartPosition);
+
+    S3DEBUG("Segment %d reads %" PRIu64 " of %" PRIu64 " key parts", s3ext_segid,
+            (uint64_t)this->keyParts.size(), (uint64_t)parts.size());
 }
 
-BucketContent& S3BucketReader::getNextKey() {
-    BucketContent& key = this->keyList.contents[this->keyIndex];
-    this->keyIndex += s3ext_segnum;
-    return key;
+// Compressed keys can only be read from the beginning.
+bool S3BucketReader::isSplittable(BucketContent& key) {
+    S3Params keyParams = this->constructReaderParams(key, 0, key.getSize());
+    return this->s3Interface->checkCompressionType(keyParams.getS3Url()) == S3_COMPRESSION_PLAIN;
 }
 
-S3Params S3BucketReader::constructReaderParams(BucketContent& key) {
+S3Params S3BucketReader::constructReaderParams(BucketContent& key, uint64_t offset, uint64_t end) {
     // encode the key name but leave the "/"
     // "/encoded_path/encoded_name"
     string keyEncoded = UriEncode(key.getName());
@@ -44,71 +135,191 @@ S3Params S3BucketReader::constructReaderParams(BucketContent& key) {
     S3Params readerParams = this->params.setPrefix(keyEncoded);
 
     readerParams.setKeySize(key.getSize());
+    readerParams.setKeyRange(offset, end);
+
+    // A key never needs more downloading threads than it has chunks.
+    uint64_t chunkSize = readerParams.getChunkSize();
+    if (chunkSize > 0) {
+        uint64_t numOfChunks = std::max((end - offset + chunkSize - 1) / chunkSize, (uint64_t)1);
+        readerParams.setNumOfChunks(std::min(readerParams.getNumOfChunks(), numOfChunks));
+    }
 
-    S3DEBUG("key: %s, size: %" PRIu64, readerParams.getS3Url().getFullUrlForCurl().c_str(),
-            readerParams.getKeySize());
+    S3DEBUG("key: %s, size: %" PRIu64 ", range: %" PRIu64 "-%" PRIu64,
+            readerParams.getS3Url().getFullUrlForCurl().c_str(), readerParams.getKeySize(), offset,
+            end);
     return readerParams;
 }
 
-uint64_t S3BucketReader::readWithoutHeaderLine(char* buf, uint64_t count) {
-    char* current = NULL;
-    char* end = NULL;
-    char* currentEOL = eolString;
-
-    // check one char at a time
-    while (*currentEOL != '\0') {
-        if (current == end) {
-            uint64_t readCount = this->upstreamReader->read(buf, count);
-            // we have reach the end of file but found no matching EOL.
-            if (readCount == 0) {
-                S3WARN("%s", "Reach end of file before matching line terminator");
-                return 0;
-            }
+// Return the position right after the first line terminator in [begin, end), or
+// NULL if there is none. A terminator split between two calls is still found.
+const char* S3BucketReader::matchEOL(const char* begin, const char* end) {
+    if (eolString[0] == '\0') {
+        return begin;
+    }
 
-            current = buf;
-            end = buf + readCount;
+    for (const char* current = begin; current != end; current++) {
+        // No line terminator starts with its own suffix ('\n', '\r' or "\r\n"), so
+        // after a mismatch the current char can only start a new match.
+        if (*current != eolString[this->eolMatched]) {
+            this->eolMatched = 0;
         }
 
-        // skip until we met next newline char
-        for (; current != end; current++) {
-            if (*current == *currentEOL) {
-                currentEOL++;
-                current++;
-                break;
-            } else {
-                currentEOL = eolString;
+        if (*current == eolString[this->eolMatched]) {
+            this->eolMatched++;
+            if (eolString[this->eolMatched] == '\0') {
+                this->eolMatched = 0;
+                return current + 1;
             }
         }
     }
 
-    // move remained data to front.
-    uint64_t remain = end - current;
-    char* p = buf;
-    while (current != end) {
-        *p = *current;
-        p++;
-        current++;
+    return NULL;
+}
+
+uint64_t S3BucketReader::readWithoutHeaderLine(char* buf, uint64_t count) {
+    const char* lineEnd = NULL;
+    uint64_t readCount = 0;
+
+    this->eolMatched = 0;
+    while (lineEnd == NULL) {
+        readCount = this->upstreamReader->read(buf, count);
+        // we have reach the end of file but found no matching EOL.
+        if (readCount == 0) {
+            S3WARN("%s", "Reach end of file before matching line terminator");
+            this->partHasLine = false;
+            return 0;
+        }
+
+        lineEnd = this->matchEOL(buf, buf + readCount);
     }
 
+    // move remained data to front.
+    uint64_t remain = buf + readCount - lineEnd;
+    memmove(buf, lineEnd, remain);
+
     return remain;
 }
 
+// Reopen the current part past its end to read the rest of its last line. The
+// tail starts strlen(eolString) bytes before the end, exactly where the next part
+// starts looking for its first line, so both find the same line boundary.
+void S3BucketReader::openLineTail() {
+    const BucketKeyPart& part = this->prefetchWindow.front().part;
+    BucketContent& key = this->keyList.contents[part.keyIndex];
+    uint64_t eolLen = strlen(eolString);
+
+    S3Params tailParams = this->constructReaderParams(key, part.end - eolLen, key.getSize());
+    tailParams.setNumOfChunks(1);
+    tailParams.setChunkSize(std::min(tailParams.getChunkSize(), (uint64_t)S3_LINE_TAIL_CHUNKSIZE));
+
+    this->upstreamReader->close();
+    this->upstreamReader->open(tailParams);
+
+    this->readingLineTail = true;
+    this->lineTailDone = false;
+    this->lineTailSkip = eolLen;
+    this->eolMatched = 0;
+}
+
+uint64_t S3BucketReader::readLineTail(char* buf, uint64_t count) {
+    while (!this->lineTailDone) {
+        uint64_t readCount = this->upstreamReader->read(buf, count);
+        if (readCount == 0) {
+            break;
+        }
+
+        const char* lineEnd = this->matchEOL(buf, buf + readCount);
+        if (lineEnd != NULL) {
+            this->lineTailDone = true;
+        } else {
+            lineEnd = buf + readCount;
+        }
+
+        uint64_t skip = std::min(this->lineTailSkip, (uint64_t)(lineEnd - buf));
+        this->lineTailSkip -= skip;
+
+        uint64_t len = lineEnd - buf - skip;
+        if (len != 0) {
+            memmove(buf, buf + skip, len);
+            return len;
+        }
+    }
+
+    return 0;
+}
+
+void S3BucketReader::fillPrefetchWindow() {
+    S3MemoryContext& memoryContext = const_cast<S3MemoryContext&>(this->params.getMemoryContext());
+
+    while (this->prefetchWindow.size() < this->params.getPrefetchKeys() &&
+           !this->idleReaders.empty() && this->partIndex < this->keyParts.size()) {
+        const BucketKeyPart& part = this->keyParts[this->partIndex];
+
+        // A part in the middle of a key starts strlen(eolString) bytes early, so a
+        // line starting right at its offset is found by skipping one line terminator.
+        uint64_t offset = (part.offset > 0) ? part.offset - strlen(eolString) : 0;
+        S3Params readerParams =
+            constructReaderParams(this->keyList.contents[part.keyIndex], offset, part.end);
+
+        // Keys behind the first one wait until the keys ahead give back enough chunks.
+        uint64_t numOfChunks = readerParams.getNumOfChunks();
+        if (!memoryContext.reserve(numOfChunks)) {
+            S3_CHECK_OR_DIE(!this->prefetchWindow.empty(), S3RuntimeError,
+                            "Not enough memory to read a single key");
+            break;
+        }
+
+        this->partIndex++;
+
+        Reader* reader = this->idleReaders.back();
+        this->idleReaders.pop_back();
+
+        try {
+            reader->open(readerParams);
+        } catch (...) {
+            reader->close();
+            memoryContext.unreserve(numOfChunks);
+            this->idleReaders.push_back(reader);
+            throw;
+        }
+
+        PrefetchedKey key = {reader, part, numOfChunks};
+        this->prefetchWindow.push_back(key);
+    }
+}
+
+void S3BucketReader::finishCurrentKey() {
+    S3MemoryContext& memoryContext = const_cast<S3MemoryContext&>(this->params.getMemoryContext());
+    PrefetchedKey& key = this->prefetchWindow.front();
+
+    key.reader->close();
+    memoryContext.unreserve(key.numOfChunks);
+
+    this->idleReaders.push_back(key.reader);
+    this->prefetchWindow.pop_front();
+    this->upstreamReader = NULL;
+}
+
 uint64_t S3BucketReader::read(char* buf, uint64_t count) {
-    S3_CHECK_OR_DIE(this->upstreamReader != NULL, S3RuntimeError, "upstreamReader is NULL");
+    S3_CHECK_OR_DIE(this->upstreamReader != NULL || !this->idleReaders.empty(), S3RuntimeError,
+                    "upstreamReader is NULL");
     uint64_t readCount = 0;
     while (true) {
         if (this->needNewReader) {
-            if (this->keyIndex >= this->keyList.contents.size()) {
+            this->fillPrefetchWindow();
+            if (this->prefetchWindow.empty()) {
                 S3DEBUG("Read finished for segment: %d", s3ext_segid);
                 return 0;
             }
-            BucketContent& key = this->getNextKey();
 
-            this->upstreamReader->open(constructReaderParams(key));
+            this->upstreamReader = this->prefetchWindow.front().reader;
             this->needNewReader = false;
+            this->partHasLine = true;
+            this->readingLineTail = false;
 
+            // the line running into a part belongs to the part before it, and
             // ignore header line if it is not the first file
-            if (hasHeader && !this->isFirstFile) {
+            if (this->prefetchWindow.front().part.offset > 0 || (hasHeader && !this->isFirstFile)) {
                 readCount = readWithoutHeaderLine(buf, count);
                 if (readCount != 0) {
                     return readCount;
@@ -116,25 +327,43 @@ uint64_t S3BucketReader::read(char* buf, uint64_t count) {
             }
         }
 
-        readCount = this->upstreamReader->read(buf, count);
+        if (this->readingLineTail) {
+            readCount = this->readLineTail(buf, count);
+        } else {
+            readCount = this->upstreamReader->read(buf, count);
+        }
+
         if (readCount != 0) {
             return readCount;
         }
 
+        const BucketKeyPart& part = this->prefetchWindow.front().part;
+        if (!this->readingLineTail && this->partHasLine &&
+            part.end < this->keyList.contents[part.keyIndex].getSize()) {
+            this->openLineTail();
+            continue;
+        }
+
         // Finished one file, continue to next
-        this->upstreamReader->close();
+        this->finishCurrentKey();
         this->needNewReader = true;
         this->isFirstFile = false;
     }
 }
 
 void S3BucketReader::close() {
-    if (this->upstreamReader != NULL) {
-        this->upstreamReader->close();
-        this->upstreamReader = NULL;
+    while (!this->prefetchWindow.empty()) {
+        this->finishCurrentKey();
+    }
+
+    for (uint64_t i = 0; i < this->idleReaders.size(); i++) {
+        this->idleReaders[i]->close();
     }
+    this->idleReaders.clear();
 
     if (!this->keyList.contents.empty()) {
         this->keyList.contents.clear();
     }
-}
\ No newline at end of file
+
+    this->keyParts.clear();
+}
@@ -10,6 +10,14 @@ void S3CommonReader::open(const S3Params &params) {
             this->upstreamReader = &this->decompressReader;
             this->decompressReader.setReader(&this->keyReader);
             break;
+        case S3_COMPRESSION_ZSTD:
+#ifdef HAVE_LIBZSTD
+            this->upstreamReader = &this->zstdDecompressReader;
+            this->zstdDecompressReader.setReader(&this->keyReader);
+            break;
+#else
+            S3_DIE(S3RuntimeError, "zstd compressed file, but gpcloud is built without zstd");
+#endif
         case S3_COMPRESSION_PLAIN:
             this->upstreamReader = &this->keyReader;
             break;
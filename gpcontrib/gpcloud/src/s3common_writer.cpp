@@ -3,12 +3,25 @@
 void S3CommonWriter::open(const S3Params& params) {
     this->keyWriter.setS3InterfaceService(this->s3InterfaceService);
 
-    if (params.isAutoCompress()) {
-        this->upstreamWriter = &this->compressWriter;
-        this->compressWriter.setWriter(&this->keyWriter);
-    } else {
-        this->upstreamWriter = &this->keyWriter;
-    }
+    switch (params.getCompression()) {
+        case S3_COMPRESSION_GZIP:
+            this->upstreamWriter = &this->compressWriter;
+            this->compressWriter.setWriter(&this->keyWriter);
+            break;
+        case S3_COMPRESSION_ZSTD:
+#ifdef HAVE_LIBZSTD
+            this->upstreamWriter = &this->zstdCompressWriter;
+            this->zstdCompressWriter.setWriter(&this->keyWriter);
+            break;
+#else
+            S3_DIE(S3RuntimeError, "zstd compression, but gpcloud is built without zstd");
+#endif
+        case S3_COMPRESSION_PLAIN:
+            this->upstreamWriter = &this->keyWriter;
+            break;
+        default:
+            S3_CHECK_OR_DIE(false, S3RuntimeError, "unknown compression type");
+    };
 
     this->upstreamWriter->open(params);
 }
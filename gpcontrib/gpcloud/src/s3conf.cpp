@@ -100,6 +100,16 @@ S3Params InitConfig(const string& urlWithOptions) {
                                        8 * 1024 * 1024, 128 * 1024 * 1024);
     params.setChunkSize(chunkSize);
 
+    int64_t prefetchKeys = s3Cfg.SafeScan("prefetch_keys", configSection, 1, 1, 64);
+    params.setPrefetchKeys(prefetchKeys);
+
+    // 0 disables splitting, otherwise a part is never smaller than the minimal chunk size.
+    int64_t splitSize = s3Cfg.SafeScan("split_size", configSection, 0, 0, INT64_MAX);
+    if (splitSize > 0) {
+        splitSize = std::max(splitSize, (int64_t)(8 * 1024 * 1024));
+    }
+    params.setSplitSize(splitSize);
+
     int64_t lowSpeedLimit = s3Cfg.SafeScan("low_speed_limit", configSection, 10240, 0, INT_MAX);
     params.setLowSpeedLimit(lowSpeedLimit);
 
@@ -110,6 +120,22 @@ S3Params InitConfig(const string& urlWithOptions) {
 
     params.setAutoCompress(s3Cfg.GetBool(configSection, "autocompress", "true"));
 
+    // 'compression' picks the codec for writing, it overrides 'autocompress' when set.
+    string compression = s3Cfg.Get(configSection, "compression", "");
+    if (compression == "gzip") {
+        params.setCompression(S3_COMPRESSION_GZIP);
+    } else if (compression == "zstd") {
+#ifndef HAVE_LIBZSTD
+        S3_CHECK_OR_DIE(false, S3ConfigError,
+                        "\"FATAL: compression zstd is not supported by this build\"", "compression");
+#endif
+        params.setCompression(S3_COMPRESSION_ZSTD);
+    } else if (compression == "none") {
+        params.setCompression(S3_COMPRESSION_PLAIN);
+    } else if (!compression.empty()) {
+        S3_CHECK_OR_DIE(false, S3ConfigError, "\"FATAL: compression is invalid\"", "compression");
+    }
+
     params.setVerifyCert(s3Cfg.GetBool(configSection, "verifycert", "true"));
 
     string sse_type = s3Cfg.Get(configSection, "server_side_encryption", "");
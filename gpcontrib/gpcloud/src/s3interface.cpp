@@ -353,6 +353,13 @@ uint64_t S3InterfaceService::fetchData(uint64_t offset, S3VectorUInt8 &data, uin
 }
 
 S3CompressionType S3InterfaceService::checkCompressionType(const S3Url &s3Url) {
+    // Keys written with 'compression = zstd' are named after their codec, no need to probe them.
+    const string &key = s3Url.getPrefix();
+    if (key.size() > strlen(S3_ZSTD_EXTENSION) &&
+        key.compare(key.size() - strlen(S3_ZSTD_EXTENSION), string::npos, S3_ZSTD_EXTENSION) == 0) {
+        return S3_COMPRESSION_ZSTD;
+    }
+
     HTTPHeaders headers;
 
     char rangeBuf[S3_RANGE_HEADER_STRING_LEN] = {0};
@@ -381,6 +388,12 @@ S3CompressionType S3InterfaceService::checkCompressionType(const S3Url &s3Url) {
         if ((responseData[0] == 0x1f) && (responseData[1] == 0x8b)) {
             return S3_COMPRESSION_GZIP;
         }
+
+        // zstd frame magic number 0xFD2FB528, little-endian
+        if ((responseData[0] == 0x28) && (responseData[1] == 0xb5) && (responseData[2] == 0x2f) &&
+            (responseData[3] == 0xfd)) {
+            return S3_COMPRESSION_ZSTD;
+        }
     } else if (resp.getStatus() == RESPONSE_ERROR) {
         S3MessageParser s3msg(resp);
         S3_DIE(S3LogicError, s3msg.getCode(), s3msg.getMessage());
@@ -189,8 +189,13 @@ void S3KeyReader::open(const S3Params& params) {
     this->numOfChunks = params.getNumOfChunks();
     S3_CHECK_OR_DIE(this->numOfChunks > 0, S3RuntimeError, "numOfChunks must not be zero");
 
-    this->offsetMgr.setKeySize(params.getKeySize());
+    // OffsetMgr hands out chunks between the range offset and end, as if the key ended there.
+    this->offsetMgr.setKeySize(params.getKeyEnd());
     this->offsetMgr.setChunkSize(params.getChunkSize());
+    this->offsetMgr.setCurPos(params.getKeyOffset());
+
+    this->rangeSize = params.getKeyEnd() - params.getKeyOffset();
+    this->rangeReachesKeyEnd = (params.getKeyEnd() == params.getKeySize());
 
     S3_CHECK_OR_DIE(params.getChunkSize() > 0, S3RuntimeError,
                     "chunk size must be greater than zero");
@@ -211,13 +216,14 @@ void S3KeyReader::open(const S3Params& params) {
 }
 
 uint64_t S3KeyReader::read(char* buf, uint64_t count) {
-    uint64_t fileLen = this->offsetMgr.getKeySize();
+    uint64_t fileLen = this->rangeSize;
     uint64_t readLen = 0;
 
     do {
         // confirm there is no more available data, done with this file
         if (this->transferredKeyLen >= fileLen) {
-            if (!this->hasEol && !this->eolAppended) {
+            // a range ending inside the key is not the end of the last line
+            if (this->rangeReachesKeyEnd && !this->hasEol && !this->eolAppended) {
                 uint64_t eolLen = strlen(eolString);
                 strncpy(buf, eolString, eolLen);
 
@@ -264,6 +270,8 @@ void S3KeyReader::reset() {
     this->sharedError = false;
     this->curReadingChunk = 0;
     this->transferredKeyLen = 0;
+    this->rangeSize = 0;
+    this->rangeReachesKeyEnd = true;
 
     this->offsetMgr.reset();
 
@@ -0,0 +1,94 @@
+#include "zstd_compress_writer.h"
+
+#ifdef HAVE_LIBZSTD
+
+ZstdCompressWriter::ZstdCompressWriter() : writer(NULL), cstream(NULL), isClosed(true) {
+    this->out = new char[S3_ZIP_COMPRESS_CHUNKSIZE];
+}
+
+ZstdCompressWriter::~ZstdCompressWriter() {
+    try {
+        this->close();
+    } catch (...) {
+    }
+    if (this->cstream != NULL) {
+        ZSTD_freeCStream(this->cstream);
+    }
+    delete[] this->out;
+}
+
+void ZstdCompressWriter::open(const S3Params& params) {
+    this->cstream = ZSTD_createCStream();
+    S3_CHECK_OR_DIE(this->cstream != NULL, S3RuntimeError, "failed to create zstd stream");
+
+    size_t ret = ZSTD_initCStream(this->cstream, S3_ZSTD_COMPRESSION_LEVEL);
+    if (ZSTD_isError(ret)) {
+        ZSTD_freeCStream(this->cstream);
+        this->cstream = NULL;
+        S3_DIE(S3RuntimeError,
+               string("failed to initialize zstd library: ") + ZSTD_getErrorName(ret));
+    }
+
+    this->isClosed = false;
+
+    this->writer->open(params);
+}
+
+uint64_t ZstdCompressWriter::write(const char* buf, uint64_t count) {
+    // Defensive code
+    if (buf == NULL || count == 0) {
+        return 0;
+    }
+
+    ZSTD_inBuffer input = {buf, count, 0};
+
+    // Incompressible data may take more than one output buffer, loop until all input is consumed.
+    while (input.pos < input.size) {
+        ZSTD_outBuffer output = {this->out, S3_ZIP_COMPRESS_CHUNKSIZE, 0};
+
+        size_t ret = ZSTD_compressStream(this->cstream, &output, &input);
+        S3_CHECK_OR_DIE(!ZSTD_isError(ret), S3RuntimeError,
+                        string("Failed to compress data: ") + ZSTD_getErrorName(ret));
+
+        if (output.pos > 0) {
+            this->writer->write(this->out, output.pos);
+        }
+    }
+
+    return count;
+}
+
+void ZstdCompressWriter::close() {
+    if (this->isClosed) {
+        return;
+    }
+
+    // Mark it closed first, a failure below must not be retried from the destructor.
+    this->isClosed = true;
+
+    size_t remaining;
+    do {
+        ZSTD_outBuffer output = {this->out, S3_ZIP_COMPRESS_CHUNKSIZE, 0};
+
+        remaining = ZSTD_endStream(this->cstream, &output);
+        S3_CHECK_OR_DIE(!ZSTD_isError(remaining), S3RuntimeError,
+                        string("Failed to compress data: ") + ZSTD_getErrorName(remaining));
+
+        if (output.pos > 0) {
+            this->writer->write(this->out, output.pos);
+        }
+    } while (remaining > 0);
+
+    ZSTD_freeCStream(this->cstream);
+    this->cstream = NULL;
+
+    S3DEBUG("Compression finished: end of zstd frame.");
+
+    this->writer->close();
+}
+
+void ZstdCompressWriter::setWriter(Writer* writer) {
+    this->writer = writer;
+}
+
+#endif /* HAVE_LIBZSTD */
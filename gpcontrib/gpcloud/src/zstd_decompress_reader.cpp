@@ -0,0 +1,97 @@
+#include "zstd_decompress_reader.h"
+
+#ifdef HAVE_LIBZSTD
+
+ZstdDecompressReader::ZstdDecompressReader()
+    : reader(NULL),
+      dstream(NULL),
+      readerEOF(false),
+      framePending(0),
+      compressedBytes(0),
+      isClosed(true) {
+    this->in = new char[S3_ZIP_DECOMPRESS_CHUNKSIZE];
+    this->input.src = this->in;
+    this->input.size = 0;
+    this->input.pos = 0;
+}
+
+ZstdDecompressReader::~ZstdDecompressReader() {
+    this->close();
+
+    delete[] this->in;
+}
+
+void ZstdDecompressReader::setReader(Reader *reader) {
+    this->reader = reader;
+}
+
+void ZstdDecompressReader::open(const S3Params &params) {
+    this->dstream = ZSTD_createDStream();
+    S3_CHECK_OR_DIE(this->dstream != NULL, S3RuntimeError, "failed to create zstd stream");
+
+    size_t ret = ZSTD_initDStream(this->dstream);
+    if (ZSTD_isError(ret)) {
+        ZSTD_freeDStream(this->dstream);
+        this->dstream = NULL;
+        S3_DIE(S3RuntimeError,
+               string("failed to initialize zstd library: ") + ZSTD_getErrorName(ret));
+    }
+
+    this->input.src = this->in;
+    this->input.size = 0;
+    this->input.pos = 0;
+    this->readerEOF = false;
+    this->framePending = 0;
+    this->compressedBytes = 0;
+
+    this->isClosed = false;
+
+    this->reader->open(params);
+}
+
+uint64_t ZstdDecompressReader::read(char *buf, uint64_t count) {
+    ZSTD_outBuffer output = {buf, count, 0};
+
+    while (output.pos == 0) {
+        if ((this->input.pos == this->input.size) && !this->readerEOF) {
+            uint64_t hasRead = this->reader->read(this->in, S3_ZIP_DECOMPRESS_CHUNKSIZE);
+            this->readerEOF = (hasRead == 0);
+            this->input.size = hasRead;
+            this->input.pos = 0;
+            this->compressedBytes += hasRead;
+        }
+
+        // Also called with no more input: zstd may still hold decoded data it could not return
+        // to a full output buffer last time.
+        size_t inPos = this->input.pos;
+        size_t ret = ZSTD_decompressStream(this->dstream, &output, &this->input);
+        S3_CHECK_OR_DIE(!ZSTD_isError(ret), S3RuntimeError,
+                        string("Failed to decompress data: ") + ZSTD_getErrorName(ret));
+
+        // A call without progress only hints at the header of a next frame, ignore it.
+        if ((this->input.pos > inPos) || (output.pos > 0)) {
+            this->framePending = ret;
+        }
+
+        if (this->readerEOF && (output.pos == 0)) {
+            // An empty key is an empty stream, anything else must end with a complete frame.
+            S3_CHECK_OR_DIE((this->framePending == 0) || (this->compressedBytes == 0), S3RuntimeError,
+                            "Failed to decompress data: zstd stream is truncated");
+            S3DEBUG("Decompression finished: end of zstd stream.");
+            break;
+        }
+    }
+
+    return output.pos;
+}
+
+void ZstdDecompressReader::close() {
+    if (!this->isClosed) {
+        ZSTD_freeDStream(this->dstream);
+        this->dstream = NULL;
+        this->reader->close();
+        this->isClosed = true;
+    }
+}
+
+#endif /* HAVE_LIBZSTD */
@@ -45,6 +45,7 @@ class S3BucketReaderTest : public testing::Test {
 
     MockS3Interface s3Interface;
     MockS3Reader s3Reader;
+    MockS3Reader anotherReader;
 };
 
 TEST_F(S3BucketReaderTest, OpenURL) {
@@ -169,6 +170,214 @@ TEST_F(S3BucketReaderTest, UpstreamReaderThrowException) {
     EXPECT_THROW(bucketReader->read(buf, sizeof(buf)), S3RuntimeError);
 }
 
+TEST_F(S3BucketReaderTest, ReadBucketWithPrefetchWindow) {
+    ListBucketResult result;
+    result.contents.emplace_back("foo", 456);
+    result.contents.emplace_back("bar", 200);
+    result.contents.emplace_back("baz", 100);
+
+    S3Params params("https://s3-us-east-2.amazonaws.com/s3test.pivotal.io/whatever");
+    params.setPrefetchKeys(2);
+
+    EXPECT_CALL(s3Interface, listBucket(_)).Times(1).WillOnce(Return(result));
+
+    // "foo" and "bar" are opened together, "baz" reuses the reader of "foo".
+    EXPECT_CALL(anotherReader, open(_)).Times(2);
+    EXPECT_CALL(anotherReader, read(_, _))
+        .Times(4)
+        .WillOnce(Return(256))
+        .WillOnce(Return(0))
+        .WillOnce(Return(100))
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(s3Reader, open(_)).Times(1);
+    EXPECT_CALL(s3Reader, read(_, _)).Times(2).WillOnce(Return(200)).WillOnce(Return(0));
+
+    s3ext_segid = 0;
+    s3ext_segnum = 1;
+
+    bucketReader->open(params);
+    bucketReader->setUpstreamReader(&s3Reader);
+    bucketReader->addUpstreamReader(&anotherReader);
+
+    EXPECT_EQ((uint64_t)256, bucketReader->read(buf, sizeof(buf)));
+    EXPECT_EQ((uint64_t)200, bucketReader->read(buf, sizeof(buf)));
+    EXPECT_EQ((uint64_t)100, bucketReader->read(buf, sizeof(buf)));
+    EXPECT_EQ((uint64_t)0, bucketReader->read(buf, sizeof(buf)));
+}
+
+TEST_F(S3BucketReaderTest, PrefetchWindowIsLimitedByMemory) {
+    ListBucketResult result;
+    result.contents.emplace_back("foo", 2048);
+    result.contents.emplace_back("bar", 100);
+
+    S3Params params("https://s3-us-east-2.amazonaws.com/s3test.pivotal.io/whatever");
+    params.setChunkSize(1024);
+    params.setNumOfChunks(2);
+    params.setPrefetchKeys(2);
+    PrepareS3MemContext(params);
+
+    EXPECT_CALL(s3Interface, listBucket(_)).Times(1).WillOnce(Return(result));
+
+    // "foo" takes all chunks, so "bar" is not opened until "foo" is done.
+    EXPECT_CALL(anotherReader, open(_)).Times(2);
+    EXPECT_CALL(anotherReader, read(_, _))
+        .Times(4)
+        .WillOnce(Return(64))
+        .WillOnce(Return(0))
+        .WillOnce(Return(32))
+        .WillOnce(Return(0));
+
+    EXPECT_CALL(s3Reader, open(_)).Times(0);
+
+    s3ext_segid = 0;
+    s3ext_segnum = 1;
+
+    bucketReader->open(params);
+    bucketReader->setUpstreamReader(&s3Reader);
+    bucketReader->addUpstreamReader(&anotherReader);
+
+    EXPECT_EQ((uint64_t)64, bucketReader->read(buf, sizeof(buf)));
+    EXPECT_EQ((uint64_t)32, bucketReader->read(buf, sizeof(buf)));
+    EXPECT_EQ((uint64_t)0, bucketReader->read(buf, sizeof(buf)));
+}
+
+TEST_F(S3BucketReaderTest, AssignKeysBySize) {
+    ListBucketResult result;
+    result.contents.emplace_back("k0", 10);
+    result.contents.emplace_back("k1", 100);
+    result.contents.emplace_back("k2", 20);
+    result.contents.emplace_back("k3", 70);
+    result.contents.emplace_back("k4", 30);
+
+    S3Params params("https://s3-us-east-2.amazonaws.com/s3test.pivotal.io/whatever");
+
+    EXPECT_CALL(s3Interface, listBucket(_)).Times(2).WillRepeatedly(Return(result));
+
+    s3ext_segnum = 2;
+
+    // 100 and 20 go to segment 0, 70, 30 and 10 to segment 1.
+    s3ext_segid = 0;
+    bucketReader->open(params);
+    const vector<BucketKeyPart>& parts = bucketReader->getKeyParts();
+    ASSERT_EQ((uint64_t)2, parts.size());
+    EXPECT_EQ((uint64_t)1, parts[0].keyIndex);
+    EXPECT_EQ((uint64_t)2, parts[1].keyIndex);
+
+    s3ext_segid = 1;
+    bucketReader->open(params);
+    ASSERT_EQ((uint64_t)3, parts.size());
+    EXPECT_EQ((uint64_t)0, parts[0].keyIndex);
+    EXPECT_EQ((uint64_t)3, parts[1].keyIndex);
+    EXPECT_EQ((uint64_t)4, parts[2].keyIndex);
+}
+
+// Serves the requested range of a key held in memory.
+class MockRangeReader : public Reader {
+   public:
+    MockRangeReader(const string& data) : data(data), pos(0), end(0) {
+    }
+
+    void open(const S3Params& params) {
+        pos = params.getKeyOffset();
+        end = params.getKeyEnd();
+    }
+
+    uint64_t read(char* buf, uint64_t count) {
+        uint64_t len = std::min(count, end - pos);
+        memcpy(buf, data.data() + pos, len);
+        pos += len;
+        return len;
+    }
+
+    void close() {
+    }
+
+   private:
+    string data;
+    uint64_t pos;
+    uint64_t end;
+};
+
+static void ReadSplitKey(MockS3Interface& s3Interface, const string& data, const string& eol) {
+    strcpy(eolString, eol.c_str());
+
+    ListBucketResult result;
+    result.contents.emplace_back("foo", data.size());
+
+    EXPECT_CALL(s3Interface, listBucket(_)).WillRepeatedly(Return(result));
+    EXPECT_CALL(s3Interface, checkCompressionType(_)).WillRepeatedly(Return(S3_COMPRESSION_PLAIN));
+
+    S3Params params("https://s3-us-east-2.amazonaws.com/s3test.pivotal.io/whatever");
+    params.setSplitSize(7);
+
+    // Each segment reads whole lines, and together they read every line once.
+    string allData;
+    s3ext_segnum = 3;
+    for (s3ext_segid = 0; s3ext_segid < s3ext_segnum; s3ext_segid++) {
+        MockRangeReader rangeReader(data);
+        S3BucketReader bucketReader;
+        bucketReader.setS3InterfaceService(&s3Interface);
+        bucketReader.setUpstreamReader(&rangeReader);
+        bucketReader.open(params);
+
+        string segmentData;
+        char buf[5];
+        uint64_t len;
+        while ((len = bucketReader.read(buf, sizeof(buf))) != 0) {
+            segmentData.append(buf, len);
+        }
+
+        if (!segmentData.empty()) {
+            EXPECT_EQ(eol, segmentData.substr(segmentData.size() - eol.size()));
+        }
+        allData += segmentData;
+    }
+
+    EXPECT_EQ(data.size(), allData.size());
+
+    vector<string> lines, allLines;
+    for (size_t pos = 0, next; pos < data.size(); pos = next + eol.size()) {
+        next = data.find(eol, pos);
+        lines.push_back(data.substr(pos, next - pos));
+    }
+    for (size_t pos = 0, next; pos < allData.size(); pos = next + eol.size()) {
+        next = allData.find(eol, pos);
+        allLines.push_back(allData.substr(pos, next - pos));
+    }
+    std::sort(lines.begin(), lines.end());
+    std::sort(allLines.begin(), allLines.end());
+    EXPECT_EQ(lines, allLines);
+}
+
+TEST_F(S3BucketReaderTest, ReadSplitKeyByLines) {
+    ReadSplitKey(s3Interface, "a\nbbbbbbbbbbbbbb\ncc\nd\neeeeee\nfffffff\ng\nhh\niiiiii\n", "\n");
+}
+
+TEST_F(S3BucketReaderTest, ReadSplitKeyByLinesWithCRLF) {
+    ReadSplitKey(s3Interface, "a\r\nbbbbb\r\ncc\r\nd\r\neeeeee\r\nfff\rf\r\ng\r\nhh\r\nii\r\n", "\r\n");
+}
+
+TEST_F(S3BucketReaderTest, CompressedKeyIsNotSplit) {
+    ListBucketResult result;
+    result.contents.emplace_back("foo", 100);
+
+    S3Params params("https://s3-us-east-2.amazonaws.com/s3test.pivotal.io/whatever");
+    params.setSplitSize(10);
+
+    EXPECT_CALL(s3Interface, listBucket(_)).Times(1).WillOnce(Return(result));
+    EXPECT_CALL(s3Interface, checkCompressionType(_)).WillOnce(Return(S3_COMPRESSION_GZIP));
+
+    s3ext_segid = 0;
+    s3ext_segnum = 4;
+    bucketReader->open(params);
+
+    const vector<BucketKeyPart>& parts = bucketReader->getKeyParts();
+    ASSERT_EQ((uint64_t)1, parts.size());
+    EXPECT_EQ((uint64_t)0, parts[0].offset);
+    EXPECT_EQ((uint64_t)100, parts[0].end);
+}
+
 class MockRead {
    public:
     MockRead(const char* ptr) : p(ptr) {
@@ -61,6 +61,21 @@ TEST_F(S3CommonReaderTest, OpenPlain) {
     ASSERT_TRUE(NULL != dynamic_cast<S3KeyReader *>(this->upstreamReader));
 }
 
+TEST_F(S3CommonReaderTest, OpenZstd) {
+    EXPECT_CALL(mockS3Interface, checkCompressionType(_)).WillOnce(Return(S3_COMPRESSION_ZSTD));
+    S3Params params("s3://abc/def.zst");
+    params.setNumOfChunks(1);
+    params.setChunkSize(1024 * 1024 * 2);
+
+#ifdef HAVE_LIBZSTD
+    this->open(params);
+
+    ASSERT_EQ(this->upstreamReader, &this->zstdDecompressReader);
+#else
+    EXPECT_THROW(this->open(params), S3RuntimeError);
+#endif
+}
+
 TEST_F(S3CommonReaderTest, ReadGZip) {
     Byte compressionBuff[0x100];
     uLong compressedLen = sizeof(compressionBuff);
@@ -19,6 +19,8 @@ TEST(Config, Basic) {
 
     EXPECT_EQ((uint64_t)6, params.getNumOfChunks());
     EXPECT_EQ((uint64_t)(64 * 1024 * 1024 + 1), params.getChunkSize());
+    EXPECT_EQ((uint64_t)4, params.getPrefetchKeys());
+    EXPECT_EQ((uint64_t)(8 * 1024 * 1024), params.getSplitSize());
 
     EXPECT_EQ(EXT_INFO, s3ext_loglevel);
     EXPECT_EQ(STDERR_LOG, s3ext_logtype);
@@ -34,6 +36,7 @@ TEST(Config, Basic) {
     EXPECT_EQ("", params.getProxy());
 
     EXPECT_TRUE(params.isAutoCompress());
+    EXPECT_EQ(S3_COMPRESSION_GZIP, params.getCompression());
     EXPECT_TRUE(params.isVerifyCert());
 
     EXPECT_EQ(SSE_S3, params.getSSEType());
@@ -46,6 +49,8 @@ TEST(Config, SpecialSectionValues) {
 
     EXPECT_EQ((uint64_t)8, params.getNumOfChunks());
     EXPECT_EQ((uint64_t)(128 * 1024 * 1024), params.getChunkSize());
+    EXPECT_EQ((uint64_t)64, params.getPrefetchKeys());
+    EXPECT_EQ((uint64_t)(1024 * 1024 * 1024), params.getSplitSize());
 
     EXPECT_EQ((uint64_t)10240, params.getLowSpeedLimit());
     EXPECT_EQ((uint64_t)60, params.getLowSpeedTime());
@@ -59,6 +64,8 @@ TEST(Config, SpecialSectionLowValues) {
 
     EXPECT_EQ((uint64_t)1, params.getNumOfChunks());
     EXPECT_EQ((uint64_t)(8 * 1024 * 1024), params.getChunkSize());
+    EXPECT_EQ((uint64_t)1, params.getPrefetchKeys());
+    EXPECT_EQ((uint64_t)0, params.getSplitSize());
 }
 
 TEST(Config, SpecialSectionWrongKeyName) {
@@ -66,6 +73,7 @@ TEST(Config, SpecialSectionWrongKeyName) {
 
     EXPECT_EQ((uint64_t)4, params.getNumOfChunks());
     EXPECT_EQ((uint64_t)(64 * 1024 * 1024), params.getChunkSize());
+    EXPECT_EQ((uint64_t)1, params.getPrefetchKeys());
 }
 
 TEST(Config, SpecialSwitches) {
@@ -73,6 +81,19 @@ TEST(Config, SpecialSwitches) {
 
     EXPECT_TRUE(params.isDebugCurl());
     EXPECT_FALSE(params.isAutoCompress());
+    EXPECT_EQ(S3_COMPRESSION_PLAIN, params.getCompression());
+}
+
+TEST(Config, CompressionOverridesAutoCompress) {
+    S3Params params = InitConfig("s3://abc/a config=data/s3test.conf section=special_compression");
+
+    EXPECT_TRUE(params.isAutoCompress());
+    EXPECT_EQ(S3_COMPRESSION_GZIP, params.getCompression());
+}
+
+TEST(Config, WrongCompression) {
+    EXPECT_THROW(InitConfig("s3://abc/a config=data/s3test.conf section=wrong_compression"),
+                 S3ConfigError);
 }
 
 TEST(Config, SectionExist) {
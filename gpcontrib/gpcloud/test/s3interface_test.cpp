@@ -409,6 +409,27 @@ TEST_F(S3InterfaceServiceTest, checkItsGzipCompressed) {
     EXPECT_EQ(S3_COMPRESSION_GZIP, this->checkCompressionType(s3Url));
 }
 
+TEST_F(S3InterfaceServiceTest, checkItsZstdCompressed) {
+    vector<uint8_t> raw;
+    raw.resize(4);
+    raw[0] = 0x28;
+    raw[1] = 0xb5;
+    raw[2] = 0x2f;
+    raw[3] = 0xfd;
+    Response response(RESPONSE_OK, raw);
+    EXPECT_CALL(mockRESTfulService, get(_, _)).WillOnce(Return(response));
+
+    S3Url s3Url("https://s3-us-west-2.amazonaws.com/s3test.pivotal.io/whatever");
+    EXPECT_EQ(S3_COMPRESSION_ZSTD, this->checkCompressionType(s3Url));
+}
+
+TEST_F(S3InterfaceServiceTest, checkItsZstdCompressedByExtension) {
+    EXPECT_CALL(mockRESTfulService, get(_, _)).Times(0);
+
+    S3Url s3Url("https://s3-us-west-2.amazonaws.com/s3test.pivotal.io/dir/data0_1.csv.zst");
+    EXPECT_EQ(S3_COMPRESSION_ZSTD, this->checkCompressionType(s3Url));
+}
+
 TEST_F(S3InterfaceServiceTest, checkItsNotCompressed) {
     vector<uint8_t> raw;
     raw.resize(4);
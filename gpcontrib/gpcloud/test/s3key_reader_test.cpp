@@ -460,6 +460,28 @@ TEST_F(S3KeyReaderTest, ReadWithKeyLargerThanChunkSize) {
     EXPECT_EQ((uint64_t)0, this->read(buffer, 255));
 }
 
+TEST_F(S3KeyReaderTest, ReadWithKeyRange) {
+    S3Params params("s3://abc/def");
+
+    params.setNumOfChunks(1);
+
+    params.setKeySize(1024);
+    params.setKeyRange(300, 700);
+    params.setChunkSize(255);
+
+    EXPECT_CALL(s3Interface, fetchData(300, _, 255, _))
+        .WillOnce(Invoke(MockFetchData(255, 255)));
+    EXPECT_CALL(s3Interface, fetchData(555, _, 145, _))
+        .WillOnce(Invoke(MockFetchData(145, 255)));
+
+    this->open(params);
+
+    // no line terminator is appended, the range ends in the middle of the key
+    EXPECT_EQ((uint64_t)255, this->read(buffer, 255));
+    EXPECT_EQ((uint64_t)145, this->read(buffer, 255));
+    EXPECT_EQ((uint64_t)0, this->read(buffer, 255));
+}
+
 TEST_F(S3KeyReaderTest, ReadWithSameKeyChunkReadSize) {
     S3Params params("s3://abc/def");
 
@@ -0,0 +1,114 @@
+#include "zstd_compress_writer.cpp"
+#include <random>
+#include "gtest/gtest.h"
+
+#ifdef HAVE_LIBZSTD
+
+class MockZstdWriter : public Writer {
+   public:
+    MockZstdWriter() : closed(false) {
+    }
+
+    virtual void open(const S3Params &params) {
+    }
+
+    virtual uint64_t write(const char *buf, uint64_t count) {
+        this->data.insert(this->data.end(), buf, buf + count);
+        return count;
+    }
+
+    virtual void close() {
+        this->closed = true;
+    }
+
+    vector<char> data;
+    bool closed;
+};
+
+class ZstdCompressWriterTest : public testing::Test {
+   protected:
+    virtual void SetUp() {
+        zstdWriter.setWriter(&writer);
+        zstdWriter.open(S3Params("s3://abc/def/"));
+    }
+
+    virtual void TearDown() {
+        zstdWriter.close();
+    }
+
+    string decompress() {
+        string result;
+
+        ZSTD_DStream *dstream = ZSTD_createDStream();
+        ZSTD_initDStream(dstream);
+
+        ZSTD_inBuffer input = {writer.data.data(), writer.data.size(), 0};
+        vector<char> buf(ZSTD_DStreamOutSize());
+        size_t ret = 0;
+        do {
+            ZSTD_outBuffer output = {buf.data(), buf.size(), 0};
+            ret = ZSTD_decompressStream(dstream, &output, &input);
+            EXPECT_FALSE(ZSTD_isError(ret));
+            result.append(buf.data(), output.pos);
+        } while (!ZSTD_isError(ret) && (input.pos < input.size || ret > 0));
+
+        ZSTD_freeDStream(dstream);
+        return result;
+    }
+
+    ZstdCompressWriter zstdWriter;
+    MockZstdWriter writer;
+};
+
+TEST_F(ZstdCompressWriterTest, AbleToInputNull) {
+    EXPECT_EQ(0, zstdWriter.write(NULL, 0));
+}
+
+TEST_F(ZstdCompressWriterTest, AbleToCompressEmptyData) {
+    zstdWriter.close();
+
+    EXPECT_TRUE(writer.closed);
+    EXPECT_EQ(string(""), decompress());
+}
+
+TEST_F(ZstdCompressWriterTest, AbleToCompressAndCheckZstdMagic) {
+    const char input[] = "The quick brown fox jumps over the lazy dog";
+    zstdWriter.write(input, sizeof(input) - 1);
+    zstdWriter.close();
+
+    ASSERT_LE(4, writer.data.size());
+    EXPECT_EQ((char)0x28, writer.data[0]);
+    EXPECT_EQ((char)0xb5, writer.data[1]);
+    EXPECT_EQ((char)0x2f, writer.data[2]);
+    EXPECT_EQ((char)0xfd, writer.data[3]);
+    EXPECT_EQ(string(input), decompress());
+}
+
+TEST_F(ZstdCompressWriterTest, CloseMultipleTimes) {
+    const char input[] = "The quick brown fox jumps over the lazy dog";
+    zstdWriter.write(input, sizeof(input) - 1);
+
+    zstdWriter.close();
+    size_t size = writer.data.size();
+    zstdWriter.close();
+
+    EXPECT_EQ(size, writer.data.size());
+    EXPECT_EQ(string(input), decompress());
+}
+
+TEST_F(ZstdCompressWriterTest, AbleToWriteLargerThanCompressChunkSize) {
+    // random data does not compress, so the output takes several buffers.
+    string input(S3_ZIP_COMPRESS_CHUNKSIZE * 2 + 1, '\0');
+    std::mt19937 generator(1);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (char)generator();
+    }
+
+    zstdWriter.write(input.data(), input.size());
+    zstdWriter.write(input.data(), 1);
+    zstdWriter.close();
+
+    EXPECT_EQ(input + input[0], decompress());
+}
+
+#endif /* HAVE_LIBZSTD */
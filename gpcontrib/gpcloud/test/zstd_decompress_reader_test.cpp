@@ -0,0 +1,135 @@
+#include "zstd_decompress_reader.cpp"
+#include "gtest/gtest.h"
+
+#ifdef HAVE_LIBZSTD
+
+class MockZstdBufferReader : public Reader {
+   public:
+    MockZstdBufferReader() : offset(0), chunkSize(UINT64_MAX) {
+    }
+
+    void open(const S3Params &params) {
+    }
+    void close() {
+    }
+
+    void setData(const void *input, uint64_t size) {
+        const char *p = static_cast<const char *>(input);
+
+        this->data.assign(p, p + size);
+        this->offset = 0;
+    }
+
+    uint64_t read(char *buf, uint64_t count) {
+        uint64_t size = std::min(std::min(this->data.size() - this->offset, count), this->chunkSize);
+        memcpy(buf, this->data.data() + this->offset, size);
+
+        this->offset += size;
+        return size;
+    }
+
+    void setChunkSize(uint64_t size) {
+        this->chunkSize = size;
+    }
+
+   private:
+    std::vector<char> data;
+    uint64_t offset;
+    uint64_t chunkSize;
+};
+
+class ZstdDecompressReaderTest : public testing::Test {
+   protected:
+    virtual void SetUp() {
+        zstdReader.setReader(&bufReader);
+        zstdReader.open(params);
+    }
+
+    virtual void TearDown() {
+        zstdReader.close();
+    }
+
+    void setBufReaderByRawData(const void *input, uint64_t len) {
+        size_t bound = ZSTD_compressBound(len);
+        vector<char> compressed(bound);
+
+        size_t size = ZSTD_compress(compressed.data(), bound, input, len, 1);
+        ASSERT_FALSE(ZSTD_isError(size));
+
+        bufReader.setData(compressed.data(), size);
+    }
+
+    string readAll(uint64_t bufSize) {
+        string result;
+        vector<char> buf(bufSize);
+
+        uint64_t count;
+        while ((count = zstdReader.read(buf.data(), bufSize)) > 0) {
+            result.append(buf.data(), count);
+        }
+        return result;
+    }
+
+    S3Params params;
+    ZstdDecompressReader zstdReader;
+    MockZstdBufferReader bufReader;
+};
+
+TEST_F(ZstdDecompressReaderTest, AbleToDecompressEmptyData) {
+    bufReader.setData(NULL, 0);
+
+    char buf[16];
+    EXPECT_EQ(0, zstdReader.read(buf, sizeof(buf)));
+    EXPECT_EQ(0, zstdReader.read(buf, sizeof(buf)));
+}
+
+TEST_F(ZstdDecompressReaderTest, AbleToDecompressSmallCompressedData) {
+    const char hello[] = "The quick brown fox jumps over the lazy dog";
+    setBufReaderByRawData(hello, sizeof(hello) - 1);
+
+    EXPECT_EQ(string(hello), readAll(1024));
+}
+
+TEST_F(ZstdDecompressReaderTest, AbleToDecompressWithSmallReadBufferAndFragmentalInput) {
+    string input;
+    for (int i = 0; i < 100000; i++) {
+        input += std::to_string((unsigned long long)i) + "\n";
+    }
+    setBufReaderByRawData(input.data(), input.size());
+    bufReader.setChunkSize(7);
+
+    EXPECT_EQ(input, readAll(13));
+}
+
+TEST_F(ZstdDecompressReaderTest, AbleToDecompressConcatenatedFrames) {
+    const char first[] = "first frame\n";
+    const char second[] = "second frame\n";
+    char compressed[256];
+
+    size_t size1 = ZSTD_compress(compressed, sizeof(compressed), first, sizeof(first) - 1, 1);
+    size_t size2 = ZSTD_compress(compressed + size1, sizeof(compressed) - size1, second,
+                                 sizeof(second) - 1, 1);
+    bufReader.setData(compressed, size1 + size2);
+
+    EXPECT_EQ(string(first) + second, readAll(1024));
+}
+
+TEST_F(ZstdDecompressReaderTest, AbleToDetectTruncatedStream) {
+    string input(1024 * 1024, 'x');
+    size_t bound = ZSTD_compressBound(input.size());
+    vector<char> compressed(bound);
+
+    size_t size = ZSTD_compress(compressed.data(), bound, input.data(), input.size(), 1);
+    bufReader.setData(compressed.data(), size - 1);
+
+    EXPECT_THROW(readAll(input.size()), S3RuntimeError);
+}
+
+TEST_F(ZstdDecompressReaderTest, AbleToDecompressWithIncorrectEncodedStream) {
+    const char garbage[] = "this is not a zstd stream";
+    bufReader.setData(garbage, sizeof(garbage) - 1);
+
+    EXPECT_THROW(readAll(1024), S3RuntimeError);
+}
+
+#endif /* HAVE_LIBZSTD */
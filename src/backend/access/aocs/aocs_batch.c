@@ -0,0 +1,283 @@
+/*--------------------------------------------------------------------------
+ *
+ * aocs_batch.c
+ *	  Evaluation of simple scan quals over batches of column values.
+ *
+ * An append-only columnar scan reads each column from its own datum stream,
+ * so nothing forces it to produce a whole row at a time.  When a sequential
+ * scan's quals include simple "column op constant" comparisons on
+ * integer-like columns, the scan reads only those columns for a batch of
+ * rows, runs each comparison as a loop over the batch into a selection
+ * vector, and only then reads the rest of the projected columns for the rows
+ * that survived.  The comparisons handled here are removed from the qual the
+ * executor evaluates per tuple.
+ *
+ * Only types passed by value whose default btree operators compare plain
+ * signed integers are supported, so the loops can compare the Datums
+ * directly with the same result as the operator's function.  Floats are left
+ * to the executor because of their NaN ordering.
+ *
+ * Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/aocs/aocs_batch.c
+ *
+ *--------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "cdb/cdbaocsam.h"
+#include "nodes/primnodes.h"
+#include "utils/lsyscache.h"
+#include "utils/typcache.h"
+
+/* GUC */
+bool		gp_aocs_batch_quals = true;
+
+/*
+ * Map a column type to the way its values compare, or return false if the
+ * type is not supported.
+ */
+static bool
+batch_qual_type(Oid typid, AOCSBatchQualType *type)
+{
+	switch (typid)
+	{
+		case INT2OID:
+			*type = AOCSBATCH_INT16;
+			return true;
+		case INT4OID:
+		case DATEOID:
+			*type = AOCSBATCH_INT32;
+			return true;
+		case INT8OID:
+			*type = AOCSBATCH_INT64;
+			return true;
+#ifdef HAVE_INT64_TIMESTAMP
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			*type = AOCSBATCH_INT64;
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+/*
+ * aocs_batch_build_quals
+ *
+ * Pick the clauses of a scan's qual list that can be evaluated over batches
+ * of column values.  A clause qualifies if it compares a column of the
+ * scanned relation with a non-NULL constant of the same, supported, type,
+ * using an operator of that type's default btree operator family.
+ *
+ * 'used' must have room for one entry per clause of 'qual'; entries of the
+ * clauses that were converted are set to true.  Returns NULL and sets
+ * *nquals to 0 if no clause qualifies.
+ */
+AOCSBatchQual *
+aocs_batch_build_quals(Relation rel, List *qual, Index scanrelid,
+					   int *nquals, bool *used)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	AOCSBatchQual *quals = NULL;
+	int			n = 0;
+	int			i = 0;
+	ListCell   *lc;
+
+	*nquals = 0;
+
+	foreach(lc, qual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+		Oid			opno;
+		TypeCacheEntry *typentry;
+		AOCSBatchQualType type;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+
+		used[i++] = false;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			continue;
+
+		opno = opexpr->opno;
+		leftop = (Node *) linitial(opexpr->args);
+		rightop = (Node *) lsecond(opexpr->args);
+
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+		}
+		else if (IsA(rightop, Var) && IsA(leftop, Const))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				continue;
+		}
+		else
+			continue;
+
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || var->varattno > tupdesc->natts ||
+			con->constisnull)
+			continue;
+
+		if (tupdesc->attrs[var->varattno - 1]->atttypid != var->vartype ||
+			con->consttype != var->vartype ||
+			!batch_qual_type(var->vartype, &type))
+			continue;
+
+		typentry = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+		if (!OidIsValid(typentry->btree_opf) ||
+			!op_in_opfamily(opno, typentry->btree_opf))
+			continue;
+
+		get_op_opfamily_properties(opno, typentry->btree_opf, false,
+								   &strategy, &lefttype, &righttype);
+		if (lefttype != var->vartype || righttype != var->vartype)
+			continue;
+
+		if (quals == NULL)
+			quals = (AOCSBatchQual *) palloc(sizeof(AOCSBatchQual) * list_length(qual));
+
+		quals[n].attno = var->varattno - 1;
+		quals[n].type = type;
+		quals[n].strategy = strategy;
+		quals[n].constval = con->constvalue;
+		n++;
+
+		used[i - 1] = true;
+	}
+
+	*nquals = n;
+	return quals;
+}
+
+/*
+ * Keep the entries of sel[0..nsel-1] whose value satisfies "value op c",
+ * compacting them to the front of sel.  NULLs never satisfy a comparison.
+ */
+#define BATCH_FILTER(getter, op) \
+	do { \
+		for (i = 0; i < nsel; i++) \
+		{ \
+			int			row = sel[i]; \
+			\
+			sel[n] = row; \
+			n += (!isnull[row] && getter(values[row]) op c); \
+		} \
+	} while (0)
+
+#define BATCH_FILTER_STRATEGY(getter) \
+	do { \
+		switch (qual->strategy) \
+		{ \
+			case BTLessStrategyNumber: \
+				BATCH_FILTER(getter, <); \
+				break; \
+			case BTLessEqualStrategyNumber: \
+				BATCH_FILTER(getter, <=); \
+				break; \
+			case BTEqualStrategyNumber: \
+				BATCH_FILTER(getter, ==); \
+				break; \
+			case BTGreaterEqualStrategyNumber: \
+				BATCH_FILTER(getter, >=); \
+				break; \
+			case BTGreaterStrategyNumber: \
+				BATCH_FILTER(getter, >); \
+				break; \
+			default: \
+				elog(ERROR, "unexpected strategy number %d", qual->strategy); \
+		} \
+	} while (0)
+
+/*
+ * Filter the selection vector of the batch with one qual.  Returns the new
+ * number of selected rows.
+ */
+static int
+batch_filter(AOCSBatchQual *qual, Datum *values, bool *isnull,
+			 uint16 *sel, int nsel)
+{
+	int			n = 0;
+	int			i;
+
+	switch (qual->type)
+	{
+		case AOCSBATCH_INT16:
+			{
+				int16		c = DatumGetInt16(qual->constval);
+
+				BATCH_FILTER_STRATEGY(DatumGetInt16);
+				break;
+			}
+		case AOCSBATCH_INT32:
+			{
+				int32		c = DatumGetInt32(qual->constval);
+
+				BATCH_FILTER_STRATEGY(DatumGetInt32);
+				break;
+			}
+		case AOCSBATCH_INT64:
+			{
+				int64		c = DatumGetInt64(qual->constval);
+
+				BATCH_FILTER_STRATEGY(DatumGetInt64);
+				break;
+			}
+	}
+
+	return n;
+}
+
+/*
+ * aocs_batch_eval_quals
+ *
+ * Evaluate all the quals of the batch over the rows read into it, leaving
+ * the rows that satisfy all of them in the selection vector.
+ */
+void
+aocs_batch_eval_quals(AOCSBatch *batch)
+{
+	int			nsel = batch->nrows;
+	int			i;
+	int			k;
+
+	for (i = 0; i < nsel; i++)
+		batch->sel[i] = i;
+
+	for (i = 0; i < batch->nquals && nsel > 0; i++)
+	{
+		AOCSBatchQual *qual = &batch->quals[i];
+
+		/* find the key column of the qual */
+		for (k = 0; k < batch->num_key_atts; k++)
+		{
+			if (batch->key_atts[k] == qual->attno)
+				break;
+		}
+		Assert(k < batch->num_key_atts);
+
+		nsel = batch_filter(qual,
+							&batch->values[k * AOCS_BATCH_SIZE],
+							&batch->isnull[k * AOCS_BATCH_SIZE],
+							batch->sel, nsel);
+	}
+
+	batch->nsel = nsel;
+	batch->nextsel = 0;
+}
@@ -502,12 +502,78 @@ aocs_beginscan_internal(Relation relation,
 	return scan;
 }
 
+/*
+ * aocs_set_batch_quals
+ *
+ * Make the scan evaluate the given quals itself, over batches of the values
+ * of their columns, and return only rows that satisfy all of them.  The
+ * quals come from aocs_batch_build_quals(), and their columns must be among
+ * the projected columns of the scan.  Must be called before the first
+ * aocs_getnext().
+ */
+void
+aocs_set_batch_quals(AOCSScanDesc scan, int nquals, AOCSBatchQual *quals)
+{
+	AOCSBatch  *batch;
+	int			i;
+	int			j;
+
+	Assert(scan->batch == NULL);
+
+	if (nquals == 0)
+		return;
+
+	batch = (AOCSBatch *) palloc0(sizeof(AOCSBatch));
+	batch->nquals = nquals;
+	batch->quals = quals;
+
+	batch->key_atts = palloc(scan->num_proj_atts * sizeof(int));
+	batch->other_atts = palloc(scan->num_proj_atts * sizeof(int));
+	for (i = 0; i < scan->num_proj_atts; i++)
+	{
+		int			attno = scan->proj_atts[i];
+		bool		iskey = false;
+
+		for (j = 0; j < nquals; j++)
+		{
+			if (quals[j].attno == attno)
+				iskey = true;
+		}
+
+		if (iskey)
+			batch->key_atts[batch->num_key_atts++] = attno;
+		else
+			batch->other_atts[batch->num_other_atts++] = attno;
+	}
+	Assert(batch->num_key_atts > 0);
+
+	batch->values = palloc(batch->num_key_atts * AOCS_BATCH_SIZE * sizeof(Datum));
+	batch->isnull = palloc(batch->num_key_atts * AOCS_BATCH_SIZE * sizeof(bool));
+	batch->rownums = palloc(AOCS_BATCH_SIZE * sizeof(int64));
+	batch->sel = palloc(AOCS_BATCH_SIZE * sizeof(uint16));
+
+	scan->batch = batch;
+}
+
+static void
+aocs_batch_reset(AOCSBatch *batch)
+{
+	batch->nrows = 0;
+	batch->next = 0;
+	batch->seg_done = false;
+	batch->nsel = 0;
+	batch->nextsel = 0;
+}
+
 void
 aocs_rescan(AOCSScanDesc scan)
 {
 	close_cur_scan_seg(scan);
 	close_ds_read(scan->ds, scan->relationTupleDesc->natts);
 	aocs_initscan(scan);
+
+	if (scan->batch)
+		aocs_batch_reset(scan->batch);
 }
 
 void
@@ -536,6 +602,19 @@ aocs_endscan(AOCSScanDesc scan)
 
 	AppendOnlyVisimap_Finish(&scan->visibilityMap, AccessShareLock);
 
+	if (scan->batch)
+	{
+		AOCSBatch  *batch = scan->batch;
+
+		pfree(batch->key_atts);
+		pfree(batch->other_atts);
+		pfree(batch->values);
+		pfree(batch->isnull);
+		pfree(batch->rownums);
+		pfree(batch->sel);
+		pfree(batch);
+	}
+
 	pfree(scan);
 }
 
@@ -613,6 +692,212 @@ static void upgrade_datum_fetch(AOCSFetchDesc fetch, int attno, Datum values[],
 					   values, isnull, formatversion);
 }
 
+/*
+ * Move the datum stream of a column to its next datum, reading the next
+ * block if needed.  Returns false at the end of the segment file.
+ */
+static inline bool
+advance_column(AOCSScanDesc scan, int attno)
+{
+	int			err;
+
+	err = datumstreamread_advance(scan->ds[attno]);
+	Assert(err >= 0);
+	if (err == 0)
+	{
+		err = datumstreamread_block(scan->ds[attno], scan->blockDirectory, attno);
+		if (err < 0)
+			return false;
+
+		err = datumstreamread_advance(scan->ds[attno]);
+		Assert(err > 0);
+	}
+
+	return true;
+}
+
+/*
+ * Read the values of the qual columns of up to AOCS_BATCH_SIZE rows of the
+ * current segment file into the batch, and evaluate the quals over them.
+ */
+static void
+aocs_batch_fill(AOCSScanDesc scan)
+{
+	AOCSBatch  *batch = scan->batch;
+	int			k;
+
+	batch->nrows = 0;
+	batch->next = 0;
+
+	while (batch->nrows < AOCS_BATCH_SIZE)
+	{
+		int			row = batch->nrows;
+		int64		rowNum = INT64CONST(-1);
+
+		for (k = 0; k < batch->num_key_atts; k++)
+		{
+			int			attno = batch->key_atts[k];
+			DatumStreamRead *ds = scan->ds[attno];
+
+			if (!advance_column(scan, attno))
+			{
+				batch->seg_done = true;
+				goto done;
+			}
+
+			datumstreamread_get(ds,
+								&batch->values[k * AOCS_BATCH_SIZE + row],
+								&batch->isnull[k * AOCS_BATCH_SIZE + row]);
+
+			if (rowNum == INT64CONST(-1) &&
+				ds->blockFirstRowNum != INT64CONST(-1))
+			{
+				Assert(ds->blockFirstRowNum > 0);
+				rowNum = ds->blockFirstRowNum + datumstreamread_nth(ds);
+			}
+		}
+
+		scan->cur_seg_row++;
+		batch->rownums[row] = (rowNum == INT64CONST(-1)) ? scan->cur_seg_row : rowNum;
+		batch->nrows++;
+	}
+
+done:
+	aocs_batch_eval_quals(batch);
+}
+
+/*
+ * Move the datum streams of the non-qual columns forward, without decoding
+ * any values, until they have passed 'nrows' rows of the batch.  Returns
+ * false if a segment file ended early.
+ */
+static bool
+aocs_batch_skip_others(AOCSScanDesc scan, int nrows)
+{
+	AOCSBatch  *batch = scan->batch;
+	int			k;
+
+	for (; batch->next < nrows; batch->next++)
+	{
+		for (k = 0; k < batch->num_other_atts; k++)
+		{
+			if (!advance_column(scan, batch->other_atts[k]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * aocs_getnext() for a scan with batch quals.
+ */
+static bool
+aocs_getnext_batch(AOCSScanDesc scan, TupleTableSlot *slot)
+{
+	AOCSBatch  *batch = scan->batch;
+	Datum	   *d = slot_get_values(slot);
+	bool	   *null = slot_get_isnull(slot);
+	int			ncol = slot->tts_tupleDescriptor->natts;
+	bool		isSnapshotAny = (scan->snapshot == SnapshotAny);
+	AOTupleId	aoTupleId;
+	int			k;
+
+	while (1)
+	{
+		AOCSFileSegInfo *curseginfo;
+		int			row;
+
+		if (batch->nextsel >= batch->nsel)
+		{
+			/*
+			 * The batch is used up.  Catch up with its rows that were not
+			 * selected in the other columns, and read the next one.
+			 */
+			if (scan->cur_seg >= 0 && !batch->seg_done &&
+				!aocs_batch_skip_others(scan, batch->nrows))
+				batch->seg_done = true;
+
+			if (scan->cur_seg < 0 || batch->seg_done)
+			{
+				if (scan->cur_seg >= 0)
+					close_cur_scan_seg(scan);
+
+				if (open_next_scan_seg(scan) < 0)
+				{
+					/* No more seg, we are at the end */
+					ExecClearTuple(slot);
+					scan->cur_seg = -1;
+					aocs_batch_reset(batch);
+					return false;
+				}
+				scan->cur_seg_row = 0;
+				aocs_batch_reset(batch);
+			}
+
+			aocs_batch_fill(scan);
+			continue;
+		}
+
+		Assert(scan->cur_seg >= 0);
+		curseginfo = scan->seginfo[scan->cur_seg];
+
+		row = batch->sel[batch->nextsel++];
+
+		AOTupleIdInit(&aoTupleId, curseginfo->segno, batch->rownums[row]);
+
+		if (!isSnapshotAny && !AppendOnlyVisimap_IsVisible(&scan->visibilityMap, &aoTupleId))
+			continue;
+
+		/* Fetch the other columns of the selected row */
+		if (!aocs_batch_skip_others(scan, row))
+		{
+			batch->seg_done = true;
+			batch->nsel = 0;
+			continue;
+		}
+		for (k = 0; k < batch->num_other_atts; k++)
+		{
+			int			attno = batch->other_atts[k];
+
+			if (!advance_column(scan, attno))
+			{
+				batch->seg_done = true;
+				batch->nsel = 0;
+				break;
+			}
+
+			datumstreamread_get(scan->ds[attno], &d[attno], &null[attno]);
+
+			if (curseginfo->formatversion < AORelationVersion_GetLatest())
+			{
+				upgrade_datum_scan(scan, attno, d, null,
+								   curseginfo->formatversion);
+			}
+		}
+		if (k < batch->num_other_atts)
+			continue;
+		batch->next = row + 1;
+
+		for (k = 0; k < batch->num_key_atts; k++)
+		{
+			int			attno = batch->key_atts[k];
+
+			d[attno] = batch->values[k * AOCS_BATCH_SIZE + row];
+			null[attno] = batch->isnull[k * AOCS_BATCH_SIZE + row];
+		}
+
+		scan->cdb_fake_ctid = *((ItemPointer) &aoTupleId);
+
+		TupSetVirtualTupleNValid(slot, ncol);
+		slot_set_ctid(slot, &(scan->cdb_fake_ctid));
+		return true;
+	}
+
+	Assert(!"Never here");
+	return false;
+}
+
 bool
 aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 {
@@ -627,6 +912,9 @@ aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot)
 
 	Assert(ScanDirectionIsForward(direction));
 
+	if (scan->batch)
+		return aocs_getnext_batch(scan, slot);
+
 	ncol = slot->tts_tupleDescriptor->natts;
 	Assert(ncol <= scan->relationTupleDesc->natts);
 
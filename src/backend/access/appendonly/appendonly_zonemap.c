@@ -0,0 +1,538 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_zonemap.c
+ *   maintain per-block min/max summaries (zone maps) for append-only tables.
+ *
+ * See appendonly_zonemap.h for an overview.
+ *
+ * The summaries live in a fixed-size shared hash table.  When the table is
+ * full, all entries are thrown away and the cache starts filling up again;
+ * losing an entry only means that a block has to be read.
+ *
+ * Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/access/appendonly/appendonly_zonemap.c
+ *
+ *------------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/appendonly_zonemap.h"
+#include "access/nbtree.h"
+#include "nodes/primnodes.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+/*
+ * GUC variables
+ */
+int			gp_appendonly_zonemap_entries;	/* size of the shared cache */
+bool		gp_appendonly_zonemap_scan;		/* use zone maps to skip blocks */
+
+/*
+ * Identifies one append-only storage block.  RelFileNode, segno and the
+ * 8-byte aligned fileOffset leave no padding, so the tag can be hashed as
+ * raw bytes.
+ */
+typedef struct AppendOnlyZoneMapTag
+{
+	RelFileNode node;
+	int32		segno;
+	int64		fileOffset;
+} AppendOnlyZoneMapTag;
+
+typedef struct AppendOnlyZoneMapEntry
+{
+	AppendOnlyZoneMapTag tag;	/* hash key, must be first */
+
+	/* Identity of the block contents the summary was computed from */
+	int64		firstRowNum;
+	int32		rowCount;
+
+	int32		ncols;
+	AttrNumber	attnum[AOZONEMAP_MAX_COLUMNS];
+	bool		hasvalue[AOZONEMAP_MAX_COLUMNS];	/* false if all NULL */
+	Datum		minval[AOZONEMAP_MAX_COLUMNS];
+	Datum		maxval[AOZONEMAP_MAX_COLUMNS];
+} AppendOnlyZoneMapEntry;
+
+typedef struct AppendOnlyZoneMapControl
+{
+	LWLock	   *lock;			/* protects ZoneMapHash */
+} AppendOnlyZoneMapControl;
+
+static AppendOnlyZoneMapControl *ZoneMapControl = NULL;
+static HTAB *ZoneMapHash = NULL;
+
+static void zonemap_reset_locked(void);
+static bool zonemap_key_may_match(AppendOnlyZoneMapEntry *entry, ScanKey key);
+
+/*
+ * AppendOnlyZoneMapShmemSize -- estimate the shared memory needed for the
+ * zone map cache.
+ */
+Size
+AppendOnlyZoneMapShmemSize(void)
+{
+	Size		size;
+
+	if (gp_appendonly_zonemap_entries <= 0)
+		return 0;
+
+	size = MAXALIGN(sizeof(AppendOnlyZoneMapControl));
+	size = add_size(size, hash_estimate_size((Size) gp_appendonly_zonemap_entries,
+											 sizeof(AppendOnlyZoneMapEntry)));
+
+	return size;
+}
+
+/*
+ * AppendOnlyZoneMapShmemInit -- create the zone map cache in shared memory.
+ */
+void
+AppendOnlyZoneMapShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	if (gp_appendonly_zonemap_entries <= 0)
+		return;
+
+	ZoneMapControl = (AppendOnlyZoneMapControl *)
+		ShmemInitStruct("Append Only Zone Map Control",
+						sizeof(AppendOnlyZoneMapControl),
+						&found);
+
+	if (!found)
+		ZoneMapControl->lock = LWLockAssign();
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(AppendOnlyZoneMapTag);
+	info.entrysize = sizeof(AppendOnlyZoneMapEntry);
+	info.hash = tag_hash;
+
+	ZoneMapHash = ShmemInitHash("Append Only Zone Map Hash",
+								gp_appendonly_zonemap_entries,
+								gp_appendonly_zonemap_entries,
+								&info,
+								HASH_ELEM | HASH_FUNCTION);
+	if (!ZoneMapHash)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("not enough shared memory for append-only zone maps")));
+}
+
+/*
+ * Drop all entries.  Caller must hold the lock in exclusive mode.
+ */
+static void
+zonemap_reset_locked(void)
+{
+	HASH_SEQ_STATUS status;
+	AppendOnlyZoneMapEntry *entry;
+
+	hash_seq_init(&status, ZoneMapHash);
+	while ((entry = (AppendOnlyZoneMapEntry *) hash_seq_search(&status)) != NULL)
+		hash_search(ZoneMapHash, &entry->tag, HASH_REMOVE, NULL);
+}
+
+/*
+ * AppendOnlyZoneMapBuilder_Init
+ *
+ * Decide which columns of 'rel' get summarized.  Leaves builder->ncols at
+ * zero if the cache is disabled or the relation has no suitable column.
+ */
+void
+AppendOnlyZoneMapBuilder_Init(AppendOnlyZoneMapBuilder *builder, Relation rel)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			i;
+
+	MemSet(builder, 0, sizeof(AppendOnlyZoneMapBuilder));
+
+	if (ZoneMapHash == NULL)
+		return;
+
+	for (i = 0; i < tupdesc->natts && builder->ncols < AOZONEMAP_MAX_COLUMNS; i++)
+	{
+		Form_pg_attribute attr = tupdesc->attrs[i];
+		TypeCacheEntry *typentry;
+
+		/*
+		 * Only pass-by-value types are summarized, so that an entry is of
+		 * fixed size and needs no detoasting or collation handling.
+		 */
+		if (attr->attisdropped || !attr->attbyval)
+			continue;
+
+		typentry = lookup_type_cache(attr->atttypid, TYPECACHE_CMP_PROC_FINFO);
+		if (!OidIsValid(typentry->cmp_proc_finfo.fn_oid))
+			continue;
+
+		builder->attnum[builder->ncols] = attr->attnum;
+		builder->cmpfn[builder->ncols] = &typentry->cmp_proc_finfo;
+		builder->ncols++;
+	}
+}
+
+void
+AppendOnlyZoneMapBuilder_Reset(AppendOnlyZoneMapBuilder *builder)
+{
+	builder->nrows = 0;
+	MemSet(builder->hasvalue, 0, sizeof(builder->hasvalue));
+}
+
+static inline void
+zonemap_add_value(AppendOnlyZoneMapBuilder *builder, int col, Datum value)
+{
+	FmgrInfo   *cmpfn = builder->cmpfn[col];
+
+	if (!builder->hasvalue[col])
+	{
+		builder->minval[col] = value;
+		builder->maxval[col] = value;
+		builder->hasvalue[col] = true;
+	}
+	else if (DatumGetInt32(FunctionCall2(cmpfn, value, builder->minval[col])) < 0)
+		builder->minval[col] = value;
+	else if (DatumGetInt32(FunctionCall2(cmpfn, value, builder->maxval[col])) > 0)
+		builder->maxval[col] = value;
+}
+
+/*
+ * Add a row that is about to be written into the current block.
+ */
+void
+AppendOnlyZoneMapBuilder_AddMemTuple(AppendOnlyZoneMapBuilder *builder,
+									 MemTuple tuple,
+									 MemTupleBinding *mt_bind)
+{
+	int			i;
+
+	if (builder->ncols == 0)
+		return;
+
+	for (i = 0; i < builder->ncols; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		value = memtuple_getattr(tuple, mt_bind, builder->attnum[i], &isnull);
+		if (!isnull)
+			zonemap_add_value(builder, i, value);
+	}
+	builder->nrows++;
+}
+
+/*
+ * Add a row read from the current block.
+ */
+void
+AppendOnlyZoneMapBuilder_AddSlot(AppendOnlyZoneMapBuilder *builder,
+								 TupleTableSlot *slot)
+{
+	int			i;
+
+	if (builder->ncols == 0)
+		return;
+
+	for (i = 0; i < builder->ncols; i++)
+	{
+		Datum		value;
+		bool		isnull;
+
+		value = slot_getattr(slot, builder->attnum[i], &isnull);
+		if (!isnull)
+			zonemap_add_value(builder, i, value);
+	}
+	builder->nrows++;
+}
+
+/*
+ * AppendOnlyZoneMap_Record
+ *
+ * Store the summary accumulated in 'builder' for the block at 'fileOffset'
+ * of segment file 'segno', and reset the builder for the next block.
+ *
+ * Nothing is stored unless every row of the block went through the
+ * builder, or if the block header carries no first row number to validate
+ * the entry against later.
+ */
+void
+AppendOnlyZoneMap_Record(AppendOnlyZoneMapBuilder *builder,
+						 RelFileNode *node,
+						 int segno,
+						 int64 fileOffset,
+						 int64 firstRowNum,
+						 int rowCount)
+{
+	AppendOnlyZoneMapTag tag;
+	AppendOnlyZoneMapEntry *entry;
+	bool		found;
+
+	if (builder->ncols == 0 || ZoneMapHash == NULL)
+		return;
+
+	if (builder->nrows != rowCount || firstRowNum < 0)
+	{
+		AppendOnlyZoneMapBuilder_Reset(builder);
+		return;
+	}
+
+	MemSet(&tag, 0, sizeof(tag));
+	tag.node = *node;
+	tag.segno = segno;
+	tag.fileOffset = fileOffset;
+
+	LWLockAcquire(ZoneMapControl->lock, LW_EXCLUSIVE);
+
+	entry = (AppendOnlyZoneMapEntry *)
+		hash_search(ZoneMapHash, &tag, HASH_ENTER_NULL, &found);
+	if (entry == NULL)
+	{
+		/* Cache is full, start over. */
+		zonemap_reset_locked();
+		entry = (AppendOnlyZoneMapEntry *)
+			hash_search(ZoneMapHash, &tag, HASH_ENTER_NULL, &found);
+	}
+
+	if (entry != NULL)
+	{
+		entry->firstRowNum = firstRowNum;
+		entry->rowCount = rowCount;
+		entry->ncols = builder->ncols;
+		memcpy(entry->attnum, builder->attnum, sizeof(entry->attnum));
+		memcpy(entry->hasvalue, builder->hasvalue, sizeof(entry->hasvalue));
+		memcpy(entry->minval, builder->minval, sizeof(entry->minval));
+		memcpy(entry->maxval, builder->maxval, sizeof(entry->maxval));
+	}
+
+	LWLockRelease(ZoneMapControl->lock);
+
+	AppendOnlyZoneMapBuilder_Reset(builder);
+}
+
+/*
+ * Can any row summarized by 'entry' satisfy 'key'?
+ */
+static bool
+zonemap_key_may_match(AppendOnlyZoneMapEntry *entry, ScanKey key)
+{
+	int			col;
+	int32		cmp;
+
+	for (col = 0; col < entry->ncols; col++)
+	{
+		if (entry->attnum[col] == key->sk_attno)
+			break;
+	}
+	if (col == entry->ncols)
+		return true;			/* column not summarized */
+
+	/* btree operators are strict, so an all-NULL block never matches */
+	if (!entry->hasvalue[col])
+		return false;
+
+	switch (key->sk_strategy)
+	{
+		case BTLessStrategyNumber:
+		case BTLessEqualStrategyNumber:
+			cmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												  key->sk_collation,
+												  entry->minval[col],
+												  key->sk_argument));
+			return (key->sk_strategy == BTLessStrategyNumber) ? cmp < 0 : cmp <= 0;
+
+		case BTGreaterStrategyNumber:
+		case BTGreaterEqualStrategyNumber:
+			cmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												  key->sk_collation,
+												  entry->maxval[col],
+												  key->sk_argument));
+			return (key->sk_strategy == BTGreaterStrategyNumber) ? cmp > 0 : cmp >= 0;
+
+		case BTEqualStrategyNumber:
+			cmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												  key->sk_collation,
+												  entry->minval[col],
+												  key->sk_argument));
+			if (cmp > 0)
+				return false;
+			cmp = DatumGetInt32(FunctionCall2Coll(&key->sk_func,
+												  key->sk_collation,
+												  entry->maxval[col],
+												  key->sk_argument));
+			return cmp >= 0;
+
+		default:
+			return true;
+	}
+}
+
+/*
+ * AppendOnlyZoneMap_BlockMayMatch
+ *
+ * Check the summary of a block against the scan keys built by
+ * AppendOnlyZoneMap_BuildScanKeys().  Returns false only if the block has a
+ * valid summary and that summary rules out every key.  *found is set to
+ * whether a valid summary exists for the block.
+ */
+bool
+AppendOnlyZoneMap_BlockMayMatch(RelFileNode *node,
+								int segno,
+								int64 fileOffset,
+								int64 firstRowNum,
+								int rowCount,
+								int nkeys,
+								ScanKey keys,
+								bool *found)
+{
+	AppendOnlyZoneMapTag tag;
+	AppendOnlyZoneMapEntry *entry;
+	AppendOnlyZoneMapEntry localEntry;
+	int			i;
+
+	*found = false;
+
+	if (ZoneMapHash == NULL || firstRowNum < 0)
+		return true;
+
+	MemSet(&tag, 0, sizeof(tag));
+	tag.node = *node;
+	tag.segno = segno;
+	tag.fileOffset = fileOffset;
+
+	LWLockAcquire(ZoneMapControl->lock, LW_SHARED);
+
+	entry = (AppendOnlyZoneMapEntry *)
+		hash_search(ZoneMapHash, &tag, HASH_FIND, NULL);
+	if (entry != NULL &&
+		entry->firstRowNum == firstRowNum &&
+		entry->rowCount == rowCount)
+	{
+		memcpy(&localEntry, entry, sizeof(AppendOnlyZoneMapEntry));
+		*found = true;
+	}
+
+	LWLockRelease(ZoneMapControl->lock);
+
+	if (!*found)
+		return true;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		if (!zonemap_key_may_match(&localEntry, &keys[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * AppendOnlyZoneMap_BuildScanKeys
+ *
+ * Convert the simple "column op constant" clauses of a scan's qual list into
+ * scan keys that can be checked against block summaries.  The keys use the
+ * btree comparison support function rather than the operator itself, and
+ * are never evaluated against individual tuples; the quals themselves are
+ * still checked by the executor.
+ *
+ * Returns NULL and sets *nkeys to 0 if no clause qualifies.
+ */
+ScanKey
+AppendOnlyZoneMap_BuildScanKeys(Relation rel, List *qual, Index scanrelid,
+								int *nkeys)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	ScanKey		keys = NULL;
+	int			n = 0;
+	ListCell   *lc;
+
+	*nkeys = 0;
+
+	if (ZoneMapHash == NULL || !gp_appendonly_zonemap_scan)
+		return NULL;
+
+	foreach(lc, qual)
+	{
+		OpExpr	   *opexpr = (OpExpr *) lfirst(lc);
+		Node	   *leftop;
+		Node	   *rightop;
+		Var		   *var;
+		Const	   *con;
+		Oid			opno;
+		TypeCacheEntry *typentry;
+		int			strategy;
+		Oid			lefttype;
+		Oid			righttype;
+		Oid			cmpproc;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+			continue;
+
+		opno = opexpr->opno;
+		leftop = (Node *) linitial(opexpr->args);
+		rightop = (Node *) lsecond(opexpr->args);
+
+		if (IsA(leftop, Var) && IsA(rightop, Const))
+		{
+			var = (Var *) leftop;
+			con = (Const *) rightop;
+		}
+		else if (IsA(rightop, Var) && IsA(leftop, Const))
+		{
+			var = (Var *) rightop;
+			con = (Const *) leftop;
+			opno = get_commutator(opno);
+			if (!OidIsValid(opno))
+				continue;
+		}
+		else
+			continue;
+
+		if (var->varno != scanrelid || var->varlevelsup != 0 ||
+			var->varattno <= 0 || var->varattno > tupdesc->natts ||
+			con->constisnull)
+			continue;
+
+		if (!tupdesc->attrs[var->varattno - 1]->attbyval)
+			continue;
+
+		typentry = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+		if (!OidIsValid(typentry->btree_opf) ||
+			!op_in_opfamily(opno, typentry->btree_opf))
+			continue;
+
+		get_op_opfamily_properties(opno, typentry->btree_opf, false,
+								   &strategy, &lefttype, &righttype);
+		if (lefttype != var->vartype)
+			continue;
+
+		cmpproc = get_opfamily_proc(typentry->btree_opf, lefttype, righttype,
+									BTORDER_PROC);
+		if (!OidIsValid(cmpproc))
+			continue;
+
+		if (keys == NULL)
+			keys = (ScanKey) palloc(sizeof(ScanKeyData) * list_length(qual));
+
+		ScanKeyEntryInitialize(&keys[n],
+							   0,
+							   var->varattno,
+							   strategy,
+							   righttype,
+							   var->varcollid,
+							   cmpproc,
+							   con->constvalue);
+		n++;
+	}
+
+	*nkeys = n;
+	return keys;
+}
@@ -156,6 +156,7 @@ initscan(AppendOnlyScanDesc scan, ScanKey key)
 	scan->aos_need_new_segfile = true;	/* need to assign a file to be scanned */
 	scan->aos_done_all_segfiles = false;
 	scan->bufferDone = true;
+	scan->aos_zonemap_building = false;
 
 	if (scan->initedStorageRoutines)
 		AppendOnlyExecutorReadBlock_ResetCounts(
@@ -773,6 +774,8 @@ AppendOnlyExecutorReadBlock_GetBlockInfo(AppendOnlyStorageRead *storageRead,
 		return false;
 	}
 
+	executorReadBlock->hasFirstRowNum = (executorReadBlock->blockFirstRowNum >= 0);
+
 	/*
 	 * If the firstRowNum is not stored in the AOBlock,
 	 * executorReadBlock->blockFirstRowNum is set to -1. Since this is
@@ -1253,19 +1256,61 @@ getNextBlock(AppendOnlyScanDesc scan)
 			return false;
 	}
 
-	if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
-												  &scan->storageRead,
-												  &scan->executorReadBlock))
+	for (;;)
 	{
-		if (scan->blockDirectory)
+		AppendOnlyExecutorReadBlock *executorReadBlock = &scan->executorReadBlock;
+		bool		found;
+
+		if (!AppendOnlyExecutorReadBlock_GetBlockInfo(
+													  &scan->storageRead,
+													  executorReadBlock))
+		{
+			if (scan->blockDirectory)
+			{
+				AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			}
+
+			/* done reading the file */
+			CloseScannedFileSeg(scan);
+
+			return false;
+		}
+
+		/*
+		 * Consult the zone map before reading the block contents.  When
+		 * building the block directory every block must be visited.
+		 */
+		if (scan->aos_zonemap_nkeys == 0 || scan->blockDirectory ||
+			!executorReadBlock->hasFirstRowNum)
+			break;
+
+		if (AppendOnlyZoneMap_BlockMayMatch(&scan->aos_rd->rd_node,
+											executorReadBlock->segmentFileNum,
+											executorReadBlock->headerOffsetInFile,
+											executorReadBlock->blockFirstRowNum,
+											executorReadBlock->rowCount,
+											scan->aos_zonemap_nkeys,
+											scan->aos_zonemap_keys,
+											&found))
 		{
-			AppendOnlyBlockDirectory_End_forInsert(scan->blockDirectory);
+			/* Summarize the block while scanning it, if not done yet */
+			scan->aos_zonemap_building = !found;
+			scan->aos_zonemap_firstRowNum = executorReadBlock->blockFirstRowNum;
+			AppendOnlyZoneMapBuilder_Reset(&scan->aos_zonemap_builder);
+			break;
 		}
 
-		/* done reading the file */
-		CloseScannedFileSeg(scan);
+		elogif(Debug_appendonly_print_scan, LOG,
+			   "Append-only scan skipped block for table '%s' using zone map "
+			   "(segment file '%s', block offset in file = " INT64_FORMAT ")",
+			   AppendOnlyStorageRead_RelationName(&scan->storageRead),
+			   AppendOnlyStorageRead_SegmentFileName(&scan->storageRead),
+			   executorReadBlock->headerOffsetInFile);
 
-		return false;
+		AppendOnlyExecutionReadBlock_FinishedScanBlock(executorReadBlock);
+		AppendOnlyStorageRead_SkipCurrentBlock(&scan->storageRead);
+		scan->aos_zonemap_skipped++;
+		SIMPLE_FAULT_INJECTOR("ao_zonemap_skip_block");
 	}
 
 	if (scan->blockDirectory)
@@ -1341,6 +1386,11 @@ appendonlygettup(AppendOnlyScanDesc scan,
 			 */
 			AOTupleId  *aoTupleId = (AOTupleId *) slot_get_ctid(slot);
 
+			/* Invisible tuples count too, the summary covers the block */
+			if (scan->aos_zonemap_building)
+				AppendOnlyZoneMapBuilder_AddSlot(&scan->aos_zonemap_builder,
+												 slot);
+
 			if (!isSnapshotAny && !AppendOnlyVisimap_IsVisible(&scan->visibilityMap, aoTupleId))
 			{
 				/*
@@ -1355,6 +1405,17 @@ appendonlygettup(AppendOnlyScanDesc scan,
 		}
 		else
 		{
+			if (scan->aos_zonemap_building)
+			{
+				AppendOnlyZoneMap_Record(&scan->aos_zonemap_builder,
+										 &scan->aos_rd->rd_node,
+										 scan->executorReadBlock.segmentFileNum,
+										 scan->executorReadBlock.headerOffsetInFile,
+										 scan->aos_zonemap_firstRowNum,
+										 scan->executorReadBlock.rowCount);
+				scan->aos_zonemap_building = false;
+			}
+
 			/* no more items in the varblock, get new buffer */
 			scan->bufferDone = true;
 		}
@@ -1526,6 +1587,14 @@ finishWriteBlock(AppendOnlyInsertDesc aoInsertDesc)
 										 itemCount,
 										 false);
 
+	/* And remember the block's summary in the zone map */
+	AppendOnlyZoneMap_Record(&aoInsertDesc->zoneMapBuilder,
+							 &aoInsertDesc->aoi_rel->rd_node,
+							 aoInsertDesc->cur_segno,
+							 AppendOnlyStorageWrite_LogicalBlockStartOffset(&aoInsertDesc->storageWrite),
+							 aoInsertDesc->blockFirstRowNum,
+							 itemCount);
+
 	Assert(aoInsertDesc->nonCompressedData == NULL);
 	Assert(!AppendOnlyStorageWrite_IsBufferAllocated(&aoInsertDesc->storageWrite));
 }
@@ -1742,6 +1811,25 @@ appendonly_rescan(AppendOnlyScanDesc scan,
 	initscan(scan, key);
 }
 
+/* ----------------
+ *		appendonly_set_zonemap_keys	- use zone maps to skip blocks
+ *
+ * 'keys' are built by AppendOnlyZoneMap_BuildScanKeys().  They are only
+ * checked against block summaries, never against individual tuples.  The
+ * scan takes ownership of the array.
+ * ----------------
+ */
+void
+appendonly_set_zonemap_keys(AppendOnlyScanDesc scan, int nkeys, ScanKey keys)
+{
+	Assert(scan->aos_zonemap_keys == NULL);
+
+	scan->aos_zonemap_nkeys = nkeys;
+	scan->aos_zonemap_keys = keys;
+
+	AppendOnlyZoneMapBuilder_Init(&scan->aos_zonemap_builder, scan->aos_rd);
+}
+
 /* ----------------
  *		appendonly_endscan	- end relation scan
  * ----------------
@@ -1754,6 +1842,15 @@ appendonly_endscan(AppendOnlyScanDesc scan)
 	if (scan->aos_key)
 		pfree(scan->aos_key);
 
+	if (scan->aos_zonemap_keys)
+	{
+		elogif(Debug_appendonly_print_scan, LOG,
+			   "Append-only scan of table '%s' skipped " INT64_FORMAT " blocks using zone maps",
+			   RelationGetRelationName(scan->aos_rd),
+			   scan->aos_zonemap_skipped);
+		pfree(scan->aos_zonemap_keys);
+	}
+
 	if (scan->aos_segfile_arr)
 	{
 		for (int seginfo_no = 0; seginfo_no < scan->aos_total_segfiles; seginfo_no++)
@@ -2783,6 +2880,8 @@ aoInsertDesc->appendOnlyMetaDataSnapshot, //CONCERN:Safe to assume all block dir
 											aoInsertDesc->fsInfo, aoInsertDesc->lastSequence,
 											rel, segno, 1, false);
 
+	AppendOnlyZoneMapBuilder_Init(&aoInsertDesc->zoneMapBuilder, rel);
+
 	return aoInsertDesc;
 }
 
@@ -2981,6 +3080,9 @@ appendonly_insert(AppendOnlyInsertDesc aoInsertDesc,
 
 		if (itemLen > 0)
 			memcpy(itemPtr, tup, itemLen);
+
+		AppendOnlyZoneMapBuilder_AddMemTuple(&aoInsertDesc->zoneMapBuilder,
+											 tup, aoInsertDesc->mt_bind);
 	}
 	else
 	{
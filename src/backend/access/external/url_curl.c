@@ -26,6 +26,7 @@
 #include "cdb/cdbutil.h"
 #include "cdb/cdbvars.h"
 #include "miscadmin.h"
+#include "storage/gp_compress.h"
 #include "utils/guc.h"
 #include "utils/resowner.h"
 #include "utils/uri.h"
@@ -94,6 +95,22 @@ typedef struct
 		int			datalen;	/* remaining datablock length */
 	} block;
 
+#ifdef HAVE_LIBZSTD
+	bool		zstd;			/* gpfdist accepted zstd compressed data */
+	zstd_context *zstd_cxt;		/* created on first use */
+
+	/*
+	 * Decompressed data of the current block when reading, compressed data
+	 * of the request body when writing.
+	 */
+	struct
+	{
+		char	   *ptr;		/* palloc-ed buffer */
+		int			max;
+		int			bot,
+					top;
+	} zbuf;
+#endif
 } URL_CURL_FILE;
 
 
@@ -109,6 +126,9 @@ typedef struct
 #define FDIST_TIMEOUT  408
 #define MAX_TRY_WAIT_TIME 64
 
+/* data sent to gpfdist is bound by the network, compress it fast */
+#define GPFDIST_ZSTD_COMPRESSION_LEVEL 1
+
 /*
  * SSL support GUCs - should be added soon. Until then we will use stubs
  *
@@ -311,6 +331,15 @@ header_callback(void *ptr_, size_t size, size_t nmemb, void *userp)
 		}
 	}
 
+#ifdef HAVE_LIBZSTD
+	/*
+	 * gpfdist answers our X-GP-ZSTD header with its own if it accepts zstd
+	 * compressed data blocks.
+	 */
+	if (len > 10 && *ptr == 'X' && 0 == strncmp("X-GP-ZSTD:", ptr, 10))
+		url->zstd = true;
+#endif
+
 	/*
 	 * extract the GP-PROTO value from the HTTP header.
 	 */
@@ -1164,6 +1193,10 @@ url_curl_fopen(char *url, bool forwrite, extvar_t *ev, CopyState pstate)
 	set_httpheader(file, "X-GP-SEGMENT-COUNT", ev->GP_SEGMENT_COUNT);
 	set_httpheader(file, "X-GP-LINE-DELIM-STR", ev->GP_LINE_DELIM_STR);
 	set_httpheader(file, "X-GP-LINE-DELIM-LENGTH", ev->GP_LINE_DELIM_LENGTH);
+#ifdef HAVE_LIBZSTD
+	/* offer to exchange zstd compressed data blocks */
+	set_httpheader(file, "X-GP-ZSTD", "1");
+#endif
 
 	if (forwrite)
 	{
@@ -1414,6 +1447,20 @@ url_curl_fclose(URL_FILE *fileg, bool failOnError, const char *relname)
 		file->out.ptr = NULL;
 	}
 
+#ifdef HAVE_LIBZSTD
+	if (file->zstd_cxt)
+	{
+		zstd_free_context(file->zstd_cxt);
+		file->zstd_cxt = NULL;
+	}
+
+	if (file->zbuf.ptr)
+	{
+		pfree(file->zbuf.ptr);
+		file->zbuf.ptr = NULL;
+	}
+#endif
+
 	file->gp_proto = 0;
 	file->error = file->eof = 0;
 	memset(&file->in, 0, sizeof(file->in));
@@ -1471,6 +1518,107 @@ gp_proto0_read(char *buf, int bufsz, URL_CURL_FILE *file)
 	return n;
 }
 
+#ifdef HAVE_LIBZSTD
+/*
+ * Make sure the zbuf of the file can hold size bytes.
+ */
+static void
+zbuf_reserve(URL_CURL_FILE *file, Size size)
+{
+	if (size > MaxAllocSize)
+		elog(ERROR, "gpfdist error: compressed data block too large (" UINT64_FORMAT " bytes)",
+			 (uint64) size);
+
+	if (file->zbuf.max >= size)
+		return;
+
+	if (file->zbuf.ptr)
+		file->zbuf.ptr = repalloc(file->zbuf.ptr, size);
+	else
+		file->zbuf.ptr = palloc(size);
+	file->zbuf.max = size;
+}
+
+/*
+ * gp_proto1_decompress_block
+ *
+ * Decompress a 'Z' block of len bytes into file->zbuf, and make its data the
+ * current data block.
+ */
+static void
+gp_proto1_decompress_block(URL_CURL_FILE *file, int len)
+{
+	const char *src;
+	unsigned long long size;
+	size_t		ret;
+
+	fill_buffer(file, len);
+	if (file->in.top - file->in.bot < len)
+		elog(ERROR, "gpfdist error: stream ends suddenly");
+
+	src = file->in.ptr + file->in.bot;
+
+	size = ZSTD_getFrameContentSize(src, len);
+	if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("gpfdist error: invalid compressed data block of length %d", len)));
+
+	zbuf_reserve(file, size);
+
+	if (!file->zstd_cxt)
+		file->zstd_cxt = zstd_alloc_context();
+	if (!file->zstd_cxt->dctx)
+	{
+		file->zstd_cxt->dctx = ZSTD_createDCtx();
+		if (!file->zstd_cxt->dctx)
+			elog(ERROR, "out of memory");
+	}
+
+	ret = ZSTD_decompressDCtx(file->zstd_cxt->dctx, file->zbuf.ptr, size, src, len);
+	if (ZSTD_isError(ret) || ret != size)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("gpfdist error: could not decompress data block: %s",
+						ZSTD_isError(ret) ? ZSTD_getErrorName(ret) : "wrong length")));
+
+	file->in.bot += len;
+	file->zbuf.bot = 0;
+	file->zbuf.top = size;
+	file->block.datalen = size;
+}
+
+/*
+ * gp_proto0_compress
+ *
+ * Compress nbytes of buf into file->zbuf, as a single zstd frame.
+ */
+static void
+gp_proto0_compress(URL_CURL_FILE *file, const char *buf, int nbytes)
+{
+	size_t		ret;
+
+	zbuf_reserve(file, ZSTD_compressBound(nbytes));
+
+	if (!file->zstd_cxt)
+		file->zstd_cxt = zstd_alloc_context();
+	if (!file->zstd_cxt->cctx)
+	{
+		file->zstd_cxt->cctx = ZSTD_createCCtx();
+		if (!file->zstd_cxt->cctx)
+			elog(ERROR, "out of memory");
+	}
+
+	ret = ZSTD_compressCCtx(file->zstd_cxt->cctx, file->zbuf.ptr, file->zbuf.max,
+							buf, nbytes, GPFDIST_ZSTD_COMPRESSION_LEVEL);
+	if (ZSTD_isError(ret))
+		elog(ERROR, "could not compress data for gpfdist: %s", ZSTD_getErrorName(ret));
+
+	file->zbuf.bot = 0;
+	file->zbuf.top = ret;
+}
+#endif
+
 /*
  * gp_proto1_read
  *
@@ -1479,6 +1627,11 @@ gp_proto0_read(char *buf, int bufsz, URL_CURL_FILE *file)
  * byte 0: type (can be 'F'ilename, 'O'ffset, 'D'ata, 'E'rror, 'L'inenumber)
  * byte 1-4: length. # bytes of following data block. in network-order.
  * byte 5-X: the block itself.
+ *
+ * If gpfdist accepted our X-GP-ZSTD header, data blocks may also come as
+ * 'Z'ipped blocks, each holding one zstd frame of data. Such a block is
+ * decompressed as a whole when it arrives, and then handed out like a 'D'ata
+ * block.
  */
 static size_t
 gp_proto1_read(char *buf, int bufsz, URL_CURL_FILE *file, CopyState pstate, char *buf2)
@@ -1627,6 +1780,15 @@ gp_proto1_read(char *buf, int bufsz, URL_CURL_FILE *file, CopyState pstate, char
 			break;
 		}
 
+#ifdef HAVE_LIBZSTD
+		/* Compressed data */
+		if (type == 'Z' && file->zstd)
+		{
+			gp_proto1_decompress_block(file, len);
+			continue;
+		}
+#endif
+
 		elog(ERROR, "gpfdist error: unknown meta type %d", type);
 	}
 
@@ -1634,6 +1796,19 @@ gp_proto1_read(char *buf, int bufsz, URL_CURL_FILE *file, CopyState pstate, char
 	if (bufsz > file->block.datalen)
 		bufsz = file->block.datalen;
 
+#ifdef HAVE_LIBZSTD
+	/* a compressed block was decompressed as a whole */
+	if (file->zbuf.top > file->zbuf.bot)
+	{
+		n = Min(bufsz, file->zbuf.top - file->zbuf.bot);
+
+		memcpy(buf, file->zbuf.ptr + file->zbuf.bot, n);
+		file->zbuf.bot += n;
+		file->block.datalen -= n;
+		return n;
+	}
+#endif
+
 	fill_buffer(file, bufsz);
 	n = file->in.top - file->in.bot;
 
@@ -1675,6 +1850,16 @@ gp_proto0_write(URL_CURL_FILE *file, CopyState pstate)
 
 	if (nbytes == 0)
 		return;
+
+#ifdef HAVE_LIBZSTD
+	/* gpfdist accepted zstd, post the data as a single zstd frame */
+	if (file->zstd)
+	{
+		gp_proto0_compress(file, buf, nbytes);
+		buf = file->zbuf.ptr;
+		nbytes = file->zbuf.top;
+	}
+#endif
 	
 	/* post binary data */
 	CURL_EASY_SETOPT(file->curl->handle, CURLOPT_POSTFIELDS, buf);
@@ -0,0 +1,329 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbplancache.c
+ *	  Caching of dispatched plans on the QEs.
+ *
+ * With gp_qe_plan_cache on, every plan the QD dispatches carries a
+ * fingerprint of its serialized form, and each QE keeps the last
+ * QE_PLAN_CACHE_SIZE plans it received, deserialized, by fingerprint.  When
+ * all QEs of a gang already have the plan, the QD sends just the
+ * fingerprint, and the QEs run a copy of their cached plan.
+ *
+ * The QD never asks a QE what it has cached.  Instead it keeps, for every
+ * QE connection, a copy of the list of fingerprints that the QE holds, and
+ * both sides update their list in the same way for every message that
+ * carries a fingerprint: the fingerprint moves to the front, and when a new
+ * one does not fit, the ones at the end are dropped.  The number of plans
+ * and their total size are limited, the size being that of the serialized
+ * plan, which both sides know.  As the QE processes the messages in the
+ * order the QD sent them, the lists stay the same.
+ *
+ * When the QD loses track, because a dispatch failed part way, a QE failed
+ * or was canceled, or simply after a catalog change, it forgets everything
+ * it knew about all QEs and sends the full plans again.  The QEs keep their
+ * lists, so whatever the QD thinks a QE has, it really has.  The QEs never
+ * need to invalidate anything on their own: a cached plan is only used for
+ * a dispatch whose serialized plan is the same, and whether that plan is
+ * still valid is for the QD to decide.
+ *
+ * Portions Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/cdb/cdbplancache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/hash.h"
+#include "libpq-fe.h"
+#include "cdb/cdbconn.h"
+#include "cdb/cdbplancache.h"
+#include "port/pg_crc32c.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/syscache.h"
+
+/*
+ * Bumped whenever the QD forgets what the QEs have cached.  The lists kept
+ * in the SegmentDatabaseDescriptors are only valid if they were last
+ * updated in the current generation.
+ */
+static uint32 qePlanCacheGeneration = 1;
+static bool qePlanCacheCallbacksRegistered = false;
+
+typedef struct QEPlanCacheEntry
+{
+	MemoryContext context;		/* holds the plan */
+	PlannedStmt *plan;
+} QEPlanCacheEntry;
+
+/*
+ * QE side: the cached plans, in the order of qePlanCacheList, most recently
+ * used first.
+ */
+static QEPlanCacheList qePlanCacheList;
+static QEPlanCacheEntry qePlanCache[QE_PLAN_CACHE_SIZE];
+
+static void QEPlanCacheRelCallback(Datum arg, Oid relid);
+static void QEPlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue);
+
+/*
+ * Compute the fingerprint of a serialized plan.
+ *
+ * Two independent 32-bit hashes of the whole string make for a 64-bit key.
+ * Zero means "no fingerprint" in the dispatch protocol, so we never return
+ * that.
+ */
+uint64
+QEPlanCacheFingerprint(const char *splan, int len)
+{
+	pg_crc32c	crc;
+	uint64		fingerprint;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, splan, len);
+	FIN_CRC32C(crc);
+
+	fingerprint = DatumGetUInt32(hash_any((const unsigned char *) splan, len));
+	fingerprint = (fingerprint << 32) | crc;
+	if (fingerprint == 0)
+		fingerprint = 1;
+
+	return fingerprint;
+}
+
+/*
+ * Is a plan of this size, before compression, small enough to be cached?
+ */
+bool
+QEPlanCacheFits(int size)
+{
+	return size <= QE_PLAN_CACHE_MAX_BYTES;
+}
+
+/*
+ * Does the QE behind segdbDesc have the plan with this fingerprint?
+ */
+bool
+QEPlanCacheHasPlan(SegmentDatabaseDescriptor *segdbDesc, uint64 fingerprint)
+{
+	QEPlanCacheList *list = &segdbDesc->cachedPlans;
+	int			i;
+
+	if (segdbDesc->cachedPlansGeneration != qePlanCacheGeneration)
+		return false;
+
+	for (i = 0; i < list->count; i++)
+	{
+		if (list->fingerprints[i] == fingerprint)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Move a fingerprint to the front of a list kept in most recently used
+ * order.  Returns the index the fingerprint was found at, or -1.
+ *
+ * If it was not in the list yet, the plans at the end are dropped until the
+ * new one fits, and *nkept is set to the number of plans that were kept.
+ * They are now at positions 1 to *nkept.
+ *
+ * This is shared by the QD's copies of the lists, and the QE's own list, so
+ * that they cannot go out of sync.
+ */
+static int
+touchFingerprint(QEPlanCacheList *list, uint64 fingerprint, int size,
+				 int *nkept)
+{
+	int			i;
+
+	for (i = 0; i < list->count; i++)
+	{
+		if (list->fingerprints[i] == fingerprint)
+			break;
+	}
+
+	if (i < list->count)
+	{
+		int			found_size = list->sizes[i];
+
+		memmove(&list->fingerprints[1], &list->fingerprints[0],
+				i * sizeof(uint64));
+		memmove(&list->sizes[1], &list->sizes[0], i * sizeof(int));
+		list->fingerprints[0] = fingerprint;
+		list->sizes[0] = found_size;
+		return i;
+	}
+
+	Assert(QEPlanCacheFits(size));
+
+	while (list->count == QE_PLAN_CACHE_SIZE ||
+		   (list->count > 0 &&
+			list->totalSize + size > QE_PLAN_CACHE_MAX_BYTES))
+	{
+		list->count--;
+		list->totalSize -= list->sizes[list->count];
+	}
+	*nkept = list->count;
+
+	memmove(&list->fingerprints[1], &list->fingerprints[0],
+			list->count * sizeof(uint64));
+	memmove(&list->sizes[1], &list->sizes[0], list->count * sizeof(int));
+	list->fingerprints[0] = fingerprint;
+	list->sizes[0] = size;
+	list->count++;
+	list->totalSize += size;
+	return -1;
+}
+
+/*
+ * Record that the plan with this fingerprint and size is being dispatched
+ * to the QE behind segdbDesc, with or without the plan itself.  This must be
+ * called exactly once for every message to that QE that carries a
+ * fingerprint.
+ */
+void
+QEPlanCacheRemember(SegmentDatabaseDescriptor *segdbDesc, uint64 fingerprint,
+					int size)
+{
+	int			nkept;
+
+	Assert(fingerprint != 0);
+
+	if (!qePlanCacheCallbacksRegistered)
+	{
+		CacheRegisterRelcacheCallback(QEPlanCacheRelCallback, (Datum) 0);
+		CacheRegisterSyscacheCallback(PROCOID, QEPlanCacheSysCallback,
+									  (Datum) 0);
+		qePlanCacheCallbacksRegistered = true;
+	}
+
+	if (segdbDesc->cachedPlansGeneration != qePlanCacheGeneration)
+	{
+		MemSet(&segdbDesc->cachedPlans, 0, sizeof(segdbDesc->cachedPlans));
+		segdbDesc->cachedPlansGeneration = qePlanCacheGeneration;
+	}
+
+	touchFingerprint(&segdbDesc->cachedPlans, fingerprint, size, &nkept);
+}
+
+/*
+ * Forget what all QEs have cached.  Called when dispatching failed, or a QE
+ * failed or was canceled, and we can't be sure which QEs processed their
+ * message.
+ */
+void
+QEPlanCacheForgetAll(void)
+{
+	qePlanCacheGeneration++;
+	/* zero would match a freshly created segment descriptor */
+	if (qePlanCacheGeneration == 0)
+		qePlanCacheGeneration++;
+}
+
+/*
+ * Plans change when the relations they use or the functions they call do.
+ * The plans the QD dispatches afterwards have different fingerprints anyway,
+ * but there's no point in the QEs keeping the old plans around either, so
+ * we start over.
+ */
+static void
+QEPlanCacheRelCallback(Datum arg, Oid relid)
+{
+	QEPlanCacheForgetAll();
+}
+
+static void
+QEPlanCacheSysCallback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	QEPlanCacheForgetAll();
+}
+
+/*
+ * QE side: remember a plan that was dispatched with a fingerprint.  'size'
+ * is the size of the serialized plan before compression.
+ *
+ * If we already have it, it just becomes the most recently used one.
+ */
+void
+QEPlanCacheStore(uint64 fingerprint, int size, PlannedStmt *plan)
+{
+	QEPlanCacheEntry entry;
+	MemoryContext oldcontext;
+	int			oldcount = qePlanCacheList.count;
+	int			nkept;
+	int			i;
+
+	Assert(fingerprint != 0);
+
+	/* copy the plan first, so that running out of memory changes nothing */
+	entry.context = AllocSetContextCreate(TopMemoryContext,
+										  "QE plan cache entry",
+										  ALLOCSET_SMALL_MINSIZE,
+										  ALLOCSET_SMALL_INITSIZE,
+										  ALLOCSET_DEFAULT_MAXSIZE);
+	PG_TRY();
+	{
+		oldcontext = MemoryContextSwitchTo(entry.context);
+		entry.plan = copyObject(plan);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	PG_CATCH();
+	{
+		MemoryContextDelete(entry.context);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	i = touchFingerprint(&qePlanCacheList, fingerprint, size, &nkept);
+	if (i >= 0)
+	{
+		MemoryContextDelete(entry.context);
+
+		entry = qePlanCache[i];
+		memmove(&qePlanCache[1], &qePlanCache[0], i * sizeof(QEPlanCacheEntry));
+		qePlanCache[0] = entry;
+		return;
+	}
+
+	/* touchFingerprint() dropped the plans after the first nkept */
+	for (i = nkept; i < oldcount; i++)
+		MemoryContextDelete(qePlanCache[i].context);
+
+	memmove(&qePlanCache[1], &qePlanCache[0], nkept * sizeof(QEPlanCacheEntry));
+	qePlanCache[0] = entry;
+}
+
+/*
+ * QE side: get a copy of the cached plan with this fingerprint, in the
+ * current memory context, or NULL if we don't have it.
+ *
+ * The executor, and exec_mpp_query() itself, may scribble on the plan it
+ * runs, so the cached one is never handed out.
+ */
+PlannedStmt *
+QEPlanCacheLookup(uint64 fingerprint)
+{
+	QEPlanCacheEntry entry;
+	int			nkept;
+	int			i;
+
+	for (i = 0; i < qePlanCacheList.count; i++)
+	{
+		if (qePlanCacheList.fingerprints[i] == fingerprint)
+			break;
+	}
+	if (i == qePlanCacheList.count)
+		return NULL;
+
+	touchFingerprint(&qePlanCacheList, fingerprint, 0, &nkept);
+
+	entry = qePlanCache[i];
+	memmove(&qePlanCache[1], &qePlanCache[0], i * sizeof(QEPlanCacheEntry));
+	qePlanCache[0] = entry;
+
+	return (PlannedStmt *) copyObject(entry.plan);
+}
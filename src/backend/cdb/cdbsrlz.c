@@ -51,7 +51,29 @@ serializeNode(Node *node, int *size, int *uncompressed_size_out)
 	{
 		pszNode = nodeToBinaryStringFast(node, &uncompressed_size);
 		Assert(pszNode != NULL);
+	}
+	END_MEMORY_ACCOUNT();
+
+	sNode = compressSerializedNode(pszNode, uncompressed_size, size);
+
+	if (NULL != uncompressed_size_out)
+		*uncompressed_size_out = uncompressed_size;
+	return sNode;
+}
 
+/*
+ * Compress a string made by nodeToBinaryStringFast(), the way serializeNode()
+ * does.  Takes ownership of the input string, which may be returned as is.
+ */
+char *
+compressSerializedNode(char *pszNode, int uncompressed_size, int *size)
+{
+	char	   *sNode;
+
+	Assert(pszNode != NULL);
+	Assert(size != NULL);
+	START_MEMORY_ACCOUNT(MemoryAccounting_CreateAccount(0, MEMORY_OWNER_TYPE_Serializer));
+	{
 		/* If we have been compiled with libzstd, use it to compress it */
 #ifdef HAVE_LIBZSTD
 		sNode = compress_string(pszNode, uncompressed_size, size);
@@ -63,8 +85,6 @@ serializeNode(Node *node, int *size, int *uncompressed_size_out)
 	}
 	END_MEMORY_ACCOUNT();
 
-	if (NULL != uncompressed_size_out)
-		*uncompressed_size_out = uncompressed_size;
 	return sNode;
 }
 
@@ -101,6 +121,28 @@ deserializeNode(const char *strNode, int size)
 	return node;
 }
 
+/*
+ * Size of a string made by serializeNode() before it was compressed, which
+ * is also the size deserializeNode() works on.
+ */
+int
+serializedNodeSize(const char *strNode, int size)
+{
+#ifdef HAVE_LIBZSTD
+	unsigned long long uncompressed_size;
+
+	uncompressed_size = ZSTD_getFrameContentSize(strNode, size);
+	if (uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+		uncompressed_size == ZSTD_CONTENTSIZE_ERROR ||
+		uncompressed_size > MaxAllocSize)
+		elog(ERROR, "invalid compressed data");
+
+	return (int) uncompressed_size;
+#else
+	return size;
+#endif			/* HAVE_LIBZSTD */
+}
+
 #ifdef HAVE_LIBZSTD
 /*
  * Compress a (binary) string using libzstd
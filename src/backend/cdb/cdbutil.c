@@ -836,6 +836,10 @@ cleanupQE(SegmentDatabaseDescriptor *segdbDesc)
 	if (FtsIsSegmentDown(segdbDesc->segment_database_info))
 		return false; 
 
+	/* A pre-warmed QE that is still connecting has nothing to clean up */
+	if (segdbDesc->connecting)
+		return true;
+
 	/* If a reader exceed the cached memory limitation, destroy it */
 	if (!segdbDesc->isWriter &&
 		(segdbDesc->conn->mop_high_watermark >> 20) > gp_vmem_protect_gang_cache_limit)
@@ -917,7 +921,8 @@ destroy_segdb:
 
 	cdbconn_termSegmentDescriptor(segdbDesc);
 
-	if (segdbDesc->isWriter)
+	/* a writer that never finished connecting has not joined the transaction */
+	if (segdbDesc->isWriter && !segdbDesc->connecting)
 	{
 		markCurrentGxactWriterGangLost();
 	}
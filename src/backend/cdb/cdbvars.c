@@ -88,6 +88,11 @@ int			gp_safefswritesize; /* set for safe AO writes in non-mature fs */
 int			gp_cached_gang_threshold;	/* How many gangs to keep around from
 										 * stmt to stmt. */
 
+int			gp_prewarm_segworkers = 0;	/* How many QEs per segment to start
+										 * connecting at session start. */
+bool		gp_overlap_gang_creation = false;	/* Start the writer gang
+												 * before planning */
+
 bool		Gp_write_shared_snapshot;	/* tell the writer QE to write the
 										 * shared snapshot */
 
@@ -165,11 +170,13 @@ bool		gp_enable_slow_cursor_testmode = false;
 uint32		Gp_listener_port;
 
 int			Gp_max_packet_size; /* max Interconnect packet size */
+int			gp_motion_batch_size = 0;	/* tuples per column-wise batch */
 
 int			Gp_interconnect_queue_depth = 4;	/* max number of messages
 												 * waiting in rx-queue before
 												 * we drop. */
 int			Gp_interconnect_snd_queue_depth = 2;
+int			Gp_interconnect_io_batch_size = 32;
 int			Gp_interconnect_timer_period = 5;
 int			Gp_interconnect_timer_checking_period = 20;
 int			Gp_interconnect_default_rtt = 20;
@@ -192,6 +199,8 @@ bool		gp_interconnect_log_stats = false;	/* emit stats at log-level */
 
 bool		gp_interconnect_cache_future_packets = true;
 
+bool		gp_interconnect_shm = false;	/* same-host packets via shmem */
+
 int			Gp_udp_bufsize_k;	/* UPD recv buf size, in KB */
 
 #ifdef USE_ASSERT_CHECKING
@@ -231,6 +240,7 @@ bool		gp_selectivity_damping_sigsort = true;
 
 int			gp_hashjoin_tuples_per_bucket = 5;
 int			gp_hashagg_groups_per_bucket = 5;
+bool		gp_enable_runtime_filter = false;
 
 /* Analyzing aid */
 int			gp_motion_slice_noop = 0;
@@ -258,6 +268,12 @@ int			gp_segworker_relative_priority = PRIO_MAX;
 /* Max size of dispatched plans; 0 if no limit */
 int			gp_max_plan_size = 0;
 
+/* Send each gang only the part of the plan that it executes */
+bool		gp_dispatch_plan_fragments = false;
+
+/* Let the QEs cache the plans they are sent */
+bool		gp_qe_plan_cache = false;
+
 /* Disable setting of tuple hints while reading */
 bool		gp_disable_tuple_hints = false;
 
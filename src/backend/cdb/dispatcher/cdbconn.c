@@ -134,6 +134,9 @@ cdbconn_doConnectStart(SegmentDatabaseDescriptor *segdbDesc,
 	char		portstr[MAX_INT_STRING_LEN];
 	int			nkeywords = 0;
 
+	/* A new QE has no plans cached */
+	segdbDesc->cachedPlansGeneration = 0;
+
 	keywords[nkeywords] = "gpqeid";
 	values[nkeywords] = gpqeid;
 	nkeywords++;
@@ -238,6 +241,8 @@ cdbconn_doConnectStart(SegmentDatabaseDescriptor *segdbDesc,
 void
 cdbconn_doConnectComplete(SegmentDatabaseDescriptor *segdbDesc)
 {
+	segdbDesc->connecting = false;
+
 	PQsetNoticeReceiver(segdbDesc->conn, &MPPnoticeReceiver, segdbDesc);
 
 	/*
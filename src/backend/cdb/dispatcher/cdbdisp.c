@@ -26,6 +26,7 @@
 #include "libpq-int.h"
 #include "cdb/cdbfts.h"
 #include "cdb/cdbgang.h"
+#include "cdb/cdbplancache.h"
 #include "cdb/cdbsreh.h"
 #include "cdb/cdbvars.h"
 #include "utils/resowner.h"
@@ -116,6 +117,16 @@ cdbdisp_checkDispatchResult(struct CdbDispatcherState *ds,
 {
 	(pDispatchFuncs->checkResults) (ds, waitMode);
 
+	/*
+	 * A QE that failed, or was canceled, may have given up before it got to
+	 * caching the plan it was sent.  That doesn't always abort the
+	 * transaction: the QEs of a query that needs no more rows are canceled,
+	 * and some callers only report the errors of the QEs.
+	 */
+	if (waitMode == DISPATCH_WAIT_CANCEL ||
+		(ds->primaryResults != NULL && ds->primaryResults->errcode != 0))
+		QEPlanCacheForgetAll();
+
 	if (log_dispatch_stats)
 		ShowUsage("DISPATCH STATISTICS");
 
@@ -324,6 +335,16 @@ cdbdisp_makeDispatchParams(CdbDispatcherState *ds,
 	MemoryContextSwitchTo(oldContext);
 }
 
+void
+cdbdisp_setDispatchQueryText(CdbDispatcherState *ds,
+							 char *queryText,
+							 int queryTextLen)
+{
+	Assert(ds->dispatchParams != NULL);
+
+	(pDispatchFuncs->setQueryText) (ds->dispatchParams, queryText, queryTextLen);
+}
+
 /*
  * Free memory in CdbDispatcherState
  *
@@ -512,6 +533,12 @@ AtAbort_DispatcherState(void)
 
 	Assert(open_dispatcher_handles == NULL);
 
+	/*
+	 * We don't know which QEs got as far as caching the plan we sent them,
+	 * if any.
+	 */
+	QEPlanCacheForgetAll();
+
 	/*
 	 * If primary writer gang is destroyed in current Gxact
 	 * reset session and drop temp files
@@ -536,6 +563,8 @@ AtSubAbort_DispatcherState(void)
 	}
 
 	CdbResourceOwnerWalker(CurrentResourceOwner, cdbdisp_cleanupDispatcherHandle);
+
+	QEPlanCacheForgetAll();
 }
 
 void
@@ -82,6 +82,7 @@ typedef struct CdbDispatchCmdAsync
 } CdbDispatchCmdAsync;
 
 static void *cdbdisp_makeDispatchParams_async(int maxSlices, int largestGangSize, char *queryText, int len);
+static void cdbdisp_setQueryText_async(void *dispatchParams, char *queryText, int len);
 
 static void cdbdisp_checkDispatchResult_async(struct CdbDispatcherState *ds,
 								  DispatchWaitMode waitMode);
@@ -99,6 +100,7 @@ DispatcherInternalFuncs DispatcherAsyncFuncs =
 	cdbdisp_checkForCancel_async,
 	cdbdisp_getWaitSocketFd_async,
 	cdbdisp_makeDispatchParams_async,
+	cdbdisp_setQueryText_async,
 	cdbdisp_checkDispatchResult_async,
 	cdbdisp_dispatchToGang_async,
 	cdbdisp_waitDispatchFinish_async
@@ -366,6 +368,20 @@ cdbdisp_makeDispatchParams_async(int maxSlices, int largestGangSize, char *query
 	return (void *) pParms;
 }
 
+/*
+ * Switch the query text sent by later dispatchToGang calls.  The libpq
+ * connections send the text without copying it, so the old text must be
+ * kept around by the caller until dispatch is finished.
+ */
+static void
+cdbdisp_setQueryText_async(void *dispatchParams, char *queryText, int len)
+{
+	CdbDispatchCmdAsync *pParms = (CdbDispatchCmdAsync *) dispatchParams;
+
+	pParms->query_text = queryText;
+	pParms->query_text_len = len;
+}
+
 /*
  * Receive and process results from all running QEs.
  *
@@ -21,12 +21,14 @@
 #include "libpq-int.h"
 #include "cdb/cdbconn.h"
 #include "cdb/cdbgang.h"
+#include "cdb/cdbplancache.h"
 #include "cdb/cdbutil.h"
 #include "cdb/cdbvars.h"
 #include "cdb/cdbmutate.h"
 #include "cdb/cdbsrlz.h"
 #include "cdb/tupleremap.h"
 #include "nodes/execnodes.h"
+#include "optimizer/walkers.h"
 #include "tcop/tcopprot.h"
 #include "utils/datum.h"
 #include "utils/guc.h"
@@ -80,6 +82,12 @@ typedef struct DispatchCommandQueryParms
 	char	   *serializedParams;
 	int			serializedParamslen;
 
+	/*
+	 * Fingerprint of the plan for the QEs' plan cache, or 0.  If the plan
+	 * tree is left out, the QEs run the cached plan with this fingerprint.
+	 */
+	uint64		planFingerprint;
+
 	/*
 	 * Additional information.
 	 */
@@ -93,6 +101,33 @@ typedef struct DispatchCommandQueryParms
 	int			serializedDtxContextInfolen;
 } DispatchCommandQueryParms;
 
+/*
+ * Context for cutting a PlannedStmt into the fragments dispatched to each
+ * gang, see serializePlanFragment().
+ */
+typedef struct PlanFragmentContext
+{
+	plan_tree_base_prefix base; /* Required prefix for plan_tree_walker/mutator */
+	List	   *motions;		/* every Motion node in the plan */
+	List	   *motStack;		/* Motions above the node being visited */
+	Bitmapset **senders;		/* by motionID, motionIDs of Motions below */
+	Bitmapset  *subplans;		/* plan_id - 1 of SubPlans left in a fragment */
+} PlanFragmentContext;
+
+/*
+ * A serialized plan to dispatch, and the query strings made for it so far.
+ */
+typedef struct PlanPayload
+{
+	char	   *splan;			/* uncompressed, until a query string needs it */
+	int			splan_len;
+	uint64		fingerprint;	/* 0 unless the QEs are to cache the plan */
+	char	   *fullText;		/* query string carrying the plan */
+	int			fullTextLen;
+	char	   *cachedText;		/* query string carrying the fingerprint only */
+	int			cachedTextLen;
+} PlanPayload;
+
 static int fillSliceVector(SliceTable *sliceTable,
 				int sliceIndex,
 				SliceVec *sliceVector,
@@ -101,7 +136,14 @@ static int fillSliceVector(SliceTable *sliceTable,
 static char *buildGpQueryString(DispatchCommandQueryParms *pQueryParms,
 				   int *finalLen);
 
-static DispatchCommandQueryParms *cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc, bool planRequiresTxn);
+static DispatchCommandQueryParms *cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc, bool planRequiresTxn,
+							bool wholePlan);
+static void checkDispatchedPlanSize(int splan_len_uncompressed);
+static void buildSliceQueryStrings(struct QueryDesc *queryDesc,
+					   DispatchCommandQueryParms *pQueryParms,
+					   SliceVec *sliceVector, int nSlices,
+					   bool usePlanFragments,
+					   char **sliceQueryText, int *sliceQueryTextLength);
 static DispatchCommandQueryParms *cdbdisp_buildUtilityQueryParms(struct Node *stmt, int flags, List *oid_assignments);
 static DispatchCommandQueryParms *cdbdisp_buildCommandQueryParms(const char *strCommand, int flags);
 
@@ -540,7 +582,8 @@ cdbdisp_buildUtilityQueryParms(struct Node *stmt,
 
 static DispatchCommandQueryParms *
 cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc,
-							bool planRequiresTxn)
+							bool planRequiresTxn,
+							bool wholePlan)
 {
 	char	   *splan,
 			   *sddesc,
@@ -568,26 +611,23 @@ cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc,
 	 * serialized plan tree. Note that we're called for a single slice tree
 	 * (corresponding to an initPlan or the main plan), so the parameters are
 	 * fixed and we can include them in the prefix.
+	 *
+	 * If each gang gets its own query string, with its own fragment of the
+	 * plan or with the plan left out, the caller serializes the plan instead.
 	 */
-	splan = serializeNode((Node *) queryDesc->plannedstmt, &splan_len, &splan_len_uncompressed);
-
-	uint64		plan_size_in_kb = ((uint64) splan_len_uncompressed) / (uint64) 1024;
-
-	elog(((gp_log_gang >= GPVARS_VERBOSITY_TERSE) ? LOG : DEBUG1),
-		 "Query plan size to dispatch: " UINT64_FORMAT "KB", plan_size_in_kb);
+	if (wholePlan)
+	{
+		splan = serializeNode((Node *) queryDesc->plannedstmt, &splan_len, &splan_len_uncompressed);
+		checkDispatchedPlanSize(splan_len_uncompressed);
 
-	if (0 < gp_max_plan_size && plan_size_in_kb > gp_max_plan_size)
+		Assert(splan != NULL && splan_len > 0 && splan_len_uncompressed > 0);
+	}
+	else
 	{
-		ereport(ERROR,
-				(errcode(ERRCODE_STATEMENT_TOO_COMPLEX),
-				 (errmsg("Query plan size limit exceeded, current size: "
-						 UINT64_FORMAT "KB, max allowed size: %dKB",
-						 plan_size_in_kb, gp_max_plan_size),
-				  errhint("Size controlled by gp_max_plan_size"))));
+		splan = NULL;
+		splan_len = 0;
 	}
 
-	Assert(splan != NULL && splan_len > 0 && splan_len_uncompressed > 0);
-
 	if (queryDesc->params != NULL && queryDesc->params->numParams > 0)
 	{
 		sparams = serializeParamListInfo(queryDesc->params, &sparams_len);
@@ -626,6 +666,313 @@ cdbdisp_buildPlanQueryParms(struct QueryDesc *queryDesc,
 	return pQueryParms;
 }
 
+/*
+ * Log the size of a serialized plan about to be dispatched, and check it
+ * against gp_max_plan_size.
+ */
+static void
+checkDispatchedPlanSize(int splan_len_uncompressed)
+{
+	uint64		plan_size_in_kb = ((uint64) splan_len_uncompressed) / (uint64) 1024;
+
+	elog(((gp_log_gang >= GPVARS_VERBOSITY_TERSE) ? LOG : DEBUG1),
+		 "Query plan size to dispatch: " UINT64_FORMAT "KB", plan_size_in_kb);
+
+	if (0 < gp_max_plan_size && plan_size_in_kb > gp_max_plan_size)
+	{
+		ereport(ERROR,
+				(errcode(ERRCODE_STATEMENT_TOO_COMPLEX),
+				 (errmsg("Query plan size limit exceeded, current size: "
+						 UINT64_FORMAT "KB, max allowed size: %dKB",
+						 plan_size_in_kb, gp_max_plan_size),
+				  errhint("Size controlled by gp_max_plan_size"))));
+	}
+}
+
+/*
+ * Walker to collect the Motions of a plan, and for each of them the
+ * motionIDs of the Motions beneath it.  Subplans are visited through their
+ * SubPlan expressions, so a Motion inside an initPlan or a correlated
+ * subquery counts as beneath the Motions above that expression.
+ */
+static bool
+PlanFragmentMotionWalker(Node *node, PlanFragmentContext *ctx)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, Motion))
+	{
+		Motion	   *motion = (Motion *) node;
+		ListCell   *lc;
+
+		foreach(lc, ctx->motStack)
+		{
+			Motion	   *parent = (Motion *) lfirst(lc);
+
+			ctx->senders[parent->motionID] =
+				bms_add_member(ctx->senders[parent->motionID], motion->motionID);
+		}
+		ctx->motions = list_append_unique_ptr(ctx->motions, motion);
+
+		ctx->motStack = lcons(motion, ctx->motStack);
+		plan_tree_walker(node, PlanFragmentMotionWalker, ctx);
+		ctx->motStack = list_delete_first(ctx->motStack);
+
+		return false;
+	}
+
+	return plan_tree_walker(node, PlanFragmentMotionWalker, ctx);
+}
+
+/*
+ * Walker to find the SubPlans still referenced from a plan fragment.
+ */
+static bool
+PlanFragmentSubPlanWalker(Node *node, PlanFragmentContext *ctx)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, SubPlan))
+	{
+		int			i = ((SubPlan *) node)->plan_id - 1;
+
+		if (bms_is_member(i, ctx->subplans))
+			return false;
+		ctx->subplans = bms_add_member(ctx->subplans, i);
+	}
+
+	return plan_tree_walker(node, PlanFragmentSubPlanWalker, ctx);
+}
+
+/*
+ * Serialize, without compressing, the part of the plan that the gang
+ * executing slice 'sliceIndex' needs.
+ *
+ * With alien elimination, a QE only initializes the nodes between the
+ * sending Motion of its slice and the Motions it receives from (see
+ * InitPlan()), but it finds that Motion, and the initPlans whose values we
+ * dispatch, by walking down from the top of the plan.  So we keep the
+ * subtrees of the Motions that have the slice's sending Motion beneath them,
+ * and cut off the subtrees of all other Motions.  Subplans that are no
+ * longer referenced are replaced with NULLs, to keep the plan_ids of the
+ * others valid.
+ *
+ * The plan is modified in place while it is serialized, and put back
+ * together before returning.
+ */
+static char *
+serializePlanFragment(PlannedStmt *stmt, PlanFragmentContext *ctx,
+					  int sliceIndex, int *len)
+{
+	List	   *subplans = stmt->subplans;
+	List	   *fragment_subplans = NIL;
+	Plan	  **lefttrees;
+	ListCell   *lc;
+	char	   *result;
+	int			i;
+
+	lefttrees = palloc(list_length(ctx->motions) * sizeof(Plan *));
+
+	i = 0;
+	foreach(lc, ctx->motions)
+	{
+		Motion	   *motion = (Motion *) lfirst(lc);
+
+		lefttrees[i++] = motion->plan.lefttree;
+		if (motion->motionID != sliceIndex &&
+			!bms_is_member(sliceIndex, ctx->senders[motion->motionID]))
+			motion->plan.lefttree = NULL;
+	}
+
+	PG_TRY();
+	{
+		ctx->subplans = NULL;
+		PlanFragmentSubPlanWalker((Node *) stmt->planTree, ctx);
+
+		i = 0;
+		foreach(lc, subplans)
+		{
+			fragment_subplans = lappend(fragment_subplans,
+										bms_is_member(i, ctx->subplans) ? lfirst(lc) : NULL);
+			i++;
+		}
+		stmt->subplans = fragment_subplans;
+
+		result = nodeToBinaryStringFast(stmt, len);
+	}
+	PG_CATCH();
+	{
+		stmt->subplans = subplans;
+		i = 0;
+		foreach(lc, ctx->motions)
+			((Motion *) lfirst(lc))->plan.lefttree = lefttrees[i++];
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	stmt->subplans = subplans;
+	i = 0;
+	foreach(lc, ctx->motions)
+		((Motion *) lfirst(lc))->plan.lefttree = lefttrees[i++];
+
+	list_free(fragment_subplans);
+	bms_free(ctx->subplans);
+	ctx->subplans = NULL;
+	pfree(lefttrees);
+
+	return result;
+}
+
+static void
+initPlanPayload(PlanPayload *payload, char *splan, int splan_len)
+{
+	checkDispatchedPlanSize(splan_len);
+
+	payload->splan = splan;
+	payload->splan_len = splan_len;
+	if (gp_qe_plan_cache && QEPlanCacheFits(splan_len))
+		payload->fingerprint = QEPlanCacheFingerprint(splan, splan_len);
+	else
+		payload->fingerprint = 0;
+	payload->fullText = NULL;
+	payload->fullTextLen = 0;
+	payload->cachedText = NULL;
+	payload->cachedTextLen = 0;
+}
+
+/*
+ * Get the query string for dispatching a plan to a gang.
+ *
+ * If the plan has a fingerprint, and every QE of the gang has the plan in
+ * its cache, the plan itself is left out.  Either way, every QE is recorded
+ * as having the plan now.
+ */
+static char *
+getPlanQueryString(DispatchCommandQueryParms *pQueryParms,
+				   PlanPayload *payload, Gang *gang, int *finalLen)
+{
+	bool		cached = false;
+	int			i;
+
+	if (payload->fingerprint != 0)
+	{
+		cached = true;
+		for (i = 0; i < gang->size; i++)
+		{
+			if (!QEPlanCacheHasPlan(gang->db_descriptors[i], payload->fingerprint))
+			{
+				cached = false;
+				break;
+			}
+		}
+
+		for (i = 0; i < gang->size; i++)
+			QEPlanCacheRemember(gang->db_descriptors[i], payload->fingerprint,
+								payload->splan_len);
+	}
+
+	if (cached && payload->cachedText == NULL)
+	{
+		pQueryParms->planFingerprint = payload->fingerprint;
+		payload->cachedText = buildGpQueryString(pQueryParms, &payload->cachedTextLen);
+		pQueryParms->planFingerprint = 0;
+	}
+	else if (!cached && payload->fullText == NULL)
+	{
+		/* The uncompressed plan is no longer needed after this */
+		pQueryParms->serializedPlantree =
+			compressSerializedNode(payload->splan, payload->splan_len,
+								   &pQueryParms->serializedPlantreelen);
+		payload->splan = NULL;
+		pQueryParms->planFingerprint = payload->fingerprint;
+
+		payload->fullText = buildGpQueryString(pQueryParms, &payload->fullTextLen);
+
+		pfree(pQueryParms->serializedPlantree);
+		pQueryParms->serializedPlantree = NULL;
+		pQueryParms->serializedPlantreelen = 0;
+		pQueryParms->planFingerprint = 0;
+	}
+
+	if (cached)
+	{
+		*finalLen = payload->cachedTextLen;
+		return payload->cachedText;
+	}
+	*finalLen = payload->fullTextLen;
+	return payload->fullText;
+}
+
+/*
+ * Build the query string for each slice in sliceVector that is dispatched.
+ *
+ * With usePlanFragments, each carries only the plan fragment that the
+ * slice's gang executes.  Otherwise they carry the whole plan, and differ
+ * only in whether the QEs of the gang have it cached already.
+ */
+static void
+buildSliceQueryStrings(struct QueryDesc *queryDesc,
+					   DispatchCommandQueryParms *pQueryParms,
+					   SliceVec *sliceVector, int nSlices,
+					   bool usePlanFragments,
+					   char **sliceQueryText, int *sliceQueryTextLength)
+{
+	PlannedStmt *stmt = queryDesc->plannedstmt;
+	PlanFragmentContext ctx;
+	PlanPayload payload;
+	int			iSlice;
+
+	if (usePlanFragments)
+	{
+		exec_init_plan_tree_base(&ctx.base, stmt);
+		ctx.motions = NIL;
+		ctx.motStack = NIL;
+		ctx.senders = palloc0((stmt->nMotionNodes + 1) * sizeof(Bitmapset *));
+		ctx.subplans = NULL;
+
+		PlanFragmentMotionWalker((Node *) stmt->planTree, &ctx);
+		Assert(ctx.motStack == NIL);
+	}
+	else
+	{
+		char	   *splan;
+		int			splan_len;
+
+		splan = nodeToBinaryStringFast(stmt, &splan_len);
+		initPlanPayload(&payload, splan, splan_len);
+	}
+
+	for (iSlice = 0; iSlice < nSlices; iSlice++)
+	{
+		Slice	   *slice = sliceVector[iSlice].slice;
+
+		if (slice->gangType == GANGTYPE_UNALLOCATED)
+			continue;
+
+		if (usePlanFragments)
+		{
+			char	   *splan;
+			int			splan_len;
+
+			splan = serializePlanFragment(stmt, &ctx, slice->sliceIndex, &splan_len);
+			initPlanPayload(&payload, splan, splan_len);
+		}
+
+		sliceQueryText[iSlice] = getPlanQueryString(pQueryParms, &payload,
+													slice->primaryGang,
+													&sliceQueryTextLength[iSlice]);
+
+		if (usePlanFragments && payload.splan != NULL)
+			pfree(payload.splan);
+	}
+
+	if (!usePlanFragments && payload.splan != NULL)
+		pfree(payload.splan);
+}
+
 /*
  * Three Helper functions for cdbdisp_dispatchX:
  *
@@ -850,7 +1197,7 @@ buildGpQueryString(DispatchCommandQueryParms *pQueryParms,
 	 * Here we only need to determine the truncated size, the actual work is
 	 * done later when copying it to the result buffer.
 	 */
-	if (querytree || plantree)
+	if (querytree || plantree || pQueryParms->planFingerprint != 0)
 		command_len = strnlen(command, QUERY_STRING_TRUNCATE_SIZE - 1) + 1;
 	else
 		command_len = strlen(command) + 1;
@@ -880,7 +1227,8 @@ buildGpQueryString(DispatchCommandQueryParms *pQueryParms,
 		sddesc_len +
 		sizeof(numsegments) +
 		sizeof(resgroupInfo.len) +
-		resgroupInfo.len;
+		resgroupInfo.len +
+		sizeof(n32) * 2 /* planFingerprint */;
 
 	shared_query = palloc0(total_query_len);
 
@@ -995,6 +1343,19 @@ buildGpQueryString(DispatchCommandQueryParms *pQueryParms,
 		pos += resgroupInfo.len;
 	}
 
+	/*
+	 * High order half first, like currentStatementStartTimestamp
+	 */
+	n32 = (uint32) (pQueryParms->planFingerprint >> 32);
+	n32 = htonl(n32);
+	memcpy(pos, &n32, sizeof(n32));
+	pos += sizeof(n32);
+
+	n32 = (uint32) pQueryParms->planFingerprint;
+	n32 = htonl(n32);
+	memcpy(pos, &n32, sizeof(n32));
+	pos += sizeof(n32);
+
 	len = pos - shared_query - 1;
 
 	/*
@@ -1029,6 +1390,10 @@ cdbdisp_dispatchX(QueryDesc* queryDesc,
 	int			rootIdx;
 	char	   *queryText = NULL;
 	int			queryTextLength = 0;
+	char	  **sliceQueryText = NULL;
+	int		   *sliceQueryTextLength = NULL;
+	bool		usePlanFragments;
+	bool		usePlanCache;
 	struct SliceTable *sliceTbl;
 	struct EState *estate;
 	CdbDispatcherState *ds;
@@ -1069,8 +1434,28 @@ cdbdisp_dispatchX(QueryDesc* queryDesc,
 	sliceVector = palloc0(nTotalSlices * sizeof(SliceVec));
 	nSlices = fillSliceVector(sliceTbl, rootIdx, sliceVector, nTotalSlices);
 
-	pQueryParms = cdbdisp_buildPlanQueryParms(queryDesc, planRequiresTxn);
-	queryText = buildGpQueryString(pQueryParms, &queryTextLength);
+	/*
+	 * The QEs can only run from a fragment of the plan if they leave out the
+	 * nodes of other slices; and with no Motions there is nothing to leave
+	 * out.
+	 */
+	usePlanFragments = gp_dispatch_plan_fragments &&
+		execute_pruned_plan &&
+		queryDesc->plannedstmt->nMotionNodes > 0;
+	usePlanCache = gp_qe_plan_cache;
+
+	pQueryParms = cdbdisp_buildPlanQueryParms(queryDesc, planRequiresTxn,
+											  !usePlanFragments && !usePlanCache);
+	if (usePlanFragments || usePlanCache)
+	{
+		sliceQueryText = palloc0(nSlices * sizeof(char *));
+		sliceQueryTextLength = palloc0(nSlices * sizeof(int));
+		buildSliceQueryStrings(queryDesc, pQueryParms, sliceVector, nSlices,
+							   usePlanFragments,
+							   sliceQueryText, sliceQueryTextLength);
+	}
+	else
+		queryText = buildGpQueryString(pQueryParms, &queryTextLength);
 
 	/*
 	 * Allocate result array with enough slots for QEs of primary gangs.
@@ -1143,6 +1528,9 @@ cdbdisp_dispatchX(QueryDesc* queryDesc,
 		}
 		SIMPLE_FAULT_INJECTOR("before_one_slice_dispatched");
 
+		if (sliceQueryText)
+			cdbdisp_setDispatchQueryText(ds, sliceQueryText[iSlice],
+										 sliceQueryTextLength[iSlice]);
 		cdbdisp_dispatchToGang(ds, primaryGang, si);
 		if (planRequiresTxn || isDtxExplicitBegin())
 			addToGxactTwophaseSegments(primaryGang);
@@ -1151,6 +1539,11 @@ cdbdisp_dispatchX(QueryDesc* queryDesc,
 	}
 
 	pfree(sliceVector);
+	if (sliceQueryText)
+	{
+		pfree(sliceQueryText);
+		pfree(sliceQueryTextLength);
+	}
 
 	cdbdisp_waitDispatchFinish(ds);
 
@@ -19,12 +19,15 @@
 #include "utils/memutils.h"
 
 #include "access/xact.h"
+#include "catalog/gp_policy.h"
 #include "catalog/namespace.h"
 #include "commands/variable.h"
 #include "nodes/execnodes.h"	/* CdbProcess, Slice, SliceTable */
+#include "nodes/nodeFuncs.h"
 #include "postmaster/postmaster.h"
 #include "tcop/tcopprot.h"
 #include "utils/int8.h"
+#include "utils/rel.h"
 #include "utils/sharedsnapshot.h"
 #include "tcop/pquery.h"
 
@@ -74,6 +77,7 @@ static bool NeedResetSession = false;
 static Oid	OldTempNamespace = InvalidOid;
 
 static void resetSessionForPrimaryGangLoss(void);
+static bool queryNeedsSegmentsWalker(Node *node, void *context);
 
 /*
  * cdbgang_createGang:
@@ -673,6 +677,101 @@ void DisconnectAndDestroyUnusedQEs(void)
 	}
 }
 
+/*
+ * Start connecting the QEs of a new session ahead of its first query.
+ *
+ * Called once, when the session first becomes idle, just before we tell the
+ * client that we're ready.  The segments then start up the QEs while the
+ * client sends its first query, and while we parse and plan it, rather than
+ * after that.  gp_prewarm_segworkers QEs are started on every segment: the
+ * writer, and readers for the other slices, up to as many as would be kept
+ * around between statements anyway.
+ */
+void
+PrewarmSessionQEs(void)
+{
+	if (Gp_role != GP_ROLE_DISPATCH || gp_prewarm_segworkers <= 0)
+		return;
+
+	if (cdbcomponent_qesExist())
+		return;
+
+	cdbgang_prewarmQEs_async(Min(gp_prewarm_segworkers, gp_cached_gang_threshold + 1));
+}
+
+/*
+ * Start connecting the writer gang for a query that is about to be planned.
+ *
+ * Called before planning, when the session has no QEs at all, either
+ * because it's new or because they were released after it had been idle.
+ * If the query reads or writes distributed tables, it's going to need at
+ * least the writer gang, and we start it now, so that the segments start up
+ * the QEs while we plan the query.  AssignGangs() then picks up the writers
+ * from the freelists, and completes their connections.
+ */
+void
+PrewarmWriterGangForQuery(Query *query)
+{
+	if (Gp_role != GP_ROLE_DISPATCH || !gp_overlap_gang_creation)
+		return;
+
+	if (cdbcomponent_qesExist() || CurrentGangCreating != NULL)
+		return;
+
+	if (!IsTransactionState())
+		return;
+
+	if (!queryNeedsSegmentsWalker((Node *) query, NULL))
+		return;
+
+	/*
+	 * cdbgang_prewarmQEs_async() swallows its errors, so load the segment
+	 * configuration here, where a catalog error is reported normally.
+	 */
+	cdbcomponent_getCdbComponents();
+
+	cdbgang_prewarmQEs_async(1);
+}
+
+/*
+ * Does the query use any relation that lives on the segments?
+ */
+static bool
+queryNeedsSegmentsWalker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+		Relation	rel;
+		bool		result;
+
+		if (rte->rtekind != RTE_RELATION)
+			return false;
+
+		if (rte->forceDistRandom)
+			return true;
+
+		/* the parser has locked it already */
+		rel = RelationIdGetRelation(rte->relid);
+		if (!RelationIsValid(rel))
+			return false;
+		result = GpPolicyIsPartitioned(rel->rd_cdbpolicy) ||
+			GpPolicyIsReplicated(rel->rd_cdbpolicy);
+		RelationClose(rel);
+
+		return result;
+	}
+
+	if (IsA(node, Query))
+		return query_tree_walker((Query *) node, queryNeedsSegmentsWalker,
+								 context, QTW_EXAMINE_RTES);
+
+	return expression_tree_walker(node, queryNeedsSegmentsWalker, context);
+}
+
 /*
  * Drop any temporary tables associated with the current session and
  * use a new session id since we have effectively reset the session.
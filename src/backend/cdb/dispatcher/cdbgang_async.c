@@ -31,6 +31,7 @@
 #include "cdb/cdbgang_async.h"
 #include "cdb/cdbvars.h"
 #include "miscadmin.h"
+#include "utils/faultinjector.h"
 
 static int	getPollTimeout(const struct timeval *startTS);
 
@@ -110,11 +111,29 @@ create_gang_retry:
 			/* if it's a cached QE, skip */
 			if (segdbDesc->conn != NULL && !cdbconn_isBadConnection(segdbDesc))
 			{
+				/* a pre-warmed QE may not be connected yet, finish it below */
+				if (segdbDesc->connecting)
+				{
+					SIMPLE_FAULT_INJECTOR("create_gang_prewarmed_qe");
+
+					connStatusDone[i] = false;
+					pollingStatus[i] = segdbDesc->pollingStatus;
+					continue;
+				}
+
 				connStatusDone[i] = true;
 				successful_connections++;
 				continue;
 			}
 
+			/* a pre-warmed connection, or a retried one, that failed */
+			if (segdbDesc->conn != NULL)
+			{
+				PQfinish(segdbDesc->conn);
+				segdbDesc->conn = NULL;
+			}
+			segdbDesc->connecting = false;
+
 			/*
 			 * Build the connection string.  Writer-ness needs to be processed
 			 * early enough now some locks are taken before command line
@@ -325,6 +344,214 @@ create_gang_retry:
 	return newGangDefinition;
 }
 
+/*
+ * Is a pre-warmed connection still short of having sent its startup packet?
+ */
+static bool
+prewarmInProgress(SegmentDatabaseDescriptor *segdbDesc)
+{
+	switch (PQstatus(segdbDesc->conn))
+	{
+		case CONNECTION_STARTED:
+		case CONNECTION_MADE:
+		case CONNECTION_SSL_STARTUP:
+		case CONNECTION_NEEDED:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/*
+ * Start connecting qesPerSegment new idle QEs on every segment, without
+ * waiting for them to come up.  If there are no QEs yet, the first one on
+ * each segment becomes the writer.
+ *
+ * The connections are driven only until the startup packets are sent.  From
+ * then on, the segments fork and initialize the QE backends on their own,
+ * while we go on with something else.  The new QEs are put on the freelists
+ * like any idle QE, and whoever allocates one of them next finishes the
+ * connection in cdbgang_createGang_async(), which by then normally only has
+ * to read the replies.
+ *
+ * Errors are not reported, only logged: the QEs that were started are
+ * dropped, and the next gang creation tries again, and reports whatever
+ * goes wrong then.  Query cancel is the exception.
+ *
+ * The caller must make sure that the segment configuration has been loaded
+ * already, or that we're outside a transaction, so that nothing else than
+ * memory and connections is acquired here.
+ */
+void
+cdbgang_prewarmQEs_async(int qesPerSegment)
+{
+	MemoryContext oldContext = CurrentMemoryContext;
+	SegmentDatabaseDescriptor **volatile segdbDescs = NULL;
+	SegmentDatabaseDescriptor *segdbDesc;
+	struct pollfd *fds = NULL;
+	struct timeval startTS;
+	volatile int nstarted = 0;
+	int			i;
+
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+	Assert(CurrentGangCreating == NULL);
+
+	if (qesPerSegment <= 0)
+		return;
+
+	PG_TRY();
+	{
+		List	   *segments = cdbcomponent_getCdbComponentsList();
+		int			totalSegs = getgpsegmentCount();
+		ListCell   *lc;
+		int			size;
+		int			n;
+
+		size = list_length(segments) * qesPerSegment;
+
+		ELOG_DISPATCHER_DEBUG("prewarmQEs size = %d", size);
+
+		segdbDescs = palloc0(sizeof(SegmentDatabaseDescriptor *) * size);
+		fds = palloc0(sizeof(struct pollfd) * size);
+
+		for (n = 0; n < qesPerSegment; n++)
+		{
+			foreach(lc, segments)
+			{
+				char		gpqeid[100];
+
+				segdbDesc = cdbcomponent_allocateIdleQE(lfirst_int(lc), SEGMENTTYPE_ANY);
+				segdbDescs[nstarted++] = segdbDesc;
+
+				/*
+				 * Callers only pre-warm when there are no idle QEs, but if
+				 * we got a cached one anyway, it's ready already.
+				 */
+				if (segdbDesc->conn != NULL)
+					continue;
+
+				if (!build_gpqeid_param(gpqeid, sizeof(gpqeid),
+										segdbDesc->isWriter,
+										segdbDesc->identifier,
+										segdbDesc->segment_database_info->hostSegs,
+										totalSegs * 2))
+					ereport(ERROR,
+							(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+							 errmsg("failed to construct connectionstring")));
+
+				cdbconn_doConnectStart(segdbDesc, gpqeid, makeOptions());
+
+				if (cdbconn_isBadConnection(segdbDesc))
+					ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+									errmsg("failed to acquire resources on one or more segments"),
+									errdetail("%s (%s)", PQerrorMessage(segdbDesc->conn), segdbDesc->whoami)));
+
+				segdbDesc->connecting = true;
+				segdbDesc->pollingStatus = PGRES_POLLING_WRITING;
+			}
+		}
+
+		gettimeofday(&startTS, NULL);
+
+		for (;;)
+		{
+			int			poll_timeout = getPollTimeout(&startTS);
+			int			nready;
+			int			nfds = 0;
+
+			for (i = 0; i < nstarted; i++)
+			{
+				segdbDesc = segdbDescs[i];
+				/*
+				 * A connection that failed is not in progress anymore either;
+				 * cdbcomponent_recycleIdleQE() drops it below.
+				 */
+				if (!segdbDesc->connecting || !prewarmInProgress(segdbDesc))
+					continue;
+
+				fds[nfds].fd = PQsocket(segdbDesc->conn);
+				fds[nfds].events =
+					segdbDesc->pollingStatus == PGRES_POLLING_READING ? POLLIN : POLLOUT;
+				fds[nfds].revents = 0;
+				nfds++;
+			}
+
+			if (nfds == 0)
+				break;
+
+			if (poll_timeout == 0)
+				ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+								errmsg("failed to acquire resources on one or more segments"),
+								errdetail("timeout expired")));
+
+			CHECK_FOR_INTERRUPTS();
+
+			nready = poll(fds, nfds, poll_timeout);
+
+			if (nready < 0)
+			{
+				int			sock_errno = SOCK_ERRNO;
+
+				if (sock_errno == EINTR)
+					continue;
+
+				ereport(ERROR, (errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+								errmsg("failed to acquire resources on one or more segments"),
+								errdetail("poll() failed: errno = %d", sock_errno)));
+			}
+			else if (nready > 0)
+			{
+				int			currentFdNumber = 0;
+
+				for (i = 0; i < nstarted; i++)
+				{
+					segdbDesc = segdbDescs[i];
+					if (!segdbDesc->connecting || !prewarmInProgress(segdbDesc))
+						continue;
+
+					Assert(PQsocket(segdbDesc->conn) == fds[currentFdNumber].fd);
+
+					if (fds[currentFdNumber].revents & fds[currentFdNumber].events ||
+						fds[currentFdNumber].revents & (POLLERR | POLLHUP | POLLNVAL))
+						segdbDesc->pollingStatus = PQconnectPoll(segdbDesc->conn);
+
+					currentFdNumber++;
+				}
+			}
+		}
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		MemoryContextSwitchTo(oldContext);
+		edata = CopyErrorData();
+		FlushErrorState();
+
+		for (i = 0; i < nstarted; i++)
+			cdbcomponent_recycleIdleQE(segdbDescs[i], true);
+
+		if (edata->sqlerrcode == ERRCODE_QUERY_CANCELED)
+			ReThrowError(edata);
+
+		elog(LOG, "could not pre-warm QEs: %s%s%s",
+			 edata->message,
+			 edata->detail ? ": " : "",
+			 edata->detail ? edata->detail : "");
+		FreeErrorData(edata);
+
+		return;
+	}
+	PG_END_TRY();
+
+	/* park them on the freelists */
+	for (i = 0; i < nstarted; i++)
+		cdbcomponent_recycleIdleQE(segdbDescs[i], false);
+
+	pfree(segdbDescs);
+	pfree(fds);
+}
+
 static int
 getPollTimeout(const struct timeval *startTS)
 {
@@ -73,6 +73,17 @@ static void statSendEOS(MotionLayerState *mlStates, MotionNodeEntry *pMNEntry);
 static void statChunksProcessed(MotionLayerState *mlStates, MotionNodeEntry *pMNEntry, int chunksProcessed, int chunkBytes, int tupleBytes);
 static void statNewTupleArrived(MotionNodeEntry *pMNEntry, ChunkSorterEntry *pCSEntry);
 static void statRecvTuple(MotionNodeEntry *pMNEntry, ChunkSorterEntry *pCSEntry);
+static SerTupBatch *getSendBatch(MotionLayerState *mlStates,
+			 ChunkTransportState *transportStates,
+			 MotionNodeEntry *pMNEntry,
+			 int16 motNodeID,
+			 int16 targetRoute);
+static SendReturnCode sendTupleBatch(MotionLayerState *mlStates,
+			   ChunkTransportState *transportStates,
+			   MotionNodeEntry *pMNEntry,
+			   int16 motNodeID,
+			   int16 targetRoute,
+			   SerTupBatch *batch);
 static bool ShouldSendRecordCache(MotionConn *conn, SerTupInfo *pSerInfo);
 static void UpdateSentRecordCache(MotionConn *conn);
 
@@ -100,12 +111,16 @@ reconstructTuple(MotionNodeEntry *pMNEntry, ChunkSorterEntry *pCSEntry, TupleRem
 	if (!tup)
 		return;
 
-	tup = TRCheckAndRemap(remapper, pSerInfo->tupdesc, tup);
+	/* A column-wise batch turns into several tuples. */
+	do
+	{
+		tup = TRCheckAndRemap(remapper, pSerInfo->tupdesc, tup);
 
-	htfifo_addtuple(pCSEntry->ready_tuples, tup);
+		htfifo_addtuple(pCSEntry->ready_tuples, tup);
 
-	/* Stats */
-	statNewTupleArrived(pMNEntry, pCSEntry);
+		/* Stats */
+		statNewTupleArrived(pMNEntry, pCSEntry);
+	} while ((tup = GetNextBatchTuple(pSerInfo)) != NULL);
 }
 
 /*
@@ -269,6 +284,8 @@ UpdateMotionLayerNode(MotionLayerState *mlStates, int16 motNodeID, bool preserve
 	pEntry->preserve_order = preserveOrder;
 	pEntry->tuple_desc = CreateTupleDescCopy(tupDesc);
 	InitSerTupInfo(pEntry->tuple_desc, &pEntry->ser_tup_info);
+	pEntry->send_batches = NULL;
+	pEntry->num_send_batches = 0;
 
 	if (!preserveOrder)
 	{
@@ -456,6 +473,24 @@ SendTuple(MotionLayerState *mlStates,
 	 */
 	pMNEntry = getMotionNodeEntry(mlStates, motNodeID);
 
+	/*
+	 * Tuples that can be batched are only sent once their batch is full, or
+	 * at end-of-stream.
+	 */
+	if (pMNEntry->ser_tup_info.batchable)
+	{
+		SerTupBatch *batch;
+
+		batch = getSendBatch(mlStates, transportStates, pMNEntry, motNodeID, targetRoute);
+		if (batch != NULL)
+		{
+			if (!AddTupleToBatch(&pMNEntry->ser_tup_info, batch, slot))
+				return SEND_COMPLETE;
+
+			return sendTupleBatch(mlStates, transportStates, pMNEntry, motNodeID, targetRoute, batch);
+		}
+	}
+
 #ifdef AMS_VERBOSE_LOGGING
 	elog(DEBUG5, "Serializing HeapTuple for sending.");
 #endif
@@ -533,6 +568,7 @@ SendEndOfStream(MotionLayerState *mlStates,
 				int motNodeID)
 {
 	MotionNodeEntry *pMNEntry;
+	int			i;
 
 	/*
 	 * Pull up the motion node entry with the node's details.  This includes
@@ -541,6 +577,19 @@ SendEndOfStream(MotionLayerState *mlStates,
 	 */
 	pMNEntry = getMotionNodeEntry(mlStates, motNodeID);
 
+	/* Send any batched tuples ahead of the end-of-stream. */
+	for (i = 0; i < pMNEntry->num_send_batches; i++)
+	{
+		SerTupBatch *batch = pMNEntry->send_batches[i];
+
+		if (batch == NULL || batch->ntuples == 0)
+			continue;
+
+		(void) sendTupleBatch(mlStates, transportStates, pMNEntry, motNodeID,
+							  i == pMNEntry->num_send_batches - 1 ? BROADCAST_SEGIDX : i,
+							  batch);
+	}
+
 	transportStates->SendEos(transportStates, motNodeID, s_eos_chunk_data);
 
 	/*
@@ -1235,6 +1284,112 @@ statRecvTuple(MotionNodeEntry *pMNEntry, ChunkSorterEntry *pCSEntry)
 	pMNEntry->stat_tuples_available--;
 }
 
+/*
+ * Get the batch of tuples for a route, creating it on first use.
+ *
+ * Returns NULL, and stops batching for the motion node, if the tuples are
+ * too wide to batch.
+ */
+static SerTupBatch *
+getSendBatch(MotionLayerState *mlStates,
+			 ChunkTransportState *transportStates,
+			 MotionNodeEntry *pMNEntry,
+			 int16 motNodeID,
+			 int16 targetRoute)
+{
+	MemoryContext oldCtxt;
+	SerTupBatch *batch;
+	int			i;
+
+	if (pMNEntry->send_batches == NULL)
+	{
+		ChunkTransportStateEntry *pEntry = NULL;
+
+		getChunkTransportState(transportStates, motNodeID, &pEntry);
+
+		/* the last one is for broadcasts */
+		pMNEntry->num_send_batches = pEntry->numConns + 1;
+		pMNEntry->send_batches = (SerTupBatch **)
+			MemoryContextAllocZero(mlStates->motion_layer_mctx,
+								   pMNEntry->num_send_batches * sizeof(SerTupBatch *));
+	}
+
+	if (targetRoute == BROADCAST_SEGIDX)
+		i = pMNEntry->num_send_batches - 1;
+	else
+		i = targetRoute;
+	Assert(i >= 0 && i < pMNEntry->num_send_batches);
+
+	batch = pMNEntry->send_batches[i];
+	if (batch == NULL)
+	{
+		oldCtxt = MemoryContextSwitchTo(mlStates->motion_layer_mctx);
+		batch = CreateTupleBatch(&pMNEntry->ser_tup_info);
+		MemoryContextSwitchTo(oldCtxt);
+
+		if (batch == NULL)
+			pMNEntry->ser_tup_info.batchable = false;
+		pMNEntry->send_batches[i] = batch;
+	}
+
+	return batch;
+}
+
+/*
+ * Send out the tuples of a batch, and empty it.
+ */
+static SendReturnCode
+sendTupleBatch(MotionLayerState *mlStates,
+			   ChunkTransportState *transportStates,
+			   MotionNodeEntry *pMNEntry,
+			   int16 motNodeID,
+			   int16 targetRoute,
+			   SerTupBatch *batch)
+{
+	struct directTransportBuffer b;
+	TupleChunkListData tcList;
+	MemoryContext oldCtxt;
+	int			ntuples = batch->ntuples;
+	int			sent;
+	SendReturnCode rc = SEND_COMPLETE;
+
+	if (targetRoute != BROADCAST_SEGIDX)
+		getTransportDirectBuffer(transportStates, motNodeID, targetRoute, &b);
+
+	oldCtxt = MemoryContextSwitchTo(mlStates->motion_layer_mctx);
+
+	sent = SerializeTupleBatch(&pMNEntry->ser_tup_info, batch, &b, &tcList, targetRoute);
+
+	MemoryContextSwitchTo(oldCtxt);
+
+	if (sent > 0)
+	{
+		putTransportDirectBuffer(transportStates, motNodeID, targetRoute, sent);
+
+		/* fill-in tcList fields to update stats */
+		tcList.num_chunks = 1;
+		tcList.serialized_data_length = sent;
+	}
+	else if (!SendTupleChunkToAMS(mlStates, transportStates, motNodeID, targetRoute, tcList.p_first))
+	{
+		pMNEntry->stopped = true;
+		rc = STOP_SENDING;
+	}
+
+	if (rc == SEND_COMPLETE)
+	{
+		/* update stats, counting every tuple of the batch as a send */
+		statSendTuple(mlStates, pMNEntry, &tcList);
+		pMNEntry->stat_total_sends += ntuples - 1;
+	}
+
+	/* cleanup */
+	if (sent == 0)
+		clearTCList(&pMNEntry->ser_tup_info.chunkCache, &tcList);
+
+	return rc;
+}
+
 /*
  * Return true if the record cache should be sent to master
  */
@@ -0,0 +1,620 @@
+/*-------------------------------------------------------------------------
+ * ic_shm.c
+ *	   Shared memory transport for interconnect connections between QEs on
+ *	   the same host.
+ *
+ * When gp_interconnect_shm is on, and the sending and the receiving QE of a
+ * UDP interconnect connection run on the same host, the packets of that
+ * connection are passed through a ring of packet-sized slots in a shared
+ * memory segment instead of over the network.  The sender builds packets
+ * exactly like it does for the network and copies them into the ring, the
+ * receiver parses them where they are and releases the slot when the motion
+ * layer is done with it.  The ring has a single producer and a single
+ * consumer, so the two counters are all the synchronization it needs, and
+ * nothing is ever retransmitted or acknowledged.
+ *
+ * The primary segments on a host are separate instances, each with its own
+ * postmaster and shared memory.  dsm.c can't be used between them, as its
+ * segments are tracked in the control segment of one postmaster, and
+ * neither can shm_mq.c, which wakes up its peer through the peer's PGPROC.
+ * The segments are therefore managed with the dsm_impl.c primitives, under
+ * a handle that both ends derive from the identity of the connection.
+ * Whichever end comes first creates the segment, the other one attaches to
+ * it, and the last one to leave destroys it.
+ *
+ * A sender that finds the ring full sleeps on a latch in the segment, which
+ * the receiver sets when it releases a slot.  A receiver sleeps on the UDP
+ * interconnect's latch, as it may be waiting for network connections at the
+ * same time.  Before it does, it flags the rings it is interested in, and a
+ * sender that sees the flag after adding a packet has the receiver's rx
+ * thread set that latch by sending it a small wakeup packet.
+ *
+ * Portions Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/backend/cdb/motion/ic_shm.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include <signal.h>
+
+#include "access/hash.h"
+#include "cdb/cdbgang.h"
+#include "cdb/cdbvars.h"
+#include "cdb/ic_shm.h"
+#include "miscadmin.h"
+#include "port/atomics.h"
+#include "storage/dsm_impl.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/pmsignal.h"
+#include "utils/faultinjector.h"
+#include "utils/memutils.h"
+
+#define SHMIC_MAGIC				0x4753494d
+#define SHMIC_WAIT_TIMEOUT_MS	250
+
+/* Number of attempts to attach to a segment that is being created */
+#define SHMIC_ATTACH_RETRIES	1000
+
+/* What both ends know about a connection */
+typedef struct ShmICIdentity
+{
+	int32		sessionId;
+	uint32		icId;
+	int32		motNodeId;
+	int32		sndPid;
+	int32		rcvPid;
+} ShmICIdentity;
+
+/*
+ * Header of a connection's segment, followed by the slots.  A packet is
+ * written to slot (head % nslots) and read from slot (tail % nslots); the
+ * ring is empty when head == tail and full when head - tail == nslots.
+ */
+typedef struct ShmICRing
+{
+	pg_atomic_uint32 magic;		/* set once the header is initialized */
+	ShmICIdentity ident;
+	int			nslots;
+	int			slotsize;
+
+	pg_atomic_uint32 nattached;	/* ends currently attached */
+	volatile bool sndAttached;	/* has the sender ever attached? */
+	volatile bool rcvAttached;	/* has the receiver ever attached? */
+
+	pg_atomic_uint32 head;		/* packets added by the sender */
+	pg_atomic_uint32 tail;		/* packets released by the receiver */
+
+	volatile bool sndWaiting;	/* sender sleeps on sndLatch */
+	volatile bool rcvWaiting;	/* receiver wants a wakeup packet */
+	volatile bool stopRequested;	/* receiver wants no more packets */
+
+	Latch		sndLatch;		/* owned by the sender */
+} ShmICRing;
+
+#define SHMIC_RING_HEADER_SIZE	MAXALIGN(sizeof(ShmICRing))
+
+#define SHMIC_SLOT(ring, n) \
+	((icpkthdr *) ((char *) (ring) + SHMIC_RING_HEADER_SIZE + \
+				   (Size) ((n) % (ring)->nslots) * (ring)->slotsize))
+
+/* A process's attachment to a connection's segment */
+struct ShmICConn
+{
+	dsm_handle	handle;
+	void	   *impl_private;
+	void	   *mapped_address;
+	Size		mapped_size;
+	bool		isSender;
+	ShmICRing  *ring;
+};
+
+/*
+ * Segments this process is attached to, and segments a receiver left behind
+ * for a sender that never attached.  The latter are destroyed at the start of
+ * the next statement, or at process exit.  Both live in TopMemoryContext.
+ */
+static List *attachedConns = NIL;
+static List *abandonedConns = NIL;
+static bool cleanupRegistered = false;
+
+static void shmic_proc_exit(int code, Datum arg);
+static void shmic_sender_wait(ShmICConn *shm, bool forSpace);
+
+/*
+ * ShmICSameHost
+ *		Should the connection between two processes use shared memory?
+ *
+ * Both ends of a connection must come to the same answer independently, so
+ * this only looks at the listener addresses in the slice table, which both
+ * ends have the same copy of.  Connections to or from the master are left to
+ * the network, because the master's address is rewritten on the sending
+ * side.
+ */
+bool
+ShmICSameHost(CdbProcess *self, CdbProcess *peer)
+{
+	if (!gp_interconnect_shm)
+		return false;
+
+	if (dynamic_shared_memory_type != DSM_IMPL_POSIX &&
+		dynamic_shared_memory_type != DSM_IMPL_SYSV)
+		return false;
+
+	if (self == NULL || peer == NULL ||
+		self->contentid < 0 || peer->contentid < 0 ||
+		self->listenerAddr == NULL || peer->listenerAddr == NULL)
+		return false;
+
+	return strcmp(self->listenerAddr, peer->listenerAddr) == 0;
+}
+
+/*
+ * ShmICLocalProcess
+ *		Find this process in a slice's list of processes.
+ */
+CdbProcess *
+ShmICLocalProcess(List *processes)
+{
+	ListCell   *lc;
+
+	foreach(lc, processes)
+	{
+		CdbProcess *proc = (CdbProcess *) lfirst(lc);
+
+		if (proc != NULL && proc->pid == MyProcPid)
+			return proc;
+	}
+
+	return NULL;
+}
+
+/*
+ * ShmICAttach
+ *		Create, or attach to, the segment of a connection.
+ */
+ShmICConn *
+ShmICAttach(int motNodeId, int sndPid, int rcvPid, bool isSender)
+{
+	ShmICIdentity ident;
+	ShmICConn  *shm;
+	ShmICRing  *ring = NULL;
+	void	   *impl_private = NULL;
+	void	   *mapped_address = NULL;
+	Size		mapped_size = 0;
+	MemoryContext oldcontext;
+	dsm_handle	handle;
+	int			slotsize = MAXALIGN(Gp_max_packet_size);
+	Size		size = SHMIC_RING_HEADER_SIZE + (Size) SHMIC_RING_SLOTS * slotsize;
+	int			retry;
+
+	if (!cleanupRegistered)
+	{
+		on_proc_exit(shmic_proc_exit, 0);
+		cleanupRegistered = true;
+	}
+
+	MemSet(&ident, 0, sizeof(ident));
+	ident.sessionId = gp_session_id;
+	ident.icId = gp_interconnect_id;
+	ident.motNodeId = motNodeId;
+	ident.sndPid = sndPid;
+	ident.rcvPid = rcvPid;
+
+	handle = DatumGetUInt32(hash_any((unsigned char *) &ident, sizeof(ident)));
+
+	for (retry = 0;; retry++)
+	{
+		if (dsm_impl_op(DSM_OP_CREATE, handle, size, &impl_private,
+						&mapped_address, &mapped_size, ERROR))
+		{
+			ring = (ShmICRing *) mapped_address;
+
+			MemSet(ring, 0, SHMIC_RING_HEADER_SIZE);
+			pg_atomic_init_u32(&ring->magic, 0);
+			ring->ident = ident;
+			ring->nslots = SHMIC_RING_SLOTS;
+			ring->slotsize = slotsize;
+			pg_atomic_init_u32(&ring->nattached, 0);
+			pg_atomic_init_u32(&ring->head, 0);
+			pg_atomic_init_u32(&ring->tail, 0);
+			InitSharedLatch(&ring->sndLatch);
+
+			pg_write_barrier();
+			pg_atomic_write_u32(&ring->magic, SHMIC_MAGIC);
+			break;
+		}
+
+		/*
+		 * The segment exists.  The other end may still be creating it, in
+		 * which case it may be too short to map yet, or not initialized.
+		 */
+		if (dsm_impl_op(DSM_OP_ATTACH, handle, 0, &impl_private,
+						&mapped_address, &mapped_size, DEBUG1) &&
+			mapped_size >= SHMIC_RING_HEADER_SIZE)
+		{
+			ring = (ShmICRing *) mapped_address;
+
+			if (pg_atomic_read_u32(&ring->magic) == SHMIC_MAGIC)
+			{
+				pg_read_barrier();
+				break;
+			}
+		}
+
+		if (mapped_address != NULL || impl_private != NULL)
+			dsm_impl_op(DSM_OP_DETACH, handle, 0, &impl_private,
+						&mapped_address, &mapped_size, ERROR);
+
+		if (retry >= SHMIC_ATTACH_RETRIES)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error: could not attach to shared memory segment %u",
+							handle)));
+
+		pg_usleep(1000L);
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (memcmp(&ring->ident, &ident, sizeof(ident)) != 0 ||
+		ring->slotsize < Gp_max_packet_size ||
+		mapped_size < SHMIC_RING_HEADER_SIZE + (Size) ring->nslots * ring->slotsize)
+	{
+		dsm_impl_op(DSM_OP_DETACH, handle, 0, &impl_private,
+					&mapped_address, &mapped_size, WARNING);
+		ereport(ERROR,
+				(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+				 errmsg("interconnect error: shared memory segment %u belongs to another connection",
+						handle)));
+	}
+
+	/*
+	 * Allocate the attachment only once the segment is mapped and checked,
+	 * so that an error above leaves nothing behind in TopMemoryContext.
+	 */
+	shm = (ShmICConn *) MemoryContextAllocZero(TopMemoryContext, sizeof(ShmICConn));
+	shm->handle = handle;
+	shm->impl_private = impl_private;
+	shm->mapped_address = mapped_address;
+	shm->mapped_size = mapped_size;
+	shm->isSender = isSender;
+	shm->ring = ring;
+
+	pg_atomic_fetch_add_u32(&ring->nattached, 1);
+
+	if (isSender)
+	{
+		OwnLatch(&ring->sndLatch);
+		ring->sndAttached = true;
+	}
+	else
+	{
+		ring->rcvAttached = true;
+
+		/* a sender may be waiting for us in ShmICWaitForReceiver() */
+		pg_memory_barrier();
+		if (ring->sndWaiting)
+			SetLatch(&ring->sndLatch);
+	}
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+	attachedConns = lappend(attachedConns, shm);
+	MemoryContextSwitchTo(oldcontext);
+
+	SIMPLE_FAULT_INJECTOR("interconnect_shm_attach");
+
+	return shm;
+}
+
+/*
+ * ShmICDetach
+ *		Detach from the segment of a connection, destroying it if we are the
+ *		last one to leave.
+ *
+ * A receiver that leaves before the sender ever attached keeps the segment,
+ * with stopRequested set, so that the sender finds out that nobody is going
+ * to read its packets instead of creating a new segment.
+ */
+void
+ShmICDetach(ShmICConn *shm)
+{
+	ShmICRing  *ring = shm->ring;
+	bool		abandon = false;
+	dsm_op		op = DSM_OP_DETACH;
+
+	if (shm->isSender)
+		DisownLatch(&ring->sndLatch);
+	else
+	{
+		/* no more packets will be read, let a blocked sender go */
+		ring->stopRequested = true;
+		pg_memory_barrier();
+		if (ring->sndWaiting)
+			SetLatch(&ring->sndLatch);
+	}
+
+	if (pg_atomic_fetch_sub_u32(&ring->nattached, 1) == 1)
+	{
+		if (!shm->isSender && !ring->sndAttached)
+			abandon = true;
+		else
+			op = DSM_OP_DESTROY;
+	}
+
+	attachedConns = list_delete_ptr(attachedConns, shm);
+	shm->ring = NULL;
+
+	dsm_impl_op(op, shm->handle, 0, &shm->impl_private,
+				&shm->mapped_address, &shm->mapped_size, WARNING);
+
+	if (abandon)
+	{
+		MemoryContext oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+		abandonedConns = lappend(abandonedConns, shm);
+		MemoryContextSwitchTo(oldcontext);
+	}
+	else
+		pfree(shm);
+}
+
+/*
+ * ShmICCleanup
+ *		Destroy the segments abandoned by earlier statements.
+ *
+ * Called when an interconnect is set up.  By then the senders of the
+ * statements those segments were created for are done.
+ */
+void
+ShmICCleanup(void)
+{
+	while (abandonedConns != NIL)
+	{
+		ShmICConn  *shm = (ShmICConn *) linitial(abandonedConns);
+
+		abandonedConns = list_delete_first(abandonedConns);
+
+		/* the sender may have destroyed it already */
+		dsm_impl_op(DSM_OP_DESTROY, shm->handle, 0, &shm->impl_private,
+					&shm->mapped_address, &shm->mapped_size, DEBUG1);
+		pfree(shm);
+	}
+}
+
+/*
+ * Detach from everything at process exit, including the segments of an
+ * interconnect whose setup failed half-way.
+ */
+static void
+shmic_proc_exit(int code, Datum arg)
+{
+	while (attachedConns != NIL)
+		ShmICDetach((ShmICConn *) linitial(attachedConns));
+
+	ShmICCleanup();
+}
+
+/*
+ * Sleep on the sender's latch until the ring has room for a packet, or
+ * until the receiver has attached, or the receiver wants no more packets.
+ *
+ * A receiver may take as long as it likes to consume packets, but one that
+ * does not attach within gp_interconnect_transmit_timeout is considered
+ * lost, like a receiver that does not acknowledge packets over the network.
+ */
+static void
+shmic_sender_wait(ShmICConn *shm, bool forSpace)
+{
+	ShmICRing  *ring = shm->ring;
+	int			retries = 0;
+
+	for (;;)
+	{
+		int			rc;
+
+		ResetLatch(&ring->sndLatch);
+		ring->sndWaiting = true;
+		pg_memory_barrier();
+
+		if (ring->stopRequested || QueryFinishPending)
+			break;
+		if (forSpace &&
+			pg_atomic_read_u32(&ring->head) - pg_atomic_read_u32(&ring->tail) < ring->nslots)
+			break;
+		if (!forSpace && ring->rcvAttached)
+			break;
+
+		rc = WaitLatch(&ring->sndLatch,
+					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+					   SHMIC_WAIT_TIMEOUT_MS);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if ((rc & WL_POSTMASTER_DEATH) ||
+			((++retries & 0x3f) == 0 && !PostmasterIsAlive()))
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("interconnect failed to send chunks"),
+					 errdetail("Postmaster is not alive.")));
+
+		/* the receiver may have gone away without a word */
+		if ((rc & WL_TIMEOUT) &&
+			kill(ring->ident.rcvPid, 0) != 0 && errno == ESRCH)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error: receiving process %d is gone",
+							ring->ident.rcvPid)));
+
+		if (!forSpace &&
+			(int64) retries * SHMIC_WAIT_TIMEOUT_MS > (int64) Gp_interconnect_transmit_timeout * 1000)
+			ereport(ERROR,
+					(errcode(ERRCODE_GP_INTERCONNECTION_ERROR),
+					 errmsg("interconnect error: receiving process %d did not attach to shared memory in %d seconds",
+							ring->ident.rcvPid, Gp_interconnect_transmit_timeout)));
+	}
+
+	ring->sndWaiting = false;
+}
+
+/*
+ * ShmICSend
+ *		Copy a packet into the ring, waiting for a free slot if necessary.
+ *
+ * Returns false, without adding the packet, if the receiver asked for no
+ * more packets or the query is finishing.  *wakeReceiver is set if the
+ * receiver is about to sleep and must be sent a wakeup packet.
+ */
+bool
+ShmICSend(ShmICConn *shm, icpkthdr *pkt, bool *wakeReceiver)
+{
+	ShmICRing  *ring = shm->ring;
+	uint32		head = pg_atomic_read_u32(&ring->head);
+
+	Assert(shm->isSender);
+	Assert(pkt->len <= ring->slotsize);
+
+	*wakeReceiver = false;
+
+	while (head - pg_atomic_read_u32(&ring->tail) >= ring->nslots)
+	{
+		if (ring->stopRequested || QueryFinishPending)
+			return false;
+
+		SIMPLE_FAULT_INJECTOR("interconnect_shm_ring_full");
+
+		shmic_sender_wait(shm, true);
+	}
+
+	if (ring->stopRequested || QueryFinishPending)
+		return false;
+
+	/* the receiver must be done with the slot before we overwrite it */
+	pg_memory_barrier();
+
+	memcpy(SHMIC_SLOT(ring, head), pkt, pkt->len);
+
+	pg_write_barrier();
+	pg_atomic_write_u32(&ring->head, head + 1);
+
+	pg_memory_barrier();
+	if (ring->rcvWaiting)
+	{
+		ring->rcvWaiting = false;
+		*wakeReceiver = true;
+	}
+
+	return true;
+}
+
+/*
+ * ShmICWaitForReceiver
+ *		Wait until the receiver has attached to the segment.
+ *
+ * A sender calls this after its last packet, so that the segment is not
+ * destroyed before the receiver could map it.
+ */
+void
+ShmICWaitForReceiver(ShmICConn *shm)
+{
+	Assert(shm->isSender);
+
+	if (!shm->ring->rcvAttached)
+		shmic_sender_wait(shm, false);
+}
+
+/*
+ * ShmICPeek
+ *		Return the oldest packet in the ring, or NULL if it is empty.
+ *
+ * The packet stays in the ring until ShmICRelease().
+ */
+icpkthdr *
+ShmICPeek(ShmICConn *shm)
+{
+	ShmICRing  *ring = shm->ring;
+	uint32		tail = pg_atomic_read_u32(&ring->tail);
+
+	Assert(!shm->isSender);
+
+	if (pg_atomic_read_u32(&ring->head) == tail)
+		return NULL;
+
+	/* read the packet only after seeing the new head */
+	pg_read_barrier();
+
+	return SHMIC_SLOT(ring, tail);
+}
+
+/*
+ * ShmICRelease
+ *		Give the slot of the oldest packet back to the sender.
+ */
+void
+ShmICRelease(ShmICConn *shm)
+{
+	ShmICRing  *ring = shm->ring;
+
+	Assert(!shm->isSender);
+	Assert(pg_atomic_read_u32(&ring->head) != pg_atomic_read_u32(&ring->tail));
+
+	/* full barrier: done reading the slot before it is handed back */
+	pg_atomic_fetch_add_u32(&ring->tail, 1);
+
+	pg_memory_barrier();
+	if (ring->sndWaiting)
+	{
+		ring->sndWaiting = false;
+		SetLatch(&ring->sndLatch);
+	}
+}
+
+/*
+ * ShmICPrepareWait
+ *		Ask the sender for a wakeup packet when it adds the next packet.
+ *
+ * Must be called after the receiver's latch was reset, and before it sleeps.
+ * Returns true if a packet has arrived in the meantime, in which case the
+ * receiver should not sleep.
+ */
+bool
+ShmICPrepareWait(ShmICConn *shm)
+{
+	ShmICRing  *ring = shm->ring;
+
+	ring->rcvWaiting = true;
+	pg_memory_barrier();
+
+	return pg_atomic_read_u32(&ring->head) != pg_atomic_read_u32(&ring->tail);
+}
+
+/*
+ * ShmICEndWait
+ *		Withdraw the request made by ShmICPrepareWait().
+ */
+void
+ShmICEndWait(ShmICConn *shm)
+{
+	if (shm->ring->rcvWaiting)
+		shm->ring->rcvWaiting = false;
+}
+
+/*
+ * ShmICRequestStop
+ *		Tell the sender that no more packets are wanted.
+ */
+void
+ShmICRequestStop(ShmICConn *shm)
+{
+	ShmICRing  *ring = shm->ring;
+
+	ring->stopRequested = true;
+
+	pg_memory_barrier();
+	if (ring->sndWaiting)
+		SetLatch(&ring->sndLatch);
+}
@@ -50,6 +50,7 @@
 #include "cdb/cdbdisp.h"
 #include "cdb/cdbdispatchresult.h"
 #include "cdb/cdbicudpfaultinjection.h"
+#include "cdb/ic_shm.h"
 
 #include <fcntl.h>
 #include <limits.h>
@@ -136,6 +137,29 @@ int
 /* 1/4 sec in msec */
 #define RX_THREAD_POLL_TIMEOUT (250)
 
+/*
+ * Batched socket I/O
+ *
+ * On Linux, up to gp_interconnect_io_batch_size packets are sent to one
+ * connection with a single sendmmsg() call, and the rx thread receives up
+ * to that many datagrams with a single recvmmsg() call.  Elsewhere, or if
+ * the kernel does not support these calls, every packet takes a sendto() or
+ * recvfrom() call of its own.
+ *
+ * The rx thread keeps up to UDPIFC_MAX_IO_BATCH receive buffers at hand
+ * instead of one, so that many are accounted for in rx_buffer_pool.maxCount
+ * when the pool is set up.
+ */
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define UDPIFC_HAVE_MMSG 1
+#define UDPIFC_MAX_IO_BATCH (64)
+#else
+#define UDPIFC_MAX_IO_BATCH (1)
+#endif
+
+/* Cleared if the kernel turns out to lack sendmmsg()/recvmmsg(). */
+static volatile bool mmsg_supported = true;
+
 /*
  * Flags definitions for flag-field of UDP-messages
  *
@@ -149,6 +173,7 @@ int
 #define UDPIC_FLAGS_DISORDER    		(32)
 #define UDPIC_FLAGS_DUPLICATE   		(64)
 #define UDPIC_FLAGS_CAPACITY    		(128)
+#define UDPIC_FLAGS_SHM_WAKEUP			(256)
 
 /*
  * ConnHtabBin
@@ -608,6 +633,8 @@ typedef struct AckSendParam
  * duplicatedPktNum          - duplicate packet number.
  * recvAckNum                - the number of Acks received.
  * statusQueryMsgNum         - the number of status query messages sent.
+ * sndSyscallNum             - the number of system calls sending data packets.
+ * recvSyscallNum            - the number of system calls receiving packets.
  *
  */
 typedef struct ICStatistics
@@ -629,6 +656,8 @@ typedef struct ICStatistics
 	int32		duplicatedPktNum;
 	int32		recvAckNum;
 	int32		statusQueryMsgNum;
+	int32		sndSyscallNum;
+	int32		recvSyscallNum;
 } ICStatistics;
 
 /* Statistics for UDP interconnect. */
@@ -707,6 +736,11 @@ static void TeardownUDPIFCInterconnect_Internal(ChunkTransportState *transportSt
 static void freeDisorderedPackets(MotionConn *conn);
 
 static void prepareRxConnForRead(MotionConn *conn);
+static bool prepareShmConnForRead(MotionConn *conn);
+static MotionConn *findShmConnForRead(ChunkTransportStateEntry *pEntry, MotionConn *conn);
+static bool prepareShmConnsForWait(ChunkTransportStateEntry *pEntry, MotionConn *conn);
+static void endShmConnsWait(ChunkTransportStateEntry *pEntry, MotionConn *conn);
+static bool sendShmBuffer(ChunkTransportStateEntry *pEntry, MotionConn *conn);
 static TupleChunkListItem RecvTupleChunkFromAnyUDPIFC(ChunkTransportState *transportStates,
 							int16 motNodeID,
 							int16 *srcRoute);
@@ -728,6 +762,7 @@ static void checkQDConnectionAlive(void);
 
 
 static void *rxThreadFunc(void *arg);
+static bool handleRxPacket(icpkthdr *pkt, int read_count, struct sockaddr_storage *peer, socklen_t peerlen, bool *skip_poll);
 
 static bool handleMismatch(icpkthdr *pkt, struct sockaddr_storage *peer, int peer_len);
 static void handleAckedPacket(MotionConn *ackConn, ICBuffer *buf, uint64 now);
@@ -743,6 +778,7 @@ static inline void addCRC(icpkthdr *pkt);
 static inline bool checkCRC(icpkthdr *pkt);
 static void sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn);
 static void sendOnce(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, ICBuffer *buf, MotionConn *conn);
+static void sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, ICBuffer **bufs, int nbufs, MotionConn *conn);
 static inline uint64 computeExpirationPeriod(MotionConn *conn, uint32 retry);
 
 static ICBuffer *getSndBuffer(MotionConn *conn);
@@ -901,6 +937,15 @@ dumpTransProtoStats()
 
 	pthread_mutex_unlock(&trans_proto_stats.lock);
 
+	fprintf(ofile, "data packets sent %d in %d calls, %.2f per call\n",
+			ic_statistics.sndPktNum, ic_statistics.sndSyscallNum,
+			ic_statistics.sndSyscallNum > 0 ?
+			(double) ic_statistics.sndPktNum / ic_statistics.sndSyscallNum : 0.0);
+	fprintf(ofile, "packets received %d in %d calls, %.2f per call\n",
+			ic_statistics.recvPktNum, ic_statistics.recvSyscallNum,
+			ic_statistics.recvSyscallNum > 0 ?
+			(double) ic_statistics.recvPktNum / ic_statistics.recvSyscallNum : 0.0);
+
 	fclose(ofile);
 }
 
@@ -1396,7 +1441,7 @@ InitMotionUDPIFC(int *listenerSocketFd, uint16 *listenerPort)
 
 	/* Initialize receive buffer pool */
 	rx_buffer_pool.count = 0;
-	rx_buffer_pool.maxCount = 1;
+	rx_buffer_pool.maxCount = UDPIFC_MAX_IO_BATCH;
 	rx_buffer_pool.freeList = NULL;
 
 	/* Initialize send control data */
@@ -1933,6 +1978,17 @@ MlPutRxBufferIFC(ChunkTransportState *transportStates, int motNodeID, int route)
 
 	conn = pEntry->conns + route;
 
+	/* a packet in shared memory just gives its slot back to the sender */
+	if (conn->shm != NULL)
+	{
+		if (conn->pBuff == NULL)
+			elog(FATAL, "Interconnect error: tried to release a NULL buffer");
+
+		ShmICRelease(conn->shm);
+		conn->pBuff = NULL;
+		return;
+	}
+
 	memset(&param, 0, sizeof(AckSendParam));
 
 	pthread_mutex_lock(&ic_control_info.lock);
@@ -2878,6 +2934,13 @@ setupOutgoingUDPConnection(ChunkTransportState *transportStates, ChunkTransportS
 	conn->conn_info.seq = 1;
 	Assert(conn->peer.ss_family == AF_INET || conn->peer.ss_family == AF_INET6);
 
+	/* pass the packets to a receiver on this host in shared memory */
+	if (ShmICSameHost(ShmICLocalProcess(pEntry->sendSlice->primaryProcesses), cdbProc))
+	{
+		conn->shm = ShmICAttach(pEntry->motNodeId, MyProcPid, cdbProc->pid, true);
+		pEntry->numShmConns++;
+	}
+
 }								/* setupOutgoingUDPConnection */
 
 /*
@@ -2970,6 +3033,7 @@ SetupUDPIFCInterconnect_Internal(SliceTable *sliceTable)
 
 	ChunkTransportStateEntry *sendingChunkTransportState = NULL;
 	ChunkTransportState *interconnect_context;
+	CdbProcess *myProc;
 
 	pthread_mutex_lock(&ic_control_info.lock);
 
@@ -3002,6 +3066,9 @@ SetupUDPIFCInterconnect_Internal(SliceTable *sliceTable)
 		   IsA(mySlice, Slice) &&
 		   mySlice->sliceIndex == sliceTable->localSlice);
 
+	myProc = ShmICLocalProcess(mySlice->primaryProcesses);
+	ShmICCleanup();
+
 #ifdef USE_ASSERT_CHECKING
 	set_test_mode();
 #endif
@@ -3103,6 +3170,14 @@ SetupUDPIFCInterconnect_Internal(SliceTable *sliceTable)
 				conn->conn_info.flags = UDPIC_FLAGS_RECEIVER_TO_SENDER;
 
 				connAddHash(&ic_control_info.connHtab, conn);
+
+				/* a sender on this host passes its packets in shared memory */
+				if (ShmICSameHost(myProc, conn->cdbProc))
+				{
+					conn->shm = ShmICAttach(pEntry->motNodeId, conn->cdbProc->pid,
+											MyProcPid, false);
+					pEntry->numShmConns++;
+				}
 			}
 		}
 	}
@@ -3390,6 +3465,12 @@ TeardownUDPIFCInterconnect_Internal(ChunkTransportState *transportStates,
 					icBufferListReturn(&conn->sndQueue, false);
 					icBufferListReturn(&conn->unackQueue, Gp_interconnect_fc_method == INTERCONNECT_FC_METHOD_CAPACITY ? false : true);
 
+					if (conn->shm != NULL)
+					{
+						ShmICDetach(conn->shm);
+						conn->shm = NULL;
+					}
+
 					connDelHash(&ic_control_info.connHtab, conn);
 				}
 				avgRtt = avgRtt / pEntry->numConns;
@@ -3454,6 +3535,13 @@ TeardownUDPIFCInterconnect_Internal(ChunkTransportState *transportStates,
 					if (conn->cdbProc == NULL)
 						continue;
 
+					/* tells the sender to stop, if it has not finished */
+					if (conn->shm != NULL)
+					{
+						ShmICDetach(conn->shm);
+						conn->shm = NULL;
+					}
+
 					/* out of memory has occurred, break out */
 					if (!conn->pkt_q)
 						break;
@@ -3532,7 +3620,8 @@ TeardownUDPIFCInterconnect_Internal(ChunkTransportState *transportStates,
 		 " freebuf_avg %f "
 		 "mismatch_pkt_num %d disordered_pkt_num %d duplicated_pkt_num %d"
 		 " rtt/dev [" UINT64_FORMAT "/" UINT64_FORMAT ", %f/%f, " UINT64_FORMAT "/" UINT64_FORMAT "] "
-		 " cwnd %f status_query_msg_num %d",
+		 " cwnd %f status_query_msg_num %d"
+		 " snd_syscall_num %d recv_syscall_num %d",
 		 ic_control_info.isSender, isReceiver,
 		 Gp_interconnect_snd_queue_depth, Gp_interconnect_queue_depth, Gp_max_packet_size,
 		 UNACK_QUEUE_RING_SLOTS_NUM, TIMER_SPAN, DEFAULT_RTT,
@@ -3545,7 +3634,8 @@ TeardownUDPIFCInterconnect_Internal(ChunkTransportState *transportStates,
 		 (double) ((double) ic_statistics.totalBuffers) / ((double) ic_statistics.bufferCountingTime),
 		 ic_statistics.mismatchNum, ic_statistics.disorderedPktNum, ic_statistics.duplicatedPktNum,
 		 (minRtt == ~((uint64) 0) ? 0 : minRtt), (minDev == ~((uint64) 0) ? 0 : minDev), avgRtt, avgDev, maxRtt, maxDev,
-		 snd_control_info.cwnd, ic_statistics.statusQueryMsgNum);
+		 snd_control_info.cwnd, ic_statistics.statusQueryMsgNum,
+		 ic_statistics.sndSyscallNum, ic_statistics.recvSyscallNum);
 
 	ic_control_info.isSender = false;
 	memset(&ic_statistics, 0, sizeof(ICStatistics));
@@ -3618,6 +3708,119 @@ prepareRxConnForRead(MotionConn *conn)
 	conn->recvBytes = conn->msgSize;
 }
 
+/*
+ * prepareShmConnForRead
+ * 		Prepare a shared memory connection for reading its oldest packet.
+ *
+ * The packet is parsed where it is in the ring, and stays there until
+ * MlPutRxBufferIFC() is called. Returns false if the ring is empty.
+ */
+static bool
+prepareShmConnForRead(MotionConn *conn)
+{
+	icpkthdr   *pkt = ShmICPeek(conn->shm);
+
+	if (pkt == NULL)
+		return false;
+
+	conn->pBuff = (uint8 *) pkt;
+	conn->msgPos = conn->pBuff;
+	conn->msgSize = pkt->len;
+	conn->recvBytes = conn->msgSize;
+
+	ic_statistics.recvPktNum++;
+
+	return true;
+}
+
+/*
+ * findShmConnForRead
+ * 		Find a shared memory connection with a packet to read, and prepare
+ * 		it for reading.
+ *
+ * Only looks at 'conn' if it is given, else at all the active connections of
+ * the motion node, starting from scanStart.
+ */
+static MotionConn *
+findShmConnForRead(ChunkTransportStateEntry *pEntry, MotionConn *conn)
+{
+	int			i;
+	int			index;
+
+	if (conn != NULL)
+	{
+		if (conn->shm != NULL && conn->stillActive && prepareShmConnForRead(conn))
+			return conn;
+		return NULL;
+	}
+
+	index = pEntry->scanStart;
+	for (i = 0; i < pEntry->numConns; i++, index++)
+	{
+		if (index >= pEntry->numConns)
+			index = 0;
+
+		conn = pEntry->conns + index;
+
+		if (conn->shm != NULL && conn->stillActive && prepareShmConnForRead(conn))
+			return conn;
+	}
+
+	return NULL;
+}
+
+/*
+ * prepareShmConnsForWait
+ * 		Ask the senders of shared memory connections to wake us up.
+ *
+ * Returns true if one of them has a packet already, in which case we should
+ * not wait.
+ */
+static bool
+prepareShmConnsForWait(ChunkTransportStateEntry *pEntry, MotionConn *conn)
+{
+	bool		ready = false;
+	int			i;
+
+	if (conn != NULL)
+		return conn->shm != NULL && conn->stillActive && ShmICPrepareWait(conn->shm);
+
+	for (i = 0; i < pEntry->numConns; i++)
+	{
+		conn = pEntry->conns + i;
+
+		if (conn->shm != NULL && conn->stillActive && ShmICPrepareWait(conn->shm))
+			ready = true;
+	}
+
+	return ready;
+}
+
+/*
+ * endShmConnsWait
+ * 		Undo prepareShmConnsForWait().
+ */
+static void
+endShmConnsWait(ChunkTransportStateEntry *pEntry, MotionConn *conn)
+{
+	int			i;
+
+	if (conn != NULL)
+	{
+		if (conn->shm != NULL)
+			ShmICEndWait(conn->shm);
+		return;
+	}
+
+	for (i = 0; i < pEntry->numConns; i++)
+	{
+		conn = pEntry->conns + i;
+
+		if (conn->shm != NULL)
+			ShmICEndWait(conn->shm);
+	}
+}
+
 /*
  * receiveChunksUDPIFC
  * 		Receive chunks from the senders
@@ -3667,6 +3870,13 @@ receiveChunksUDPIFC(ChunkTransportState *pTransportStates, ChunkTransportStateEn
 			elog(DEBUG2, "receiveChunksUDPIFC: non-directed rx woke on route %d", rx_control_info.mainWaitingState.reachRoute);
 			resetMainThreadWaiting(&rx_control_info.mainWaitingState);
 		}
+		else if (pEntry->numShmConns > 0)
+		{
+			/* 2. Do we have a packet in shared memory */
+			rxconn = findShmConnForRead(pEntry, directed ? conn : NULL);
+			if (rxconn != NULL)
+				resetMainThreadWaiting(&rx_control_info.mainWaitingState);
+		}
 
 		aggregateStatistics(pEntry);
 
@@ -3712,6 +3922,7 @@ receiveChunksUDPIFC(ChunkTransportState *pTransportStates, ChunkTransportStateEn
 		 */
 		int			wakeEvents = WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH;
 		int			waitFd = PGINVALID_SOCKET;
+		bool		shmReady = false;
 
 		if (Gp_role == GP_ROLE_DISPATCH)
 			waitFd = cdbdisp_getWaitSocketFd(pTransportStates->estate->dispatcherState);
@@ -3723,9 +3934,20 @@ receiveChunksUDPIFC(ChunkTransportState *pTransportStates, ChunkTransportStateEn
 			elog(DEBUG5, "waiting (timed) on route %d %s", rx_control_info.mainWaitingState.waitingRoute,
 				 (rx_control_info.mainWaitingState.waitingRoute == ANY_ROUTE ? "(any route)" : ""));
 		}
-		(void) WaitLatchOrSocket(&ic_control_info.latch,
-								 wakeEvents, waitFd,
-								 MAIN_THREAD_COND_TIMEOUT_MS);
+		/*
+		 * Senders in shared memory wake us up through the rx thread too, if
+		 * we ask them to.
+		 */
+		if (pEntry->numShmConns > 0)
+			shmReady = prepareShmConnsForWait(pEntry, directed ? conn : NULL);
+
+		if (!shmReady)
+			(void) WaitLatchOrSocket(&ic_control_info.latch,
+									 wakeEvents, waitFd,
+									 MAIN_THREAD_COND_TIMEOUT_MS);
+
+		if (pEntry->numShmConns > 0)
+			endShmConnsWait(pEntry, directed ? conn : NULL);
 
 		/* check the potential errors in rx thread. */
 		checkRxThreadError();
@@ -3813,6 +4035,12 @@ RecvTupleChunkFromAnyUDPIFC_Internal(ChunkTransportState *transportStates,
 			prepareRxConnForRead(conn);
 			break;
 		}
+
+		if (conn->shm != NULL && conn->stillActive && prepareShmConnForRead(conn))
+		{
+			found = true;
+			break;
+		}
 	}
 
 	if (found)
@@ -3929,9 +4157,11 @@ RecvTupleChunkFromUDPIFC_Internal(ChunkTransportState *transportStates,
 	ic_statistics.totalRecvQueueSize += conn->pkt_q_size;
 	ic_statistics.recvQueueSizeCountingTime++;
 
-	if (conn->pkt_q[conn->pkt_q_head] != NULL)
+	if (conn->pkt_q[conn->pkt_q_head] != NULL ||
+		(conn->shm != NULL && prepareShmConnForRead(conn)))
 	{
-		prepareRxConnForRead(conn);
+		if (conn->shm == NULL)
+			prepareRxConnForRead(conn);
 
 		pthread_mutex_unlock(&ic_control_info.lock);
 
@@ -4471,6 +4701,7 @@ sendOnce(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry,
 xmit_retry:
 	n = sendto(pEntry->txfd, buf->pkt, buf->pkt->len, 0,
 			   (struct sockaddr *) &conn->peer, conn->peer_len);
+	ic_statistics.sndSyscallNum++;
 	if (n < 0)
 	{
 		if (errno == EINTR)
@@ -4518,6 +4749,135 @@ xmit_retry:
 	return;
 }
 
+/*
+ * sendBatch
+ * 		Send several packets to the same connection.
+ *
+ * The packets are sent with as few sendmmsg() calls as possible.  Whatever
+ * cannot be sent that way, because of an error or because sendmmsg() is not
+ * available, goes through sendOnce(), which decides how to treat the error.
+ */
+static void
+sendBatch(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry,
+		  ICBuffer **bufs, int nbufs, MotionConn *conn)
+{
+	int			i = 0;
+
+#ifdef UDPIFC_HAVE_MMSG
+	struct mmsghdr msgs[UDPIFC_MAX_IO_BATCH];
+	struct iovec iovs[UDPIFC_MAX_IO_BATCH];
+	int			nmsgs = 0;
+	int			j;
+
+	Assert(nbufs <= UDPIFC_MAX_IO_BATCH);
+
+	if (nbufs > 1 && mmsg_supported)
+	{
+		for (j = 0; j < nbufs; j++)
+		{
+#ifdef USE_ASSERT_CHECKING
+			if (testmode_inject_fault(gp_udpic_dropxmit_percent))
+			{
+#ifdef AMS_VERBOSE_LOGGING
+				write_log("THROW PKT with seq %d srcpid %d despid %d", bufs[j]->pkt->seq, bufs[j]->pkt->srcPid, bufs[j]->pkt->dstPid);
+#endif
+				continue;
+			}
+#endif
+			iovs[nmsgs].iov_base = bufs[j]->pkt;
+			iovs[nmsgs].iov_len = bufs[j]->pkt->len;
+
+			memset(&msgs[nmsgs], 0, sizeof(struct mmsghdr));
+			msgs[nmsgs].msg_hdr.msg_name = &conn->peer;
+			msgs[nmsgs].msg_hdr.msg_namelen = conn->peer_len;
+			msgs[nmsgs].msg_hdr.msg_iov = &iovs[nmsgs];
+			msgs[nmsgs].msg_hdr.msg_iovlen = 1;
+			bufs[nmsgs] = bufs[j];
+			nmsgs++;
+		}
+		nbufs = nmsgs;
+
+		while (i < nbufs)
+		{
+			int			n;
+
+			n = sendmmsg(pEntry->txfd, &msgs[i], nbufs - i, 0);
+			ic_statistics.sndSyscallNum++;
+
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				if (errno == ENOSYS)
+					mmsg_supported = false;
+
+				/* let sendOnce() deal with the packet that failed */
+				break;
+			}
+
+			for (j = i; j < i + n; j++)
+			{
+				if (msgs[j].msg_len != bufs[j]->pkt->len &&
+					DEBUG1 >= log_min_messages)
+					write_log("Interconnect error writing an outgoing packet [seq %d]: short transmit (given %d sent %d) during sendmmsg() call."
+							  "For Remote Connection: contentId=%d at %s", bufs[j]->pkt->seq, bufs[j]->pkt->len, msgs[j].msg_len,
+							  conn->remoteContentId,
+							  conn->remoteHostAndPort);
+			}
+			i += n;
+		}
+	}
+#endif
+
+	for (; i < nbufs; i++)
+		sendOnce(transportStates, pEntry, bufs[i], conn);
+}
+
+
+/*
+ * sendShmBuffer
+ * 		Pass the current buffer of a connection to a receiver on the same
+ * 		host.
+ *
+ * The packet is copied into the shared memory ring, so the connection keeps
+ * its buffer for the next one. If the receiver is about to sleep, it is woken
+ * up by a wakeup packet to its rx thread.
+ *
+ * Returns false if the receiver does not want any more packets, or the query
+ * is finishing.
+ */
+static bool
+sendShmBuffer(ChunkTransportStateEntry *pEntry, MotionConn *conn)
+{
+	bool		wakeReceiver;
+	bool		sent;
+
+	conn->conn_info.len = conn->msgSize;
+	conn->conn_info.crc = 0;
+	memcpy(conn->pBuff, &conn->conn_info, sizeof(conn->conn_info));
+	conn->conn_info.seq++;
+
+	sent = ShmICSend(conn->shm, (icpkthdr *) conn->pBuff, &wakeReceiver);
+
+	if (wakeReceiver)
+	{
+		icpkthdr	msg;
+
+		memcpy(&msg, &conn->conn_info, sizeof(msg));
+		msg.flags = UDPIC_FLAGS_SHM_WAKEUP;
+		msg.len = sizeof(msg);
+		sendControlMessage(&msg, pEntry->txfd, (struct sockaddr *) &conn->peer, conn->peer_len);
+	}
+
+	if (sent)
+		ic_statistics.sndPktNum++;
+
+	conn->tupleCount = 0;
+	conn->msgSize = sizeof(conn->conn_info);
+
+	return sent;
+}
 
 /*
  * handleStopMsgs
@@ -4627,6 +4987,10 @@ handleStopMsgs(ChunkTransportState *transportStates, ChunkTransportStateEntry *p
 static void
 sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEntry, MotionConn *conn)
 {
+	ICBuffer   *batch[UDPIFC_MAX_IO_BATCH];
+	int			nbatch = 0;
+	int			maxbatch = Min(Gp_interconnect_io_batch_size, UDPIFC_MAX_IO_BATCH);
+
 	if (!conn->stillActive)
 		return;
 
@@ -4674,12 +5038,15 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 		 * will be output. In the time of error message output, interrupts is
 		 * potentially checked, if there is a pending query cancel, it will
 		 * lead to a dangled buffer (memory leak).
+		 *
+		 * The same holds for the packets collected here and sent together
+		 * by sendBatch.
 		 */
 #ifdef TRANSFER_PROTOCOL_STATS
 		updateStats(TPE_DATA_PKT_SEND, conn, buf->pkt);
 #endif
 
-		sendOnce(transportStates, pEntry, buf, conn);
+		batch[nbatch++] = buf;
 		ic_statistics.sndPktNum++;
 
 #ifdef AMS_VERBOSE_LOGGING
@@ -4687,7 +5054,16 @@ sendBuffers(ChunkTransportState *transportStates, ChunkTransportStateEntry *pEnt
 #endif
 
 		buf->conn->sentSeq = buf->pkt->seq;
+
+		if (nbatch >= maxbatch)
+		{
+			sendBatch(transportStates, pEntry, batch, nbatch, conn);
+			nbatch = 0;
+		}
 	}
+
+	if (nbatch > 0)
+		sendBatch(transportStates, pEntry, batch, nbatch, conn);
 }
 
 /*
@@ -5323,6 +5699,31 @@ SendChunkUDPIFC(ChunkTransportState *transportStates,
 		return true;
 	}
 
+	/* a receiver on this host takes a copy, we keep the buffer */
+	if (conn->shm != NULL)
+	{
+		if (!sendShmBuffer(pEntry, conn))
+		{
+			if (QueryFinishPending)
+			{
+				conn->stillActive = false;
+				return false;
+			}
+
+			/* the receiver asked us to stop */
+			conn->stopRequested = true;
+			handleStopMsgs(transportStates, pEntry, motionId);
+			if (!conn->stillActive)
+				return true;
+		}
+
+		memcpy(conn->pBuff + conn->msgSize, tcItem->chunk_data, tcItem->chunk_length);
+		conn->msgSize += length;
+
+		conn->tupleCount++;
+		return true;
+	}
+
 	/* prepare this for transmit */
 
 	ic_statistics.totalCapacity += conn->capacity;
@@ -5467,6 +5868,13 @@ SendEosUDPIFC(ChunkTransportState *transportStates,
 			if (pEntry->sendingEos)
 				conn->conn_info.flags |= UDPIC_FLAGS_EOS;
 
+			if (conn->shm != NULL)
+			{
+				(void) sendShmBuffer(pEntry, conn);
+				activeCount++;
+				continue;
+			}
+
 			prepareXmit(conn);
 
 			/* place it into the send queue */
@@ -5511,6 +5919,18 @@ SendEosUDPIFC(ChunkTransportState *transportStates,
 					continue;
 				}
 
+				/*
+				 * Nothing to acknowledge in shared memory, but the segment
+				 * must not go away before the receiver has mapped it.
+				 */
+				if (conn->shm != NULL)
+				{
+					ShmICWaitForReceiver(conn->shm);
+					conn->state = mcsEosSent;
+					conn->stillActive = false;
+					continue;
+				}
+
 				/* wait until this queue is emptied */
 				while (icBufferListLength(&conn->unackQueue) > 0 ||
 					   icBufferListLength(&conn->sndQueue) > 0)
@@ -5578,7 +5998,15 @@ doSendStopMessageUDPIFC(ChunkTransportState *transportStates, int16 motNodeID)
 		 */
 		if (conn->stillActive)
 		{
-			if (conn->conn_info.flags & UDPIC_FLAGS_EOS)
+			if (conn->shm != NULL)
+			{
+				conn->stopRequested = true;
+				ShmICRequestStop(conn->shm);
+
+				if (gp_log_interconnect >= GPVARS_VERBOSITY_DEBUG)
+					elog(DEBUG1, "sent stop message in shared memory. node %d route %d", motNodeID, i);
+			}
+			else if (conn->conn_info.flags & UDPIC_FLAGS_EOS)
 			{
 				/*
 				 * we have a queued packet that has EOS in it. We've acked it,
@@ -6007,6 +6435,143 @@ handleDataPacket(MotionConn *conn, icpkthdr *pkt, struct sockaddr_storage *peer,
 	return true;
 }
 
+/*
+ * handleRxPacket
+ * 		Process a packet received by the rx thread.
+ *
+ * Returns true if the packet buffer has been handed over to a connection or
+ * to the startup cache, false if the caller can reuse it.
+ *
+ * NOTE: This function MUST NOT contain elog or ereport statements.
+ * elog is NOT thread-safe.  Developers should instead use something like:
+ *
+ *	if (DEBUG3 >= log_min_messages)
+ *		write_log("my brilliant log statement here.");
+ *
+ * NOTE: In threads, we cannot use palloc/pfree, because it's not thread safe.
+ */
+static bool
+handleRxPacket(icpkthdr *pkt, int read_count, struct sockaddr_storage *peer,
+			   socklen_t peerlen, bool *skip_poll)
+{
+	MotionConn *conn = NULL;
+	bool		kept = false;
+
+	if (read_count < sizeof(icpkthdr))
+	{
+		if (DEBUG1 >= log_min_messages)
+			write_log("Interconnect error: short conn receive (%d)", read_count);
+		return false;
+	}
+
+	/*
+	 * when we get a "good" recvfrom() result, we can skip poll()
+	 * until we get a bad one.
+	 */
+	*skip_poll = true;
+
+	/* length must be >= 0 */
+	if (pkt->len < 0)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound with negative length");
+		return false;
+	}
+
+	if (pkt->len != read_count)
+	{
+		if (DEBUG3 >= log_min_messages)
+			write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
+		return false;
+	}
+
+	/*
+	 * check the CRC of the payload.
+	 */
+	if (gp_interconnect_full_crc)
+	{
+		if (!checkCRC(pkt))
+		{
+			pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &ic_statistics.crcErrors, 1);
+			if (DEBUG2 >= log_min_messages)
+				write_log("received network data error, dropping bad packet, user data unaffected.");
+			return false;
+		}
+	}
+
+#ifdef AMS_VERBOSE_LOGGING
+	logPkt("GOT MESSAGE", pkt);
+#endif
+
+	bool		wakeup_mainthread = false;
+	AckSendParam param;
+
+	memset(&param, 0, sizeof(AckSendParam));
+
+	/*
+	 * Get the connection for the pkt.
+	 *
+	 * The connection hash table should be locked until finishing the
+	 * processing of the packet to avoid the connection
+	 * addition/removal from the hash table during the mean time.
+	 */
+
+	pthread_mutex_lock(&ic_control_info.lock);
+	conn = findConnByHeader(&ic_control_info.connHtab, pkt);
+
+	if (conn != NULL && (pkt->flags & UDPIC_FLAGS_SHM_WAKEUP))
+	{
+		/* the data is in shared memory, just wake up the main thread */
+		wakeup_mainthread = true;
+	}
+	else if (conn != NULL)
+	{
+		/* Handling a regular packet */
+		if (handleDataPacket(conn, pkt, peer, &peerlen, &param, &wakeup_mainthread))
+			kept = true;
+		ic_statistics.recvPktNum++;
+	}
+	else
+	{
+		/*
+		 * There may have two kinds of Mismatched packets: a) Past
+		 * packets from previous command after I was torn down b)
+		 * Future packets from current command before my connections
+		 * are built.
+		 *
+		 * The handling logic is to "Ack the past and Nak the future".
+		 * Shared memory wakeups for a connection that is gone are
+		 * simply dropped.
+		 */
+		if ((pkt->flags & (UDPIC_FLAGS_RECEIVER_TO_SENDER | UDPIC_FLAGS_SHM_WAKEUP)) == 0)
+		{
+			if (DEBUG1 >= log_min_messages)
+				write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
+
+#ifdef AMS_VERBOSE_LOGGING
+			logPkt("Got a Mismatched Packet", pkt);
+#endif
+
+			if (handleMismatch(pkt, peer, peerlen))
+				kept = true;
+			ic_statistics.mismatchNum++;
+		}
+	}
+	pthread_mutex_unlock(&ic_control_info.lock);
+
+	if (wakeup_mainthread)
+		SetLatch(&ic_control_info.latch);
+
+	/*
+	 * real ack sending is after lock release to decrease the lock
+	 * holding time.
+	 */
+	if (param.msg.len != 0)
+		sendAckWithParam(&param);
+
+	return kept;
+}
+
 /*
  * rxThreadFunc
  * 		Main function of the receive background thread.
@@ -6022,9 +6587,11 @@ handleDataPacket(MotionConn *conn, icpkthdr *pkt, struct sockaddr_storage *peer,
 static void *
 rxThreadFunc(void *arg)
 {
-	icpkthdr   *pkt = NULL;
+	icpkthdr   *pkts[UDPIFC_MAX_IO_BATCH];
+	int			npkts = 0;
 	bool		skip_poll = false;
 	uint32		expected = 1;
+	int			i;
 
 	gp_set_thread_sigmasks();
 
@@ -6032,6 +6599,7 @@ rxThreadFunc(void *arg)
 	{
 		struct pollfd nfd;
 		int			n;
+		int			nwanted;
 
 		/* check shutdown condition */
 		expected = 1;
@@ -6044,14 +6612,22 @@ rxThreadFunc(void *arg)
 			break;
 		}
 
-		/* Try to get a buffer */
-		if (pkt == NULL)
+		/* Try to get buffers, one per datagram we may receive at once */
+		nwanted = mmsg_supported ? Min(Gp_interconnect_io_batch_size, UDPIFC_MAX_IO_BATCH) : 1;
+		if (npkts < nwanted)
 		{
 			pthread_mutex_lock(&ic_control_info.lock);
-			pkt = getRxBuffer(&rx_buffer_pool);
+			while (npkts < nwanted)
+			{
+				icpkthdr   *pkt = getRxBuffer(&rx_buffer_pool);
+
+				if (pkt == NULL)
+					break;
+				pkts[npkts++] = pkt;
+			}
 			pthread_mutex_unlock(&ic_control_info.lock);
 
-			if (pkt == NULL)
+			if (npkts == 0)
 			{
 				setRxThreadError(ENOMEM);
 				continue;
@@ -6102,15 +6678,53 @@ rxThreadFunc(void *arg)
 			/* we've got something interesting to read */
 			/* handle incoming */
 			/* ready to read on our socket */
-			MotionConn *conn = NULL;
-			int			read_count = 0;
+			struct sockaddr_storage peers[UDPIFC_MAX_IO_BATCH];
+			socklen_t	peerlens[UDPIFC_MAX_IO_BATCH];
+			int			read_counts[UDPIFC_MAX_IO_BATCH];
+			int			nread = 0;
+			int			nkept = 0;
+
+#ifdef UDPIFC_HAVE_MMSG
+			if (npkts > 1)
+			{
+				struct mmsghdr msgs[UDPIFC_MAX_IO_BATCH];
+				struct iovec iovs[UDPIFC_MAX_IO_BATCH];
 
-			struct sockaddr_storage peer;
-			socklen_t	peerlen;
+				for (i = 0; i < npkts; i++)
+				{
+					iovs[i].iov_base = (char *) pkts[i];
+					iovs[i].iov_len = Gp_max_packet_size;
+
+					memset(&msgs[i], 0, sizeof(struct mmsghdr));
+					msgs[i].msg_hdr.msg_name = &peers[i];
+					msgs[i].msg_hdr.msg_namelen = sizeof(peers[i]);
+					msgs[i].msg_hdr.msg_iov = &iovs[i];
+					msgs[i].msg_hdr.msg_iovlen = 1;
+				}
 
-			peerlen = sizeof(peer);
-			read_count = recvfrom(UDP_listenerFd, (char *) pkt, Gp_max_packet_size, 0,
-								  (struct sockaddr *) &peer, &peerlen);
+				/* the socket is non-blocking, this returns what is queued */
+				nread = recvmmsg(UDP_listenerFd, msgs, npkts, 0, NULL);
+				if (nread < 0 && errno == ENOSYS)
+				{
+					/* fall back to one recvfrom() per datagram from now on */
+					mmsg_supported = false;
+					continue;
+				}
+
+				for (i = 0; i < nread; i++)
+				{
+					read_counts[i] = msgs[i].msg_len;
+					peerlens[i] = msgs[i].msg_hdr.msg_namelen;
+				}
+			}
+			else
+#endif
+			{
+				peerlens[0] = sizeof(peers[0]);
+				read_counts[0] = recvfrom(UDP_listenerFd, (char *) pkts[0], Gp_max_packet_size, 0,
+										  (struct sockaddr *) &peers[0], &peerlens[0]);
+				nread = (read_counts[0] < 0) ? -1 : 1;
+			}
 
 			expected = 1;
 			if (pg_atomic_compare_exchange_u32((pg_atomic_uint32 *) &ic_control_info.shutdown, &expected, 0))
@@ -6122,10 +6736,7 @@ rxThreadFunc(void *arg)
 				break;
 			}
 
-			if (DEBUG5 >= log_min_messages)
-				write_log("received inbound len %d", read_count);
-
-			if (read_count < 0)
+			if (nread < 0)
 			{
 				skip_poll = false;
 
@@ -6146,121 +6757,44 @@ rxThreadFunc(void *arg)
 				continue;
 			}
 
-			if (read_count < sizeof(icpkthdr))
-			{
-				if (DEBUG1 >= log_min_messages)
-					write_log("Interconnect error: short conn receive (%d)", read_count);
-				continue;
-			}
-
-			/*
-			 * when we get a "good" recvfrom() result, we can skip poll()
-			 * until we get a bad one.
-			 */
-			skip_poll = true;
+			ic_statistics.recvSyscallNum++;
 
-			/* length must be >= 0 */
-			if (pkt->len < 0)
+			for (i = 0; i < nread; i++)
 			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound with negative length");
-				continue;
-			}
+				if (DEBUG5 >= log_min_messages)
+					write_log("received inbound len %d", read_counts[i]);
 
-			if (pkt->len != read_count)
-			{
-				if (DEBUG3 >= log_min_messages)
-					write_log("received inbound packet [%d], short: read %d bytes, pkt->len %d", pkt->seq, read_count, pkt->len);
-				continue;
-			}
-
-			/*
-			 * check the CRC of the payload.
-			 */
-			if (gp_interconnect_full_crc)
-			{
-				if (!checkCRC(pkt))
+				if (handleRxPacket(pkts[i], read_counts[i], &peers[i], peerlens[i], &skip_poll))
 				{
-					pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &ic_statistics.crcErrors, 1);
-					if (DEBUG2 >= log_min_messages)
-						write_log("received network data error, dropping bad packet, user data unaffected.");
-					continue;
+					pkts[i] = NULL;
+					nkept++;
 				}
 			}
 
-#ifdef AMS_VERBOSE_LOGGING
-			logPkt("GOT MESSAGE", pkt);
-#endif
-
-			bool		wakeup_mainthread = false;
-			AckSendParam param;
-
-			memset(&param, 0, sizeof(AckSendParam));
-
-			/*
-			 * Get the connection for the pkt.
-			 *
-			 * The connection hash table should be locked until finishing the
-			 * processing of the packet to avoid the connection
-			 * addition/removal from the hash table during the mean time.
-			 */
-
-			pthread_mutex_lock(&ic_control_info.lock);
-			conn = findConnByHeader(&ic_control_info.connHtab, pkt);
-
-			if (conn != NULL)
-			{
-				/* Handling a regular packet */
-				if (handleDataPacket(conn, pkt, &peer, &peerlen, &param, &wakeup_mainthread))
-					pkt = NULL;
-				ic_statistics.recvPktNum++;
-			}
-			else
+			/* Keep the buffers that were not handed over */
+			if (nkept > 0)
 			{
-				/*
-				 * There may have two kinds of Mismatched packets: a) Past
-				 * packets from previous command after I was torn down b)
-				 * Future packets from current command before my connections
-				 * are built.
-				 *
-				 * The handling logic is to "Ack the past and Nak the future".
-				 */
-				if ((pkt->flags & UDPIC_FLAGS_RECEIVER_TO_SENDER) == 0)
-				{
-					if (DEBUG1 >= log_min_messages)
-						write_log("mismatched packet received, seq %d, srcpid %d, dstpid %d, icid %d, sid %d", pkt->seq, pkt->srcPid, pkt->dstPid, pkt->icId, pkt->sessionId);
-
-#ifdef AMS_VERBOSE_LOGGING
-					logPkt("Got a Mismatched Packet", pkt);
-#endif
+				int			j = 0;
 
-					if (handleMismatch(pkt, &peer, peerlen))
-						pkt = NULL;
-					ic_statistics.mismatchNum++;
+				for (i = 0; i < npkts; i++)
+				{
+					if (pkts[i] != NULL)
+						pkts[j++] = pkts[i];
 				}
+				npkts = j;
 			}
-			pthread_mutex_unlock(&ic_control_info.lock);
-
-			if (wakeup_mainthread)
-				SetLatch(&ic_control_info.latch);
-
-			/*
-			 * real ack sending is after lock release to decrease the lock
-			 * holding time.
-			 */
-			if (param.msg.len != 0)
-				sendAckWithParam(&param);
 		}
 
 		/* pthread_yield(); */
 	}
 
-	/* Before return, we release the packet. */
-	if (pkt)
+	/* Before return, we release the packets. */
+	if (npkts > 0)
 	{
 		pthread_mutex_lock(&ic_control_info.lock);
-		freeRxBuffer(&rx_buffer_pool, pkt);
-		pkt = NULL;
+		for (i = 0; i < npkts; i++)
+			freeRxBuffer(&rx_buffer_pool, pkts[i]);
+		npkts = 0;
 		pthread_mutex_unlock(&ic_control_info.lock);
 	}
 
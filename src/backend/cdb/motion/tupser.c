@@ -16,6 +16,7 @@
 #include "postgres.h"
 
 #include "access/htup.h"
+#include "access/tupmacs.h"
 #include "catalog/pg_type.h"
 #include "cdb/cdbmotion.h"
 #include "cdb/cdbsrlz.h"
@@ -45,6 +46,21 @@
 #define RECORD_CACHE_MAGIC_NATTS	0xffff
 #define RECORD_CACHE_MAGIC_INFOMASK	0xffff
 
+/*
+ * A column-wise batch of tuples is sent the same way, with natts set to
+ * TUPLE_BATCH_MAGIC_NATTS.  See SerializeTupleBatch() for the layout.
+ */
+#define TUPLE_BATCH_MAGIC_NATTS		0xfffe
+#define TUPLE_BATCH_MAGIC_INFOMASK	0xffff
+
+/* Encodings of the values of an attribute in a batch */
+#define TUPBATCH_PLAIN		0	/* the values one after the other */
+#define TUPBATCH_RLE		1	/* distinct values, then run lengths */
+#define TUPBATCH_DICT		2	/* dictionary, then one byte codes */
+
+/* Largest dictionary we try to build for an attribute */
+#define TUPBATCH_MAX_DICT	16
+
 /* A MemoryContext used within the tuple serialize code, so that freeing of
  * space is SUPAFAST.  It is initialized in the first call to InitSerTupInfo()
  * since that must be called before any tuple serialization or deserialization
@@ -133,6 +149,12 @@ InitSerTupInfo(TupleDesc tupdesc, SerTupInfo *pSerInfo)
 
 	pSerInfo->myinfo = (SerAttrInfo *) palloc0(numAttrs * sizeof(SerAttrInfo));
 
+	/*
+	 * Tuples can be batched if every attribute is fixed width, and there is
+	 * nothing to remap on the receiving side.
+	 */
+	pSerInfo->batchable = (gp_motion_batch_size > 0 && !tupdesc->tdhasoid);
+
 	pSerInfo->values = (Datum *) palloc(numAttrs * sizeof(Datum));
 	pSerInfo->nulls = (bool *) palloc(numAttrs * sizeof(bool));
 
@@ -177,9 +199,15 @@ InitSerTupInfo(TupleDesc tupdesc, SerTupInfo *pSerInfo)
 			attrInfo->typlen = pt->typlen;
 			attrInfo->typbyval = pt->typbyval;
 
+			if (attrInfo->typlen <= 0)
+				pSerInfo->batchable = false;
+
 			ReleaseSysCache(typeTuple);
 		}
 	}
+
+	if (pSerInfo->has_record_types)
+		pSerInfo->batchable = false;
 }
 
 
@@ -206,6 +234,13 @@ CleanupSerTupInfo(SerTupInfo *pSerInfo)
 		pfree(pSerInfo->nulls);
 	pSerInfo->nulls = NULL;
 
+	if (pSerInfo->batch_tuples != NULL)
+		pfree(pSerInfo->batch_tuples);
+	pSerInfo->batch_tuples = NULL;
+	pSerInfo->batch_ntuples = 0;
+	pSerInfo->batch_next = 0;
+	pSerInfo->batch_maxtuples = 0;
+
 	pSerInfo->tupdesc = NULL;
 
 	while (pSerInfo->chunkCache.items != NULL)
@@ -738,6 +773,734 @@ SerializeTuple(TupleTableSlot *slot, SerTupInfo *pSerInfo, struct directTranspor
 	return 0;
 }
 
+/*
+ * Column-wise batches of tuples.
+ *
+ * When all attributes of a motion's tuples are fixed width, the sender may
+ * collect tuples for a route in a SerTupBatch, and send them as one tuple
+ * chunk that holds the values of each attribute together.  This saves the
+ * per-tuple headers and padding of SerializeTuple(), and low-cardinality
+ * attributes are cheap to compress on the way.  The batch looks like a
+ * tuple to the chunk layer:
+ *
+ *	  TupSerHeader		tuplen, natts = TUPLE_BATCH_MAGIC_NATTS
+ *	  TupBatchHeader	number of tuples and attributes
+ *
+ * followed by each attribute:
+ *
+ *	  TupBatchAttr		encoding of the values, and number of items
+ *	  bitmap			of non-NULL rows, only if the attribute has NULLs
+ *	  values			of the non-NULL rows, in the given encoding
+ *
+ * Every part is padded to TUPLE_CHUNK_ALIGN.  A batch is never larger than a
+ * tuple chunk, so it is normally sent as a single TC_WHOLE chunk.
+ */
+typedef struct TupBatchHeader
+{
+	uint16		ntuples;
+	uint16		natts;
+} TupBatchHeader;
+
+typedef struct TupBatchAttr
+{
+	uint8		encoding;		/* TUPBATCH_* */
+	uint8		hasnulls;		/* is a bitmap present? */
+	uint16		nitems;			/* runs or dictionary entries */
+} TupBatchAttr;
+
+/* How the sender is going to encode an attribute of a batch */
+typedef struct TupBatchAttrPlan
+{
+	int			encoding;
+	int			nitems;
+	uint32		size;			/* bytes of the encoded values */
+	int			dict[TUPBATCH_MAX_DICT];	/* first value of each entry */
+} TupBatchAttrPlan;
+
+/* Upper bound of the size of a batch of ntuples tuples */
+static uint32
+tupleBatchMaxSize(SerTupInfo *pSerInfo, int ntuples)
+{
+	uint32		size = sizeof(TupSerHeader) + sizeof(TupBatchHeader);
+	int			i;
+
+	for (i = 0; i < pSerInfo->tupdesc->natts; i++)
+	{
+		size += sizeof(TupBatchAttr);
+		size += TYPEALIGN(TUPLE_CHUNK_ALIGN, BITMAPLEN(ntuples));
+		size += TYPEALIGN(TUPLE_CHUNK_ALIGN, ntuples * pSerInfo->myinfo[i].typlen);
+	}
+
+	return size;
+}
+
+/*
+ * Set up a batch for the tuples of one route.
+ *
+ * The batch takes gp_motion_batch_size tuples, or fewer if that many would
+ * not fit in a tuple chunk.  Returns NULL if the tuples are too wide for
+ * batching to be worthwhile.
+ *
+ * The batch is allocated in the current memory context.
+ */
+SerTupBatch *
+CreateTupleBatch(SerTupInfo *pSerInfo)
+{
+	SerTupBatch *batch;
+	int			natts = pSerInfo->tupdesc->natts;
+	uint32		limit = Gp_max_tuple_chunk_size - TUPLE_CHUNK_HEADER_SIZE;
+	uint32		width = 0;
+	int			capacity;
+	int			i;
+
+	Assert(pSerInfo->batchable);
+
+	for (i = 0; i < natts; i++)
+		width += pSerInfo->myinfo[i].typlen;
+
+	/* start from an estimate, which the padding may push over the limit */
+	capacity = Min(gp_motion_batch_size, (int) ((uint64) limit * 8 / (width * 8 + natts)));
+	while (capacity >= 2 && tupleBatchMaxSize(pSerInfo, capacity) > limit)
+		capacity--;
+
+	if (capacity < 2)
+		return NULL;
+
+	batch = (SerTupBatch *) palloc0(sizeof(SerTupBatch));
+	batch->capacity = capacity;
+	batch->nvalues = (int *) palloc0(natts * sizeof(int));
+	batch->values = (char **) palloc(natts * sizeof(char *));
+	batch->nulls = (bits8 **) palloc(natts * sizeof(bits8 *));
+	batch->hasnulls = (bool *) palloc0(natts * sizeof(bool));
+
+	for (i = 0; i < natts; i++)
+	{
+		batch->values[i] = palloc(capacity * pSerInfo->myinfo[i].typlen);
+		batch->nulls[i] = palloc0(BITMAPLEN(capacity));
+	}
+
+	return batch;
+}
+
+/* Empty a batch after it has been sent */
+static void
+resetTupleBatch(SerTupInfo *pSerInfo, SerTupBatch *batch)
+{
+	int			i;
+
+	for (i = 0; i < pSerInfo->tupdesc->natts; i++)
+	{
+		memset(batch->nulls[i], 0, BITMAPLEN(batch->ntuples));
+		batch->nvalues[i] = 0;
+		batch->hasnulls[i] = false;
+	}
+	batch->ntuples = 0;
+}
+
+/*
+ * Add a tuple to a batch.
+ *
+ * Returns true if the batch is full, and must be sent with
+ * SerializeTupleBatch() before another tuple can be added.
+ */
+bool
+AddTupleToBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, TupleTableSlot *slot)
+{
+	int			natts = pSerInfo->tupdesc->natts;
+	int			row = batch->ntuples;
+	Datum	   *values;
+	bool	   *isnull;
+	int			i;
+
+	Assert(row < batch->capacity);
+
+	slot_getallattrs(slot);
+	values = slot_get_values(slot);
+	isnull = slot_get_isnull(slot);
+
+	for (i = 0; i < natts; i++)
+	{
+		SerAttrInfo *attrInfo = pSerInfo->myinfo + i;
+		char	   *dst;
+
+		if (isnull[i])
+		{
+			batch->hasnulls[i] = true;
+			continue;
+		}
+
+		batch->nulls[i][row >> 3] |= (1 << (row & 7));
+
+		dst = batch->values[i] + batch->nvalues[i] * attrInfo->typlen;
+		if (attrInfo->typbyval)
+			store_att_byval(dst, values[i], attrInfo->typlen);
+		else
+			memcpy(dst, DatumGetPointer(values[i]), attrInfo->typlen);
+		batch->nvalues[i]++;
+	}
+
+	batch->ntuples++;
+
+	return batch->ntuples >= batch->capacity;
+}
+
+/* Count the runs of equal values */
+static int
+batchRuns(const char *values, int nvalues, int typlen)
+{
+	int			nruns = 1;
+	int			i;
+
+	for (i = 1; i < nvalues; i++)
+	{
+		if (memcmp(values + i * typlen, values + (i - 1) * typlen, typlen) != 0)
+			nruns++;
+	}
+
+	return nruns;
+}
+
+/*
+ * Collect the distinct values, as the index of their first occurrence.
+ * Returns -1 if there are more than TUPBATCH_MAX_DICT of them.
+ */
+static int
+batchDictionary(const char *values, int nvalues, int typlen, int *dict)
+{
+	int			ndict = 0;
+	int			i,
+				j;
+
+	for (i = 0; i < nvalues; i++)
+	{
+		for (j = 0; j < ndict; j++)
+		{
+			if (memcmp(values + i * typlen, values + dict[j] * typlen, typlen) == 0)
+				break;
+		}
+
+		if (j == ndict)
+		{
+			if (ndict == TUPBATCH_MAX_DICT)
+				return -1;
+			dict[ndict++] = i;
+		}
+	}
+
+	return ndict;
+}
+
+/*
+ * Choose the encoding of each attribute of a batch, the one that takes the
+ * least space.  Returns the size of the serialized batch.
+ */
+static uint32
+planTupleBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, TupBatchAttrPlan *plans)
+{
+	uint32		len = sizeof(TupSerHeader) + sizeof(TupBatchHeader);
+	int			i;
+
+	for (i = 0; i < pSerInfo->tupdesc->natts; i++)
+	{
+		TupBatchAttrPlan *plan = plans + i;
+		int			typlen = pSerInfo->myinfo[i].typlen;
+		int			nvalues = batch->nvalues[i];
+		const char *values = batch->values[i];
+
+		plan->encoding = TUPBATCH_PLAIN;
+		plan->nitems = 0;
+		plan->size = TYPEALIGN(TUPLE_CHUNK_ALIGN, nvalues * typlen);
+
+		if (nvalues > 1)
+		{
+			int			nruns;
+			int			ndict;
+			uint32		size;
+
+			nruns = batchRuns(values, nvalues, typlen);
+			size = TYPEALIGN(TUPLE_CHUNK_ALIGN, nruns * typlen) +
+				TYPEALIGN(TUPLE_CHUNK_ALIGN, nruns * sizeof(uint16));
+			if (size < plan->size)
+			{
+				plan->encoding = TUPBATCH_RLE;
+				plan->nitems = nruns;
+				plan->size = size;
+			}
+
+			/* one byte codes don't make single byte values any smaller */
+			ndict = (typlen > 1) ? batchDictionary(values, nvalues, typlen, plan->dict) : -1;
+			if (ndict > 0)
+			{
+				size = TYPEALIGN(TUPLE_CHUNK_ALIGN, ndict * typlen) +
+					TYPEALIGN(TUPLE_CHUNK_ALIGN, nvalues);
+				if (size < plan->size)
+				{
+					plan->encoding = TUPBATCH_DICT;
+					plan->nitems = ndict;
+					plan->size = size;
+				}
+			}
+		}
+
+		len += sizeof(TupBatchAttr) + plan->size;
+		if (batch->hasnulls[i])
+			len += TYPEALIGN(TUPLE_CHUNK_ALIGN, BITMAPLEN(batch->ntuples));
+	}
+
+	return len;
+}
+
+/* Zero the padding after len bytes at pos, and return the end of it */
+static inline char *
+padBatchBytes(char *pos, int len)
+{
+	int			padding = TYPEALIGN(TUPLE_CHUNK_ALIGN, len) - len;
+
+	memset(pos + len, 0, padding);
+	return pos + len + padding;
+}
+
+/* Write the serialized form of a batch, of len bytes, to buf */
+static void
+writeTupleBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, TupBatchAttrPlan *plans,
+				char *buf, uint32 len)
+{
+	TupSerHeader tsh;
+	TupBatchHeader tbh;
+	char	   *pos = buf;
+	int			natts = pSerInfo->tupdesc->natts;
+	int			i,
+				j,
+				k;
+
+	tsh.tuplen = len;
+	tsh.natts = TUPLE_BATCH_MAGIC_NATTS;
+	tsh.infomask = TUPLE_BATCH_MAGIC_INFOMASK;
+	memcpy(pos, &tsh, sizeof(tsh));
+	pos += sizeof(tsh);
+
+	tbh.ntuples = batch->ntuples;
+	tbh.natts = natts;
+	memcpy(pos, &tbh, sizeof(tbh));
+	pos += sizeof(tbh);
+
+	for (i = 0; i < natts; i++)
+	{
+		TupBatchAttrPlan *plan = plans + i;
+		TupBatchAttr tba;
+		int			typlen = pSerInfo->myinfo[i].typlen;
+		int			nvalues = batch->nvalues[i];
+		const char *values = batch->values[i];
+
+		tba.encoding = plan->encoding;
+		tba.hasnulls = batch->hasnulls[i];
+		tba.nitems = plan->nitems;
+		memcpy(pos, &tba, sizeof(tba));
+		pos += sizeof(tba);
+
+		if (batch->hasnulls[i])
+		{
+			memcpy(pos, batch->nulls[i], BITMAPLEN(batch->ntuples));
+			pos = padBatchBytes(pos, BITMAPLEN(batch->ntuples));
+		}
+
+		switch (plan->encoding)
+		{
+			case TUPBATCH_PLAIN:
+				memcpy(pos, values, nvalues * typlen);
+				pos = padBatchBytes(pos, nvalues * typlen);
+				break;
+
+			case TUPBATCH_RLE:
+				{
+					char	   *runs = pos + TYPEALIGN(TUPLE_CHUNK_ALIGN, plan->nitems * typlen);
+					int			start = 0;
+
+					/* the first value of each run, then the run lengths */
+					for (j = 0, k = 1; k <= nvalues; k++)
+					{
+						uint16		runlen;
+
+						if (k < nvalues &&
+							memcmp(values + k * typlen, values + start * typlen, typlen) == 0)
+							continue;
+
+						runlen = k - start;
+						memcpy(pos + j * typlen, values + start * typlen, typlen);
+						memcpy(runs + j * sizeof(uint16), &runlen, sizeof(uint16));
+						j++;
+						start = k;
+					}
+					Assert(j == plan->nitems);
+
+					pos = padBatchBytes(pos, plan->nitems * typlen);
+					pos = padBatchBytes(pos, plan->nitems * sizeof(uint16));
+				}
+				break;
+
+			case TUPBATCH_DICT:
+				for (j = 0; j < plan->nitems; j++)
+					memcpy(pos + j * typlen, values + plan->dict[j] * typlen, typlen);
+				pos = padBatchBytes(pos, plan->nitems * typlen);
+
+				for (k = 0; k < nvalues; k++)
+				{
+					for (j = 0; j < plan->nitems; j++)
+					{
+						if (memcmp(values + k * typlen, values + plan->dict[j] * typlen, typlen) == 0)
+							break;
+					}
+					Assert(j < plan->nitems);
+					pos[k] = (char) j;
+				}
+				pos = padBatchBytes(pos, nvalues);
+				break;
+		}
+	}
+
+	Assert(pos == buf + len);
+}
+
+/*
+ * Convert a batch into a byte-sequence, directly into the transport buffer
+ * if it fits there, else into a chunklist.  Like SerializeTuple(), returns
+ * the number of bytes used in the transport buffer, or 0 if the batch went
+ * into the chunklist.
+ *
+ * The batch is empty afterwards.
+ */
+int
+SerializeTupleBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, struct directTransportBuffer *b, TupleChunkList tcList, int16 targetRoute)
+{
+	TupBatchAttrPlan *plans;
+	TupleChunkListItem tcItem;
+	MemoryContext oldCtxt;
+	uint32		len;
+	int			result;
+
+	AssertArg(pSerInfo != NULL);
+	AssertArg(batch != NULL && batch->ntuples > 0);
+	AssertState(s_tupSerMemCtxt != NULL);
+
+	oldCtxt = MemoryContextSwitchTo(s_tupSerMemCtxt);
+	plans = (TupBatchAttrPlan *) palloc(pSerInfo->tupdesc->natts * sizeof(TupBatchAttrPlan));
+	MemoryContextSwitchTo(oldCtxt);
+
+	len = planTupleBatch(pSerInfo, batch, plans);
+
+	if (CandidateForSerializeDirect(targetRoute, b) &&
+		(int) len + TUPLE_CHUNK_HEADER_SIZE <= b->prilen)
+	{
+		writeTupleBatch(pSerInfo, batch, plans,
+						(char *) b->pri + TUPLE_CHUNK_HEADER_SIZE, len);
+
+		SetChunkType(b->pri, TC_WHOLE);
+		SetChunkDataSize(b->pri, len);
+
+		result = len + TUPLE_CHUNK_HEADER_SIZE;
+	}
+	else
+	{
+		tcList->p_first = NULL;
+		tcList->p_last = NULL;
+		tcList->num_chunks = 0;
+		tcList->serialized_data_length = 0;
+		tcList->max_chunk_length = Gp_max_tuple_chunk_size;
+
+		/* CreateTupleBatch() made sure of this */
+		if (len + TUPLE_CHUNK_HEADER_SIZE > tcList->max_chunk_length)
+			elog(ERROR, "tuple batch of %u bytes does not fit in a chunk", len);
+
+		tcItem = getChunkFromCache(&pSerInfo->chunkCache);
+		if (tcItem == NULL)
+		{
+			ereport(FATAL,
+					(errcode(ERRCODE_OUT_OF_MEMORY),
+					 errmsg("could not allocate space for first chunk item in new chunk list")));
+		}
+
+		writeTupleBatch(pSerInfo, batch, plans,
+						(char *) tcItem->chunk_data + TUPLE_CHUNK_HEADER_SIZE, len);
+
+		SetChunkType(tcItem->chunk_data, TC_WHOLE);
+		SetChunkDataSize(tcItem->chunk_data, len);
+		tcItem->chunk_length = TUPLE_CHUNK_HEADER_SIZE + len;
+		appendChunkToTCList(tcList, tcItem);
+		tcList->serialized_data_length = len;
+
+		result = 0;
+	}
+
+	resetTupleBatch(pSerInfo, batch);
+	MemoryContextReset(s_tupSerMemCtxt);
+
+	return result;
+}
+
+/* Fetch a value of a batch, which need not be aligned */
+static inline Datum
+fetchBatchValue(const char *p, SerAttrInfo *attrInfo)
+{
+	if (!attrInfo->typbyval)
+		return PointerGetDatum(p);
+
+	switch (attrInfo->typlen)
+	{
+		case sizeof(char):
+			return CharGetDatum(*p);
+		case sizeof(int16):
+			{
+				int16		v;
+
+				memcpy(&v, p, sizeof(v));
+				return Int16GetDatum(v);
+			}
+		case sizeof(int32):
+			{
+				int32		v;
+
+				memcpy(&v, p, sizeof(v));
+				return Int32GetDatum(v);
+			}
+#if SIZEOF_DATUM == 8
+		case sizeof(Datum):
+			{
+				Datum		v;
+
+				memcpy(&v, p, sizeof(v));
+				return v;
+			}
+#endif
+		default:
+			elog(ERROR, "unsupported byval length: %d", (int) attrInfo->typlen);
+			return (Datum) 0;	/* keep compiler quiet */
+	}
+}
+
+/*
+ * Decode the values of one attribute of a batch, into every stride'th entry
+ * of values and isnull.
+ */
+static void
+decodeBatchAttr(SerTupInfo *pSerInfo, int attno, StringInfo serialTup,
+				int ntuples, Datum *values, bool *isnull, int stride)
+{
+	SerAttrInfo *attrInfo = pSerInfo->myinfo + attno;
+	int			typlen = attrInfo->typlen;
+	TupBatchAttr tba;
+	const bits8 *bitmap = NULL;
+	const char *items;
+	int			nvalues;
+	int			row;
+	int			i;
+
+	pq_copymsgbytes(serialTup, (char *) &tba, sizeof(tba));
+
+	nvalues = ntuples;
+	if (tba.hasnulls)
+	{
+		bitmap = (const bits8 *) pq_getmsgbytes(serialTup, BITMAPLEN(ntuples));
+		skipPadding(serialTup);
+
+		nvalues = 0;
+		for (row = 0; row < ntuples; row++)
+		{
+			if (att_isnull(row, bitmap) == 0)
+				nvalues++;
+		}
+	}
+
+	switch (tba.encoding)
+	{
+		case TUPBATCH_PLAIN:
+			items = pq_getmsgbytes(serialTup, nvalues * typlen);
+			skipPadding(serialTup);
+
+			for (row = 0, i = 0; row < ntuples; row++)
+			{
+				Datum	   *value = values + row * stride;
+
+				if ((isnull[row * stride] = (bitmap && att_isnull(row, bitmap))))
+				{
+					*value = (Datum) 0;
+					continue;
+				}
+				*value = fetchBatchValue(items + i * typlen, attrInfo);
+				i++;
+			}
+			break;
+
+		case TUPBATCH_RLE:
+			{
+				const char *runs;
+				int			remaining = 0;
+				int			total = 0;
+				Datum		current = (Datum) 0;
+				uint16		runlen;
+
+				items = pq_getmsgbytes(serialTup, tba.nitems * typlen);
+				skipPadding(serialTup);
+				runs = pq_getmsgbytes(serialTup, tba.nitems * sizeof(uint16));
+				skipPadding(serialTup);
+
+				for (i = 0; i < tba.nitems; i++)
+				{
+					memcpy(&runlen, runs + i * sizeof(uint16), sizeof(uint16));
+					total += runlen;
+				}
+				if (total != nvalues)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							 errmsg("incorrect binary data format"),
+							 errdetail("Runs of tuple batch attribute %d hold %d values, expected %d.",
+									   attno + 1, total, nvalues)));
+
+				for (row = 0, i = -1; row < ntuples; row++)
+				{
+					if ((isnull[row * stride] = (bitmap && att_isnull(row, bitmap))))
+					{
+						values[row * stride] = (Datum) 0;
+						continue;
+					}
+					while (remaining == 0)
+					{
+						i++;
+						memcpy(&runlen, runs + i * sizeof(uint16), sizeof(uint16));
+						remaining = runlen;
+						current = fetchBatchValue(items + i * typlen, attrInfo);
+					}
+					values[row * stride] = current;
+					remaining--;
+				}
+			}
+			break;
+
+		case TUPBATCH_DICT:
+			{
+				const unsigned char *codes;
+				Datum		dict[TUPBATCH_MAX_DICT];
+
+				if (tba.nitems > TUPBATCH_MAX_DICT)
+					ereport(ERROR,
+							(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+							 errmsg("incorrect binary data format"),
+							 errdetail("Tuple batch attribute %d has a dictionary of %d entries.",
+									   attno + 1, tba.nitems)));
+
+				items = pq_getmsgbytes(serialTup, tba.nitems * typlen);
+				skipPadding(serialTup);
+				codes = (const unsigned char *) pq_getmsgbytes(serialTup, nvalues);
+				skipPadding(serialTup);
+
+				for (i = 0; i < tba.nitems; i++)
+					dict[i] = fetchBatchValue(items + i * typlen, attrInfo);
+
+				for (row = 0, i = 0; row < ntuples; row++)
+				{
+					if ((isnull[row * stride] = (bitmap && att_isnull(row, bitmap))))
+					{
+						values[row * stride] = (Datum) 0;
+						continue;
+					}
+					if (codes[i] >= tba.nitems)
+						ereport(ERROR,
+								(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+								 errmsg("incorrect binary data format"),
+								 errdetail("Tuple batch attribute %d has dictionary code %d out of %d.",
+										   attno + 1, codes[i], tba.nitems)));
+					values[row * stride] = dict[codes[i]];
+					i++;
+				}
+			}
+			break;
+
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+					 errmsg("incorrect binary data format"),
+					 errdetail("Unknown encoding %d of tuple batch attribute %d.",
+							   tba.encoding, attno + 1)));
+	}
+}
+
+/*
+ * Deserialize a batch, positioned after its TupSerHeader, into tuples.
+ *
+ * The values of each attribute are decoded in one go, then the tuples are
+ * formed.  The first tuple is returned, the rest are handed out by
+ * GetNextBatchTuple().
+ */
+static GenericTuple
+DeserializeTupleBatch(SerTupInfo *pSerInfo, StringInfo serialTup)
+{
+	TupleDesc	tupdesc = pSerInfo->tupdesc;
+	int			natts = tupdesc->natts;
+	TupBatchHeader tbh;
+	MemoryContext oldCtxt;
+	Datum	   *values;
+	bool	   *isnull;
+	int			i;
+
+	pq_copymsgbytes(serialTup, (char *) &tbh, sizeof(tbh));
+	if (tbh.natts != natts || tbh.ntuples == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("incorrect binary data format"),
+				 errdetail("Tuple batch of %d tuples with %d attributes, expected %d attributes.",
+						   tbh.ntuples, tbh.natts, natts)));
+
+	AssertState(s_tupSerMemCtxt != NULL);
+	oldCtxt = MemoryContextSwitchTo(s_tupSerMemCtxt);
+
+	values = (Datum *) palloc(tbh.ntuples * natts * sizeof(Datum));
+	isnull = (bool *) palloc(tbh.ntuples * natts * sizeof(bool));
+
+	for (i = 0; i < natts; i++)
+		decodeBatchAttr(pSerInfo, i, serialTup, tbh.ntuples,
+						values + i, isnull + i, natts);
+
+	/* Trouble if it didn't eat the whole buffer */
+	if (serialTup->cursor != serialTup->len)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+				 errmsg("incorrect binary data format")));
+
+	/* Form the tuples in the caller's memory context */
+	MemoryContextSwitchTo(oldCtxt);
+
+	if (pSerInfo->batch_maxtuples < tbh.ntuples)
+	{
+		if (pSerInfo->batch_tuples != NULL)
+			pfree(pSerInfo->batch_tuples);
+		pSerInfo->batch_tuples = (GenericTuple *) palloc(tbh.ntuples * sizeof(GenericTuple));
+		pSerInfo->batch_maxtuples = tbh.ntuples;
+	}
+
+	for (i = 0; i < tbh.ntuples; i++)
+		pSerInfo->batch_tuples[i] = (GenericTuple)
+			heap_form_tuple(tupdesc, values + i * natts, isnull + i * natts);
+
+	MemoryContextReset(s_tupSerMemCtxt);
+
+	pSerInfo->batch_ntuples = tbh.ntuples;
+	pSerInfo->batch_next = 1;
+
+	return pSerInfo->batch_tuples[0];
+}
+
+/*
+ * Return the next tuple of the batch most recently deserialized by
+ * CvtChunksToTup(), or NULL when there are no more.
+ */
+GenericTuple
+GetNextBatchTuple(SerTupInfo *pSerInfo)
+{
+	if (pSerInfo->batch_next >= pSerInfo->batch_ntuples)
+		return NULL;
+
+	return pSerInfo->batch_tuples[pSerInfo->batch_next++];
+}
+
 /*
  * Deserialize a HeapTuple's data from a byte-array.
  *
@@ -1013,6 +1776,22 @@ CvtChunksToTup(TupleChunkList tcList, SerTupInfo *pSerInfo, TupleRemapper *remap
 			return NULL;
 		}
 
+		if (!(tshp->tuplen & MEMTUP_LEAD_BIT) &&
+			tshp->natts == TUPLE_BATCH_MAGIC_NATTS &&
+			tshp->infomask == TUPLE_BATCH_MAGIC_INFOMASK)
+		{
+			/* a column-wise batch of tuples */
+			serData.cursor += sizeof(TupSerHeader);
+
+			tup = DeserializeTupleBatch(pSerInfo, &serData);
+
+			/* Free up memory we used. */
+			if (serDataMustFree)
+				pfree(serData.data);
+
+			return tup;
+		}
+
 		if ((tshp->tuplen & MEMTUP_LEAD_BIT) != 0)
 		{
 			uint32		tuplen = memtuple_size_from_uint32(tshp->tuplen);
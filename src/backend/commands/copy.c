@@ -23,6 +23,9 @@
 #include <sys/stat.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
@@ -74,6 +77,52 @@
 #define ISOCTAL(c) (((c) >= '0') && ((c) <= '7'))
 #define OCTVALUE(c) ((c) - '0')
 
+/*
+ * Find the first of the bytes c1, c2, c3 or c4 in [ptr, end), or return end
+ * if there is none.  Callers that look for fewer bytes pass the same byte
+ * more than once.
+ *
+ * The line and field parsers below spend most of their time walking over
+ * ordinary data bytes looking for the few that mean something to them, so
+ * they use this to skip over the runs of ordinary bytes.  On x86-64, SSE2 is
+ * always available and lets us test 16 bytes at a time; once a block with a
+ * match is found, the plain loop pinpoints it.
+ */
+static inline const char *
+CopyScanForSpecial(const char *ptr, const char *end,
+				   char c1, char c2, char c3, char c4)
+{
+#ifdef __SSE2__
+	const __m128i v1 = _mm_set1_epi8(c1);
+	const __m128i v2 = _mm_set1_epi8(c2);
+	const __m128i v3 = _mm_set1_epi8(c3);
+	const __m128i v4 = _mm_set1_epi8(c4);
+
+	while (end - ptr >= 16)
+	{
+		__m128i		chunk = _mm_loadu_si128((const __m128i *) ptr);
+		__m128i		match;
+
+		match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, v1),
+										  _mm_cmpeq_epi8(chunk, v2)),
+							 _mm_or_si128(_mm_cmpeq_epi8(chunk, v3),
+										  _mm_cmpeq_epi8(chunk, v4)));
+		if (_mm_movemask_epi8(match) != 0)
+			break;
+		ptr += 16;
+	}
+#endif
+
+	for (; ptr < end; ptr++)
+	{
+		char		c = *ptr;
+
+		if (c == c1 || c == c2 || c == c3 || c == c4)
+			break;
+	}
+	return ptr;
+}
+
 
 
 
@@ -206,6 +255,10 @@ static void SendCopyFromForwardedTuple(CopyState cstate,
 						   bool *nulls);
 static void SendCopyFromForwardedHeader(CopyState cstate, CdbCopy *cdbCopy, bool file_has_oids);
 static void SendCopyFromForwardedError(CopyState cstate, CdbCopy *cdbCopy, char *errmsg);
+static bool CopyFromCanForwardLines(CopyState cstate, EState *estate);
+static uint64 SendCopyFromForwardedLines(CopyState cstate, CdbCopy *cdbCopy);
+static bool CopyReadForwardedLine(CopyState cstate);
+static void CopyFromInitInsertDesc(CopyState cstate, ResultRelInfo *resultRelInfo);
 
 static bool NextCopyFromDispatch(CopyState cstate, ExprContext *econtext,
 								 Datum *values, bool *nulls, Oid *tupleOid);
@@ -311,6 +364,16 @@ static CopyStmt *glob_copystmt = NULL;
  * it to the QE. Before any rows, a QDtoQESignature is sent first, followed by
  * a 'copy_from_dispatch_header'.
  *
+ * When the QD doesn't need to look at a row to know where it goes, i.e. when
+ * the target table is randomly distributed or replicated (not
+ * hash-distributed), it doesn't parse the rows at all. It only splits the
+ * input into lines, and sends them in blocks of 'copy_from_dispatch_line'
+ * frames to the QEs in round-robin order, or to all of them if the table is
+ * replicated. The QEs then parse the lines, evaluate the defaults, and insert
+ * the rows, like they would in utility mode. The header tells the QEs which
+ * kind of stream to expect. See CopyFromCanForwardLines() for the details of
+ * when we do this.
+ *
  *
  * COPY TO is simpler: The QEs form the output rows in the final form, and the QD
  * just collects and forwards them to the client. The QD doesn't need to parse
@@ -321,6 +384,7 @@ static const char QDtoQESignature[] = "PGCOPY-QD-TO-QE\n\377\r\n";
 typedef struct
 {
 	bool		file_has_oids;
+	bool		forward_lines;	/* rows are sent as unparsed lines */
 } copy_from_dispatch_header;
 
 typedef struct
@@ -360,6 +424,22 @@ typedef struct
 	/* 'line' follows */
 } copy_from_dispatch_error;
 
+typedef struct
+{
+	/* target relation OID, like in a row. Only used to tell this from an error. */
+	Oid			relid;
+	int64		lineno;
+	uint32		line_len;
+
+	/* 'line' follows, converted to server encoding */
+} copy_from_dispatch_line;
+
+/*
+ * In forward_lines mode, the QD collects this many bytes of lines for one
+ * QE, before moving on to the next one.
+ */
+#define COPY_FORWARD_BLOCK_SIZE		(64 * 1024)
+
 
 
 
@@ -3735,6 +3815,8 @@ CopyFrom(CopyState cstate)
 		cdbCopyStart(cdbCopy, glob_copystmt,
 					 estate->es_result_partitions, cstate->ao_segnos, cstate->file_encoding);
 
+		cstate->forward_lines = CopyFromCanForwardLines(cstate, estate);
+
 		/*
 		 * Skip header processing if dummy file get from master for COPY FROM ON
 		 * SEGMENT
@@ -3763,6 +3845,17 @@ CopyFrom(CopyState cstate)
 
 		CHECK_FOR_INTERRUPTS();
 
+		if (cstate->dispatch_mode == COPY_DISPATCH && cstate->forward_lines)
+		{
+			/* The QEs do all the work, we just pass them the lines. */
+			processed = SendCopyFromForwardedLines(cstate, cdbCopy);
+
+			/* Still need the insertion desc in the QD, see below */
+			if (processed > 0)
+				CopyFromInitInsertDesc(cstate, resultRelInfo);
+			break;
+		}
+
 		if (nTotalBufferedTuples == 0)
 		{
 			/*
@@ -3787,7 +3880,7 @@ CopyFrom(CopyState cstate)
 		 */
 		estate->es_result_relation_info = parentResultRelInfo;
 
-		if (cstate->dispatch_mode == COPY_EXECUTOR)
+		if (cstate->dispatch_mode == COPY_EXECUTOR && !cstate->forward_lines)
 		{
 			slot = NextCopyFromExecute(cstate, econtext, estate, &loaded_oid);
 			if (slot == NULL)
@@ -3938,33 +4031,7 @@ CopyFrom(CopyState cstate)
 		 * inserted in the QEs, because we nevertheless need to create the
 		 * pg_aoseg rows in the QD.
 		 */
-		{
-			char		relstorage;
-
-			relstorage = RelinfoGetStorage(resultRelInfo);
-			if (relstorage == RELSTORAGE_AOROWS &&
-				resultRelInfo->ri_aoInsertDesc == NULL)
-			{
-				ResultRelInfoSetSegno(resultRelInfo, cstate->ao_segnos);
-				resultRelInfo->ri_aoInsertDesc =
-					appendonly_insert_init(resultRelInfo->ri_RelationDesc,
-										   resultRelInfo->ri_aosegno, false);
-			}
-			else if (relstorage == RELSTORAGE_AOCOLS &&
-					 resultRelInfo->ri_aocsInsertDesc == NULL)
-			{
-				ResultRelInfoSetSegno(resultRelInfo, cstate->ao_segnos);
-				resultRelInfo->ri_aocsInsertDesc =
-					aocs_insert_init(resultRelInfo->ri_RelationDesc,
-									 resultRelInfo->ri_aosegno, false);
-			}
-			else if (relstorage == RELSTORAGE_EXTERNAL &&
-					 resultRelInfo->ri_extInsertDesc == NULL)
-			{
-				resultRelInfo->ri_extInsertDesc =
-					external_insert_init(resultRelInfo->ri_RelationDesc);
-			}
-		}
+		CopyFromInitInsertDesc(cstate, resultRelInfo);
 
 		if (cstate->dispatch_mode == COPY_DISPATCH)
 		{
@@ -4296,6 +4363,40 @@ CopyFrom(CopyState cstate)
 	return processed;
 }
 
+/*
+ * A subroutine of CopyFrom, to initialize the "insertion desc" of the target
+ * relation, if its storage requires one.
+ */
+static void
+CopyFromInitInsertDesc(CopyState cstate, ResultRelInfo *resultRelInfo)
+{
+	char		relstorage;
+
+	relstorage = RelinfoGetStorage(resultRelInfo);
+	if (relstorage == RELSTORAGE_AOROWS &&
+		resultRelInfo->ri_aoInsertDesc == NULL)
+	{
+		ResultRelInfoSetSegno(resultRelInfo, cstate->ao_segnos);
+		resultRelInfo->ri_aoInsertDesc =
+			appendonly_insert_init(resultRelInfo->ri_RelationDesc,
+								   resultRelInfo->ri_aosegno, false);
+	}
+	else if (relstorage == RELSTORAGE_AOCOLS &&
+			 resultRelInfo->ri_aocsInsertDesc == NULL)
+	{
+		ResultRelInfoSetSegno(resultRelInfo, cstate->ao_segnos);
+		resultRelInfo->ri_aocsInsertDesc =
+			aocs_insert_init(resultRelInfo->ri_RelationDesc,
+							 resultRelInfo->ri_aosegno, false);
+	}
+	else if (relstorage == RELSTORAGE_EXTERNAL &&
+			 resultRelInfo->ri_extInsertDesc == NULL)
+	{
+		resultRelInfo->ri_extInsertDesc =
+			external_insert_init(resultRelInfo->ri_RelationDesc);
+	}
+}
+
 /*
  * A subroutine of CopyFrom, to write the current batch of buffered heap
  * tuples to the heap. Also updates indexes and runs AFTER ROW INSERT
@@ -4660,6 +4761,11 @@ BeginCopyFrom(Relation rel,
 					errmsg("invalid QD->QD COPY communication header")));
 
 		cstate->file_has_oids = header_frame.file_has_oids;
+		cstate->forward_lines = header_frame.forward_lines;
+
+		/* The QD already threw the header line away */
+		if (cstate->forward_lines)
+			cstate->header_line = false;
 	}
 	else if (!cstate->binary)
 	{
@@ -4758,7 +4864,10 @@ NextCopyFromRawFields(CopyState cstate, char ***fields, int *nfields)
 	cstate->cur_lineno++;
 
 	/* Actually read the line into memory here */
-	done = CopyReadLine(cstate);
+	if (cstate->dispatch_mode == COPY_EXECUTOR && cstate->forward_lines)
+		done = CopyReadForwardedLine(cstate);
+	else
+		done = CopyReadLine(cstate);
 
 	/*
 	 * EOF at start of line means we're done.  If we see EOF after some
@@ -5635,6 +5744,7 @@ SendCopyFromForwardedHeader(CopyState cstate, CdbCopy *cdbCopy, bool file_has_oi
 
 	memset(&header_frame, 0, sizeof(header_frame));
 	header_frame.file_has_oids = file_has_oids;
+	header_frame.forward_lines = cstate->forward_lines;
 
 	cdbCopySendDataToAll(cdbCopy, (char *) &header_frame, sizeof(header_frame));
 }
@@ -5673,6 +5783,166 @@ SendCopyFromForwardedError(CopyState cstate, CdbCopy *cdbCopy, char *errormsg)
 	cdbCopySendData(cdbCopy, target_seg, msgbuf->data, msgbuf->len);
 }
 
+/*
+ * Can the QD leave parsing the input rows to the QEs?
+ *
+ * That's only possible if the QD doesn't need the values to decide where to
+ * send a row, and if the QEs can evaluate any defaults themselves.
+ *
+ * This leaves out hash-distributed tables, which are most tables. A QE that
+ * got a line could parse it and compute its hash, but it would then have to
+ * pass the row on to the QE that owns it, and the QEs of a COPY have no
+ * interconnect to do that with. So the QD still parses and hashes every row
+ * of a hash-distributed table, and COPY into those is still bound by what
+ * the QD can parse.
+ */
+static bool
+CopyFromCanForwardLines(CopyState cstate, EState *estate)
+{
+	GpPolicy   *policy = cstate->rel->rd_cdbpolicy;
+
+	if (!gp_enable_segment_copy_parsing)
+		return false;
+
+	/* binary input has no lines to split at */
+	if (cstate->binary)
+		return false;
+
+	/*
+	 * The reject limit applies to the COPY as a whole, but each QE would
+	 * only know about the rows it rejected itself.
+	 */
+	if (cstate->errMode != ALL_OR_NOTHING)
+		return false;
+
+	/* the partitions may be distributed differently from the parent */
+	if (estate->es_result_partitions)
+		return false;
+
+	if (!RelationIsHeap(cstate->rel) && !RelationIsAppendOptimized(cstate->rel))
+		return false;
+
+	/* all replicas must end up with the same defaults */
+	if (GpPolicyIsReplicated(policy))
+		return cstate->num_defaults == 0;
+
+	return GpPolicyIsRandomPartitioned(policy);
+}
+
+/*
+ * In the QD, read the rest of the input, and forward it to the QEs line by
+ * line, without parsing it. Returns the number of lines sent.
+ *
+ * The lines are collected into blocks of about COPY_FORWARD_BLOCK_SIZE bytes,
+ * and each block goes to the next QE in turn.
+ */
+static uint64
+SendCopyFromForwardedLines(CopyState cstate, CdbCopy *cdbCopy)
+{
+	StringInfo	msgbuf = cstate->dispatch_msgbuf;
+	Oid			relid = RelationGetRelid(cstate->rel);
+	bool		toAll = GpPolicyIsReplicated(cstate->rel->rd_cdbpolicy);
+	int			target_seg = gp_session_id % cdbCopy->total_segs;
+	uint64		processed = 0;
+
+	resetStringInfo(msgbuf);
+
+	for (;;)
+	{
+		copy_from_dispatch_line frame;
+		bool		done;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* on input just throw the header line away */
+		if (cstate->cur_lineno == 0 && cstate->header_line)
+		{
+			cstate->cur_lineno++;
+			if (CopyReadLine(cstate))
+				break;
+		}
+
+		cstate->cur_lineno++;
+
+		/*
+		 * EOF at start of line means we're done. EOF after some characters
+		 * ends the last line.
+		 */
+		done = CopyReadLine(cstate);
+		if (done && cstate->line_buf.len == 0)
+			break;
+
+		frame.relid = relid;
+		frame.lineno = cstate->cur_lineno;
+		frame.line_len = cstate->line_buf.len;
+
+		APPEND_MSGBUF(msgbuf, &frame, sizeof(frame));
+		APPEND_MSGBUF(msgbuf, cstate->line_buf.data, cstate->line_buf.len);
+		processed++;
+
+		if (msgbuf->len >= COPY_FORWARD_BLOCK_SIZE)
+		{
+			if (toAll)
+				cdbCopySendDataToAll(cdbCopy, msgbuf->data, msgbuf->len);
+			else
+				cdbCopySendData(cdbCopy, target_seg, msgbuf->data, msgbuf->len);
+			resetStringInfo(msgbuf);
+
+			target_seg = (target_seg + 1) % cdbCopy->total_segs;
+		}
+	}
+
+	if (msgbuf->len > 0)
+	{
+		if (toAll)
+			cdbCopySendDataToAll(cdbCopy, msgbuf->data, msgbuf->len);
+		else
+			cdbCopySendData(cdbCopy, target_seg, msgbuf->data, msgbuf->len);
+	}
+
+	return processed;
+}
+
+/*
+ * In the QE, read the next line forwarded by SendCopyFromForwardedLines()
+ * into line_buf, like CopyReadLine() does.
+ *
+ * Result is true if there are no more lines.
+ */
+static bool
+CopyReadForwardedLine(CopyState cstate)
+{
+	copy_from_dispatch_line frame;
+	int			r;
+
+	resetStringInfo(&cstate->line_buf);
+	cstate->line_buf_valid = true;
+
+	r = CopyGetData(cstate, &frame, sizeof(frame));
+	if (r == 0)
+		return true;
+	if (r != sizeof(frame))
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unexpected EOF in COPY data")));
+	if (!OidIsValid(frame.relid))
+		elog(ERROR, "invalid line frame received from QD");
+
+	enlargeStringInfo(&cstate->line_buf, frame.line_len);
+	if (CopyGetData(cstate, cstate->line_buf.data, frame.line_len) != frame.line_len)
+		ereport(ERROR,
+				(errcode(ERRCODE_BAD_COPY_FILE_FORMAT),
+				 errmsg("unexpected EOF in COPY data")));
+	cstate->line_buf.len = frame.line_len;
+	cstate->line_buf.data[frame.line_len] = '\0';
+
+	/* the QD converted the line already */
+	cstate->line_buf_converted = true;
+	cstate->cur_lineno = frame.lineno;
+
+	return false;
+}
+
 /*
  * Clean up storage and release resources for COPY FROM.
  */
@@ -5799,6 +6069,11 @@ CopyReadLineText(CopyState cstate)
 	char		quotec = '\0';
 	char		escapec = '\0';
 
+	/* fast skipping over ordinary bytes */
+	bool		can_skip;
+	char		special1;
+	char		special2;
+
 	if (cstate->csv_mode)
 	{
 		quotec = cstate->quote[0];
@@ -5810,6 +6085,21 @@ CopyReadLineText(CopyState cstate)
 
 	mblen_str[1] = '\0';
 
+	/*
+	 * The bytes that the loop below needs to look at.  Anything else can be
+	 * skipped over in bulk, as long as we are not at the start of a line,
+	 * where a CSV backslash may begin the end-of-copy marker, and the file
+	 * encoding cannot hide these bytes in multi-byte characters.
+	 */
+	if (cstate->csv_mode)
+	{
+		special1 = quotec;
+		special2 = escapec;
+	}
+	else
+		special1 = special2 = '\\';
+	can_skip = !cstate->encoding_embeds_ascii;
+
 	/*
 	 * The objective of this loop is to transfer the entire next input line
 	 * into line_buf.  Hence, we only care for detecting newlines (\r and/or
@@ -5875,6 +6165,23 @@ CopyReadLineText(CopyState cstate)
 			need_data = false;
 		}
 
+		if (can_skip && !first_char_in_line)
+		{
+			const char *next;
+
+			next = CopyScanForSpecial(copy_raw_buf + raw_buf_ptr,
+									  copy_raw_buf + copy_buf_len,
+									  '\n', '\r', special1, special2);
+			if (next > copy_raw_buf + raw_buf_ptr)
+			{
+				raw_buf_ptr = next - copy_raw_buf;
+				/* none of the skipped bytes was the escape character */
+				last_was_esc = false;
+				if (raw_buf_ptr >= copy_buf_len)
+					continue;
+			}
+		}
+
 		/* OK to fetch a character */
 		prev_raw_ptr = raw_buf_ptr;
 		c = copy_raw_buf[raw_buf_ptr++];
@@ -6281,6 +6588,17 @@ CopyReadAttributesText(CopyState cstate)
 		for (;;)
 		{
 			char		c;
+			const char *next;
+
+			/* copy the run of ordinary bytes as is */
+			next = CopyScanForSpecial(cur_ptr, line_end_ptr,
+									  delimc, escapec, delimc, escapec);
+			if (next > cur_ptr)
+			{
+				memcpy(output_ptr, cur_ptr, next - cur_ptr);
+				output_ptr += next - cur_ptr;
+				cur_ptr = (char *) next;
+			}
 
 			end_ptr = cur_ptr;
 			if (cur_ptr >= line_end_ptr)
@@ -6511,6 +6829,17 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* Not in quote */
 			for (;;)
 			{
+				const char *next;
+
+				next = CopyScanForSpecial(cur_ptr, line_end_ptr,
+										  delimc, quotec, delimc, quotec);
+				if (next > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, next - cur_ptr);
+					output_ptr += next - cur_ptr;
+					cur_ptr = (char *) next;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					goto endfield;
@@ -6534,6 +6863,17 @@ CopyReadAttributesCSV(CopyState cstate)
 			/* In quote */
 			for (;;)
 			{
+				const char *next;
+
+				next = CopyScanForSpecial(cur_ptr, line_end_ptr,
+										  escapec, quotec, escapec, quotec);
+				if (next > cur_ptr)
+				{
+					memcpy(output_ptr, cur_ptr, next - cur_ptr);
+					output_ptr += next - cur_ptr;
+					cur_ptr = (char *) next;
+				}
+
 				end_ptr = cur_ptr;
 				if (cur_ptr >= line_end_ptr)
 					ereport(ERROR,
@@ -29,7 +29,9 @@
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/elog.h"
+#include "utils/faultinjector.h"
 #include "cdb/memquota.h"
+#include "utils/resgroup.h"
 #include "utils/workfile_mgr.h"
 
 #include "access/hash.h"
@@ -127,6 +129,7 @@ static void *readHashEntry(AggState *aggstate,
 /* Methods for hash table */
 static uint32 calc_hash_value(AggState* aggstate, TupleTableSlot *inputslot);
 static void spill_hash_table(AggState *aggstate);
+static bool borrow_hash_table_memory(HashAggTable *hashtable);
 static void expand_hash_table(AggState *aggstate);
 static void init_agg_hash_iter(HashAggTable* ht);
 static HashAggEntry *lookup_agg_hash_entry(AggState *aggstate, void *input_record,
@@ -867,6 +870,7 @@ create_agg_hash_table(AggState *aggstate)
 			sizeof(GroupKeysAndAggs);
 	hashtable->mem_wanted = hashtable->mem_for_metadata;
 	hashtable->mem_used = hashtable->mem_for_metadata;
+	hashtable->mem_borrowed = 0;
 
 	hashtable->prev_slot = NULL;
 
@@ -879,6 +883,32 @@ create_agg_hash_table(AggState *aggstate)
 	return hashtable;
 }
 
+/*
+ * Called when a streaming hash table has filled up, after reading 'ntuples'
+ * input tuples into it.  If those tuples made barely fewer groups, the hash
+ * table is not worth its cost: the upper stage aggregates the same groups
+ * again anyway.  Switch to passing the rest of the input through.
+ */
+static void
+check_stream_reduction(AggState *aggstate, uint64 ntuples)
+{
+	HashAggTable *hashtable = aggstate->hhashtable;
+	Agg		   *agg = (Agg *) aggstate->ss.ps.plan;
+
+	if (gp_hashagg_stream_min_reduction <= 0 || agg->inputHasGrouping)
+		return;
+
+	if ((double) ntuples < gp_hashagg_stream_min_reduction * hashtable->num_ht_groups)
+	{
+		hashtable->passthrough = true;
+		SIMPLE_FAULT_INJECTOR("hashagg_stream_passthrough");
+		elog(HHA_MSG_LVL,
+			 "HashAgg: " UINT64_FORMAT " tuples made " UINT64_FORMAT
+			 " groups, passing the remaining input through",
+			 ntuples, hashtable->num_ht_groups);
+	}
+}
+
 /* Function: agg_hash_initial_pass
  *
  * Performs ExecAgg initialization for the first pass of the hashed case:
@@ -901,6 +931,7 @@ agg_hash_initial_pass(AggState *aggstate)
 	TupleTableSlot *outerslot = NULL;
 	bool streaming = ((Agg *) aggstate->ss.ps.plan)->streaming;
 	bool tuple_remaining = true;
+	uint64 ntuples = 0;
 
 	Assert(hashtable);
 	AssertImply(!streaming, aggstate->hashaggstatus == HASHAGG_BEFORE_FIRST_PASS);
@@ -961,6 +992,15 @@ agg_hash_initial_pass(AggState *aggstate)
 		hashkey = calc_hash_value(aggstate, outerslot);
 		entry = lookup_agg_hash_entry(aggstate, (void *)outerslot,
 									  INPUT_RECORD_TUPLE, 0, hashkey, &isNew);
+
+		/*
+		 * Before we start spilling, see if the resource group can spare
+		 * some memory for the hash table.
+		 */
+		while (entry == NULL && !streaming && !hashtable->is_spilling &&
+			   borrow_hash_table_memory(hashtable))
+			entry = lookup_agg_hash_entry(aggstate, (void *)outerslot,
+										  INPUT_RECORD_TUPLE, 0, hashkey, &isNew);
 		
 		if (entry == NULL)
 		{
@@ -980,6 +1020,7 @@ agg_hash_initial_pass(AggState *aggstate)
 			{
 				Assert(tuple_remaining);
 				hashtable->prev_slot = outerslot;
+				check_stream_reduction(aggstate, ntuples);
 				/* Stream existing entries instead of spilling */
 				break;
 			}
@@ -1010,6 +1051,7 @@ agg_hash_initial_pass(AggState *aggstate)
 		advance_aggregates(aggstate, hashtable->groupaggs->aggs);
 		
 		hashtable->num_tuples++;
+		ntuples++;
 
 		/* Reset per-input-tuple context after each tuple */
 		ResetExprContext(tmpcontext);
@@ -1017,6 +1059,7 @@ agg_hash_initial_pass(AggState *aggstate)
 		if (streaming && !HAVE_FREESPACE(hashtable))
 		{
 			Assert(tuple_remaining);
+			check_stream_reduction(aggstate, ntuples);
 			ExecClearTuple(aggstate->hashslot);
 			/* Pause and stream entries before reading the next tuple */
 			break;
@@ -1316,6 +1359,29 @@ obtain_spill_set(HashAggTable *hashtable)
 	return *p_spill_set;
 }
 
+/* Function: borrow_hash_table_memory
+ *
+ * Ask the resource group for as much memory again as the hash table has,
+ * to keep it in memory a while longer.  Returns true if we got any.
+ */
+static bool
+borrow_hash_table_memory(HashAggTable *hashtable)
+{
+	int64 borrowed;
+
+	borrowed = ResGroupBorrowSpillMemory((int64) hashtable->max_mem);
+	if (borrowed == 0)
+		return false;
+
+	hashtable->max_mem += borrowed;
+	hashtable->mem_borrowed += borrowed;
+
+	elog(HHA_MSG_LVL, "HashAgg: borrowed " INT64_FORMAT " bytes from the resource group",
+		 borrowed);
+
+	return true;
+}
+
 /* Spill all entries from the hash table to file in order to make room
  * for new hash entries.
  *
@@ -1800,6 +1866,9 @@ readHashEntry(AggState *aggstate, BatchFileInfo *file_info,
  * of a multiphase hashed aggregation to avoid spilling to 
  * file.
  *
+ * If the last load decided to pass the input through, only empty
+ * the hash table; the caller reads the rest of the input itself.
+ *
  * Return true, if all input tuples have been consumed, else
  * return false (call me again).
  */
@@ -1812,7 +1881,10 @@ agg_hash_stream(AggState *aggstate)
 		"HashAgg: streaming");
 
 	reset_agg_hash_table(aggstate, 0 /* don't reallocate buckets */);
-	
+
+	if (aggstate->hhashtable->passthrough)
+		return true;
+
 	return agg_hash_initial_pass(aggstate);
 }
 
@@ -2239,6 +2311,13 @@ agg_hash_explain(AggState *aggstate)
 		appendStringInfo(hbuf, ".\n");
 	}
 
+	if (hashtable->passthrough)
+	{
+		appendStringInfo(hbuf,
+				INT64_FORMAT " input rows passed through without aggregating.\n",
+				hashtable->num_passthrough_tuples);
+	}
+
 	/* Hash chain statistics */
 	if (hashtable->chainlength.vcnt > 0)
 	{
@@ -2385,6 +2464,8 @@ void destroy_agg_hash_table(AggState *aggstate)
 
 		mpool_delete(aggstate->hhashtable->group_buf);
 
+		ResGroupReturnSpillMemory((int64) aggstate->hhashtable->mem_borrowed);
+
 		pfree(aggstate->hhashtable);
 		aggstate->hhashtable = NULL;
 	}
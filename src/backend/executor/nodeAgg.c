@@ -189,6 +189,7 @@ static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
 static void clear_agg_object(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
+static TupleTableSlot *agg_retrieve_passthrough(AggState *aggstate);
 static void ExecAggExplainEnd(PlanState *planstate, struct StringInfoData *buf);
 static void ExecEagerFreeAgg(AggState *node);
 
@@ -1168,7 +1169,8 @@ ExecAgg(AggState *node)
 		 */
 		for (;;)
 		{
-			if (!node->hhashtable->is_spilling)
+			if (!node->hhashtable->is_spilling &&
+				node->hashaggstatus != HASHAGG_PASSTHROUGH)
 			{
 				tuple = agg_retrieve_hash_table(node);
 				node->agg_done = false; /* Not done 'til batches used up. */
@@ -1206,6 +1208,16 @@ ExecAgg(AggState *node)
 					Assert(streaming);
 					if (!agg_hash_stream(node))
 						node->hashaggstatus = HASHAGG_END_OF_PASSES;
+					else if (node->hhashtable->passthrough)
+						node->hashaggstatus = HASHAGG_PASSTHROUGH;
+					continue;
+
+				case HASHAGG_PASSTHROUGH:
+					Assert(streaming);
+					tuple = agg_retrieve_passthrough(node);
+					if (tuple != NULL)
+						return tuple;
+					node->hashaggstatus = HASHAGG_END_OF_PASSES;
 					continue;
 
 				case HASHAGG_BEFORE_FIRST_PASS:
@@ -1829,6 +1841,106 @@ agg_retrieve_hash_table(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for a streaming hashed aggregate that has stopped aggregating:
+ * every remaining input tuple forms a group of its own, and is returned as
+ * soon as it is read.  The aggregates of the next stage still combine the
+ * groups.
+ */
+static TupleTableSlot *
+agg_retrieve_passthrough(AggState *aggstate)
+{
+	HashAggTable *hashtable = aggstate->hhashtable;
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	Datum	   *aggvalues = econtext->ecxt_aggvalues;
+	bool	   *aggnulls = econtext->ecxt_aggnulls;
+	AggStatePerAgg peragg = aggstate->peragg;
+	AggStatePerGroup pergroup;
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	int			aggno;
+
+	Assert(hashtable->passthrough);
+	Assert(!node->inputHasGrouping);
+
+	if (hashtable->passthrough_aggs == NULL)
+	{
+		hashtable->passthrough_aggs = (AggStatePerGroup)
+			MemoryContextAlloc(aggstate->aggcontext,
+							   sizeof(AggStatePerGroupData) * aggstate->numaggs);
+
+		/*
+		 * A row's transition values are only needed until its output tuple
+		 * has been consumed, so keep them in the per-input-tuple memory.
+		 */
+		aggstate->mem_manager.alloc = cxt_alloc;
+		aggstate->mem_manager.free = cxt_free;
+		aggstate->mem_manager.manager = tmpcontext->ecxt_per_tuple_memory;
+		aggstate->mem_manager.realloc_ratio = 1;
+	}
+	pergroup = hashtable->passthrough_aggs;
+
+	for (;;)
+	{
+		TupleTableSlot *outerslot;
+
+		/* A tuple may have been left over when the hash table filled up */
+		if (hashtable->prev_slot != NULL)
+		{
+			outerslot = hashtable->prev_slot;
+			hashtable->prev_slot = NULL;
+		}
+		else
+			outerslot = ExecProcNode(outerPlanState(aggstate));
+
+		if (TupIsNull(outerslot))
+			return NULL;
+
+		ResetExprContext(econtext);
+		ResetExprContext(tmpcontext);
+
+		/* Aggregate the tuple as a group of its own */
+		tmpcontext->ecxt_outertuple = outerslot;
+		MemSet(pergroup, 0, sizeof(AggStatePerGroupData) * aggstate->numaggs);
+		initialize_aggregates(aggstate, peragg, pergroup);
+		advance_aggregates(aggstate, pergroup);
+
+		hashtable->num_tuples++;
+		hashtable->num_passthrough_tuples++;
+
+		for (aggno = 0; aggno < aggstate->numaggs; aggno++)
+		{
+			AggStatePerAgg peraggstate = &peragg[aggno];
+
+			Assert(peraggstate->numSortCols == 0);
+			finalize_aggregate(aggstate, peraggstate, &pergroup[aggno],
+							   &aggvalues[aggno], &aggnulls[aggno]);
+		}
+
+		/* The input tuple itself is the representative tuple of the group */
+		econtext->ecxt_outertuple = outerslot;
+		econtext->group_id = node->rollupGSTimes;
+		econtext->grouping = node->grouping;
+
+		if (ExecQual(aggstate->ss.ps.qual, econtext, false))
+		{
+			TupleTableSlot *result;
+			ExprDoneCond isDone;
+
+			result = ExecProject(aggstate->ss.ps.ps_ProjInfo, &isDone);
+
+			if (isDone != ExprEndResult)
+			{
+				aggstate->ps_TupFromTlist =
+					(isDone == ExprMultipleResult);
+				return result;
+			}
+		}
+		else
+			InstrCountFiltered1(aggstate, 1);
+	}
+}
+
 /* -----------------
  * ExecInitAgg
  *
@@ -23,6 +23,8 @@
 #include "executor/instrument.h"
 #include "nodes/execnodes.h"
 #include "executor/execDynamicScan.h"
+#include "executor/hashjoin.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeDynamicSeqscan.h"
 #include "executor/nodeSeqscan.h"
 #include "utils/hsearch.h"
@@ -33,6 +35,7 @@
 #include "cdb/partitionselection.h"
 
 static void CleanupOnePartition(DynamicSeqScanState *node);
+static void ExecDynamicSeqScanExplainEnd(PlanState *planstate, struct StringInfoData *buf);
 
 DynamicSeqScanState *
 ExecInitDynamicSeqScan(DynamicSeqScan *node, EState *estate, int eflags)
@@ -127,6 +130,16 @@ initNextTableToScan(DynamicSeqScanState *node)
 		change_varattnos_of_a_varno((Node*)scanState->ps.plan->qual, attMap, node->scanrelid);
 		change_varattnos_of_a_varno((Node*)scanState->ps.plan->targetlist, attMap, node->scanrelid);
 
+		/* The runtime filter reads the same columns as the targetlist */
+		if (node->ss_runtimefilter)
+		{
+			HashJoinRuntimeFilter *filter = node->ss_runtimefilter;
+			int			i;
+
+			for (i = 0; i < filter->nkeys; i++)
+				filter->attnos[i] = attMap[filter->attnos[i] - 1];
+		}
+
 		/*
 		 * Now that the varattno mapping has been changed, change the relation that
 		 * the new varnos correspond to
@@ -160,6 +173,7 @@ initNextTableToScan(DynamicSeqScanState *node)
 	DynamicScan_SetTableOid(&node->ss, *pid);
 	node->seqScanState = ExecInitSeqScanForPartition(&plan->seqscan, estate, node->eflags,
 													 currentRelation);
+	node->seqScanState->ss_runtimefilter = node->ss_runtimefilter;
 	return true;
 }
 
@@ -298,3 +312,32 @@ ExecReScanDynamicSeqScan(DynamicSeqScanState *node)
 	/* Force reloading the partition hash table */
 	node->pidIndex = NULL;
 }
+
+/*
+ * ExecDynamicSeqScanSetRuntimeFilter
+ *		Install a runtime filter built by the parent hash join, for the scans
+ *		of all partitions.
+ */
+void
+ExecDynamicSeqScanSetRuntimeFilter(DynamicSeqScanState *node,
+								   struct HashJoinRuntimeFilter *filter)
+{
+	node->ss_runtimefilter = filter;
+
+	/* CDB: Offer extra info for EXPLAIN ANALYZE. */
+	if (node->ss.ps.instrument && node->ss.ps.instrument->need_cdb)
+		node->ss.ps.cdbexplainfun = ExecDynamicSeqScanExplainEnd;
+}
+
+/*
+ * ExecDynamicSeqScanExplainEnd
+ *		Called before ExecutorEnd to finish EXPLAIN ANALYZE reporting.
+ */
+static void
+ExecDynamicSeqScanExplainEnd(PlanState *planstate, struct StringInfoData *buf)
+{
+	DynamicSeqScanState *node = (DynamicSeqScanState *) planstate;
+
+	if (node->ss_runtimefilter)
+		ExecHashRuntimeFilterExplain(node->ss_runtimefilter, buf);
+}
@@ -39,6 +39,7 @@
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
 #include "utils/faultinjector.h"
+#include "utils/resgroup.h"
 #include "utils/syscache.h"
 
 #include "cdb/cdbexplain.h"
@@ -46,6 +47,7 @@
 #include "cdb/cdbvars.h"
 
 static void ExecHashIncreaseNumBatches(HashJoinTable hashtable);
+static bool ExecHashTableBorrowSpace(HashJoinTable hashtable);
 static void ExecHashBuildSkewHash(HashJoinTable hashtable, Hash *node,
 					  int mcvsToUse);
 static void ExecHashSkewTableInsert(HashState *hashState, HashJoinTable hashtable,
@@ -54,6 +56,9 @@ static void ExecHashSkewTableInsert(HashState *hashState, HashJoinTable hashtabl
 						int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashState *hashState, HashJoinTable hashtable);
 
+static inline void ExecHashRuntimeFilterAdd(HashJoinRuntimeFilter *filter,
+						 uint32 hashvalue);
+
 static void ExecHashTableExplainEnd(PlanState *planstate, struct StringInfoData *buf);
 static void
 ExecHashTableExplainBatches(HashJoinTable   hashtable,
@@ -129,6 +134,9 @@ MultiExecHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (node->hs_runtimefilter)
+				ExecHashRuntimeFilterAdd(node->hs_runtimefilter, hashvalue);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -335,6 +343,7 @@ ExecHashTableCreate(HashState *hashState, HashJoinState *hjstate, List *hashOper
 	hashtable->spaceUsedSkew = 0;
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
+	hashtable->spaceBorrowed = 0;
 	hashtable->stats = NULL;
 	hashtable->eagerlyReleased = false;
 	hashtable->hjstate = hjstate;
@@ -687,10 +696,39 @@ ExecHashTableDestroy(HashState *hashState, HashJoinTable hashtable)
 
 	/* Release working memory (batchCxt is a child, so it goes away too) */
 	MemoryContextDelete(hashtable->hashCxt);
+
+	/* And give back what we borrowed on top of our operator memory */
+	ResGroupReturnSpillMemory(hashtable->spaceBorrowed);
+	hashtable->spaceBorrowed = 0;
 	}
 	END_MEMORY_ACCOUNT();
 }
 
+/*
+ * ExecHashTableBorrowSpace
+ *		try to make room for the tuples in memory before we spill
+ *
+ * The resource group may have shared memory to spare.  We ask for as much
+ * again as we are allowed now, which is what doubling the number of batches
+ * would save.
+ *
+ * Returns true if the hash table fits into the space allowed now.
+ */
+static bool
+ExecHashTableBorrowSpace(HashJoinTable hashtable)
+{
+	int64		borrowed;
+
+	borrowed = ResGroupBorrowSpillMemory(hashtable->spaceAllowed);
+	if (borrowed == 0)
+		return false;
+
+	hashtable->spaceAllowed += borrowed;
+	hashtable->spaceBorrowed += borrowed;
+
+	return hashtable->spaceUsed <= hashtable->spaceAllowed;
+}
+
 /*
  * ExecHashIncreaseNumBatches
  *		increase the original number of batches in order to reduce
@@ -925,7 +963,8 @@ ExecHashTableInsert(HashState *hashState, HashJoinTable hashtable,
 		hashtable->spaceUsed += hashTupleSize;
 		if (hashtable->spaceUsed > hashtable->spacePeak)
 			hashtable->spacePeak = hashtable->spaceUsed;
-		if (hashtable->spaceUsed > hashtable->spaceAllowed)
+		if (hashtable->spaceUsed > hashtable->spaceAllowed &&
+			!ExecHashTableBorrowSpace(hashtable))
 		{
 			ExecHashIncreaseNumBatches(hashtable);
 
@@ -1964,7 +2003,8 @@ ExecHashSkewTableInsert(HashState *hashState,
 		ExecHashRemoveNextSkewBucket(hashState, hashtable);
 
 	/* Check we are not over the total spaceAllowed, either */
-	if (hashtable->spaceUsed > hashtable->spaceAllowed)
+	if (hashtable->spaceUsed > hashtable->spaceAllowed &&
+		!ExecHashTableBorrowSpace(hashtable))
 		ExecHashIncreaseNumBatches(hashtable);
 }
 
@@ -2075,3 +2115,188 @@ ExecHashRemoveNextSkewBucket(HashState *hashState, HashJoinTable hashtable)
 		hashtable->spaceUsedSkew = 0;
 	}
 }
+
+/*
+ * Runtime filter sizing.  The filter is sized for the planner's estimate of
+ * the inner row count; if the actual count turns out to leave fewer than
+ * RUNTIME_FILTER_MIN_BITS_PER_TUPLE bits per inner tuple, the false positive
+ * rate is too high for the filter to pay off and it is not used.
+ */
+#define RUNTIME_FILTER_BITS_PER_TUPLE		16
+#define RUNTIME_FILTER_MIN_BITS_PER_TUPLE	8
+#define RUNTIME_FILTER_MIN_BITS				(1 << 13)
+#define RUNTIME_FILTER_MAX_BITS				(1 << 24)
+
+/*
+ * After this many scan tuples, a filter that has rejected less than
+ * 1/RUNTIME_FILTER_MIN_REJECT_RATIO of them is switched off to save the
+ * cost of hashing every tuple twice.
+ */
+#define RUNTIME_FILTER_CHECK_ROWS			65536
+#define RUNTIME_FILTER_MIN_REJECT_RATIO		10
+
+/*
+ * Each hash value sets two bits: one chosen by the hash value itself, the
+ * other by a rehash of it.
+ */
+#define RUNTIME_FILTER_SET_BIT(filter, bit) \
+	((filter)->bits[(bit) / 64] |= ((uint64) 1) << ((bit) % 64))
+#define RUNTIME_FILTER_TEST_BIT(filter, bit) \
+	(((filter)->bits[(bit) / 64] & (((uint64) 1) << ((bit) % 64))) != 0)
+
+static inline void
+ExecHashRuntimeFilterAdd(HashJoinRuntimeFilter *filter, uint32 hashvalue)
+{
+	uint32		mask = filter->nbits - 1;
+
+	RUNTIME_FILTER_SET_BIT(filter, hashvalue & mask);
+	RUNTIME_FILTER_SET_BIT(filter, DatumGetUInt32(hash_uint32(hashvalue)) & mask);
+}
+
+static inline bool
+ExecHashRuntimeFilterMayContain(HashJoinRuntimeFilter *filter, uint32 hashvalue)
+{
+	uint32		mask = filter->nbits - 1;
+
+	return RUNTIME_FILTER_TEST_BIT(filter, hashvalue & mask) &&
+		RUNTIME_FILTER_TEST_BIT(filter, DatumGetUInt32(hash_uint32(hashvalue)) & mask);
+}
+
+/*
+ * ExecHashRuntimeFilterCreate
+ *		Allocate an inactive runtime filter for a join expected to see
+ *		'ntuples' inner tuples, in the current memory context.
+ *
+ * The caller fills in the description of the outer hash keys.
+ */
+HashJoinRuntimeFilter *
+ExecHashRuntimeFilterCreate(int nkeys, double ntuples)
+{
+	HashJoinRuntimeFilter *filter;
+	double		wantbits;
+	uint32		nbits;
+
+	wantbits = Max(ntuples, 1.0) * RUNTIME_FILTER_BITS_PER_TUPLE;
+	nbits = RUNTIME_FILTER_MIN_BITS;
+	while (nbits < wantbits && nbits < RUNTIME_FILTER_MAX_BITS)
+		nbits <<= 1;
+
+	filter = (HashJoinRuntimeFilter *) palloc0(sizeof(HashJoinRuntimeFilter));
+	filter->nkeys = nkeys;
+	filter->attnos = (AttrNumber *) palloc0(nkeys * sizeof(AttrNumber));
+	filter->hashfunctions = (FmgrInfo *) palloc0(nkeys * sizeof(FmgrInfo));
+	filter->hashStrict = (bool *) palloc0(nkeys * sizeof(bool));
+	filter->nbits = nbits;
+	filter->bits = (uint64 *) palloc0(nbits / 8);
+
+	return filter;
+}
+
+/*
+ * ExecHashRuntimeFilterReset
+ *		Deactivate and clear a runtime filter before (re)building the inner
+ *		hash table.
+ */
+void
+ExecHashRuntimeFilterReset(HashJoinRuntimeFilter *filter)
+{
+	filter->active = false;
+	memset(filter->bits, 0, filter->nbits / 8);
+}
+
+/*
+ * ExecHashRuntimeFilterFinish
+ *		Called once every inner tuple has been added; activates the filter
+ *		unless it is too full to be worth consulting.
+ */
+void
+ExecHashRuntimeFilterFinish(HashJoinRuntimeFilter *filter, HashJoinTable hashtable)
+{
+	filter->active = !filter->ineffective &&
+		hashtable->totalTuples * RUNTIME_FILTER_MIN_BITS_PER_TUPLE <= filter->nbits;
+}
+
+/*
+ * ExecHashRuntimeFilterRejects
+ *		Does the runtime filter prove that the scan tuple in 'slot' has no
+ *		join partner?
+ *
+ * The hash value is computed exactly like ExecHashGetHashValue() does for
+ * an outer tuple, using the scan tuple's attributes in place of the outer
+ * hash key expressions.  Any memory leaked by the hash functions is left in
+ * the scan's per-tuple context, which SeqNext() resets after each rejected
+ * tuple.
+ */
+bool
+ExecHashRuntimeFilterRejects(HashJoinRuntimeFilter *filter,
+							 TupleTableSlot *slot,
+							 ExprContext *econtext)
+{
+	uint32		hashkey = 0;
+	bool		rejected = false;
+	MemoryContext oldContext;
+	int			i;
+
+	if (!filter->active)
+		return false;
+
+	oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	for (i = 0; i < filter->nkeys; i++)
+	{
+		Datum		keyval;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		keyval = slot_getattr(slot, filter->attnos[i], &isNull);
+
+		if (isNull)
+		{
+			/* the join would discard this tuple anyway */
+			if (filter->hashStrict[i] && !filter->keepNulls)
+			{
+				rejected = true;
+				break;
+			}
+			/* else, leave hashkey unmodified, equivalent to hashcode 0 */
+		}
+		else
+			hashkey ^= DatumGetUInt32(FunctionCall1(&filter->hashfunctions[i],
+													keyval));
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (!rejected)
+		rejected = !ExecHashRuntimeFilterMayContain(filter, hashkey);
+
+	filter->nprobed += 1;
+	if (rejected)
+		filter->nrejected += 1;
+
+	/* Give up on a filter that lets almost everything through. */
+	if (filter->nprobed == RUNTIME_FILTER_CHECK_ROWS &&
+		filter->nrejected * RUNTIME_FILTER_MIN_REJECT_RATIO < filter->nprobed)
+	{
+		filter->active = false;
+		filter->ineffective = true;
+	}
+
+	return rejected;
+}
+
+/*
+ * ExecHashRuntimeFilterExplain
+ *		Describe what the runtime filter did, for EXPLAIN ANALYZE.
+ */
+void
+ExecHashRuntimeFilterExplain(HashJoinRuntimeFilter *filter, StringInfo buf)
+{
+	appendStringInfo(buf, "Runtime filter rejected %.0f of %.0f rows",
+					 filter->nrejected, filter->nprobed);
+	if (filter->ineffective)
+		appendStringInfoString(buf, ", then was disabled as ineffective");
+	appendStringInfoString(buf, ".\n");
+}
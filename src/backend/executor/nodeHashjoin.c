@@ -23,8 +23,12 @@
 #include "executor/instrument.h"	/* Instrumentation */
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
+#include "executor/nodeDynamicSeqscan.h"
+#include "executor/nodeSeqscan.h"
 #include "miscadmin.h"
+#include "parser/parsetree.h"
 #include "utils/faultinjector.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
 #include "cdb/cdbvars.h"
@@ -60,6 +64,8 @@ static void ReleaseHashTable(HashJoinState *node);
 static void SpillCurrentBatch(HashJoinState *node);
 static bool ExecHashJoinReloadHashTable(HashJoinState *hjstate);
 static void ExecEagerFreeHashJoin(HashJoinState *node);
+static PlanState *ExecHashJoinOuterScan(PlanState *outerState);
+static void ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate, HashJoin *node);
 
 /* ----------------------------------------------------------------
  *		ExecHashJoin
@@ -119,6 +125,13 @@ ExecHashJoin_guts(HashJoinState *node)
 				 */
 				Assert(hashtable == NULL);
 
+				/*
+				 * Any runtime filter left over from a previous build describes
+				 * the wrong inner rows; stop the outer scan from using it.
+				 */
+				if (node->hj_RuntimeFilter)
+					ExecHashRuntimeFilterReset(node->hj_RuntimeFilter);
+
 				/*
 				 * MPP-4165: My fix for MPP-3300 was correct in that we avoided
 				 * the *deadlock* but had very unexpected (and painful)
@@ -216,6 +229,10 @@ ExecHashJoin_guts(HashJoinState *node)
 				hashNode->hashtable = hashtable;
 				(void) MultiExecProcNode((PlanState *) hashNode);
 
+				/* Every inner row is in the runtime filter; let the scan use it. */
+				if (node->hj_RuntimeFilter)
+					ExecHashRuntimeFilterFinish(node->hj_RuntimeFilter, hashtable);
+
 #ifdef HJDEBUG
 				elog(gp_workfile_caching_loglevel, "HashJoin built table with %.1f tuples by executing subplan for batch 0", hashtable->totalTuples);
 #endif
@@ -727,9 +744,140 @@ ExecInitHashJoin(HashJoin *node, EState *estate, int eflags)
 	hjstate->hj_MatchedOuter = false;
 	hjstate->hj_OuterNotEmpty = false;
 
+	if (gp_enable_runtime_filter && !(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		ExecHashJoinInitRuntimeFilter(hjstate, node);
+
 	return hjstate;
 }
 
+/*
+ * ExecHashJoinOuterScan
+ *		Return the sequential or dynamic sequential scan that produces the
+ *		outer input, or NULL if there is none.
+ *
+ * ORCA puts a dynamic scan under a Sequence, after its PartitionSelector.
+ * A Sequence returns the tuples of its last subplan as they are, so the
+ * scan below it produces the outer input just the same.
+ */
+static PlanState *
+ExecHashJoinOuterScan(PlanState *outerState)
+{
+	if (IsA(outerState, SequenceState))
+	{
+		SequenceState *seqState = (SequenceState *) outerState;
+
+		outerState = seqState->subplans[seqState->numSubplans - 1];
+	}
+
+	if (IsA(outerState, SeqScanState) || IsA(outerState, DynamicSeqScanState))
+		return outerState;
+
+	return NULL;
+}
+
+/*
+ * ExecHashJoinOuterKeyAttno
+ *		If an outer hash key is just a column of the sequential scan that
+ *		produces the outer input, return that column's attribute number in
+ *		the scan tuple; else InvalidAttrNumber.
+ */
+static AttrNumber
+ExecHashJoinOuterKeyAttno(Expr *outerkey, Plan *outerNode)
+{
+	TargetEntry *tle;
+
+	while (IsA(outerkey, RelabelType))
+		outerkey = ((RelabelType *) outerkey)->arg;
+	if (!IsA(outerkey, Var) || ((Var *) outerkey)->varno != OUTER_VAR)
+		return InvalidAttrNumber;
+
+	tle = get_tle_by_resno(outerNode->targetlist, ((Var *) outerkey)->varattno);
+	if (tle == NULL)
+		return InvalidAttrNumber;
+
+	outerkey = tle->expr;
+	while (IsA(outerkey, RelabelType))
+		outerkey = ((RelabelType *) outerkey)->arg;
+	if (!IsA(outerkey, Var) ||
+		((Var *) outerkey)->varno != ((Scan *) outerNode)->scanrelid ||
+		((Var *) outerkey)->varattno <= 0)
+		return InvalidAttrNumber;
+
+	return ((Var *) outerkey)->varattno;
+}
+
+/*
+ * ExecHashJoinInitRuntimeFilter
+ *		Push a runtime filter down to the outer scan, if the join allows it.
+ *
+ * Only inner, right and semi joins qualify; the others must emit outer
+ * tuples that have no match.  The outer input must be a sequential or a
+ * dynamic sequential scan, which then runs in our slice, and every outer
+ * hash key must be a plain column of it.  See HashJoinRuntimeFilter in
+ * hashjoin.h.
+ */
+static void
+ExecHashJoinInitRuntimeFilter(HashJoinState *hjstate, HashJoin *node)
+{
+	PlanState  *outerScan;
+	Plan	   *outerNode;
+	HashJoinRuntimeFilter *filter;
+	ListCell   *l;
+	int			i;
+
+	switch (hjstate->js.jointype)
+	{
+		case JOIN_INNER:
+		case JOIN_RIGHT:
+		case JOIN_SEMI:
+			break;
+		default:
+			return;
+	}
+
+	outerScan = ExecHashJoinOuterScan(outerPlanState(hjstate));
+	if (outerScan == NULL || node->hashclauses == NIL)
+		return;
+	outerNode = outerScan->plan;
+
+	foreach(l, node->hashclauses)
+	{
+		OpExpr	   *hclause = (OpExpr *) lfirst(l);
+
+		if (ExecHashJoinOuterKeyAttno((Expr *) linitial(hclause->args),
+									  outerNode) == InvalidAttrNumber)
+			return;
+	}
+
+	filter = ExecHashRuntimeFilterCreate(list_length(node->hashclauses),
+										 innerPlan(node)->plan_rows);
+	filter->keepNulls = hjstate->hj_nonequijoin;
+
+	i = 0;
+	foreach(l, node->hashclauses)
+	{
+		OpExpr	   *hclause = (OpExpr *) lfirst(l);
+		Oid			left_hashfn;
+		Oid			right_hashfn;
+
+		if (!get_op_hash_functions(hclause->opno, &left_hashfn, &right_hashfn))
+			elog(ERROR, "could not find hash function for hash operator %u",
+				 hclause->opno);
+		fmgr_info(left_hashfn, &filter->hashfunctions[i]);
+		filter->hashStrict[i] = op_strict(hclause->opno);
+		filter->attnos[i] = ExecHashJoinOuterKeyAttno((Expr *) linitial(hclause->args),
+													  outerNode);
+		i++;
+	}
+
+	hjstate->hj_RuntimeFilter = filter;
+	((HashState *) innerPlanState(hjstate))->hs_runtimefilter = filter;
+	if (IsA(outerScan, SeqScanState))
+		ExecSeqScanSetRuntimeFilter((SeqScanState *) outerScan, filter);
+	else
+		ExecDynamicSeqScanSetRuntimeFilter((DynamicSeqScanState *) outerScan, filter);
+}
+
 /* ----------------------------------------------------------------
  *		ExecEndHashJoin
  *
@@ -167,10 +167,9 @@ ExecMaterial(MaterialState *node)
 			{
 				if (ma->driver_slice == currentSliceId)
 				{
-					ntuplestore_flush(ts);
-
+					/* this flushes ts, to shared memory or to disk */
 					node->share_lk_ctxt = shareinput_writer_notifyready(ma->share_id, ma->nsharer_xslice,
-							estate->es_plannedstmt->planGen);
+							estate->es_plannedstmt->planGen, ts);
 				}
 			}
 			return NULL;
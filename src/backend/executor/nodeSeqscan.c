@@ -26,7 +26,9 @@
 
 #include "access/relscan.h"
 #include "executor/execdebug.h"
+#include "executor/nodeHash.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
 #include "utils/rel.h"
 
 #include "cdb/cdbappendonlyam.h"
@@ -37,6 +39,7 @@ static void InitScanRelation(SeqScanState *node, EState *estate, int eflags, Rel
 static TupleTableSlot *SeqNext(SeqScanState *node);
 
 static void InitAOCSScanOpaque(SeqScanState *scanState, Relation currentRelation);
+static void ExecSeqScanExplainEnd(PlanState *planstate, struct StringInfoData *buf);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -64,39 +67,56 @@ SeqNext(SeqScanState *node)
 	direction = estate->es_direction;
 	slot = node->ss.ss_ScanTupleSlot;
 
-	/*
-	 * get the next tuple from the table
-	 */
-	if (node->ss_currentScanDesc_ao)
+	for (;;)
 	{
-		appendonly_getnext(node->ss_currentScanDesc_ao, direction, slot);
-	}
-	else if (node->ss_currentScanDesc_aocs)
-	{
-		aocs_getnext(node->ss_currentScanDesc_aocs, direction, slot);
-	}
-	else
-	{
-		HeapScanDesc scandesc = node->ss_currentScanDesc_heap;
+		/*
+		 * get the next tuple from the table
+		 */
+		if (node->ss_currentScanDesc_ao)
+		{
+			appendonly_getnext(node->ss_currentScanDesc_ao, direction, slot);
+		}
+		else if (node->ss_currentScanDesc_aocs)
+		{
+			aocs_getnext(node->ss_currentScanDesc_aocs, direction, slot);
+		}
+		else
+		{
+			HeapScanDesc scandesc = node->ss_currentScanDesc_heap;
 
-		tuple = heap_getnext(scandesc, direction);
+			tuple = heap_getnext(scandesc, direction);
+
+			/*
+			 * save the tuple and the buffer returned to us by the access methods in
+			 * our scan tuple slot and return the slot.  Note: we pass 'false' because
+			 * tuples returned by heap_getnext() are pointers onto disk pages and were
+			 * not created with palloc() and so should not be pfree()'d.  Note also
+			 * that ExecStoreTuple will increment the refcount of the buffer; the
+			 * refcount will not be dropped until the tuple table slot is cleared.
+			 */
+			if (tuple)
+				ExecStoreHeapTuple(tuple,	/* tuple to store */
+							   slot,	/* slot to store in */
+							   scandesc->rs_cbuf,		/* buffer associated with this
+														 * tuple */
+							   false);	/* don't pfree this pointer */
+			else
+				ExecClearTuple(slot);
+		}
 
 		/*
-		 * save the tuple and the buffer returned to us by the access methods in
-		 * our scan tuple slot and return the slot.  Note: we pass 'false' because
-		 * tuples returned by heap_getnext() are pointers onto disk pages and were
-		 * not created with palloc() and so should not be pfree()'d.  Note also
-		 * that ExecStoreTuple will increment the refcount of the buffer; the
-		 * refcount will not be dropped until the tuple table slot is cleared.
+		 * Drop tuples that the parent hash join's runtime filter proves have
+		 * no join partner, before the scan quals are evaluated.
 		 */
-		if (tuple)
-			ExecStoreHeapTuple(tuple,	/* tuple to store */
-						   slot,	/* slot to store in */
-						   scandesc->rs_cbuf,		/* buffer associated with this
-													 * tuple */
-						   false);	/* don't pfree this pointer */
-		else
-			ExecClearTuple(slot);
+		if (TupIsNull(slot) || node->ss_runtimefilter == NULL ||
+			!ExecHashRuntimeFilterRejects(node->ss_runtimefilter, slot,
+										  node->ss.ps.ps_ExprContext))
+			break;
+
+		/* don't let the hash functions' garbage pile up over rejected rows */
+		ResetExprContext(node->ss.ps.ps_ExprContext);
+
+		CHECK_FOR_INTERRUPTS();
 	}
 
 	return slot;
@@ -161,6 +181,23 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags, Relation curren
 			node->ss.ps.state->es_snapshot,
 			appendOnlyMetaDataSnapshot,
 			0, NULL);
+
+		/*
+		 * Let the scan skip blocks whose zone map rules out the quals.
+		 */
+		if (gp_appendonly_zonemap_scan)
+		{
+			ScanKey		zonemapKeys;
+			int			nzonemapKeys;
+
+			zonemapKeys = AppendOnlyZoneMap_BuildScanKeys(currentRelation,
+														  node->ss.ps.plan->qual,
+														  ((Scan *) node->ss.ps.plan)->scanrelid,
+														  &nzonemapKeys);
+			if (nzonemapKeys > 0)
+				appendonly_set_zonemap_keys(node->ss_currentScanDesc_ao,
+											nzonemapKeys, zonemapKeys);
+		}
 	}
 	else if (RelationIsAoCols(currentRelation))
 	{
@@ -184,6 +221,44 @@ InitScanRelation(SeqScanState *node, EState *estate, int eflags, Relation curren
 						   appendOnlyMetaDataSnapshot,
 						   NULL /* relationTupleDesc */,
 						   node->ss_aocs_proj);
+
+		/*
+		 * Let the scan evaluate the simple comparisons of the quals over
+		 * batches of column values, and drop them from the per-tuple quals.
+		 */
+		if (gp_aocs_batch_quals && node->ss.ps.plan->qual != NIL)
+		{
+			List	   *planqual = node->ss.ps.plan->qual;
+			AOCSBatchQual *batchQuals;
+			int			nbatchQuals;
+			bool	   *used;
+
+			used = palloc(list_length(planqual) * sizeof(bool));
+			batchQuals = aocs_batch_build_quals(currentRelation,
+												planqual,
+												((Scan *) node->ss.ps.plan)->scanrelid,
+												&nbatchQuals,
+												used);
+			if (nbatchQuals > 0)
+			{
+				List	   *qual = NIL;
+				ListCell   *lc;
+				int			i = 0;
+
+				aocs_set_batch_quals(node->ss_currentScanDesc_aocs,
+									 nbatchQuals, batchQuals);
+
+				/* ps.qual was built from plan->qual, clause by clause */
+				Assert(list_length(node->ss.ps.qual) == list_length(planqual));
+				foreach(lc, node->ss.ps.qual)
+				{
+					if (!used[i++])
+						qual = lappend(qual, lfirst(lc));
+				}
+				node->ss.ps.qual = qual;
+			}
+			pfree(used);
+		}
 	}
 	else
 	{
@@ -365,6 +440,35 @@ ExecReScanSeqScan(SeqScanState *node)
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecSeqScanSetRuntimeFilter
+ *
+ *		Install a runtime filter built by the parent hash join.
+ * ----------------------------------------------------------------
+ */
+void
+ExecSeqScanSetRuntimeFilter(SeqScanState *node, struct HashJoinRuntimeFilter *filter)
+{
+	node->ss_runtimefilter = filter;
+
+	/* CDB: Offer extra info for EXPLAIN ANALYZE. */
+	if (node->ss.ps.instrument && node->ss.ps.instrument->need_cdb)
+		node->ss.ps.cdbexplainfun = ExecSeqScanExplainEnd;
+}
+
+/*
+ * ExecSeqScanExplainEnd
+ *		Called before ExecutorEnd to finish EXPLAIN ANALYZE reporting.
+ */
+static void
+ExecSeqScanExplainEnd(PlanState *planstate, struct StringInfoData *buf)
+{
+	SeqScanState *node = (SeqScanState *) planstate;
+
+	if (node->ss_runtimefilter)
+		ExecHashRuntimeFilterExplain(node->ss_runtimefilter, buf);
+}
+
 static void
 InitAOCSScanOpaque(SeqScanState *scanstate, Relation currentRelation)
 {
@@ -31,20 +31,29 @@
 #include "executor/executor.h"
 #include "executor/nodeShareInputScan.h"
 #include "miscadmin.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/lwlock.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
 #include "utils/faultinjector.h"
 #include "utils/gp_alloc.h"
+#include "utils/hsearch.h"
 #include "utils/tuplesort.h"
 #include "utils/tuplestorenew.h"
 
+struct ShareInputSyncEntry;
+
+/* What a writer or a reader of a cross-slice share knows about it */
 typedef struct ShareInput_Lk_Context
 {
-	int readyfd;
-	int donefd;
-	int  zcnt;
-	bool del_ready;
-	bool del_done;
-	char lkname_ready[MAXPGPATH];
-	char lkname_done[MAXPGPATH];
+	int			share_id;
+	bool		isWriter;
+	struct ShareInputSyncEntry *entry;	/* our reference to the shared entry */
+	bool		shm_reserved;	/* writer: holds one of nshmsegs */
+	bool		has_shm;		/* reader: result is in a DSM segment ... */
+	dsm_handle	shm_handle;		/* ... with this handle */
 } ShareInput_Lk_Context;
 
 static void writer_wait_for_acks(ShareInput_Lk_Context *pctxt, int share_id, int xslice);
@@ -85,11 +94,16 @@ init_tuplestore_state(ShareInputScanState *node)
 	if(share_type == SHARE_MATERIAL_XSLICE)
 	{
 		char rwfile_prefix[100];
+		ShareInput_Lk_Context *lk_ctxt = (ShareInput_Lk_Context *) node->share_lk_ctxt;
+
 		shareinput_create_bufname_prefix(rwfile_prefix, sizeof(rwfile_prefix), sisc->share_id);
 	
 		node->ts_state = palloc0(sizeof(GenericTupStore));
 
-		node->ts_state->matstore = ntuplestore_create_readerwriter(rwfile_prefix, 0, false);
+		if (lk_ctxt && lk_ctxt->has_shm)
+			node->ts_state->matstore = ntuplestore_create_reader_shm(lk_ctxt->shm_handle, 0);
+		else
+			node->ts_state->matstore = ntuplestore_create_readerwriter(rwfile_prefix, 0, false);
 		node->ts_pos = (void *) ntuplestore_create_accessor(node->ts_state->matstore, false);
 		ntuplestore_acc_seek_bof((NTupleStoreAccessor *)node->ts_pos);
 	}
@@ -360,59 +374,125 @@ ExecReScanShareInputScan(ShareInputScanState *node)
 }
 
 /*************************************************************************
- * XXX 
- * we need some IPC mechanism for shareinput_read_wait/writer_notify.  Semaphore is
- * the first thing come to mind but it turns out postgres is very picky about
- * how to use semaphore and we do not want to mess up with it.
+ * Synchronization between the writer of a cross-slice share and its readers.
+ *
+ * The writer and the readers are QEs of the same session on the same
+ * segment, so they meet in a small shared memory hash table, keyed by the
+ * session, the command and the share id.  Whichever of them comes first
+ * creates the entry, and the last one to leave removes it.
+ *
+ * When the writer has materialized its result, it sets the entry's ready
+ * flag, and sets the latches of the processes of its session to wake up the
+ * readers waiting for that.  A reader that sees the ready flag bumps nacked,
+ * and when it is done, ndone, and sets the writer's latch in both cases.
+ * All waits also time out once a second, to check for interrupts.
  *
- * Here we used FIFO (named pipe).  mkfifo is Posix.1 and should be available on any
- * reasonable Unix like system.
+ * A small result of a cross-slice Material is not written to workfiles at
+ * all, but copied into a dynamic shared memory segment (see
+ * ntuplestore_flush_shm()), whose handle the writer leaves in the entry for
+ * the readers.  The writer keeps the segment attached until all readers are
+ * done, and gp_shareinput_shm_kb limits how large it can be.  To stay well
+ * clear of dsm.c's limit on the number of segments, at most MaxBackends of
+ * them are in use at any time; past that, results go to workfiles.
  *
- * When we open fifo, we open it with O_RDWR.  So the fifo has both reader and writer.
- * That also means, for write, it will not block, but reader will until writer writes
- * something.
+ * Some ack may come after a done.  That doesn't matter, as they are just
+ * counters.
  *
- * At first, I used postgres File to manage the FIFO.  It turns out this is not
- * correct because when postgres run out of file descriptors, it will try to close
- * some file descriptors using an LRU algorithm.  Later when the File is used again,
- * postgres will reopen it. The FIFO here is used for synchronization so it is simply 
- * wrong.  Here we use the file descriptor directly, and use a XCallBack to cleanup
- * the resource at the end of transaction (commit or abort).
- * 
- * XXX However, it is always better to have this kind of stuff abstracted out
- * by the system.  
+ * For optimizer-generated plans, we skip the ack synchronization. The writer
+ * does not wait for readers to acknowledge the "ready" handshake anymore, as
+ * that can cause deadlocks (OPT-2690).
+ *
+ * The entry is released through an XCallBack at the end of transaction
+ * (commit or abort), in case we don't get to the end of the handshake.
  **************************************************************************/
 
-#include "fcntl.h"
-#include "unistd.h"
-#include "sys/types.h"
-#include "sys/stat.h"
-#include "storage/fd.h"
-#include "cdb/cdbselect.h"
+#define SHAREINPUT_WAIT_TIMEOUT_MS	1000
 
-void shareinput_create_bufname_prefix(char* p, int size, int share_id)
+typedef struct ShareInputSyncTag
 {
-	snprintf(p, size, "SIRW_%d_%d_%d",
-            gp_session_id, gp_command_count, share_id);
+	int			session_id;
+	int			command_count;
+	int			share_id;
+} ShareInputSyncTag;
+
+typedef struct ShareInputSyncEntry
+{
+	ShareInputSyncTag tag;		/* hash key, must be first */
+	int			refcount;		/* processes using the entry */
+	bool		ready;			/* writer has materialized its result */
+	int			nacked;			/* readers that saw ready (planner plans) */
+	int			ndone;			/* readers that are done */
+	Latch	   *writer_latch;	/* writer's latch, once it has come */
+	bool		has_shm;		/* result is in a DSM segment ... */
+	dsm_handle	shm_handle;		/* ... with this handle */
+} ShareInputSyncEntry;
+
+typedef struct ShareInputSyncControl
+{
+	LWLock	   *lock;			/* protects the hash table and its entries */
+	int			nshmsegs;		/* DSM segments in use by writers */
+} ShareInputSyncControl;
+
+static ShareInputSyncControl *ShareInputSync = NULL;
+static HTAB *ShareInputSyncHash = NULL;
+
+/*
+ * ShareInputShmemSize -- estimate the shared memory needed for the
+ * synchronization of cross-slice shares.
+ */
+Size
+ShareInputShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(ShareInputSyncControl));
+	size = add_size(size, hash_estimate_size((Size) MaxBackends,
+											 sizeof(ShareInputSyncEntry)));
+
+	return size;
 }
 
-/* Here we use the absolute path name as the lock name.  See fd.c 
- * for how the name is created (GP_TEMP_FILE_DIR and make_database_relative).
+/*
+ * ShareInputShmemInit -- create the hash table of cross-slice shares in
+ * shared memory.
  */
-static void
-sisc_lockname(char *p, int size, int share_id, const char* name)
+void
+ShareInputShmemInit(void)
 {
-	char		filename[MAXPGPATH];
-	char	   *path;
+	HASHCTL		info;
+	bool		found;
 
-	snprintf(filename, sizeof(filename),
-			 "gpcdb2.sisc_%d_%d_%d_%d_%s",
-			 GpIdentity.segindex, gp_session_id, gp_command_count, share_id, name);
+	ShareInputSync = (ShareInputSyncControl *)
+		ShmemInitStruct("ShareInputScan Sync Control",
+						sizeof(ShareInputSyncControl),
+						&found);
 
-	path = GetTempFilePath(filename, true);
-	if (strlen(path) >= size)
-		elog(ERROR, "path to temporary file too long: %s", path);
-	strcpy(p, path);
+	if (!found)
+	{
+		ShareInputSync->lock = LWLockAssign();
+		ShareInputSync->nshmsegs = 0;
+	}
+
+	MemSet(&info, 0, sizeof(info));
+	info.keysize = sizeof(ShareInputSyncTag);
+	info.entrysize = sizeof(ShareInputSyncEntry);
+	info.hash = tag_hash;
+
+	ShareInputSyncHash = ShmemInitHash("ShareInputScan Sync Hash",
+									   MaxBackends,
+									   MaxBackends,
+									   &info,
+									   HASH_ELEM | HASH_FUNCTION);
+	if (!ShareInputSyncHash)
+		ereport(FATAL,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("not enough shared memory for ShareInputScan synchronization")));
+}
+
+void shareinput_create_bufname_prefix(char* p, int size, int share_id)
+{
+	snprintf(p, size, "SIRW_%d_%d_%d",
+            gp_session_id, gp_command_count, share_id);
 }
 
 static void shareinput_clean_lk_ctxt(ShareInput_Lk_Context *lk_ctxt)
@@ -422,220 +502,195 @@ static void shareinput_clean_lk_ctxt(ShareInput_Lk_Context *lk_ctxt)
 	if (!lk_ctxt)
 		return;
 
-	if (lk_ctxt->readyfd >= 0)
+	if (lk_ctxt->entry || lk_ctxt->shm_reserved)
 	{
-		if (gp_retry_close(lk_ctxt->readyfd))
-			ereport(WARNING,
-				(errcode(ERRCODE_IO_ERROR),
-				errmsg("shareinput_clean_lk_ctxt cannot close readyfd: %m")));
-	}
+		LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
 
-	if (lk_ctxt->donefd >= 0)
-	{
-		if (gp_retry_close(lk_ctxt->donefd))
-			ereport(WARNING,
-				(errcode(ERRCODE_IO_ERROR),
-				errmsg("shareinput_clean_lk_ctxt cannot close donefd: %m")));
-	}
+		if (lk_ctxt->entry)
+		{
+			ShareInputSyncEntry *entry = lk_ctxt->entry;
 
-	if (lk_ctxt->del_ready && lk_ctxt->lkname_ready[0])
-	{
-		if (unlink(lk_ctxt->lkname_ready))
-			ereport(WARNING,
-				(errcode(ERRCODE_IO_ERROR),
-				errmsg("shareinput_clean_lk_ctxt cannot unlink \"%s\": %m",
-					lk_ctxt->lkname_ready)));
-	}
+			if (lk_ctxt->isWriter && entry->writer_latch == &MyProc->procLatch)
+				entry->writer_latch = NULL;
 
-	if (lk_ctxt->del_done && lk_ctxt->lkname_done[0])
-	{
-		if (unlink(lk_ctxt->lkname_done))
-			ereport(WARNING,
-				(errcode(ERRCODE_IO_ERROR),
-				errmsg("shareinput_clean_lk_ctxt cannot unlink \"%s\": %m",
-					lk_ctxt->lkname_done)));
+			Assert(entry->refcount > 0);
+			if (--entry->refcount == 0)
+				hash_search(ShareInputSyncHash, &entry->tag, HASH_REMOVE, NULL);
+		}
+
+		if (lk_ctxt->shm_reserved)
+		{
+			Assert(ShareInputSync->nshmsegs > 0);
+			ShareInputSync->nshmsegs--;
+		}
+
+		LWLockRelease(ShareInputSync->lock);
 	}
 
 	gp_free(lk_ctxt);
 }
 
-static void XCallBack_ShareInput_FIFO(XactEvent ev, void* vp)
+static void XCallBack_ShareInput_Sync(XactEvent ev, void* vp)
 {
 	ShareInput_Lk_Context *lk_ctxt = (ShareInput_Lk_Context *) vp; 
 	shareinput_clean_lk_ctxt(lk_ctxt);
 }
 
-static void
-create_tmp_fifo(const char *fifoname)
+/*
+ * Create our context for a share, and take a reference to its shared entry,
+ * creating it if we are the first.
+ */
+static ShareInput_Lk_Context *
+shareinput_init_lk_ctxt(int share_id, bool isWriter)
 {
-#ifdef WIN32
-	elog(ERROR, "mkfifo not supported on win32");
-#else
-	int err = mkfifo(fifoname, 0600);
-	if (err < 0 && errno != EEXIST)
-		elog(ERROR, "could not create temporary fifo \"%s\": %m", fifoname);
-#endif
+	ShareInputSyncTag tag;
+	ShareInputSyncEntry *entry;
+	bool		found;
+	ShareInput_Lk_Context *pctxt = gp_malloc(sizeof(ShareInput_Lk_Context));
+
+	if(!pctxt)
+		ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
+			errmsg("Share input %s failed: out of memory",
+				   isWriter ? "writer" : "reader")));
+
+	pctxt->share_id = share_id;
+	pctxt->isWriter = isWriter;
+	pctxt->entry = NULL;
+	pctxt->shm_reserved = false;
+	pctxt->has_shm = false;
+	pctxt->shm_handle = 0;
+
+	RegisterXactCallbackOnce(XCallBack_ShareInput_Sync, pctxt);
+
+	MemSet(&tag, 0, sizeof(tag));
+	tag.session_id = gp_session_id;
+	tag.command_count = gp_command_count;
+	tag.share_id = share_id;
+
+	LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
+
+	entry = (ShareInputSyncEntry *)
+		hash_search(ShareInputSyncHash, &tag, HASH_ENTER_NULL, &found);
+	if (!entry)
+	{
+		LWLockRelease(ShareInputSync->lock);
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of shared memory"),
+				 errdetail("Too many cross-slice shared scans are in progress.")));
+	}
+
+	if (!found)
+	{
+		entry->refcount = 0;
+		entry->ready = false;
+		entry->nacked = 0;
+		entry->ndone = 0;
+		entry->writer_latch = NULL;
+		entry->has_shm = false;
+		entry->shm_handle = 0;
+	}
+	entry->refcount++;
+	pctxt->entry = entry;
+
+	LWLockRelease(ShareInputSync->lock);
+
+	return pctxt;
 }
 
-/* 
- * As all other read/write in postgres, we may be interrupted so retry is needed.
+/*
+ * Sleep on our latch until someone sets it, or the timeout expires.  Returns
+ * false on timeout.
  */
-static int retry_read(int fd, char *buf, int rsize)
+static bool
+shareinput_wait(void)
 {
-	int sz;
-	Assert(rsize > 0);
-
-read_retry:
-	sz = read(fd, buf, rsize);
-	if (sz > 0)
-		return sz;
-	else if(sz == 0 || errno == EINTR)
-		goto read_retry;
-	else
-		elog(ERROR, "could not read from fifo: %m");
+	int			rc;
 
-	Assert(!"Never be here");
-	return 0;
-}
+	rc = WaitLatch(&MyProc->procLatch,
+				   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+				   SHAREINPUT_WAIT_TIMEOUT_MS);
 
-static int retry_write(int fd, char *buf, int wsize)
-{
-	int sz;
-	Assert(wsize > 0);
-
-write_retry:
-	sz = write(fd, buf, wsize);
-	if(sz > 0)
-		return sz;
-	else if(sz == 0 || errno == EINTR)
-		goto write_retry;
-	else
-		elog(ERROR, "could not write to fifo: %m");
+	/* emergency bailout if postmaster has died */
+	if (rc & WL_POSTMASTER_DEATH)
+		proc_exit(1);
 
-	Assert(!"Never be here");
-	return 0;
+	return (rc & WL_TIMEOUT) == 0;
 }
 
-/* 
- * Readiness (a) synchronization.
- *
- * For readiness, the shared node will write xslice of 'a' into the pipe.
- * For each share, there is just one ready writer.  Once sharer starts write
- * it need to write all xslice copies of 'a', even if we are interrupted, that
- * is, we should not call CHECK_FOR_INTERRUPTS.
- *
- * For sharer, it need to check for ready to read (using select), because read 
- * is blocking.  Otherwise if shared is cancelled before write, then we will be
- * blocked here forever.  Once shared has write at least one 'a', it will write
- * all xslice of 'a', so once select succeed, read will eventually succeed.  Once
- * sharer got 'a', it write 'b' back to shared.
- *
- * Done (b and z) synchronization.
- * For done, the shared is the only reader.  sharer will not block for writing, 
- * but shared may block for read, therefore, we much call select before shared 
- * calling read.  Because there is only one shared, nobody can steal char from
- * the pipe, therefore, if select succeed, read will not block forever.
- *
- * One thing to note is that some 'z' may comeback before all 'b' come back.
- * So, need to handle this in notifyready.
- *
- * For optimizer-generated plans, we skip the 'b' synchronization. The writer
- * does not wait for readers to acknowledge the "ready" handshake anymore, as
- * that can cause deadlocks (OPT-2690).
+/*
+ * Wake up the readers of a share.  We don't know which processes they are,
+ * so we wake up all other processes of our session on this segment.  Anyone
+ * that wasn't waiting for us will just check its own condition again.
  */
+static void
+shareinput_wakeup_readers(void)
+{
+	uint32		i;
+
+	for (i = 0; i < ProcGlobal->allProcCount; i++)
+	{
+		PGPROC	   *proc = &ProcGlobal->allProcs[i];
+
+		if (proc != MyProc && proc->pid != 0 &&
+			proc->mppSessionId == gp_session_id)
+			SetLatch(&proc->procLatch);
+	}
+}
 
 /*
  * shareinput_reader_waitready
  *
  *  Called by the reader (consumer) to wait for the writer (producer) to produce
- *  all the tuples and write them to disk.
+ *  all the tuples and write them to disk, or to shared memory.
  *
  *  This is a blocking operation.
  */
 void *
 shareinput_reader_waitready(int share_id, PlanGenerator planGen)
 {
-	mpp_fd_set rset;
-	struct timeval tval;
-	int n;
-	char a;
-	ShareInput_Lk_Context *pctxt = gp_malloc(sizeof(ShareInput_Lk_Context));
-
-	if(!pctxt)
-		ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
-			errmsg("Share input reader failed: out of memory")));
-
-	pctxt->readyfd = -1;
-	pctxt->donefd = -1;
-	pctxt->zcnt = 0;
-	pctxt->del_ready = false;
-	pctxt->del_done = false;
-	pctxt->lkname_ready[0] = '\0';
-	pctxt->lkname_done[0] = '\0';
-
-	RegisterXactCallbackOnce(XCallBack_ShareInput_FIFO, pctxt);
-
-	sisc_lockname(pctxt->lkname_ready, MAXPGPATH, share_id, "ready");
-	create_tmp_fifo(pctxt->lkname_ready);
-	pctxt->readyfd = open(pctxt->lkname_ready, O_RDWR, 0600); 
-	if(pctxt->readyfd < 0)
-		elog(ERROR, "could not open fifo \"%s\": %m", pctxt->lkname_ready);
-	
-	sisc_lockname(pctxt->lkname_done, MAXPGPATH, share_id, "done");
-	create_tmp_fifo(pctxt->lkname_done);
-	pctxt->donefd = open(pctxt->lkname_done, O_RDWR, 0600);
-	if(pctxt->donefd < 0)
-		elog(ERROR, "could not open fifo \"%s\": %m", pctxt->lkname_done);
+	ShareInput_Lk_Context *pctxt = shareinput_init_lk_ctxt(share_id, false);
+	ShareInputSyncEntry *entry = pctxt->entry;
 
 	while(1)
 	{
-		CHECK_FOR_INTERRUPTS();
+		bool		ready;
+		Latch	   *writer_latch = NULL;
 
-		MPP_FD_ZERO(&rset);
-		MPP_FD_SET(pctxt->readyfd, &rset);
+		ResetLatch(&MyProc->procLatch);
 
-		tval.tv_sec = 1;
-		tval.tv_usec = 0;
-
-		n = select(pctxt->readyfd+1, (fd_set *) &rset, NULL, NULL, &tval);
+		CHECK_FOR_INTERRUPTS();
 
-		if(n==1)
+		LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
+		ready = entry->ready;
+		if (ready)
 		{
-#if USE_ASSERT_CHECKING
-			int rwsize =
-#endif
-			retry_read(pctxt->readyfd, &a, 1);
-			Assert(rwsize == 1 && a == 'a');
-
-			elog(DEBUG1, "SISC READER (shareid=%d, slice=%d): Wait ready got writer's handshake",
-					share_id, currentSliceId);
+			pctxt->has_shm = entry->has_shm;
+			pctxt->shm_handle = entry->shm_handle;
 
+			/* For planner-generated plans, we send ack back after receiving the handshake */
 			if (planGen == PLANGEN_PLANNER)
 			{
-				/* For planner-generated plans, we send ack back after receiving the handshake */
-				elog(DEBUG1, "SISC READER (shareid=%d, slice=%d): Wait ready writing ack back to writer",
-						share_id, currentSliceId);
-
-#if USE_ASSERT_CHECKING
-				rwsize =
-#endif
-				retry_write(pctxt->donefd, "b", 1);
-				Assert(rwsize == 1);
+				entry->nacked++;
+				writer_latch = entry->writer_latch;
 			}
+		}
+		LWLockRelease(ShareInputSync->lock);
+
+		if(ready)
+		{
+			elog(DEBUG1, "SISC READER (shareid=%d, slice=%d): Wait ready got writer's handshake%s",
+					share_id, currentSliceId,
+					pctxt->has_shm ? ", result is in shared memory" : "");
 
+			if (writer_latch)
+				SetLatch(writer_latch);
 			break;
 		}
-		else if(n==0)
-		{
+
+		if (!shareinput_wait())
 			elog(DEBUG1, "SISC READER (shareid=%d, slice=%d): Wait ready time out once",
 					share_id, currentSliceId);
-		}
-		else
-		{
-			int save_errno = errno;
-			elog(LOG, "SISC READER (shareid=%d, slice=%d): Wait ready try again, errno %d ... ",
-					share_id, currentSliceId, save_errno);
-		}
 	}
 	return (void *) pctxt;
 }
@@ -643,9 +698,11 @@ shareinput_reader_waitready(int share_id, PlanGenerator planGen)
 /*
  * shareinput_writer_notifyready
  *
- *  Called by the writer (producer) once it is done producing all tuples and
- *  writing them to disk. It notifies all the readers (consumers) that tuples
- *  are ready to be read from disk.
+ *  Called by the writer (producer) once it is done producing all tuples.
+ *  If matstore is given, it's the tuplestore of a cross-slice Material, which
+ *  we flush first, into shared memory if it is small enough, or else to
+ *  disk.  Then we notify all the readers (consumers) that tuples are ready to
+ *  be read.
  *
  *  For planner-generated plans we wait for acks from all the readers before
  *  proceedings. It is a blocking operation.
@@ -654,50 +711,54 @@ shareinput_reader_waitready(int share_id, PlanGenerator planGen)
  *  It is a non-blocking operation.
  */
 void *
-shareinput_writer_notifyready(int share_id, int xslice, PlanGenerator planGen)
+shareinput_writer_notifyready(int share_id, int xslice, PlanGenerator planGen,
+							  struct NTupleStore *matstore)
 {
-	int n;
+	ShareInput_Lk_Context *pctxt = shareinput_init_lk_ctxt(share_id, true);
+	ShareInputSyncEntry *entry = pctxt->entry;
+	bool		has_shm = false;
+	dsm_handle	shm_handle = 0;
 
-	ShareInput_Lk_Context *pctxt = gp_malloc(sizeof(ShareInput_Lk_Context));
+	if (matstore != NULL)
+	{
+		if (gp_shareinput_shm_kb > 0 &&
+			dynamic_shared_memory_type != DSM_IMPL_NONE)
+		{
+			LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
+			if (ShareInputSync->nshmsegs < MaxBackends)
+			{
+				ShareInputSync->nshmsegs++;
+				pctxt->shm_reserved = true;
+			}
+			LWLockRelease(ShareInputSync->lock);
+		}
 
-	if(!pctxt)
-		ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
-			errmsg("Shareinput Writer failed: out of memory")));
-
-	pctxt->readyfd = -1;
-	pctxt->donefd = -1;
-	pctxt->zcnt = 0;
-	pctxt->del_ready = false;
-	pctxt->del_done = false;
-	pctxt->lkname_ready[0] = '\0';
-	pctxt->lkname_done[0] = '\0';
-
-	RegisterXactCallbackOnce(XCallBack_ShareInput_FIFO, pctxt);
-
-	sisc_lockname(pctxt->lkname_ready, MAXPGPATH, share_id, "ready");
-	create_tmp_fifo(pctxt->lkname_ready);
-	pctxt->del_ready = true;
-	pctxt->readyfd = open(pctxt->lkname_ready, O_RDWR, 0600); 
-	if(pctxt->readyfd < 0)
-		elog(ERROR, "could not open fifo \"%s\": %m", pctxt->lkname_ready);
-
-	sisc_lockname(pctxt->lkname_done, MAXPGPATH, share_id, "done");
-	create_tmp_fifo(pctxt->lkname_done);
-	pctxt->del_done = true;
-	pctxt->donefd = open(pctxt->lkname_done, O_RDWR, 0600);
-	if(pctxt->donefd < 0)
-		elog(ERROR, "could not open fifo \"%s\": %m", pctxt->lkname_done);
-
-	for(n=0; n<xslice; ++n)
+		if (pctxt->shm_reserved)
+			has_shm = ntuplestore_flush_shm(matstore,
+											(int64) gp_shareinput_shm_kb * 1024L,
+											&shm_handle);
+		else
+			ntuplestore_flush(matstore);
+	}
+
+	LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
+	if (pctxt->shm_reserved && !has_shm)
 	{
-#if USE_ASSERT_CHECKING
-		int rwsize =
-#endif
-		retry_write(pctxt->readyfd, "a", 1);
-		Assert(rwsize == 1);
+		/* didn't fit, it's on disk after all */
+		ShareInputSync->nshmsegs--;
+		pctxt->shm_reserved = false;
 	}
-	elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): wrote notify_ready to %d xslice readers",
-						share_id, currentSliceId, xslice);
+	entry->has_shm = has_shm;
+	entry->shm_handle = shm_handle;
+	entry->writer_latch = &MyProc->procLatch;
+	entry->ready = true;
+	LWLockRelease(ShareInputSync->lock);
+
+	shareinput_wakeup_readers();
+
+	elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): notified ready to %d xslice readers%s",
+						share_id, currentSliceId, xslice,
+						has_shm ? ", result is in shared memory" : "");
 	
 	if (planGen == PLANGEN_PLANNER)
 	{
@@ -719,53 +780,26 @@ shareinput_writer_notifyready(int share_id, int xslice, PlanGenerator planGen)
 static void
 writer_wait_for_acks(ShareInput_Lk_Context *pctxt, int share_id, int xslice)
 {
-	int ack_needed = xslice;
-	mpp_fd_set rset;
-	struct timeval tval;
-	char b;
+	ShareInputSyncEntry *entry = pctxt->entry;
 
-	while(ack_needed > 0)
+	while(1)
 	{
-		CHECK_FOR_INTERRUPTS();
+		int			nacked;
 
-		MPP_FD_ZERO(&rset);
-		MPP_FD_SET(pctxt->donefd, &rset);
+		ResetLatch(&MyProc->procLatch);
 
-		tval.tv_sec = 1;
-		tval.tv_usec = 0;
-		int numReady = select(pctxt->donefd+1, (fd_set *) &rset, NULL, NULL, &tval);
+		CHECK_FOR_INTERRUPTS();
 
-		if(numReady==1)
-		{
-#if USE_ASSERT_CHECKING
-			int rwsize =
-#endif
-			retry_read(pctxt->donefd, &b, 1);
-			Assert(rwsize == 1);
+		LWLockAcquire(ShareInputSync->lock, LW_SHARED);
+		nacked = entry->nacked;
+		LWLockRelease(ShareInputSync->lock);
 
-			if(b == 'z')
-			{
-				++pctxt->zcnt;
-			}
-			else
-			{
-				Assert(b == 'b');
-				--ack_needed;
-				elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): notify ready succeed 1, xslice remaining %d",
-						share_id, currentSliceId, ack_needed);
-			}
-		}
-		else if(numReady==0)
-		{
-			elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): Notify ready time out once ... ",
-					share_id, currentSliceId);
-		}
-		else
-		{
-			int save_errno = errno;
-			elog(LOG, "SISC WRITER (shareid=%d, slice=%d): notify still wait for an answer, errno %d",
-					share_id, currentSliceId, save_errno);
-		}
+		if (nacked >= xslice)
+			break;
+
+		if (!shareinput_wait())
+			elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): Notify ready time out once, xslice remaining %d",
+					share_id, currentSliceId, xslice - nacked);
 	}
 }
 
@@ -773,7 +807,7 @@ writer_wait_for_acks(ShareInput_Lk_Context *pctxt, int share_id, int xslice)
  * shareinput_reader_notifydone
  *
  *  Called by the reader (consumer) to notify the writer (producer) that
- *  it is done reading tuples from disk.
+ *  it is done reading tuples.
  *
  *  This is a non-blocking operation.
  */
@@ -781,14 +815,18 @@ void
 shareinput_reader_notifydone(void *ctxt, int share_id)
 {
 	ShareInput_Lk_Context *pctxt = (ShareInput_Lk_Context *) ctxt;
-#if USE_ASSERT_CHECKING
-	int rwsize  =
-#endif
-	retry_write(pctxt->donefd, "z", 1);
-	Assert(rwsize == 1);
+	Latch	   *writer_latch;
+
+	LWLockAcquire(ShareInputSync->lock, LW_EXCLUSIVE);
+	pctxt->entry->ndone++;
+	writer_latch = pctxt->entry->writer_latch;
+	LWLockRelease(ShareInputSync->lock);
+
+	if (writer_latch)
+		SetLatch(writer_latch);
 
 	shareinput_clean_lk_ctxt(pctxt);
-	UnregisterXactCallbackOnce(XCallBack_ShareInput_FIFO, (void *) ctxt);
+	UnregisterXactCallbackOnce(XCallBack_ShareInput_Sync, (void *) ctxt);
 }
 
 /*
@@ -803,56 +841,36 @@ void
 shareinput_writer_waitdone(void *ctxt, int share_id, int nsharer_xslice)
 {
 	ShareInput_Lk_Context *pctxt = (ShareInput_Lk_Context *) ctxt;
-	mpp_fd_set rset;
-	struct timeval tval;
-	int numReady;
-	char z;
-	int ack_needed = nsharer_xslice - pctxt->zcnt;
+	ShareInputSyncEntry *entry = pctxt->entry;
 
 	elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): waiting for DONE message from %d readers",
-							share_id, currentSliceId, ack_needed);
+							share_id, currentSliceId, nsharer_xslice);
 
-	while(ack_needed > 0)
+	while(1)
 	{
+		int			ndone;
+
+		ResetLatch(&MyProc->procLatch);
+
 		CHECK_FOR_INTERRUPTS();
-	
-		MPP_FD_ZERO(&rset);
-		MPP_FD_SET(pctxt->donefd, &rset);
 
-		tval.tv_sec = 1;
-		tval.tv_usec = 0;
-		numReady = select(pctxt->donefd+1, (fd_set *) &rset, NULL, NULL, &tval);
-	
-		if(numReady==1)
-		{
-#if USE_ASSERT_CHECKING
-			int rwsize =
-#endif
-			retry_read(pctxt->donefd, &z, 1);
-			Assert(rwsize == 1 && z == 'z');
+		LWLockAcquire(ShareInputSync->lock, LW_SHARED);
+		ndone = entry->ndone;
+		LWLockRelease(ShareInputSync->lock);
 
-			elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): wait done get 1 notification",
-					share_id, currentSliceId);
-			--ack_needed;
-		}
-		else if(numReady==0)
-		{
-			elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): wait done timeout once",
-					share_id, currentSliceId);
-		}
-		else 
-		{
-			int save_errno = errno;
-			elog(LOG, "SISC WRITER (shareid=%d, slice=%d): wait done time out once, errno %d",
-					share_id, currentSliceId, save_errno);
-		}
+		if (ndone >= nsharer_xslice)
+			break;
+
+		if (!shareinput_wait())
+			elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): wait done timeout once, %d readers remaining",
+					share_id, currentSliceId, nsharer_xslice - ndone);
 	}
 
 	elog(DEBUG1, "SISC WRITER (shareid=%d, slice=%d): Writer received all %d reader done notifications",
-			share_id, currentSliceId, nsharer_xslice - pctxt->zcnt);
+			share_id, currentSliceId, nsharer_xslice);
 
 	shareinput_clean_lk_ctxt(ctxt);
-	UnregisterXactCallbackOnce(XCallBack_ShareInput_FIFO, (void *) ctxt);
+	UnregisterXactCallbackOnce(XCallBack_ShareInput_Sync, (void *) ctxt);
 }
 
 /*
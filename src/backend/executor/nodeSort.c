@@ -223,7 +223,7 @@ ExecSort(SortState *node)
 					tuplesort_flush(tuplesortstate);
 
 					node->share_lk_ctxt = shareinput_writer_notifyready(plannode->share_id, plannode->nsharer_xslice,
-							estate->es_plannedstmt->planGen);
+							estate->es_plannedstmt->planGen, NULL);
 				}
 			}
 
@@ -3059,16 +3059,25 @@ gpdb::CountLeafPartTables
 }
 
 /*
- * To detect changes to catalog tables that require resetting the Metadata
- * Cache, we use the normal PostgreSQL catalog cache invalidation mechanism.
- * We register a callback to a cache on all the catalog tables that contain
- * information that's contained in the ORCA metadata cache.
-
- * There is no fine-grained mechanism in the metadata cache for invalidating
- * individual entries ATM, so we just blow the whole cache whenever anything
- * changes. The callback simply increments a counter. Whenever we start
- * planning a query, we check the counter to see if it has changed since the
- * last planned query, and reset the whole cache if it has.
+ * To detect changes to catalog tables that require invalidating entries in
+ * the Metadata Cache, we use the normal PostgreSQL catalog cache
+ * invalidation mechanism. We register a callback to a cache on all the
+ * catalog tables that contain information that's contained in the ORCA
+ * metadata cache.
+ *
+ * Invalidation messages only carry a relation OID, or the hash value of a
+ * syscache key, so we remember which catalog entries each object in the
+ * metadata cache was built from, as it is fetched by the relcache
+ * translator (see the MDCacheTrack* functions below). When an invalidation
+ * names one of those entries, the object is queued for eviction, and
+ * COptTasks evicts the queued objects before planning the next query.
+ * Invalidations of anything we haven't fetched, such as a temp table
+ * created by another session, leave the metadata cache alone.
+ *
+ * We still blow the whole cache when an invalidation can't be traced back
+ * to individual objects: a reset of a whole catalog cache, a change to the
+ * catalogs marked as such below, a hash value shared by two tracked
+ * objects, or more queued evictions than MDCACHE_MAX_PENDING_EVICTIONS.
  *
  * To make sure we've covered all catalog tables that contain information
  * that's stored in the metadata cache, there are "catalog tables: xxx"
@@ -3077,38 +3086,160 @@ gpdb::CountLeafPartTables
  * anything fetched via the wrapper functions in this file can end up in the
  * metadata cache and hence need to have an invalidation callback registered.
  */
-static bool mdcache_invalidation_counter_registered = false;
-static int64 mdcache_invalidation_counter = 0;
-static int64 last_mdcache_invalidation_counter = 0;
+#define MDCACHE_MAX_PENDING_EVICTIONS 256
+
+/* A relation or index in the metadata cache, keyed by its OID */
+typedef struct MDCacheTrackedRel
+{
+	Oid			relid;			/* hash key; must be first */
+	int			ncolstats;		/* column statistics positions fetched */
+	bool		evict_all;		/* any change resets the whole cache */
+} MDCacheTrackedRel;
+
+/* A syscache entry that a metadata cache object was built from */
+typedef struct MDCacheSyscacheKey
+{
+	int			cacheid;
+	uint32		hashvalue;
+} MDCacheSyscacheKey;
+
+typedef struct MDCacheTrackedEntry
+{
+	MDCacheSyscacheKey key;		/* hash key; must be first */
+	gpdb::MDCacheObjectRef ref;	/* the object to evict when it changes */
+	bool		ambiguous;		/* more than one object has this key */
+} MDCacheTrackedEntry;
+
+static bool mdcache_invalidation_callbacks_registered = false;
+static bool mdcache_reset_pending = false;
+static HTAB *mdcache_tracked_rels = NULL;
+static HTAB *mdcache_tracked_entries = NULL;
+static gpdb::MDCacheObjectRef mdcache_pending_evictions[MDCACHE_MAX_PENDING_EVICTIONS];
+static int	mdcache_num_pending_evictions = 0;
+
+static void
+mdcache_create_tracking_tables(void)
+{
+	HASHCTL		ctl;
+
+	if (mdcache_tracked_rels)
+		hash_destroy(mdcache_tracked_rels);
+	if (mdcache_tracked_entries)
+		hash_destroy(mdcache_tracked_entries);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Oid);
+	ctl.entrysize = sizeof(MDCacheTrackedRel);
+	ctl.hash = oid_hash;
+	mdcache_tracked_rels = hash_create("ORCA metadata cache relations", 256, &ctl,
+									   HASH_ELEM | HASH_FUNCTION);
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(MDCacheSyscacheKey);
+	ctl.entrysize = sizeof(MDCacheTrackedEntry);
+	ctl.hash = tag_hash;
+	mdcache_tracked_entries = hash_create("ORCA metadata cache catalog entries", 256, &ctl,
+										  HASH_ELEM | HASH_FUNCTION);
+}
+
+static void
+mdcache_request_reset(void)
+{
+	mdcache_reset_pending = true;
+	mdcache_num_pending_evictions = 0;
+}
+
+static void
+mdcache_queue_eviction(const gpdb::MDCacheObjectRef *ref)
+{
+	if (mdcache_reset_pending)
+		return;
+
+	if (mdcache_num_pending_evictions >= MDCACHE_MAX_PENDING_EVICTIONS)
+	{
+		mdcache_request_reset();
+		return;
+	}
+
+	mdcache_pending_evictions[mdcache_num_pending_evictions++] = *ref;
+}
 
 static void
-mdsyscache_invalidation_counter_callback(Datum arg, int cacheid, uint32 hashvalue)
+mdsyscache_invalidation_callback(Datum arg, int cacheid, uint32 hashvalue)
 {
-	mdcache_invalidation_counter++;
+	MDCacheSyscacheKey key;
+	MDCacheTrackedEntry *entry;
+
+	/* arg is true for catalogs whose changes always reset the whole cache */
+	if (DatumGetBool(arg) || hashvalue == 0)
+	{
+		mdcache_request_reset();
+		return;
+	}
+
+	MemSet(&key, 0, sizeof(key));
+	key.cacheid = cacheid;
+	key.hashvalue = hashvalue;
+	entry = (MDCacheTrackedEntry *) hash_search(mdcache_tracked_entries, &key,
+												HASH_FIND, NULL);
+	if (entry == NULL)
+		return;
+
+	if (entry->ambiguous)
+		mdcache_request_reset();
+	else
+		mdcache_queue_eviction(&entry->ref);
 }
 
 static void
-mdrelcache_invalidation_counter_callback(Datum arg, Oid relid)
+mdrelcache_invalidation_callback(Datum arg, Oid relid)
 {
-	mdcache_invalidation_counter++;
+	MDCacheTrackedRel *rel;
+	gpdb::MDCacheObjectRef ref;
+
+	if (!OidIsValid(relid))
+	{
+		mdcache_request_reset();
+		return;
+	}
+
+	rel = (MDCacheTrackedRel *) hash_search(mdcache_tracked_rels, &relid,
+											HASH_FIND, NULL);
+	if (rel == NULL)
+		return;
+
+	if (rel->evict_all)
+	{
+		mdcache_request_reset();
+		return;
+	}
+
+	MemSet(&ref, 0, sizeof(ref));
+	ref.kind = gpdb::MDCacheObjectRelation;
+	ref.oid = relid;
+	mdcache_queue_eviction(&ref);
 }
 
 static void
 register_mdcache_invalidation_callbacks(void)
 {
 	/* These are all the catalog tables that we care about. */
-	int			metadata_caches[] = {
-		AGGFNOID,			/* pg_aggregate */
-		AMOPOPID,			/* pg_amop */
-		CASTSOURCETARGET,	/* pg_cast */
-		CONSTROID,			/* pg_constraint */
-		OPEROID,			/* pg_operator */
-		OPFAMILYOID,		/* pg_opfamily */
-		PARTOID,			/* pg_partition */
-		PARTRULEOID,		/* pg_partition_rule */
-		STATRELATTINH,			/* pg_statistics */
-		TYPEOID,			/* pg_type */
-		PROCOID,			/* pg_proc */
+	struct
+	{
+		int			cacheid;
+		bool		reset_all;		/* not tracked per object */
+	}			metadata_caches[] = {
+		{AGGFNOID, false},			/* pg_aggregate */
+		{AMOPOPID, true},			/* pg_amop */
+		{CASTSOURCETARGET, false},	/* pg_cast */
+		{CONSTROID, false},			/* pg_constraint */
+		{OPEROID, false},			/* pg_operator */
+		{OPFAMILYOID, true},		/* pg_opfamily */
+		{PARTOID, true},			/* pg_partition */
+		{PARTRULEOID, true},		/* pg_partition_rule */
+		{STATRELATTINH, false},		/* pg_statistics */
+		{TYPEOID, false},			/* pg_type */
+		{PROCOID, false},			/* pg_proc */
 
 		/*
 		 * lookup_type_cache() will also access pg_opclass, via GetDefaultOpClass(),
@@ -3149,19 +3280,62 @@ register_mdcache_invalidation_callbacks(void)
 	};
 	unsigned int i;
 
+	mdcache_create_tracking_tables();
+
 	for (i = 0; i < lengthof(metadata_caches); i++)
 	{
-		CacheRegisterSyscacheCallback(metadata_caches[i],
-									  &mdsyscache_invalidation_counter_callback,
-									  (Datum) 0);
+		CacheRegisterSyscacheCallback(metadata_caches[i].cacheid,
+									  &mdsyscache_invalidation_callback,
+									  BoolGetDatum(metadata_caches[i].reset_all));
 	}
 
 	/* also register the relcache callback */
-	CacheRegisterRelcacheCallback(&mdrelcache_invalidation_counter_callback,
+	CacheRegisterRelcacheCallback(&mdrelcache_invalidation_callback,
 								  (Datum) 0);
 }
 
-// Has there been any catalog changes since last call?
+static void
+mdcache_track_syscache_entry(int cacheid, uint32 hashvalue,
+							 const gpdb::MDCacheObjectRef *ref)
+{
+	MDCacheSyscacheKey key;
+	MDCacheTrackedEntry *entry;
+	bool		found;
+
+	MemSet(&key, 0, sizeof(key));
+	key.cacheid = cacheid;
+	key.hashvalue = hashvalue;
+	entry = (MDCacheTrackedEntry *) hash_search(mdcache_tracked_entries, &key,
+												HASH_ENTER, &found);
+	if (!found)
+	{
+		entry->ref = *ref;
+		entry->ambiguous = false;
+	}
+	else if (entry->ref.kind != ref->kind ||
+			 entry->ref.oid != ref->oid ||
+			 entry->ref.oid2 != ref->oid2)
+		entry->ambiguous = true;
+}
+
+static MDCacheTrackedRel *
+mdcache_track_rel(Oid relid)
+{
+	MDCacheTrackedRel *rel;
+	bool		found;
+
+	rel = (MDCacheTrackedRel *) hash_search(mdcache_tracked_rels, &relid,
+											HASH_ENTER, &found);
+	if (!found)
+	{
+		rel->ncolstats = 0;
+		rel->evict_all = false;
+	}
+	return rel;
+}
+
+// Has there been any catalog changes since last call that require
+// resetting the whole metadata cache?
 bool
 gpdb::MDCacheNeedsReset
 		(
@@ -3170,16 +3344,19 @@ gpdb::MDCacheNeedsReset
 {
 	GP_WRAP_START;
 	{
-		if (!mdcache_invalidation_counter_registered)
+		if (!mdcache_invalidation_callbacks_registered)
 		{
 			register_mdcache_invalidation_callbacks();
-			mdcache_invalidation_counter_registered = true;
+			mdcache_invalidation_callbacks_registered = true;
 		}
-		if (last_mdcache_invalidation_counter == mdcache_invalidation_counter)
+		if (!mdcache_reset_pending)
 			return false;
 		else
 		{
-			last_mdcache_invalidation_counter = mdcache_invalidation_counter;
+			/* the cache starts over, and so does what we know about it */
+			mdcache_create_tracking_tables();
+			mdcache_reset_pending = false;
+			mdcache_num_pending_evictions = 0;
 			return true;
 		}
 	}
@@ -3188,6 +3365,181 @@ gpdb::MDCacheNeedsReset
 	return true;
 }
 
+// Remember that a relation or index is in the metadata cache. If evict_all
+// is set, any change to it resets the whole cache; that is used for objects
+// keyed by their own OID that are only invalidated through their relation,
+// such as triggers.
+void
+gpdb::MDCacheTrackRelation
+		(
+			Oid relid,
+			bool evict_all
+		)
+{
+	GP_WRAP_START;
+	{
+		MDCacheTrackedRel *rel;
+
+		if (!mdcache_invalidation_callbacks_registered)
+			return;
+
+		rel = mdcache_track_rel(relid);
+		rel->evict_all |= evict_all;
+		return;
+	}
+	GP_WRAP_END;
+}
+
+// Remember that statistics on the column at position pos, attribute attno,
+// of a relation are in the metadata cache
+void
+gpdb::MDCacheTrackColStats
+		(
+			Oid relid,
+			AttrNumber attno,
+			int pos
+		)
+{
+	GP_WRAP_START;
+	{
+		MDCacheTrackedRel *rel;
+		MDCacheObjectRef ref;
+
+		if (!mdcache_invalidation_callbacks_registered)
+			return;
+
+		rel = mdcache_track_rel(relid);
+		rel->ncolstats = Max(rel->ncolstats, pos + 1);
+
+		/* catalog tables: pg_statistic */
+		if (attno > 0)
+		{
+			MemSet(&ref, 0, sizeof(ref));
+			ref.kind = MDCacheObjectRelation;
+			ref.oid = relid;
+			mdcache_track_syscache_entry(STATRELATTINH,
+										 GetSysCacheHashValue3(STATRELATTINH,
+															   ObjectIdGetDatum(relid),
+															   Int16GetDatum(attno),
+															   BoolGetDatum(false)),
+										 &ref);
+		}
+		return;
+	}
+	GP_WRAP_END;
+}
+
+// Remember that an object looked up by OID in the given syscache (a type,
+// operator, function, aggregate or check constraint) is in the metadata cache
+void
+gpdb::MDCacheTrackObject
+		(
+			int cacheid,
+			Oid oid
+		)
+{
+	GP_WRAP_START;
+	{
+		MDCacheObjectRef ref;
+
+		if (!mdcache_invalidation_callbacks_registered)
+			return;
+
+		MemSet(&ref, 0, sizeof(ref));
+		ref.kind = MDCacheObjectGPDB;
+		ref.oid = oid;
+		mdcache_track_syscache_entry(cacheid,
+									 GetSysCacheHashValue1(cacheid, ObjectIdGetDatum(oid)),
+									 &ref);
+		return;
+	}
+	GP_WRAP_END;
+}
+
+// Remember that the cast between two types is in the metadata cache
+void
+gpdb::MDCacheTrackCast
+		(
+			Oid src_type,
+			Oid dest_type
+		)
+{
+	GP_WRAP_START;
+	{
+		MDCacheObjectRef ref;
+
+		if (!mdcache_invalidation_callbacks_registered)
+			return;
+
+		/* catalog tables: pg_cast */
+		MemSet(&ref, 0, sizeof(ref));
+		ref.kind = MDCacheObjectCast;
+		ref.oid = src_type;
+		ref.oid2 = dest_type;
+		mdcache_track_syscache_entry(CASTSOURCETARGET,
+									 GetSysCacheHashValue2(CASTSOURCETARGET,
+														   ObjectIdGetDatum(src_type),
+														   ObjectIdGetDatum(dest_type)),
+									 &ref);
+		return;
+	}
+	GP_WRAP_END;
+}
+
+// Fetch the next metadata cache object that has been invalidated since the
+// last call. Returns false when there are none left.
+bool
+gpdb::MDCacheNextInvalidObject
+		(
+			MDCacheObjectRef *ref
+		)
+{
+	GP_WRAP_START;
+	{
+		MDCacheTrackedRel *rel;
+		Oid			parent_oid;
+
+		if (mdcache_num_pending_evictions == 0)
+			return false;
+
+		*ref = mdcache_pending_evictions[--mdcache_num_pending_evictions];
+		if (ref->kind != MDCacheObjectRelation)
+			return true;
+
+		rel = (MDCacheTrackedRel *) hash_search(mdcache_tracked_rels, &ref->oid,
+												HASH_FIND, NULL);
+		ref->ncolstats = rel ? rel->ncolstats : 0;
+		if (rel)
+			hash_search(mdcache_tracked_rels, &ref->oid, HASH_REMOVE, NULL);
+
+		/*
+		 * The row count and statistics of a partitioned table are derived
+		 * from its leaf partitions, so a change to a partition invalidates
+		 * the tables above it too. rel_partition_get_root() returns the
+		 * immediate parent of a partition, not the root, so walk it up one
+		 * level at a time until it returns InvalidOid.
+		 */
+		for (parent_oid = rel_partition_get_root(ref->oid);
+			 OidIsValid(parent_oid);
+			 parent_oid = rel_partition_get_root(parent_oid))
+		{
+			MDCacheObjectRef parent_ref;
+
+			if (hash_search(mdcache_tracked_rels, &parent_oid, HASH_FIND, NULL) == NULL)
+				continue;
+
+			MemSet(&parent_ref, 0, sizeof(parent_ref));
+			parent_ref.kind = MDCacheObjectRelation;
+			parent_ref.oid = parent_oid;
+			mdcache_queue_eviction(&parent_ref);
+		}
+		return true;
+	}
+	GP_WRAP_END;
+
+	return false;
+}
+
 // Functions for ORCA's memory consumption to be tracked by GPDB
 void *
 gpdb::OptimizerAlloc
@@ -116,6 +116,7 @@ CTranslatorRelcacheToDXL::RetrieveObject
 			break;
 		
 		case IMDId::EmdidRelStats:
+			gpdb::MDCacheTrackRelation(CMDIdGPDB::CastMdid(CMDIdRelStats::CastMdid(mdid)->GetRelMdId())->Oid(), false /* evict_all */);
 			md_obj = RetrieveRelStats(mp, mdid);
 			break;
 		
@@ -124,6 +125,11 @@ CTranslatorRelcacheToDXL::RetrieveObject
 			break;
 		
 		case IMDId::EmdidCastFunc:
+			gpdb::MDCacheTrackCast
+					(
+					CMDIdGPDB::CastMdid(CMDIdCast::CastMdid(mdid)->MdidSrc())->Oid(),
+					CMDIdGPDB::CastMdid(CMDIdCast::CastMdid(mdid)->MdidDest())->Oid()
+					);
 			md_obj = RetrieveCast(mp, mdid);
 			break;
 		
@@ -166,45 +172,59 @@ CTranslatorRelcacheToDXL::RetrieveObjectGPDB
 
 	GPOS_ASSERT(0 != oid);
 
-	// find out what type of object this oid stands for
+	// find out what type of object this oid stands for, and remember which
+	// catalog entry it comes from so that it can be evicted from the
+	// metadata cache when that entry changes; the entry is tracked before
+	// it is read, so that an invalidation arriving while the object is
+	// being built is not lost
 
 	if (gpdb::IndexExists(oid))
 	{
+		gpdb::MDCacheTrackRelation(oid, false /* evict_all */);
 		return RetrieveIndex(mp, md_accessor, mdid);
 	}
 
 	if (gpdb::TypeExists(oid))
 	{
+		gpdb::MDCacheTrackObject(TYPEOID, oid);
 		return RetrieveType(mp, mdid);
 	}
 
 	if (gpdb::RelationExists(oid))
 	{
+		gpdb::MDCacheTrackRelation(oid, false /* evict_all */);
 		return RetrieveRel(mp, md_accessor, mdid);
 	}
 
 	if (gpdb::OperatorExists(oid))
 	{
+		gpdb::MDCacheTrackObject(OPEROID, oid);
 		return RetrieveScOp(mp, mdid);
 	}
 
 	if (gpdb::AggregateExists(oid))
 	{
+		gpdb::MDCacheTrackObject(AGGFNOID, oid);
+		gpdb::MDCacheTrackObject(PROCOID, oid);
 		return RetrieveAgg(mp, mdid);
 	}
 
 	if (gpdb::FunctionExists(oid))
 	{
+		gpdb::MDCacheTrackObject(PROCOID, oid);
 		return RetrieveFunc(mp, mdid);
 	}
 
 	if (gpdb::TriggerExists(oid))
 	{
+		// pg_trigger changes only show up as invalidations of the relation
+		gpdb::MDCacheTrackRelation(gpdb::GetTriggerRelid(oid), true /* evict_all */);
 		return RetrieveTrigger(mp, mdid);
 	}
 
 	if (gpdb::CheckConstraintExists(oid))
 	{
+		gpdb::MDCacheTrackObject(CONSTROID, oid);
 		return RetrieveCheckConstraints(mp, md_accessor, mdid);
 	}
 
@@ -2339,6 +2359,8 @@ CTranslatorRelcacheToDXL::RetrieveColStats
 	const IMDColumn *md_col = md_rel->GetMdCol(pos);
 	AttrNumber attno = (AttrNumber) md_col->AttrNum();
 
+	gpdb::MDCacheTrackColStats(rel_oid, attno, (int) pos);
+
 	// number of rows from pg_class
 	double num_rows;
 	bool stats_empty;
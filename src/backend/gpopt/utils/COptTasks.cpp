@@ -41,6 +41,7 @@
 #include "gpos/io/COstreamFile.h"
 #include "gpos/io/COstreamString.h"
 #include "gpos/memory/CAutoMemoryPool.h"
+#include "gpos/memory/CCacheAccessor.h"
 #include "gpos/task/CAutoTraceFlag.h"
 #include "gpos/common/CAutoP.h"
 
@@ -53,6 +54,7 @@
 #include "gpopt/engine/CCTEConfig.h"
 #include "gpopt/mdcache/CAutoMDAccessor.h"
 #include "gpopt/mdcache/CMDCache.h"
+#include "gpopt/mdcache/CMDKey.h"
 #include "gpopt/minidump/CMinidumperUtils.h"
 #include "gpopt/optimizer/COptimizer.h"
 #include "gpopt/optimizer/COptimizerConfig.h"
@@ -66,6 +68,7 @@
 
 #include "naucrates/md/IMDId.h"
 #include "naucrates/md/CMDIdRelStats.h"
+#include "naucrates/md/CMDIdColStats.h"
 
 #include "naucrates/md/CSystemId.h"
 #include "naucrates/md/IMDRelStats.h"
@@ -627,6 +630,74 @@ COptTasks::GetCostModel
 	return cost_model;
 }
 
+//---------------------------------------------------------------------------
+//	@function:
+//		COptTasks::EvictMDCacheObject
+//
+//	@doc:
+//		Evict the object with the given metadata id from the metadata cache,
+//		if it is there; releases the mdid
+//
+//---------------------------------------------------------------------------
+void
+COptTasks::EvictMDCacheObject
+	(
+	IMDId *mdid
+	)
+{
+	CMDKey md_key(mdid);
+	CCacheAccessor<IMDCacheObject*, CMDKey*> cache_accessor(CMDCache::Pcache());
+
+	cache_accessor.Lookup(&md_key);
+	if (NULL != cache_accessor.Val())
+	{
+		cache_accessor.MarkForDeletion();
+	}
+
+	mdid->Release();
+}
+
+//---------------------------------------------------------------------------
+//	@function:
+//		COptTasks::EvictInvalidMDCacheObjects
+//
+//	@doc:
+//		Evict the metadata cache objects built from catalog entries that
+//		have been invalidated since the last query was optimized
+//
+//---------------------------------------------------------------------------
+void
+COptTasks::EvictInvalidMDCacheObjects
+	(
+	CMemoryPool *mp
+	)
+{
+	gpdb::MDCacheObjectRef ref;
+
+	while (gpdb::MDCacheNextInvalidObject(&ref))
+	{
+		switch (ref.kind)
+		{
+			case gpdb::MDCacheObjectRelation:
+				EvictMDCacheObject(GPOS_NEW(mp) CMDIdGPDB(ref.oid));
+				EvictMDCacheObject(GPOS_NEW(mp) CMDIdRelStats(GPOS_NEW(mp) CMDIdGPDB(ref.oid)));
+				for (ULONG pos = 0; pos < (ULONG) ref.ncolstats; pos++)
+				{
+					EvictMDCacheObject(GPOS_NEW(mp) CMDIdColStats(GPOS_NEW(mp) CMDIdGPDB(ref.oid), pos));
+				}
+				break;
+
+			case gpdb::MDCacheObjectGPDB:
+				EvictMDCacheObject(GPOS_NEW(mp) CMDIdGPDB(ref.oid));
+				break;
+
+			case gpdb::MDCacheObjectCast:
+				EvictMDCacheObject(GPOS_NEW(mp) CMDIdCast(GPOS_NEW(mp) CMDIdGPDB(ref.oid), GPOS_NEW(mp) CMDIdGPDB(ref.oid2)));
+				break;
+		}
+	}
+}
+
 //---------------------------------------------------------------------------
 //	@function:
 //		COptTasks::OptimizeTask
@@ -670,9 +741,23 @@ COptTasks::OptimizeTask
 		CMDCache::Reset();
 		CMDCache::SetCacheQuota(optimizer_mdcache_size * 1024L);
 	}
-	else if (CMDCache::ULLGetCacheQuota() != (ULLONG) optimizer_mdcache_size * 1024L)
+	else
 	{
-		CMDCache::SetCacheQuota(optimizer_mdcache_size * 1024L);
+		// evict just the objects whose catalog entries have changed
+		EvictInvalidMDCacheObjects(mp);
+
+		// queueing the parents of an evicted partition may have overflowed
+		// the queue, and dropped the rest of it; reset the cache now rather
+		// than optimize this query against stale objects
+		if (gpdb::MDCacheNeedsReset())
+		{
+			CMDCache::Reset();
+		}
+
+		if (CMDCache::ULLGetCacheQuota() != (ULLONG) optimizer_mdcache_size * 1024L)
+		{
+			CMDCache::SetCacheQuota(optimizer_mdcache_size * 1024L);
+		}
 	}
 
 
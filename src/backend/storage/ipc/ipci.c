@@ -24,6 +24,7 @@
 #include "access/twophase.h"
 #include "access/distributedlog.h"
 #include "access/appendonlywriter.h"
+#include "access/appendonly_zonemap.h"
 #include "cdb/cdblocaldistribxact.h"
 #include "cdb/cdbvars.h"
 #include "commands/async.h"
@@ -62,6 +63,7 @@
 #include "postmaster/backoff.h"
 #include "cdb/memquota.h"
 #include "executor/instrument.h"
+#include "executor/nodeShareInputScan.h"
 #include "executor/spi.h"
 #include "utils/workfile_mgr.h"
 #include "utils/session_state.h"
@@ -176,6 +178,8 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 
 		size = add_size(size, SharedSnapshotShmemSize());
 		size = add_size(size, FtsShmemSize());
+		size = add_size(size, AppendOnlyZoneMapShmemSize());
+		size = add_size(size, ShareInputShmemSize());
 		size = add_size(size, tmShmemSize());
 		size = add_size(size, CheckpointerShmemSize());
 		size = add_size(size, CancelBackendMsgShmemSize());
@@ -282,6 +286,16 @@ CreateSharedMemoryAndSemaphores(bool makePrivate, int port)
 	if (Gp_role == GP_ROLE_DISPATCH)
 		InitAppendOnlyWriter();
 
+	/*
+	 * Set up append only zone map cache
+	 */
+	AppendOnlyZoneMapShmemInit();
+
+	/*
+	 * Set up synchronization of cross-slice shared scans
+	 */
+	ShareInputShmemInit();
+
 	/*
 	 * Set up resource manager 
 	 */
@@ -253,6 +253,12 @@ NumLWLocks(void)
     /* cdbfts.c needs one lock */
     numLocks++;
 
+	/* appendonly_zonemap.c needs one lock */
+	numLocks++;
+
+	/* nodeShareInputScan.c needs one lock */
+	numLocks++;
+
 	/* multixact.c needs two SLRU areas */
 	numLocks += NUM_MXACTOFFSET_BUFFERS + NUM_MXACTMEMBER_BUFFERS;
 
@@ -84,6 +84,7 @@
 #include "mb/pg_wchar.h"
 
 #include "cdb/cdbvars.h"
+#include "cdb/cdbplancache.h"
 #include "cdb/cdbsrlz.h"
 #include "cdb/cdbtm.h"
 #include "cdb/cdbdtxcontextinfo.h"
@@ -954,6 +955,9 @@ pg_plan_query(Query *querytree, int cursorOptions, ParamListInfo boundParams)
 	if (log_planner_stats)
 		ResetUsage();
 
+	/* let the QEs start up while we plan, if the session has none */
+	PrewarmWriterGangForQuery(querytree);
+
 	/* call the optimizer */
 	plan = planner(querytree, cursorOptions, boundParams);
 
@@ -1031,6 +1035,9 @@ pg_plan_queries(List *querytrees, int cursorOptions, ParamListInfo boundParams)
  * query_string -- optional query text (C string).
  * serializedQuerytree[len]  -- Query node or (NULL,0) if plan provided.
  * serializedPlantree[len] -- PlannedStmt node, or (NULL,0) if query provided.
+ * planFingerprint -- if not 0, the plan is kept in the QE plan cache under
+ *		this fingerprint; and if serializedPlantree is (NULL,0), the cached plan
+ *		is run.
  * serializedParams[len] -- optional parameters
  * serializedQueryDispatchDesc[len] -- QueryDispatchDesc node, or (NULL,0) if query provided.
  *
@@ -1041,6 +1048,7 @@ static void
 exec_mpp_query(const char *query_string,
 			   const char * serializedQuerytree, int serializedQuerytreelen,
 			   const char * serializedPlantree, int serializedPlantreelen,
+			   uint64 planFingerprint,
 			   const char * serializedParams, int serializedParamslen,
 			   const char * serializedQueryDispatchDesc, int serializedQueryDispatchDesclen)
 {
@@ -1123,7 +1131,21 @@ exec_mpp_query(const char *query_string,
 		plan = (PlannedStmt *) deserializeNode(serializedPlantree,serializedPlantreelen);
 		if (!plan || !IsA(plan, PlannedStmt))
 			elog(ERROR, "MPPEXEC: receive invalid planned statement");
+
+		if (planFingerprint != 0)
+			QEPlanCacheStore(planFingerprint,
+							 serializedNodeSize(serializedPlantree, serializedPlantreelen),
+							 plan);
     }
+	else if (planFingerprint != 0)
+	{
+		plan = QEPlanCacheLookup(planFingerprint);
+		if (!plan)
+			elog(ERROR, "MPPEXEC: plan " UINT64_FORMAT " is not in the plan cache",
+				 planFingerprint);
+
+		SIMPLE_FAULT_INJECTOR("qe_plan_cache_hit");
+	}
 
 	/*
      * Deserialize the extra execution information (a QueryDispatchDesc node), if there is one.
@@ -4593,6 +4615,7 @@ PostgresMain(int argc, char *argv[],
 	StringInfoData input_message;
 	sigjmp_buf	local_sigjmp_buf;
 	volatile bool send_ready_for_query = true;
+	volatile bool prewarmedQEs = false;
 
 	MemoryAccountIdType postgresMainMemoryAccountId = MEMORY_OWNER_TYPE_Undefined;
 
@@ -5106,6 +5129,7 @@ PostgresMain(int argc, char *argv[],
 		 * queries
 		 */
 		IdleTracker_DeactivateProcess();
+		VmemTracker_ReturnLease();
 
 		/*
 		 * Also consider releasing our catalog snapshot if any, so that it's
@@ -5146,6 +5170,16 @@ PostgresMain(int argc, char *argv[],
 
 				set_ps_display("idle", false);
 				pgstat_report_activity(STATE_IDLE, NULL);
+
+				/*
+				 * Before the first query, get the QEs started, so that they
+				 * come up while the client sends the query.
+				 */
+				if (!prewarmedQEs)
+				{
+					prewarmedQEs = true;
+					PrewarmSessionQEs();
+				}
 			}
 
 			ReadyForQuery(whereToSendOutput);
@@ -5274,6 +5308,7 @@ PostgresMain(int argc, char *argv[],
 					int serializedParamslen = 0;
 					int serializedQueryDispatchDesclen = 0;
 					int resgroupInfoLen = 0;
+					uint64 planFingerprint;
 					TimestampTz statementStart;
 					Oid suid;
 					Oid ouid;
@@ -5338,6 +5373,8 @@ PostgresMain(int argc, char *argv[],
 					if (resgroupInfoLen > 0)
 						resgroupInfoBuf = pq_getmsgbytes(&input_message, resgroupInfoLen);
 
+					planFingerprint = (uint64) pq_getmsgint64(&input_message);
+
 					pq_getmsgend(&input_message);
 
 					elog((Debug_print_full_dtm ? LOG : DEBUG5), "MPP dispatched stmt from QD: %s.",query_string);
@@ -5362,7 +5399,8 @@ PostgresMain(int argc, char *argv[],
 					if (cuid > 0)
 						SetUserIdAndContext(cuid, false); /* Set current userid */
 
-					if (serializedQuerytreelen==0 && serializedPlantreelen==0)
+					if (serializedQuerytreelen==0 && serializedPlantreelen==0 &&
+						planFingerprint == 0)
 					{
 						if (strncmp(query_string, "BEGIN", 5) == 0)
 						{
@@ -5393,6 +5431,7 @@ PostgresMain(int argc, char *argv[],
 						exec_mpp_query(query_string,
 									   serializedQuerytree, serializedQuerytreelen,
 									   serializedPlantree, serializedPlantreelen,
+									   planFingerprint,
 									   serializedParams, serializedParamslen,
 									   serializedQueryDispatchDesc, serializedQueryDispatchDesclen);
 
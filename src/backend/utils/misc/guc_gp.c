@@ -24,6 +24,7 @@
 #include "access/url.h"
 #include "access/xlog_internal.h"
 #include "cdb/cdbappendonlyam.h"
+#include "cdb/cdbaocsam.h"
 #include "cdb/cdbdisp.h"
 #include "cdb/cdbhash.h"
 #include "cdb/cdbsreh.h"
@@ -268,6 +269,7 @@ bool		gp_enable_multiphase_agg = true;
 bool		gp_enable_preunique = TRUE;
 bool		gp_eager_preunique = FALSE;
 bool		gp_hashagg_streambottom = true;
+double		gp_hashagg_stream_min_reduction = 1.2;
 bool		gp_enable_agg_distinct = true;
 bool		gp_enable_dqa_pruning = true;
 bool		gp_eager_dqa_pruning = FALSE;
@@ -280,6 +282,7 @@ bool		gp_log_dynamic_partition_pruning = false;
 bool		gp_cte_sharing = false;
 bool		gp_enable_relsize_collection = false;
 bool		gp_recursive_cte = true;
+int			gp_shareinput_shm_kb = 8192;
 
 /* Optimizer related gucs */
 bool		optimizer;
@@ -420,6 +423,7 @@ bool		gp_reject_internal_tcp_conn = true;
 
 /* copy */
 bool		gp_enable_segment_copy_checking = true;
+bool		gp_enable_segment_copy_parsing = true;
 /*
  * Default storage options GUC.  Value is comma-separated name=value
  * pairs.  E.g. "appendonly=true,orientation=column"
@@ -433,6 +437,7 @@ bool		gp_external_enable_filter_pushdown = true;
 /* Executor */
 bool		gp_enable_mk_sort = true;
 bool		gp_enable_motion_mk_sort = true;
+int			gp_mk_sort_threads = 1;
 
 /* Enable GDD */
 bool		gp_enable_global_deadlock_detector = false;
@@ -646,6 +651,19 @@ struct config_bool ConfigureNamesBool_gp[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"gp_enable_runtime_filter", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables runtime filters pushed from hash joins down to sequential scans."),
+			gettext_noop("An inner or semi hash join whose outer input is a "
+						 "sequential scan builds a bloom filter over its inner "
+						 "join keys, which the scan uses to discard rows that "
+						 "cannot find a match."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_enable_runtime_filter,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gp_enable_direct_dispatch", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enable dispatch for single-row-insert targetted mirror-pairs."),
@@ -655,6 +673,24 @@ struct config_bool ConfigureNamesBool_gp[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"gp_dispatch_plan_fragments", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Dispatch to each gang only the part of the plan it executes."),
+			gettext_noop("Plan subtrees under Motions that belong to other slices are left out.")
+		},
+		&gp_dispatch_plan_fragments,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"gp_qe_plan_cache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Let the QEs cache the plans dispatched to them."),
+			gettext_noop("A plan that a QE already has is dispatched by its fingerprint only.")
+		},
+		&gp_qe_plan_cache,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"gp_enable_predicate_propagation", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("When two expressions are equivalent (such as with "
@@ -1038,6 +1074,26 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_zonemap_scan", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Use per-block min/max summaries to skip append-only blocks during scans."),
+			NULL
+		},
+		&gp_appendonly_zonemap_scan,
+		true,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_aocs_batch_quals", PGC_USERSET, APPENDONLY_TABLES,
+			gettext_noop("Evaluate simple comparisons on column-oriented table scans over batches of column values."),
+			NULL
+		},
+		&gp_aocs_batch_quals,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_heap_require_relhasoids_match", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Issue an error on discovery of a mismatch between relhasoids and a tuple header."),
@@ -1177,6 +1233,29 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_interconnect_shm", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Pass UDP interconnect packets between QEs on the same host through shared memory."),
+			NULL,
+			GUC_GPDB_ADDOPT
+		},
+		&gp_interconnect_shm,
+		false,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"gp_overlap_gang_creation", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Start creating the writer gang of a session before planning a query that needs it."),
+			gettext_noop("Only takes effect when the session has no segment workers, so that the "
+						 "segment workers start up while the query is being planned."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_overlap_gang_creation,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"resource_scheduler", PGC_POSTMASTER, RESOURCES_MGM,
 			gettext_noop("Enable resource scheduling."),
@@ -1835,6 +1914,17 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_resgroup_borrow_shared_memory", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Lets operators borrow free shared memory of the resource group before they spill."),
+			NULL,
+			GUC_GPDB_ADDOPT
+		},
+		&gp_resgroup_borrow_shared_memory,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_resqueue_print_operator_memory_limits", PGC_USERSET, LOGGING_WHAT,
 			gettext_noop("Prints out the memory limit for operators (in explain) assigned by resource queue's "
@@ -2877,6 +2967,17 @@ struct config_bool ConfigureNamesBool_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_enable_segment_copy_parsing", PGC_USERSET, CUSTOM_OPTIONS,
+			gettext_noop("Let the segments parse the input lines of \"COPY FROM\", when the master does not need to look at them."),
+			gettext_noop("This applies to randomly distributed and replicated tables."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_enable_segment_copy_parsing,
+		true,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_ignore_error_table", PGC_USERSET, COMPAT_OPTIONS_PREVIOUS,
 			gettext_noop("Ignore INTO error-table in external table and COPY (Deprecated)."),
@@ -2937,6 +3038,16 @@ struct config_bool ConfigureNamesBool_gp[] =
 		check_gp_resource_group_bypass, NULL, NULL
 	},
 
+	{
+		{"gp_resource_group_fast_admission", PGC_SUSET, RESOURCES,
+			gettext_noop("Reuse the slots of finished transactions without locking the resource groups."),
+			NULL,
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_resource_group_fast_admission,
+		true, NULL, NULL
+	},
+
 	{
 		{"stats_queue_level", PGC_SUSET, STATS_COLLECTOR,
 			gettext_noop("Collects resource queue-level statistics on database activity."),
@@ -3196,6 +3307,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_shareinput_shm_kb", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the largest result of a cross-slice shared scan that is passed in shared memory."),
+			gettext_noop("Larger results are passed in workfiles. 0 always uses workfiles."),
+			GUC_UNIT_KB | GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_shareinput_shm_kb,
+		8192, 0, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_vmem_idle_resource_timeout", PGC_USERSET, CLIENT_CONN_OTHER,
 			gettext_noop("Sets the time a session can be idle (in milliseconds) before we release gangs on the segment DBs to free resources."),
@@ -3298,6 +3420,16 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_appendonly_zonemap_entries", PGC_POSTMASTER, APPENDONLY_TABLES,
+			gettext_noop("Maximum number of append-only block summaries (zone maps) cached in shared memory."),
+			gettext_noop("Zero disables zone maps.")
+		},
+		&gp_appendonly_zonemap_entries,
+		16384, 0, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_external_max_segs", PGC_USERSET, EXTERNAL_TABLES,
 			gettext_noop("Maximum number of segments that connect to a single gpfdist URL."),
@@ -3319,6 +3451,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_motion_batch_size", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the maximum number of fixed-width tuples a motion sends in one column-wise batch."),
+			gettext_noop("0 sends tuples one at a time."),
+			GUC_GPDB_ADDOPT
+		},
+		&gp_motion_batch_size,
+		0, 0, 8192,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_queue_depth", PGC_USERSET, GP_ARRAY_TUNING,
 			gettext_noop("Sets the maximum size of the receive queue for each connection in the UDP interconnect"),
@@ -3341,6 +3484,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_interconnect_io_batch_size", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the maximum number of packets sent or received per system call in the UDP interconnect"),
+			NULL,
+			GUC_GPDB_ADDOPT
+		},
+		&Gp_interconnect_io_batch_size,
+		32, 1, 64,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_interconnect_timer_period", PGC_USERSET, GP_ARRAY_TUNING,
 			gettext_noop("Sets the timer period (in ms) for UDP interconnect"),
@@ -3529,6 +3683,18 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_prewarm_segworkers", PGC_USERSET, GP_ARRAY_TUNING,
+			gettext_noop("Sets the number of segment workers per segment to start connecting when a session starts."),
+			gettext_noop("The connections are started before the session's first query, so that the "
+						 "segment workers start up while the query is sent and planned. Zero disables it."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_prewarm_segworkers,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+
 
 	{
 #ifdef USE_ASSERT_CHECKING
@@ -3737,6 +3903,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_mk_sort_threads", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Number of threads that may sort a large in-memory multi-key sort."),
+			gettext_noop("Only sorts on integer keys use more than one thread."),
+			GUC_NOT_IN_SAMPLE | GUC_GPDB_ADDOPT
+		},
+		&gp_mk_sort_threads,
+		1, 1, 32,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_hashagg_default_nbatches", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Default number of batches for hashagg's (re-)spilling phases."),
@@ -3821,6 +3998,17 @@ struct config_int ConfigureNamesInt_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_vmem_lease_chunks", PGC_SUSET, RESOURCES_MEM,
+			gettext_noop("Number of vmem chunks each process reserves from the segment vmem at once."),
+			gettext_noop("Set to 1 to reserve every chunk from the segment vmem as it is needed."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_vmem_lease_chunks,
+		8, 1, 1024,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_vmem_protect_segworker_cache_limit", PGC_POSTMASTER, RESOURCES_MEM,
 			gettext_noop("Max virtual memory limit (in MB) for a segworker to be cachable."),
@@ -4222,6 +4410,17 @@ struct config_real ConfigureNamesReal_gp[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"gp_hashagg_stream_min_reduction", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Sets the minimum number of input rows per group for the streaming bottom stage of two stage hashagg to keep aggregating."),
+			gettext_noop("When its hash table fills up with fewer rows per group, the bottom stage passes the rest of its input through without aggregating. 0 disables this."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&gp_hashagg_stream_min_reduction,
+		1.2, 0.0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"gp_resqueue_priority_cpucores_per_segment", PGC_POSTMASTER, RESOURCES_MGM,
 			gettext_noop("Number of processing units associated with a segment."),
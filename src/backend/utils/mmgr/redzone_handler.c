@@ -123,6 +123,30 @@ RedZoneHandler_ShmemInit()
 	}
 }
 
+/*
+ * Returns the vmem chunks that the sessions on this segment use.
+ *
+ * This is segmentVmemChunks without the leases that processes took ahead of
+ * time and don't use (see gp_vmem_lease_chunks). We walk all the entries of
+ * the session state array, so only call this when segmentVmemChunks is past
+ * a limit. No lock is needed: the entries never move, and the free ones have
+ * no vmem.
+ */
+int32
+RedZoneHandler_GetSessionVmemChunks()
+{
+	int32 sessionVmemChunks = 0;
+
+	Assert(NULL != AllSessionStateEntries);
+
+	for (int i = 0; i < AllSessionStateEntries->maxSession; i++)
+	{
+		sessionVmemChunks += AllSessionStateEntries->sessions[i].sessionVmem;
+	}
+
+	return sessionVmemChunks;
+}
+
 /*
  * Returns true if the system is in red-zone (too little VMEM)
  */
@@ -133,7 +157,12 @@ RedZoneHandler_IsVmemRedZone()
 
 	if (vmemTrackerInited)
 	{
-		return *segmentVmemChunks > redZoneChunks;
+		/*
+		 * Unused leases count in segmentVmemChunks, so before we call it a
+		 * red zone, check that the sessions actually use that much.
+		 */
+		return *segmentVmemChunks > redZoneChunks &&
+			RedZoneHandler_GetSessionVmemChunks() > redZoneChunks;
 	}
 
 	return false;
@@ -194,6 +194,10 @@ test__RedZoneHandler_IsVmemRedZone__ProperlyIdentifiesRedZone(void **state)
 
 	vmemTrackerInited = true;
 
+	CreateSessionStateArray(4);
+	AcquireSessionState(1 /* sessionId */, 50 /* vmem */, 1 /* activeProcessCount */);
+	AcquireSessionState(2, 40, 1);
+
 	static int32 fakeSegmentVmemChunks = 0;
 	segmentVmemChunks = &fakeSegmentVmemChunks;
 
@@ -205,15 +209,46 @@ test__RedZoneHandler_IsVmemRedZone__ProperlyIdentifiesRedZone(void **state)
 	/* 100 chunks */
 	*segmentVmemChunks = 100;
 	redZoneChunks = 80;
-	/* segmentVmemChunks exceeds redZoneChunks. So, should be red zone */
+	/* The sessions use 90 chunks of the 100. So, should be red zone */
 	assert_true(RedZoneHandler_IsVmemRedZone());
 
+	/*
+	 * segmentVmemChunks exceeds redZoneChunks, but only because of the leases
+	 * that processes don't use. Not a red zone.
+	 */
+	redZoneChunks = 95;
+	assert_false(RedZoneHandler_IsVmemRedZone());
+	redZoneChunks = 80;
+
 	vmemTrackerInited = false;
 	/*
 	 * segmentVmemChunks exceeds redZoneChunks. But vmem tracker is not
 	 * initialized. Therefore, no red zone detection
 	 */
 	assert_false(RedZoneHandler_IsVmemRedZone());
+
+	DestroySessionStateArray();
+}
+
+/*
+ * Checks if RedZoneHandler_GetSessionVmemChunks() adds up the vmem of all
+ * sessions, and nothing else
+ */
+void
+test__RedZoneHandler_GetSessionVmemChunks__AddsUpAllSessions(void **state)
+{
+	CreateSessionStateArray(8);
+
+	assert_int_equal(RedZoneHandler_GetSessionVmemChunks(), 0);
+
+	AcquireSessionState(1 /* sessionId */, 100 /* vmem */, 1 /* activeProcessCount */);
+	AcquireSessionState(2, 7, 0);
+	AcquireSessionState(3, 0, 1);
+	AcquireSessionState(4, 42, 1);
+
+	assert_int_equal(RedZoneHandler_GetSessionVmemChunks(), 149);
+
+	DestroySessionStateArray();
 }
 
 /*
@@ -417,6 +452,7 @@ main(int argc, char* argv[])
 		unit_test(test__RedZoneHandler_ShmemInit__InitializesGlobalVarsWhenPostmaster),
 		unit_test(test__RedZoneHandler_ShmemInit__InitializesUnderPostmaster),
 		unit_test(test__RedZoneHandler_IsVmemRedZone__ProperlyIdentifiesRedZone),
+		unit_test(test__RedZoneHandler_GetSessionVmemChunks__AddsUpAllSessions),
 		unit_test(test__RedZoneHandler_FlagTopConsumer__SingletonDetector),
 		unit_test(test__RedZoneHandler_FlagTopConsumer__FindsTopConsumer),
 		unit_test(test__RedZoneHandler_FlagTopConsumer__IgnoresIdleSession),
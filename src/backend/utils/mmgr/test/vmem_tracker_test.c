@@ -83,6 +83,8 @@ void VmemTrackerTestSetup(void **state)
 	gp_vmem_protect_limit = 8192;
 	/* Disable runaway detector */
 	runaway_detector_activation_percent = 100;
+	/* Reserve every chunk from the segment, unless a test says otherwise */
+	gp_vmem_lease_chunks = 1;
 
 	will_return(ShmemInitStruct, &fakeSegmentVmemChunks);
 	will_assign_value(ShmemInitStruct, foundPtr, false);
@@ -270,6 +272,7 @@ test__VmemTracker_ReserveVmem__TrackedBytesSanity(void **state)
 
 	/* This will be over the vmem limit */
 	will_be_called(RedZoneHandler_DetectRunawaySession);
+	will_return(RedZoneHandler_GetSessionVmemChunks, vmemChunksQuota + 1);
 	/* 1 more byte, and we need a new chunk */
 	status = VmemTracker_ReserveVmem(1);
 	assert_true(status == MemoryFailure_VmemExhausted);
@@ -293,6 +296,7 @@ test__VmemTracker_ReserveVmem__TrackedBytesSanity(void **state)
 	maxChunksPerQuery = vmemChunksQuota + 1;
 
 	will_be_called(RedZoneHandler_DetectRunawaySession);
+	will_return(RedZoneHandler_GetSessionVmemChunks, vmemChunksQuota + 1);
 	/* This will first hit the vmem limit */
 	/* 1 more byte, and we need a new chunk */
 	status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(vmemChunksQuota + 1));
@@ -547,6 +551,112 @@ test__VmemTracker_Init__InitializesOthers(void **state)
 	assert_true(trackedBytes == 0);
 }
 
+/*
+ * Checks that we reserve the segment vmem in leases, and that the process
+ * uses up the lease before reserving more, and gives it back when it is idle.
+ */
+void
+test__VmemTracker_ReserveVmem__LeaseSanity(void **state)
+{
+	gp_mp_inited = true;
+	gp_vmem_lease_chunks = 4;
+
+#ifdef USE_ASSERT_CHECKING
+	will_return_count(MemoryProtection_IsOwnerThread, true, 3);
+#endif
+
+	will_return_count(RedZoneHandler_GetRedZoneLimitChunks, INT32_MAX, 2);
+	will_be_called_count(RedZoneHandler_DetectRunawaySession, 2);
+
+	/* The first chunk takes a whole lease from the segment */
+	MemoryAllocationStatus status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(1));
+	assert_true(status == MemoryAllocation_Success);
+	assert_true(trackedVmemChunks == 1);
+	assert_true(MySessionState->sessionVmem == 1);
+	assert_true(*segmentVmemChunks == 4);
+
+	/* The next ones come out of the lease */
+	status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(2));
+	assert_true(status == MemoryAllocation_Success);
+	assert_true(trackedVmemChunks == 3);
+	assert_true(MySessionState->sessionVmem == 3);
+	assert_true(*segmentVmemChunks == 4);
+
+	/* Freeing everything keeps all but one chunk of the lease */
+	VmemTracker_ReleaseVmem(CHUNKS_TO_BYTES(3));
+	assert_true(trackedVmemChunks == 0);
+	assert_true(MySessionState->sessionVmem == 0);
+	assert_true(*segmentVmemChunks == 3);
+
+	/* Going idle gives back the rest */
+	VmemTracker_ReturnLease();
+	assert_true(*segmentVmemChunks == 0);
+}
+
+/*
+ * Checks that we don't take a lease that would reach into the red zone.
+ */
+void
+test__VmemTracker_ReserveVmem__NoLeaseNearRedZone(void **state)
+{
+	gp_mp_inited = true;
+	gp_vmem_lease_chunks = 4;
+
+#ifdef USE_ASSERT_CHECKING
+	will_return(MemoryProtection_IsOwnerThread, true);
+#endif
+
+	will_return(RedZoneHandler_GetRedZoneLimitChunks, 3);
+	will_be_called(RedZoneHandler_DetectRunawaySession);
+
+	MemoryAllocationStatus status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(1));
+	assert_true(status == MemoryAllocation_Success);
+	assert_true(trackedVmemChunks == 1);
+	assert_true(*segmentVmemChunks == 1);
+}
+
+/*
+ * Checks that the leases that other processes don't use don't make us fail
+ * at the vmem limit, and that we don't keep a lease there.
+ */
+void
+test__VmemTracker_ReserveVmem__IgnoreUnusedLeasesAtLimit(void **state)
+{
+	gp_mp_inited = true;
+	gp_vmem_lease_chunks = 4;
+
+#ifdef USE_ASSERT_CHECKING
+	will_return_count(MemoryProtection_IsOwnerThread, true, 3);
+#endif
+
+	will_return_count(RedZoneHandler_GetRedZoneLimitChunks, INT32_MAX, 2);
+	will_be_called_count(RedZoneHandler_DetectRunawaySession, 2);
+
+	/* Many other processes hold leases up to the limit, and use none of it */
+	*segmentVmemChunks = vmemChunksQuota - 1;
+
+	/* The sessions use no more than we ask for, so we get it */
+	will_return(RedZoneHandler_GetSessionVmemChunks, 2);
+	MemoryAllocationStatus status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(2));
+	assert_true(status == MemoryAllocation_Success);
+	assert_true(trackedVmemChunks == 2);
+	assert_true(MySessionState->sessionVmem == 2);
+	assert_true(*segmentVmemChunks == vmemChunksQuota + 1);
+
+	/* At the limit, we give back what we free right away */
+	VmemTracker_ReleaseVmem(CHUNKS_TO_BYTES(1));
+	assert_true(trackedVmemChunks == 1);
+	assert_true(*segmentVmemChunks == vmemChunksQuota);
+
+	/* But we fail once the sessions really use the vmem */
+	will_return(RedZoneHandler_GetSessionVmemChunks, vmemChunksQuota + 1);
+	status = VmemTracker_ReserveVmem(CHUNKS_TO_BYTES(1));
+	assert_true(status == MemoryFailure_VmemExhausted);
+	assert_true(trackedVmemChunks == 1);
+	assert_true(MySessionState->sessionVmem == 1);
+	assert_true(*segmentVmemChunks == vmemChunksQuota);
+}
+
 /*
  * Checks if we release all vmem during shutdown.
  */
@@ -604,6 +714,7 @@ test__VmemTracker_RequestWaiver__WaiveEnforcement(void **state)
 
 
 	/* 1 more byte will fail */
+	will_return(RedZoneHandler_GetSessionVmemChunks, vmemChunksQuota + 1);
 	status = VmemTracker_ReserveVmem(1);
 	assert_true(status == MemoryFailure_VmemExhausted);
 	/* No new chunk should have been reserved */
@@ -629,6 +740,7 @@ test__VmemTracker_RequestWaiver__WaiveEnforcement(void **state)
 
 	/* This will be over the vmem limit + waived chunks, therefore will fail */
 	will_be_called(RedZoneHandler_DetectRunawaySession);
+	will_return(RedZoneHandler_GetSessionVmemChunks, vmemChunksQuota + 2);
 	/* 1 more byte, and we need a new chunk */
 	status = VmemTracker_ReserveVmem(1);
 	assert_true(status == MemoryFailure_VmemExhausted);
@@ -682,6 +794,9 @@ main(int argc, char* argv[])
 		unit_test_setup_teardown(test__VmemTracker_ShmemInit__InitSegmentVmemLimitInPostmaster, VmemTrackerTestSetup, VmemTrackerTestTeardown),
 		unit_test_setup_teardown(test__VmemTracker_ShmemInit__QuotaCalculation, VmemTrackerTestSetup, VmemTrackerTestTeardown),
 		unit_test_setup_teardown(test__VmemTracker_Init__InitializesOthers, VmemTrackerTestSetup, VmemTrackerTestTeardown),
+		unit_test_setup_teardown(test__VmemTracker_ReserveVmem__LeaseSanity, VmemTrackerTestSetup, VmemTrackerTestTeardown),
+		unit_test_setup_teardown(test__VmemTracker_ReserveVmem__NoLeaseNearRedZone, VmemTrackerTestSetup, VmemTrackerTestTeardown),
+		unit_test_setup_teardown(test__VmemTracker_ReserveVmem__IgnoreUnusedLeasesAtLimit, VmemTrackerTestSetup, VmemTrackerTestTeardown),
 		unit_test_setup_teardown(test__VmemTracker_Shutdown__ReleasesAllVmem, VmemTrackerTestSetup, VmemTrackerTestTeardown),
 		unit_test_setup_teardown(test__VmemTracker_RequestWaiver__WaiveEnforcement, VmemTrackerTestSetup, VmemTrackerTestTeardown),
 	};
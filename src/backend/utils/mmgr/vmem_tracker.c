@@ -50,6 +50,16 @@ static int32 trackedVmemChunks = 0;
 static int32 maxVmemChunksTracked = 0;
 /* Number of bytes tracked (i.e., allocated under the tutelage of vmem tracker) */
 static int64 trackedBytes = 0;
+/*
+ * Number of chunks this process has reserved from segmentVmemChunks. This
+ * is never less than trackedVmemChunks: the rest is a lease we took ahead
+ * of time, so that we don't have to update the segment counter, that every
+ * process on the segment contends on, for every single chunk.
+ */
+static int32 leasedVmemChunks = 0;
+
+/* Number of chunks to reserve from the segment vmem at once */
+int gp_vmem_lease_chunks = 8;
 
 /* Vmem quota in chunk unit */
 static int32 vmemChunksQuota = 0;
@@ -80,6 +90,8 @@ volatile int32 *segmentVmemChunks = NULL;
 
 static void ReleaseAllVmemChunks(void);
 static int32 VmemTracker_GetMaxChunksPerQuery(void);
+static bool VmemTracker_IsNearVmemCeiling(int32 ceilingChunks);
+static void VmemTracker_ShrinkLease(int32 maxSpareChunks);
 
 /*
  * Initializes the shared memory states of the vmem tracker. This
@@ -93,6 +105,7 @@ VmemTracker_ShmemInit()
 	trackedVmemChunks = 0;
 	maxVmemChunksTracked = 0;
 	trackedBytes = 0;
+	leasedVmemChunks = 0;
 
 	bool		alreadyInShmem = false;
 
@@ -146,6 +159,7 @@ VmemTracker_Init()
 	Assert(trackedVmemChunks == 0);
 	Assert(maxVmemChunksTracked == 0);
 	Assert(trackedBytes == 0);
+	Assert(leasedVmemChunks == 0);
 
 	/*
 	 * Even though asserts have passed, make sure that in production system
@@ -154,6 +168,7 @@ VmemTracker_Init()
 	trackedVmemChunks = 0;
 	maxVmemChunksTracked = 0;
 	trackedBytes = 0;
+	leasedVmemChunks = 0;
 
 	Assert(0 < vmemChunksQuota || Gp_role != GP_ROLE_EXECUTE);
 	Assert(gp_vmem_limit_per_query == 0 || (maxChunksPerQuery != 0 && maxChunksPerQuery < gp_vmem_limit_per_query));
@@ -191,6 +206,129 @@ VmemTracker_ResetMaxVmemReserved()
 	maxVmemChunksTracked = trackedVmemChunks;
 }
 
+/*
+ * Reserve at least 'numChunks' more chunks of the segment vmem for the lease
+ * of current process. The reservation is validated against segment level
+ * vmem quota.
+ *
+ * We round the reservation up to gp_vmem_lease_chunks, as long as the whole
+ * lease fits below both the vmem limit and the red zone. Near either of them
+ * we reserve just what is needed, so that we don't fail or trigger the
+ * runaway detector on behalf of chunks that nobody uses.
+ *
+ * Returns false if the segment vmem is exhausted, with nothing reserved.
+ */
+static bool
+VmemTracker_ExtendLease(int32 numChunks, bool *waiverUsed)
+{
+	int32 vmemLimitChunks = VmemTracker_GetVmemLimitChunks();
+	int32 leaseChunks = numChunks;
+
+	Assert(0 < numChunks);
+
+	if (gp_vmem_lease_chunks > numChunks && waivedChunks == 0)
+	{
+		int32 ceiling = Min(vmemLimitChunks, RedZoneHandler_GetRedZoneLimitChunks());
+
+		if (!VmemTracker_IsNearVmemCeiling(ceiling))
+			leaseChunks = gp_vmem_lease_chunks;
+	}
+
+	for (;;)
+	{
+		int32 new_vmem = pg_atomic_add_fetch_u32((pg_atomic_uint32 *)segmentVmemChunks, leaseChunks);
+
+		/*
+		 * If segment vmem is exhausted, rollback the reservation. For non-QE
+		 * processes and processes in critical section, we don't enforce VMEM,
+		 * but we do track the usage.
+		 */
+		if (new_vmem <= vmemLimitChunks ||
+			Gp_role != GP_ROLE_EXECUTE || CritSectionCount != 0)
+			break;
+
+		if (new_vmem <= vmemLimitChunks + waivedChunks)
+		{
+			*waiverUsed = true;
+			break;
+		}
+
+		pg_atomic_sub_fetch_u32((pg_atomic_uint32 *)segmentVmemChunks, leaseChunks);
+
+		/*
+		 * Somebody else got there first. What we actually need may still
+		 * fit.
+		 */
+		if (leaseChunks != numChunks)
+		{
+			leaseChunks = numChunks;
+			continue;
+		}
+
+		/*
+		 * The leases that other processes don't use count in the segment
+		 * vmem as well. Check what the sessions actually use, which includes
+		 * what we ask for now, and let us through if that is within the
+		 * limit. The processes holding those leases give them back when they
+		 * next reserve or release vmem, now that the segment is at its limit.
+		 */
+		int32 sessionVmemChunks = RedZoneHandler_GetSessionVmemChunks();
+
+		if (sessionVmemChunks > vmemLimitChunks + waivedChunks)
+			return false;
+
+		if (sessionVmemChunks > vmemLimitChunks)
+			*waiverUsed = true;
+
+		pg_atomic_add_fetch_u32((pg_atomic_uint32 *)segmentVmemChunks, leaseChunks);
+		break;
+	}
+
+	leasedVmemChunks += leaseChunks;
+
+	return true;
+}
+
+/*
+ * Returns true if the segment vmem is within a lease of 'ceilingChunks'.
+ */
+static bool
+VmemTracker_IsNearVmemCeiling(int32 ceilingChunks)
+{
+	return *segmentVmemChunks > ceilingChunks - gp_vmem_lease_chunks;
+}
+
+/*
+ * Give back the part of our lease that is not in use, except for
+ * 'maxSpareChunks' chunks.
+ */
+static void
+VmemTracker_ShrinkLease(int32 maxSpareChunks)
+{
+	int32 spare = leasedVmemChunks - trackedVmemChunks;
+
+	Assert(0 <= spare);
+
+	if (spare > maxSpareChunks)
+	{
+		pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) segmentVmemChunks, spare - maxSpareChunks);
+		leasedVmemChunks -= spare - maxSpareChunks;
+		Assert(*segmentVmemChunks >= 0);
+	}
+}
+
+/*
+ * Give back all of the segment vmem that this process reserved ahead of
+ * time. Called when the process goes idle, as an idle process has no use
+ * for it.
+ */
+void
+VmemTracker_ReturnLease(void)
+{
+	if (leasedVmemChunks > trackedVmemChunks)
+		VmemTracker_ShrinkLease(0);
+}
+
 /*
  * Reserve 'num_chunks_to_reserve' number of chunks for current process. The
  * reservation is validated against segment level vmem quota.
@@ -238,30 +376,20 @@ VmemTracker_ReserveVmemChunks(int32 numChunksToReserve)
 		waiverUsed = true;
 	}
 
-	/* Now reserve vmem at segment level */
-	int32 new_vmem = pg_atomic_add_fetch_u32((pg_atomic_uint32 *)segmentVmemChunks, numChunksToReserve);
-	int32 vmemLimitChunks = VmemTracker_GetVmemLimitChunks();
-
 	/*
-	 * If segment vmem is exhausted, rollback query level reservation. For non-QE
-	 * processes and processes in critical section, we don't enforce VMEM, but we
-	 * do track the usage.
+	 * Now reserve vmem at segment level, unless what is left of our lease
+	 * covers it.
 	 */
-	if (new_vmem > vmemLimitChunks &&
-			Gp_role == GP_ROLE_EXECUTE && CritSectionCount == 0)
+	if (trackedVmemChunks + numChunksToReserve > leasedVmemChunks &&
+		!VmemTracker_ExtendLease(trackedVmemChunks + numChunksToReserve - leasedVmemChunks,
+								 &waiverUsed))
 	{
-		if (new_vmem > vmemLimitChunks + waivedChunks)
-		{
-			/* Revert query memory reservation */
-			pg_atomic_sub_fetch_u32((pg_atomic_uint32 *)&MySessionState->sessionVmem, numChunksToReserve);
-			/* Revert vmem reservation */
-			pg_atomic_sub_fetch_u32((pg_atomic_uint32 *)segmentVmemChunks, numChunksToReserve);
-			/* Revert resgroup memory reservation */
-			ResGroupReleaseMemory(numChunksToReserve);
+		/* Revert query memory reservation */
+		pg_atomic_sub_fetch_u32((pg_atomic_uint32 *)&MySessionState->sessionVmem, numChunksToReserve);
+		/* Revert resgroup memory reservation */
+		ResGroupReleaseMemory(numChunksToReserve);
 
-			return MemoryFailure_VmemExhausted;
-		}
-		waiverUsed = true;
+		return MemoryFailure_VmemExhausted;
 	}
 
 	/* The current process now owns additional vmem in this segment */
@@ -291,14 +419,21 @@ VmemTracker_ReleaseVmemChunks(int reduction)
 	/* We don't support vmem usage from non-owner thread */
 	Assert(MemoryProtection_IsOwnerThread());
 
-	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) segmentVmemChunks, reduction);
-
-	Assert(*segmentVmemChunks >= 0);
 	Assert(NULL != MySessionState);
 	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *)&MySessionState->sessionVmem, reduction);
 	ResGroupReleaseMemory(reduction);
 	Assert(0 <= MySessionState->sessionVmem);
 	trackedVmemChunks -= reduction;
+
+	/*
+	 * Keep the released chunks in our lease, up to the lease size, in case
+	 * we need them again soon. Near the vmem limit, others may need them
+	 * more.
+	 */
+	if (VmemTracker_IsNearVmemCeiling(VmemTracker_GetVmemLimitChunks()))
+		VmemTracker_ShrinkLease(0);
+	else
+		VmemTracker_ShrinkLease(Max(gp_vmem_lease_chunks - 1, 0));
 }
 
 /*
@@ -309,6 +444,8 @@ ReleaseAllVmemChunks()
 {
 	VmemTracker_ReleaseVmemChunks(trackedVmemChunks);
 	Assert(0 == trackedVmemChunks);
+	VmemTracker_ShrinkLease(0);
+	Assert(0 == leasedVmemChunks);
 	trackedBytes = 0;
 }
 
@@ -541,6 +678,17 @@ VmemTracker_ReserveVmem(int64 newlyRequestedBytes)
 		 */
 		trackedBytes -= newlyRequestedBytes;
 
+		/*
+		 * Close to the red zone or the vmem limit, give back what is left of
+		 * our lease, so that the segment vmem shows what is actually in use.
+		 */
+		if (leasedVmemChunks > trackedVmemChunks &&
+			VmemTracker_IsNearVmemCeiling(Min(VmemTracker_GetVmemLimitChunks(),
+											  RedZoneHandler_GetRedZoneLimitChunks())))
+		{
+			VmemTracker_ShrinkLease(0);
+		}
+
 		/*
 		 * Detect a runaway session. Moreover, if the current session is deemed
 		 * as runaway, start cleanup.
@@ -84,6 +84,8 @@ bool						gp_log_resgroup_memory = false;
 int							gp_resgroup_memory_policy_auto_fixed_mem;
 bool						gp_resgroup_print_operator_memory_limits = false;
 int							memory_spill_ratio=20;
+bool						gp_resource_group_fast_admission = true;
+bool						gp_resgroup_borrow_shared_memory = true;
 
 /*
  * Data structures
@@ -125,6 +127,7 @@ struct ResGroupProcData
 	Oid		groupId;
 
 	int32	memUsage;			/* memory usage of current proc */
+	int32	memLent;			/* shared memory lent to our operators */
 
 	ResGroupData		*group;
 	ResGroupSlotData	*slot;
@@ -150,6 +153,9 @@ struct ResGroupSlotData
 
 	ResGroupSlotData	*next;
 
+	int				parkedNext;	/* next parked slot id + 1, 0 if none */
+	uint32			parkEpoch;	/* group's parkEpoch when the slot was got */
+
 	ResGroupCaps	caps;
 };
 
@@ -198,9 +204,16 @@ struct ResGroupData
 	volatile int32	memUsage;
 	volatile int32	memSharedUsage;
 
+	/*
+	 * shared memory chunks lent to operators that would spill otherwise,
+	 * they are counted in memSharedUsage as well; protected by ResGroupLock,
+	 * see ResGroupBorrowSpillMemory()
+	 */
+	volatile int32	memSharedLent;
+
 	volatile int			nRunning;		/* number of running trans */
 	volatile int	nRunningBypassed;		/* number of running trans in bypass mode */
-	int			totalExecuted;	/* total number of executed trans */
+	volatile int	totalExecuted;	/* total number of executed trans */
 	int			totalQueued;	/* total number of queued trans	*/
 	Interval	totalQueuedTime;/* total queue time */
 	PROC_QUEUE	waitProcs;		/* list of PGPROC objects waiting on this group */
@@ -212,9 +225,35 @@ struct ResGroupData
 
 	bool		lockedForDrop;  /* true if resource group is dropped but not committed yet */
 
+	/*
+	 * Slots released by the QD that are kept for the next transactions of
+	 * the group, see groupParkSlot().  A parked slot still counts in
+	 * nRunning and memQuotaUsed, nParked and memQuotaParked tell how much
+	 * of them is parked, for the statistics.
+	 */
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	pg_atomic_uint64	parkedSlots;
+#endif
+	volatile uint32	parkEpoch;	/* bumped when the parked slots become stale */
+	volatile int32	nParked;
+	volatile int32	memQuotaParked;
+
 	ResGroupCaps	caps;		/* capabilities of this group */
 };
 
+/*
+ * The parkedSlots word of a group: the id + 1 of the first parked slot in
+ * the upper half, a tag that changes on every update against ABA in bits
+ * 1 to 31, and whether parking is closed in bit 0.
+ */
+#define PARKED_CLOSED			((uint64) 1)
+#define PARKED_HEAD(word)		((int) ((word) >> 32))
+#define PARKED_TAG(word)		((uint32) (((word) >> 1) & 0x7FFFFFFF))
+#define PARKED_MAKE(head, tag, closed) \
+	(((uint64) (head) << 32) | \
+	 ((uint64) ((tag) & 0x7FFFFFFF) << 1) | \
+	 ((closed) ? PARKED_CLOSED : 0))
+
 struct ResGroupControl
 {
 	int32			totalChunks;	/* total memory chunks on this segment */
@@ -301,6 +340,12 @@ static int32 groupIncMemUsage(ResGroupData *group,
 static int32 groupDecMemUsage(ResGroupData *group,
 							  ResGroupSlotData *slot,
 							  int32 chunks);
+static int32 groupLendMemory(ResGroupData *group,
+							 ResGroupSlotData *slot,
+							 int32 chunks);
+static void groupTakeBackMemory(ResGroupData *group,
+								ResGroupSlotData *slot,
+								int32 chunks);
 static void initSlot(ResGroupSlotData *slot, ResGroupData *group,
 					 int32 slotMemQuota);
 static void selfAttachResGroup(ResGroupData *group, ResGroupSlotData *slot);
@@ -310,6 +355,10 @@ static ResGroupSlotData *slotpoolAllocSlot(void);
 static void slotpoolFreeSlot(ResGroupSlotData *slot);
 static ResGroupSlotData *groupGetSlot(ResGroupData *group);
 static void groupPutSlot(ResGroupData *group, ResGroupSlotData *slot);
+static bool groupParkSlot(ResGroupData *group, ResGroupSlotData *slot);
+static ResGroupSlotData *groupUnparkSlot(ResGroupData *group);
+static void groupCloseParking(ResGroupData *group, bool invalidate);
+static void groupOpenParking(ResGroupData *group);
 static Oid decideResGroupId(void);
 static void decideResGroup(ResGroupInfo *pGroupInfo);
 static bool groupIncBypassedRef(ResGroupInfo *pGroupInfo);
@@ -709,6 +758,9 @@ ResGroupCheckForDrop(Oid groupId, char *name)
 
 	group = groupHashFind(groupId, true);
 
+	/* The parked slots are not in use */
+	groupCloseParking(group, false);
+
 	if (group->nRunning + group->nRunningBypassed > 0)
 	{
 		int nQuery = group->nRunning + group->nRunningBypassed + group->waitProcs.size;
@@ -755,6 +807,8 @@ ResGroupDropFinish(const ResourceGroupCallbackContext *callbackCtx,
 		{
 			wakeupSlots(group, false);
 			unlockResGroupForDrop(group);
+			if (!isCommit)
+				groupOpenParking(group);
 		}
 
 		if (isCommit)
@@ -865,6 +919,10 @@ ResGroupAlterOnCommit(const ResourceGroupCallbackContext *callbackCtx)
 		savedInterruptHoldoffCount = InterruptHoldoffCount;
 		group = groupHashFind(callbackCtx->groupid, true);
 
+		/* The slots got with the old caps must not be reused */
+		if (Gp_role == GP_ROLE_DISPATCH)
+			groupCloseParking(group, true);
+
 		group->caps = callbackCtx->caps;
 
 		if (callbackCtx->limittype == RESGROUP_LIMIT_TYPE_CPU)
@@ -909,6 +967,9 @@ ResGroupAlterOnCommit(const ResourceGroupCallbackContext *callbackCtx)
 							MaxCpuSetLength);
 			ResGroupOps_SetCpuSet(DEFAULT_CPUSET_GROUP_ID, defaultCpusetGroup);
 		}
+
+		if (Gp_role == GP_ROLE_DISPATCH)
+			groupOpenParking(group);
 	}
 	PG_CATCH();
 	{
@@ -996,7 +1057,8 @@ ResGroupGetStat(Oid groupId, ResGroupStatType type)
 	switch (type)
 	{
 		case RES_GROUP_STAT_NRUNNING:
-			result = Int32GetDatum(group->nRunning + group->nRunningBypassed);
+			result = Int32GetDatum(group->nRunning - group->nParked +
+								   group->nRunningBypassed);
 			break;
 		case RES_GROUP_STAT_NQUEUEING:
 			result = Int32GetDatum(group->waitProcs.size);
@@ -1189,6 +1251,75 @@ ResGroupReserveMemory(int32 memoryChunks, int32 overuseChunks, bool *waiverUsed)
 	return true;
 }
 
+/*
+ * Lend shared memory of the group to an operator that is about to spill.
+ *
+ * Hash joins, hash aggregates and sorts size themselves for the operator
+ * memory given by memory_spill_ratio.  When they run out of it, they call
+ * this before writing anything to workfiles, and may keep going in memory
+ * for as many more bytes as we lend them.
+ *
+ * At most half of the free shared memory of the group is handed out at a
+ * time, so that the other operators can still borrow some.
+ *
+ * What is lent must be given back with ResGroupReturnSpillMemory(); it is
+ * taken back anyway when the process leaves the group.
+ *
+ * Return the number of bytes lent, 0 if the group has nothing to spare.
+ */
+int64
+ResGroupBorrowSpillMemory(int64 bytes)
+{
+	ResGroupData	*group = self->group;
+	int32			chunks;
+	int32			lent;
+
+	if (!gp_resgroup_borrow_shared_memory || bytes <= 0)
+		return 0;
+
+	if (!IsResGroupActivated() || bypassedGroup || !selfIsAssigned())
+		return 0;
+
+	/* Only the vmtracker auditor accounts for the shared memory */
+	if (group->caps.memAuditor != RESGROUP_MEMORY_AUDITOR_VMTRACKER)
+		return 0;
+
+	chunks = Max(VmemTracker_ConvertVmemBytesToChunks(bytes), 1);
+
+	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+	lent = groupLendMemory(group, self->slot, chunks);
+	LWLockRelease(ResGroupLock);
+
+	if (lent == 0)
+		return 0;
+
+	self->memLent += lent;
+
+	return VmemTracker_ConvertVmemChunksToBytes(lent);
+}
+
+/*
+ * Give back memory lent by ResGroupBorrowSpillMemory().
+ */
+void
+ResGroupReturnSpillMemory(int64 bytes)
+{
+	int32		chunks;
+
+	if (bytes <= 0 || self->memLent == 0)
+		return;
+
+	Assert(selfIsAssigned());
+
+	chunks = Min(VmemTracker_ConvertVmemBytesToChunks(bytes), self->memLent);
+
+	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+	groupTakeBackMemory(self->group, self->slot, chunks);
+	LWLockRelease(ResGroupLock);
+
+	self->memLent -= chunks;
+}
+
 /*
  * Release the memory of resource group
  */
@@ -1307,10 +1438,17 @@ createGroup(Oid groupId, const ResGroupCaps *caps)
 	group->memGap = 0;
 	group->memUsage = 0;
 	group->memSharedUsage = 0;
+	group->memSharedLent = 0;
 	group->memQuotaUsed = 0;
 	group->groupMemOps = NULL;
 	memset(&group->totalQueuedTime, 0, sizeof(group->totalQueuedTime));
 	group->lockedForDrop = false;
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	pg_atomic_init_u64(&group->parkedSlots, PARKED_MAKE(0, 0, false));
+#endif
+	group->parkEpoch = 0;
+	group->nParked = 0;
+	group->memQuotaParked = 0;
 
 	group->memQuotaGranted = 0;
 	group->memSharedGranted = 0;
@@ -1439,6 +1577,76 @@ groupDecMemUsage(ResGroupData *group, ResGroupSlotData *slot, int32 chunks)
 	return 0;
 }
 
+/*
+ * Lend up to chunks of the group's shared memory to an operator of a slot.
+ *
+ * The lent memory is charged to memSharedUsage, and added to the quota of
+ * the slot, so it is counted once when the operator goes on to use it.
+ * What the slot already used beyond its quota is charged to memSharedUsage
+ * already, and is now covered by the larger quota instead.
+ *
+ * The caller must hold ResGroupLock.  Return the number of chunks lent.
+ */
+static int32
+groupLendMemory(ResGroupData *group, ResGroupSlotData *slot, int32 chunks)
+{
+	int32		available;
+	int32		overused;
+	int32		lent;
+
+	available = group->memSharedGranted - group->memSharedUsage;
+	lent = Min(chunks, available / 2);
+	if (lent <= 0)
+		return 0;
+
+	overused = Max(0, slot->memUsage - slot->memQuota);
+
+	slot->memQuota += lent;
+	pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->memSharedUsage,
+							lent - Min(lent, overused));
+	group->memSharedLent += lent;
+
+	LOG_RESGROUP_DEBUG(LOG, "lend %d chunks to an operator of group %u, %d chunks lent in total",
+					   lent, group->groupId, group->memSharedLent);
+
+	return lent;
+}
+
+/*
+ * Take back chunks lent by groupLendMemory().
+ *
+ * The part of them the slot still uses is now beyond its quota, and stays
+ * charged to memSharedUsage; the rest is released, to the global shared
+ * memory first if the group has overused its own.
+ *
+ * The caller must hold ResGroupLock.
+ */
+static void
+groupTakeBackMemory(ResGroupData *group, ResGroupSlotData *slot, int32 chunks)
+{
+	int32		overused;
+	int32		released;
+	int32		oldSharedUsage;
+
+	Assert(chunks <= group->memSharedLent);
+
+	slot->memQuota -= chunks;
+	group->memSharedLent -= chunks;
+
+	overused = Max(0, slot->memUsage - slot->memQuota);
+	released = chunks - Min(chunks, overused);
+	if (released == 0)
+		return;
+
+	oldSharedUsage = pg_atomic_fetch_sub_u32((pg_atomic_uint32 *) &group->memSharedUsage,
+											 released);
+	Assert(oldSharedUsage >= released);
+
+	pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &pResGroupControl->freeChunks,
+							Min(Max(0, oldSharedUsage - group->memSharedGranted),
+								released));
+}
+
 /*
  * Attach a process (QD or QE) to a slot.
  */
@@ -1457,6 +1665,8 @@ selfAttachResGroup(ResGroupData *group, ResGroupSlotData *slot)
 static void
 selfDetachResGroup(ResGroupData *group, ResGroupSlotData *slot)
 {
+	Assert(self->memLent == 0);
+
 	groupDecMemUsage(group, slot, self->memUsage);
 	pg_atomic_sub_fetch_u32((pg_atomic_uint32*) &slot->nProcs, 1);
 	selfUnsetSlot();
@@ -1477,6 +1687,8 @@ initSlot(ResGroupSlotData *slot, ResGroupData *group, int32 slotMemQuota)
 	slot->caps = group->caps;
 	slot->memQuota = slotMemQuota;
 	slot->memUsage = 0;
+	slot->parkedNext = 0;
+	slot->parkEpoch = group->parkEpoch;
 }
 
 /*
@@ -1631,6 +1843,193 @@ groupPutSlot(ResGroupData *group, ResGroupSlotData *slot)
 	 */
 }
 
+/*
+ * Park a slot released by the QD, without holding ResGroupLock.
+ *
+ * A parked slot keeps its place in nRunning and its memory quota, so the
+ * next transaction of the group can take it over with groupUnparkSlot()
+ * without going through the lock.  Parking is closed as soon as someone
+ * has to wait for a slot, or the caps of the group change, and the
+ * releasing transactions then take the slow path through groupReleaseSlot()
+ * that wakes up the waiters.
+ *
+ * Return true if the slot is parked, false if it must be put back for real.
+ */
+static bool
+groupParkSlot(ResGroupData *group, ResGroupSlotData *slot)
+{
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	uint64		oldval;
+	uint64		newval;
+	int32		memQuota = slot->memQuota;
+
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+	Assert(slot->groupId == group->groupId);
+
+	if (!gp_resource_group_fast_admission)
+		return false;
+
+	/* Somebody is still attached to the slot */
+	if (slot->nProcs != 0 || slot->memUsage != 0)
+		return false;
+
+	/*
+	 * Count the slot as parked before it really is, so that the statistics
+	 * never see more running transactions than there are.
+	 */
+	pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->nParked, 1);
+	pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->memQuotaParked,
+							memQuota);
+
+	oldval = pg_atomic_read_u64(&group->parkedSlots);
+	/* Pairs with the barrier of the CAS in groupCloseParking() */
+	pg_read_barrier();
+
+	for (;;)
+	{
+		/* A slot got before the caps changed must not be reused */
+		if ((oldval & PARKED_CLOSED) ||
+			slot->parkEpoch != group->parkEpoch)
+			break;
+
+		slot->parkedNext = PARKED_HEAD(oldval);
+		newval = PARKED_MAKE(slotGetId(slot) + 1, PARKED_TAG(oldval) + 1,
+							 false);
+
+		if (pg_atomic_compare_exchange_u64(&group->parkedSlots,
+										   &oldval, newval))
+			return true;
+	}
+
+	slot->parkedNext = 0;
+	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->nParked, 1);
+	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->memQuotaParked,
+							memQuota);
+#endif /* PG_HAVE_ATOMIC_U64_SUPPORT */
+
+	return false;
+}
+
+/*
+ * Take over a parked slot of the group, without holding ResGroupLock.
+ *
+ * Return NULL if there is none, or parking is closed.
+ */
+static ResGroupSlotData *
+groupUnparkSlot(ResGroupData *group)
+{
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	ResGroupSlotData *slot;
+	uint64		oldval;
+	uint64		newval;
+
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+
+	oldval = pg_atomic_read_u64(&group->parkedSlots);
+	/* Pairs with the barrier of the CAS in groupParkSlot() */
+	pg_read_barrier();
+
+	for (;;)
+	{
+		if ((oldval & PARKED_CLOSED) || PARKED_HEAD(oldval) == 0)
+			return NULL;
+
+		/*
+		 * The slot might be taken and parked again by others at any time,
+		 * but then the tag changes and the CAS fails.
+		 */
+		slot = &pResGroupControl->slots[PARKED_HEAD(oldval) - 1];
+		newval = PARKED_MAKE(slot->parkedNext, PARKED_TAG(oldval) + 1, false);
+
+		if (pg_atomic_compare_exchange_u64(&group->parkedSlots,
+										   &oldval, newval))
+			break;
+	}
+
+	slot->parkedNext = 0;
+	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->nParked, 1);
+	pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->memQuotaParked,
+							slot->memQuota);
+
+	return slot;
+#else
+	return NULL;
+#endif /* PG_HAVE_ATOMIC_U64_SUPPORT */
+}
+
+/*
+ * Close parking and put back all the parked slots of the group.
+ *
+ * With invalidate, the slots that are in use now will not be parked
+ * anymore either, this is for when the caps of the group change.
+ */
+static void
+groupCloseParking(ResGroupData *group, bool invalidate)
+{
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	uint64		oldval;
+	int			slotId;
+
+	Assert(LWLockHeldExclusiveByMe(ResGroupLock));
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+
+	/* Must be visible before parking is opened again */
+	if (invalidate)
+		group->parkEpoch++;
+
+	oldval = pg_atomic_read_u64(&group->parkedSlots);
+	while (!(oldval & PARKED_CLOSED))
+	{
+		if (pg_atomic_compare_exchange_u64(&group->parkedSlots, &oldval,
+										   PARKED_MAKE(0, PARKED_TAG(oldval) + 1,
+													   true)))
+			break;
+	}
+
+	if (oldval & PARKED_CLOSED)
+		return;
+
+	/* Nobody else can reach the parked slots now */
+	for (slotId = PARKED_HEAD(oldval) - 1; slotId >= 0; )
+	{
+		ResGroupSlotData *slot = &pResGroupControl->slots[slotId];
+
+		slotId = slot->parkedNext - 1;
+		slot->parkedNext = 0;
+
+		pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->nParked, 1);
+		pg_atomic_sub_fetch_u32((pg_atomic_uint32 *) &group->memQuotaParked,
+								slot->memQuota);
+
+		groupPutSlot(group, slot);
+	}
+#endif /* PG_HAVE_ATOMIC_U64_SUPPORT */
+}
+
+/*
+ * Open parking again, unless someone is waiting for a slot, or the group
+ * is being dropped.
+ */
+static void
+groupOpenParking(ResGroupData *group)
+{
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	uint64		oldval;
+
+	Assert(LWLockHeldExclusiveByMe(ResGroupLock));
+	Assert(Gp_role == GP_ROLE_DISPATCH);
+
+	if (group->lockedForDrop || !groupWaitQueueIsEmpty(group))
+		return;
+
+	/* Only the lock holder changes a closed word */
+	oldval = pg_atomic_read_u64(&group->parkedSlots);
+	if (oldval & PARKED_CLOSED)
+		pg_atomic_write_u64(&group->parkedSlots,
+							PARKED_MAKE(0, PARKED_TAG(oldval) + 1, false));
+#endif /* PG_HAVE_ATOMIC_U64_SUPPORT */
+}
+
 /*
  * Reserve memory quota for a slot in group.
  *
@@ -1787,6 +2186,30 @@ groupAcquireSlot(ResGroupInfo *pGroupInfo)
 	Assert(!selfIsAssigned());
 	group = pGroupInfo->group;
 
+	/* try to take over a parked slot without the lock */
+	slot = groupUnparkSlot(group);
+	if (slot != NULL)
+	{
+		if (slot->groupId == pGroupInfo->groupId)
+		{
+			pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->totalExecuted, 1);
+			pgstat_report_resgroup(0, group->groupId);
+			return slot;
+		}
+
+		/*
+		 * Our group was dropped and another one took its place in the
+		 * meantime, give the slot back to that one.
+		 */
+		if (!groupParkSlot(group, slot))
+		{
+			LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+			groupReleaseSlot(group, slot);
+			LWLockRelease(ResGroupLock);
+		}
+		return NULL;
+	}
+
 	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
 
 	/* Has the group been dropped? */
@@ -1802,11 +2225,23 @@ groupAcquireSlot(ResGroupInfo *pGroupInfo)
 		/* try to get a slot directly */
 		slot = groupGetSlot(group);
 
+		if (slot == NULL)
+		{
+			/*
+			 * Some of the slots might only be parked, put them back and
+			 * try again.  Parking stays closed while we wait, so that the
+			 * releasing transactions take the way that wakes us up.
+			 */
+			groupCloseParking(group, false);
+			slot = groupGetSlot(group);
+		}
+
 		if (slot != NULL)
 		{
 			/* got one, lucky */
-			group->totalExecuted++;
+			groupOpenParking(group);
 			LWLockRelease(ResGroupLock);
+			pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->totalExecuted, 1);
 			pgstat_report_resgroup(0, group->groupId);
 			return slot;
 		}
@@ -1838,8 +2273,8 @@ groupAcquireSlot(ResGroupInfo *pGroupInfo)
 	MyProc->resSlot = NULL;
 	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
 	addTotalQueueDuration(group);
-	group->totalExecuted++;
 	LWLockRelease(ResGroupLock);
+	pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->totalExecuted, 1);
 
 	pgstat_report_resgroup(0, group->groupId);
 	return slot;
@@ -2329,6 +2764,9 @@ groupReleaseSlot(ResGroupData *group, ResGroupSlotData *slot)
 	 * configuration were changed during our execution.
 	 */
 	wakeupSlots(group, true);
+
+	/* Parking can go on if nobody is left waiting */
+	groupOpenParking(group);
 }
 
 /*
@@ -2495,7 +2933,7 @@ AssignResGroupOnMaster(void)
 		bypassedGroup = groupInfo.group;
 
 		/* Update pg_stat_activity statistics */
-		bypassedGroup->totalExecuted++;
+		pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &bypassedGroup->totalExecuted, 1);
 		pgstat_report_resgroup(0, bypassedGroup->groupId);
 
 		/* Initialize the fake slot */
@@ -2584,19 +3022,47 @@ UnassignResGroup(void)
 	if (self->memUsage > 10)
 		LOG_RESGROUP_DEBUG(LOG, "idle proc memory usage: %d", self->memUsage);
 
-	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
-
-	/* Sub proc memory accounting info from group and slot */
-	selfDetachResGroup(group, slot);
-
 	if (Gp_role == GP_ROLE_DISPATCH)
 	{
-		/* Release the slot */
-		groupReleaseSlot(group, slot);
+		/* Take back what our operators forgot to return */
+		if (self->memLent > 0)
+		{
+			LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+			groupTakeBackMemory(group, slot, self->memLent);
+			LWLockRelease(ResGroupLock);
+			self->memLent = 0;
+		}
+
+		/* Sub proc memory accounting info from group and slot */
+		selfDetachResGroup(group, slot);
 
 		sessionResetSlot();
+
+		/* Park the slot for the next transaction, or release it */
+		if (!groupParkSlot(group, slot))
+		{
+			LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+			groupReleaseSlot(group, slot);
+			LWLockRelease(ResGroupLock);
+		}
+
+		pgstat_report_resgroup(0, InvalidOid);
+		return;
 	}
-	else if (slot->nProcs == 0)
+
+	LWLockAcquire(ResGroupLock, LW_EXCLUSIVE);
+
+	/* Take back what our operators forgot to return */
+	if (self->memLent > 0)
+	{
+		groupTakeBackMemory(group, slot, self->memLent);
+		self->memLent = 0;
+	}
+
+	/* Sub proc memory accounting info from group and slot */
+	selfDetachResGroup(group, slot);
+
+	if (slot->nProcs == 0)
 	{
 		int32 released;
 
@@ -2949,7 +3415,7 @@ groupWaitCancel(void)
 		groupReleaseSlot(group, slot);
 		Assert(sessionGetSlot() == NULL);
 
-		group->totalExecuted++;
+		pg_atomic_add_fetch_u32((pg_atomic_uint32 *) &group->totalExecuted, 1);
 
 		addTotalQueueDuration(group);
 	}
@@ -3545,6 +4011,7 @@ resgroupDumpGroup(StringInfo str, ResGroupData *group)
 	appendStringInfo(str, "\"group_id\":%u,", group->groupId);
 	appendStringInfo(str, "\"nRunning\":%d,", group->nRunning);
 	appendStringInfo(str, "\"nRunningBypassed\":%d,", group->nRunningBypassed);
+	appendStringInfo(str, "\"nParked\":%d,", group->nParked);
 	appendStringInfo(str, "\"locked_for_drop\":%d,", group->lockedForDrop);
 	appendStringInfo(str, "\"memExpected\":%d,", group->memExpected);
 	appendStringInfo(str, "\"memQuotaGranted\":%d,", group->memQuotaGranted);
@@ -3552,6 +4019,7 @@ resgroupDumpGroup(StringInfo str, ResGroupData *group)
 	appendStringInfo(str, "\"memQuotaUsed\":%d,", group->memQuotaUsed);
 	appendStringInfo(str, "\"memUsage\":%d,", group->memUsage);
 	appendStringInfo(str, "\"memSharedUsage\":%d,", group->memSharedUsage);
+	appendStringInfo(str, "\"memSharedLent\":%d,", group->memSharedLent);
 
 	resgroupDumpWaitQueue(str, &group->waitProcs);
 	resgroupDumpCaps(str, (ResGroupCap*)(&group->caps));
@@ -3757,10 +4225,12 @@ groupMemOnDumpForVmtracker(ResGroupData *group, StringInfo str)
 			VmemTracker_ConvertVmemChunksToMB(
 				group->memQuotaGranted + group->memSharedGranted - group->memUsage));
 	appendStringInfo(str, "\"quota_used\":%d, ",
-			VmemTracker_ConvertVmemChunksToMB(group->memQuotaUsed));
+			VmemTracker_ConvertVmemChunksToMB(
+				group->memQuotaUsed - group->memQuotaParked));
 	appendStringInfo(str, "\"quota_available\":%d, ",
 			VmemTracker_ConvertVmemChunksToMB(
-				group->memQuotaGranted - group->memQuotaUsed));
+				group->memQuotaGranted - group->memQuotaUsed +
+				group->memQuotaParked));
 	appendStringInfo(str, "\"quota_granted\":%d, ",
 			VmemTracker_ConvertVmemChunksToMB(group->memQuotaGranted));
 	appendStringInfo(str, "\"quota_proposed\":%d, ",
@@ -280,6 +280,166 @@ test_CpusetOperation(void **state)
 	//assert_string_equal(cpuset, "0");
 }
 
+void
+test__groupParkSlot_and_groupUnparkSlot(void **state)
+{
+#ifdef PG_HAVE_ATOMIC_U64_SUPPORT
+	ResGroupControl control;
+	ResGroupSlotData slots[3];
+	ResGroupData group;
+	int i;
+
+	MemSet(&control, 0, sizeof(control));
+	MemSet(slots, 0, sizeof(slots));
+	MemSet(&group, 0, sizeof(group));
+
+	control.slots = slots;
+	pResGroupControl = &control;
+	Gp_role = GP_ROLE_DISPATCH;
+
+	group.groupId = 1;
+	pg_atomic_init_u64(&group.parkedSlots, PARKED_MAKE(0, 0, false));
+	for (i = 0; i < 3; i++)
+	{
+		slots[i].groupId = 1;
+		slots[i].memQuota = 10;
+	}
+
+	assert_true(groupUnparkSlot(&group) == NULL);
+
+	/* the parked slots are taken over last in, first out */
+	assert_true(groupParkSlot(&group, &slots[0]));
+	assert_true(groupParkSlot(&group, &slots[2]));
+	assert_int_equal(group.nParked, 2);
+	assert_int_equal(group.memQuotaParked, 20);
+
+	assert_true(groupUnparkSlot(&group) == &slots[2]);
+	assert_true(groupUnparkSlot(&group) == &slots[0]);
+	assert_true(groupUnparkSlot(&group) == NULL);
+	assert_int_equal(group.nParked, 0);
+	assert_int_equal(group.memQuotaParked, 0);
+
+	/* a slot got before the caps changed is not parked */
+	group.parkEpoch++;
+	assert_false(groupParkSlot(&group, &slots[1]));
+
+	/* neither is a slot that is still in use */
+	slots[1].parkEpoch = group.parkEpoch;
+	slots[1].nProcs = 1;
+	assert_false(groupParkSlot(&group, &slots[1]));
+	slots[1].nProcs = 0;
+
+	/* and nothing is parked or taken over while parking is closed */
+	assert_true(groupParkSlot(&group, &slots[1]));
+	pg_atomic_write_u64(&group.parkedSlots,
+						PARKED_MAKE(PARKED_HEAD(pg_atomic_read_u64(&group.parkedSlots)),
+									1, true));
+	assert_false(groupParkSlot(&group, &slots[0]));
+	assert_true(groupUnparkSlot(&group) == NULL);
+	assert_int_equal(group.nParked, 1);
+
+	pResGroupControl = NULL;
+#endif /* PG_HAVE_ATOMIC_U64_SUPPORT */
+}
+
+void
+test__groupLendMemory_and_groupTakeBackMemory(void **state)
+{
+	ResGroupControl control;
+	ResGroupSlotData slot;
+	ResGroupData group;
+
+	MemSet(&control, 0, sizeof(control));
+	MemSet(&slot, 0, sizeof(slot));
+	MemSet(&group, 0, sizeof(group));
+
+	control.freeChunks = 50;
+	pResGroupControl = &control;
+
+	group.groupId = 1;
+	group.memSharedGranted = 100;
+	group.memSharedUsage = 20;
+	slot.memQuota = 10;
+	slot.memUsage = 10;
+
+	/* at most half of the free shared memory is lent at a time */
+	assert_int_equal(groupLendMemory(&group, &slot, 64), 40);
+	assert_int_equal(group.memSharedUsage, 60);
+	assert_int_equal(group.memSharedLent, 40);
+	assert_int_equal(slot.memQuota, 50);
+	assert_int_equal(groupLendMemory(&group, &slot, 64), 20);
+	assert_int_equal(group.memSharedUsage, 80);
+	assert_int_equal(slot.memQuota, 70);
+
+	/* the lent memory the slot goes on to use is not charged again */
+	groupIncMemUsage(&group, &slot, 30);
+	assert_int_equal(group.memSharedUsage, 80);
+	assert_int_equal(slot.memUsage, 40);
+
+	/* what the slot still uses stays charged when it is taken back */
+	groupTakeBackMemory(&group, &slot, 60);
+	assert_int_equal(group.memSharedLent, 0);
+	assert_int_equal(slot.memQuota, 10);
+	assert_int_equal(group.memSharedUsage, 50);
+	assert_int_equal(control.freeChunks, 50);
+
+	/* what the slot overused before is covered by the lent memory */
+	assert_int_equal(groupLendMemory(&group, &slot, 20), 20);
+	assert_int_equal(group.memSharedUsage, 50);
+	assert_int_equal(slot.memQuota, 30);
+
+	/* the global shared memory the group overused is released first */
+	groupDecMemUsage(&group, &slot, 30);
+	group.memSharedUsage = 110;
+	groupTakeBackMemory(&group, &slot, 20);
+	assert_int_equal(group.memSharedUsage, 90);
+	assert_int_equal(control.freeChunks, 60);
+
+	/* nothing is lent when the group has no free shared memory */
+	group.memSharedUsage = group.memSharedGranted;
+	assert_int_equal(groupLendMemory(&group, &slot, 64), 0);
+	assert_int_equal(group.memSharedLent, 0);
+
+	pResGroupControl = NULL;
+}
+
+void
+test__ResGroupBorrowSpillMemory_with_cgroup_auditor(void **state)
+{
+	ResGroupControl control;
+	ResGroupSlotData slot;
+	ResGroupData group;
+
+	MemSet(&control, 0, sizeof(control));
+	MemSet(&slot, 0, sizeof(slot));
+	MemSet(&group, 0, sizeof(group));
+
+	control.chunkSizeInBits = BITS_IN_MB;
+	pResGroupControl = &control;
+	Gp_resource_manager_policy = RESOURCE_MANAGER_POLICY_GROUP;
+	ResGroupActivated = true;
+
+	group.groupId = 1;
+	group.caps.memAuditor = RESGROUP_MEMORY_AUDITOR_CGROUP;
+	group.memSharedGranted = 100;
+
+	self->groupId = 1;
+	self->group = &group;
+	self->slot = &slot;
+
+	/* groups with the cgroup memory auditor don't lend */
+	assert_int_equal(ResGroupBorrowSpillMemory(VmemTracker_ConvertVmemChunksToBytes(1)), 0);
+	assert_int_equal(group.memSharedUsage, 0);
+	assert_int_equal(self->memLent, 0);
+
+	self->groupId = InvalidOid;
+	self->group = NULL;
+	self->slot = NULL;
+	ResGroupActivated = false;
+	Gp_resource_manager_policy = RESOURCE_MANAGER_POLICY_QUEUE;
+	pResGroupControl = NULL;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -294,6 +454,9 @@ main(int argc, char *argv[])
 			unit_test(test__CpusetToBitset_abnormal_case),
 			unit_test(test_BitsetToCpuset),
 			unit_test(test_CpusetOperation),
+			unit_test(test__groupParkSlot_and_groupUnparkSlot),
+			unit_test(test__groupLendMemory_and_groupTakeBackMemory),
+			unit_test(test__ResGroupBorrowSpillMemory_with_cgroup_auditor),
 	};
 
 	MemoryContextInit();
@@ -113,11 +113,14 @@
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "utils/datum.h"
+#include "utils/date.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/resgroup.h"
 #include "utils/syscache.h"
+#include "utils/timestamp.h"
 #include "utils/tuplesort.h"
 #include "utils/pg_locale.h"
 #include "utils/builtins.h"
@@ -212,6 +215,8 @@ struct Tuplesortstate_mk
 	bool		randomAccess;	/* did caller request random access? */
 
 	int64		memAllowed;
+	int64		memBorrowed;	/* part of memAllowed lent by the resource
+								 * group, see borrow_sort_memory() */
 
 	int			maxTapes;		/* number of tapes (Knuth's T) */
 	int			tapeRange;		/* maxTapes-1 (Knuth's P) */
@@ -506,6 +511,8 @@ static void readtup_datum(Tuplesortstate_mk *state, TuplesortPos_mk *pos, MKEntr
 
 static void tupsort_prepare_char(MKEntry *a, bool isChar);
 static int	tupsort_compare_char(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *mkContext);
+static void tupsort_prepare_text_abbrev(MKEntry *a);
+static int	tupsort_compare_text_abbrev(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *mkContext);
 
 static Datum tupsort_fetch_datum_mtup(MKEntry *a, MKContext *mkctxt, MKLvContext *lvctxt, bool *isNullOut);
 static Datum tupsort_fetch_datum_itup(MKEntry *a, MKContext *mkctxt, MKLvContext *lvctxt, bool *isNullOut);
@@ -583,6 +590,7 @@ tuplesort_begin_common(ScanState *ss, int workMem, bool randomAccess, bool alloc
 	state->mkctxt.bounded = false;
 	state->mkctxt.boundUsed = false;
 	state->memAllowed = workMem * 1024L;
+	state->memBorrowed = 0;
 
 	state->work_set = NULL;
 	state->ss = ss;
@@ -739,8 +747,33 @@ create_mksort_context(MKContext *mkctxt,
 			sinfo->typByVal = tupdesc->attrs[sinfo->attno - 1]->attbyval;
 			sinfo->typLen = tupdesc->attrs[sinfo->attno - 1]->attlen;
 
-			if (sinfo->scanKey.sk_func.fn_addr == btint4cmp)
+			if (sinfo->scanKey.sk_func.fn_addr == btint4cmp ||
+				sinfo->scanKey.sk_func.fn_addr == btint2cmp ||
+				sinfo->scanKey.sk_func.fn_addr == date_cmp)
 				sinfo->lvtype = MKLV_TYPE_INT32;
+			else if (sinfo->scanKey.sk_func.fn_addr == btint8cmp
+#ifdef HAVE_INT64_TIMESTAMP
+					 || sinfo->scanKey.sk_func.fn_addr == timestamp_cmp
+#endif
+				)
+				sinfo->lvtype = MKLV_TYPE_INT64;
+
+#if SIZEOF_DATUM == 8
+
+			/*
+			 * In C collation, text compares byte by byte, so the first 8
+			 * bytes packed into a Datum compare the same way the strings
+			 * do, and settle most comparisons without detoasting anything.
+			 * The entries hold that prefix instead of the datum, so they
+			 * are copied around by value.
+			 */
+			if (sinfo->scanKey.sk_func.fn_addr == bttextcmp &&
+				lc_collate_is_c(sinfo->scanKey.sk_collation))
+			{
+				sinfo->lvtype = MKLV_TYPE_TEXT_ABBREV;
+				sinfo->typByVal = true;
+			}
+#endif
 
 			/* GPDB_91_MERGE_FIXME: these MKLV_TYPE_CHAR and MKLV_TYPE_TEXT
 			 * fastpaths only work with the default collation of the database.
@@ -1061,6 +1094,8 @@ tuplesort_end_mk(Tuplesortstate_mk *state)
 
 	TRACE_POSTGRESQL_TUPLESORT_END(state->tapeset ? 1 : 0, spaceUsed);
 
+	ResGroupReturnSpillMemory(state->memBorrowed);
+
 	/*
 	 * Free the per-sort memory context, thereby releasing all working memory,
 	 * including the Tuplesortstate_mk struct itself.
@@ -1277,6 +1312,28 @@ grow_unsorted_array(Tuplesortstate_mk *state)
 	return true;
 }
 
+/*
+ * borrow_sort_memory
+ *	 Ask the resource group for as much memory again as we are allowed, to
+ *	 keep sorting in memory instead of switching to tapes.
+ *
+ * Returns true if we got any.
+ */
+static bool
+borrow_sort_memory(Tuplesortstate_mk *state)
+{
+	int64		borrowed;
+
+	borrowed = ResGroupBorrowSpillMemory(state->memAllowed);
+	if (borrowed == 0)
+		return false;
+
+	state->memAllowed += borrowed;
+	state->memBorrowed += borrowed;
+
+	return true;
+}
+
 
 /*
  * Shared code for tuple and datum cases.
@@ -1303,6 +1360,10 @@ puttuple_common(Tuplesortstate_mk *state, MKEntry *e)
 			if (!state->mkheap && state->entry_count >= state->entry_allocsize - 1)
 			{
 				growSucceed = grow_unsorted_array(state);
+
+				/* Out of memory, see if the resource group can spare some */
+				if (!growSucceed && borrow_sort_memory(state))
+					growSucceed = grow_unsorted_array(state);
 			}
 
 			/* full sort? */
@@ -1381,7 +1442,8 @@ tuplesort_performsort_mk(Tuplesortstate_mk *state)
 			 * amount of memory.  Just qsort 'em and we're done.
 			 */
 			if (!state->mkctxt.bounded)
-				mk_qsort(state->entries, state->entry_count, &state->mkctxt);
+				mk_qsort_parallel(state->entries, state->entry_count, &state->mkctxt,
+								  gp_mk_sort_threads);
 			else
 				tuplesort_limit_sort(state);
 
@@ -3160,6 +3222,16 @@ tupsort_compare_datum(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *
 
 				return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
 			}
+		case MKLV_TYPE_INT64:
+			{
+				int64		i1 = DatumGetInt64(v1->d);
+				int64		i2 = DatumGetInt64(v2->d);
+				int			result = (i1 < i2) ? -1 : ((i1 == i2) ? 0 : 1);
+
+				return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
+			}
+		case MKLV_TYPE_TEXT_ABBREV:
+			return tupsort_compare_text_abbrev(v1, v2, lvctxt, context);
 		default:
 			return tupsort_compare_char(v1, v2, lvctxt, context);
 	}
@@ -3205,6 +3277,47 @@ tupsort_cpfr(MKEntry *dst, MKEntry *src, MKLvContext *lvctxt)
 	}
 }
 
+/*
+ * Compare two text values in C collation by their abbreviated keys, and
+ * only if those are equal, by the values themselves.
+ */
+static int
+tupsort_compare_text_abbrev(MKEntry *v1, MKEntry *v2, MKLvContext *lvctxt, MKContext *mkContext)
+{
+	Datum		p1Original,
+				p2Original;
+	bool		p1IsNull,
+				p2IsNull;
+	int			result;
+
+	Assert(mkContext->fetchForPrep);
+
+	if (v1->d != v2->d)
+	{
+		result = (v1->d < v2->d) ? -1 : 1;
+		return ((lvctxt->scanKey.sk_flags & SK_BT_DESC) != 0) ? -result : result;
+	}
+
+	/*
+	 * Text cannot contain zero bytes, so if the last byte of the key is
+	 * zero, the strings are shorter than the key, and they are equal.
+	 */
+	if ((v1->d & 0xFF) == 0)
+		return 0;
+
+	p1Original = (mkContext->fetchForPrep) (v1, mkContext, lvctxt, &p1IsNull);
+	p2Original = (mkContext->fetchForPrep) (v2, mkContext, lvctxt, &p2IsNull);
+
+	Assert(!p1IsNull);
+	Assert(!p2IsNull);
+
+	return inlineApplySortFunction(&lvctxt->scanKey.sk_func,
+								   lvctxt->scanKey.sk_flags,
+								   lvctxt->scanKey.sk_collation,
+								   p1Original, false,
+								   p2Original, false);
+}
+
 static void
 tupsort_refcnt(void *vp, int ref)
 {
@@ -3387,6 +3500,35 @@ tupsort_prepare(MKEntry *a, MKContext *mkctxt, int lv)
 		tupsort_prepare_char(a, true);
 	else if (lvctxt->lvtype == MKLV_TYPE_TEXT)
 		tupsort_prepare_char(a, false);
+	else if (lvctxt->lvtype == MKLV_TYPE_TEXT_ABBREV)
+		tupsort_prepare_text_abbrev(a);
+}
+
+/*
+ * Replace the text datum of an entry with its abbreviated key: the first 8
+ * bytes of the string, most significant first, padded with zeros.
+ */
+static void
+tupsort_prepare_text_abbrev(MKEntry *a)
+{
+	char	   *p;
+	void	   *tofree = NULL;
+	int			len;
+	int			i;
+	uint64		key = 0;
+
+	if (mke_is_null(a))
+		return;
+
+	varattrib_untoast_ptr_len(a->d, &p, &len, &tofree);
+
+	for (i = 0; i < len && i < sizeof(key); i++)
+		key |= ((uint64) (unsigned char) p[i]) << (8 * (sizeof(key) - 1 - i));
+
+	if (tofree)
+		pfree(tofree);
+
+	a->d = (Datum) key;
 }
 
 /* "True" length (not counting trailing blanks) of a BpChar */
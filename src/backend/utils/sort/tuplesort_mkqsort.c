@@ -20,16 +20,23 @@
 
 #include "postgres.h"
 #include "access/genam.h"
+#include "access/nbtree.h"
+#include "utils/faultinjector.h"
 #include "utils/tuplesort.h"
 #include "utils/tuplesort_mk.h"
 #include "utils/tuplesort_mk_details.h"
 
 #include "miscadmin.h"
 
+#include <limits.h>
+#include <pthread.h>
+
 #ifdef MKQSORT_VERIFY 
 extern void mkqsort_verify(MKEntry *a, int l, int r, MKContext *mkctxt);
 #endif
 
+static void mk_qsort_rec(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull, bool inWorker);
+
 /**
  * Given an array, swap the entries at a[i] and a[j]
  */
@@ -261,7 +268,171 @@ static void mk_qsort_part3(MKEntry *a, int left, int right, int lv, MKContext *m
 	*firstInHighOut = rightIndex;
 }
 
+/*
+ * Radix pass for integer levels.
+ *
+ * Before quick sorting a large range on an integer key, we split it into
+ * buckets by the key's bytes, most significant first, moving the entries
+ * into place without any extra memory (an "American flag" sort).  Only the
+ * buckets still holding many entries are split further, and every bucket
+ * ends up being handed to mk_qsort_impl, which orders what is left and takes
+ * care of equal keys and the deeper levels, exactly as it would have for the
+ * whole range.  Bytes that are the same for all entries cost a counting
+ * pass, but no moves.
+ */
+#define MKQS_RADIX_MIN_ENTRIES 1024
+
+/*
+ * The key of an entry as an unsigned number that sorts in the order we
+ * want, most significant byte first.
+ */
+static inline uint64 mkqs_radix_key(MKEntry *e, MKLvContext *lvctxt)
+{
+	uint64 key;
+
+	if (lvctxt->lvtype == MKLV_TYPE_INT32)
+		key = ((uint64) ((uint32) DatumGetInt32(e->d) ^ 0x80000000)) << 32;
+	else
+		key = ((uint64) DatumGetInt64(e->d)) ^ (UINT64CONST(1) << 63);
+
+	if (lvctxt->scanKey.sk_flags & SK_BT_DESC)
+		key = ~key;
+
+	return key;
+}
+
+static void mk_radix_sort_bytes(MKEntry *a, int left, int right, int lv, int byte, MKContext *ctxt, bool seenNull, bool inWorker)
+{
+	MKLvContext *lvctxt = ctxt->lvctxt + lv;
+	int nbytes = (lvctxt->lvtype == MKLV_TYPE_INT32) ? 4 : 8;
+	int shift = 56 - 8 * byte;
+	int start[256];
+	int next[256];
+	int end[256];
+	int b;
+	int i;
+
+	if (!inWorker)
+		CHECK_FOR_INTERRUPTS();
+
+	memset(end, 0, sizeof(end));
+	for (i = left; i <= right; i++)
+		end[(mkqs_radix_key(a + i, lvctxt) >> shift) & 0xFF]++;
+
+	for (b = 0, i = left; b < 256; b++)
+	{
+		start[b] = next[b] = i;
+		i += end[b];
+		end[b] = i;
+	}
+
+	/* Move every entry to its bucket, following the cycles */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < end[b])
+		{
+			MKEntry tmp = a[next[b]];
+			int tb = (mkqs_radix_key(&tmp, lvctxt) >> shift) & 0xFF;
+
+			while (tb != b)
+			{
+				MKEntry displaced = a[next[tb]];
+
+				a[next[tb]++] = tmp;
+				tmp = displaced;
+				tb = (mkqs_radix_key(&tmp, lvctxt) >> shift) & 0xFF;
+			}
+			a[next[b]++] = tmp;
+		}
+	}
+
+	for (b = 0; b < 256; b++)
+	{
+		int n = end[b] - start[b];
+
+		if (n == 0)
+			continue;
+
+		if (n >= MKQS_RADIX_MIN_ENTRIES && byte + 1 < nbytes)
+			mk_radix_sort_bytes(a, start[b], end[b] - 1, lv, byte + 1, ctxt, seenNull, inWorker);
+		else
+			mk_qsort_rec(a, start[b], end[b] - 1, lv, false, ctxt, seenNull, inWorker);
+
+		if (QueryFinishPending)
+			return;
+	}
+}
+
+/*
+ * Move the entries of a range that has just been prepared at a level, and
+ * are null at that level, to the front or the back of the range, depending
+ * on their null flags.  On return, [*first, *last] are the non-null ones.
+ *
+ * Returns false, having done nothing, if the entries differ in more than
+ * their null flags at this level, as the plain compare does not ignore the
+ * rest of compflags.
+ */
+static bool mkqs_split_nulls(MKEntry *a, int left, int right, int *first, int *last)
+{
+	int32 flags = a[left].compflags & ~MKE_CF_NULLBITS;
+	int i;
+
+	for (i = left; i <= right; i++)
+	{
+		if ((a[i].compflags & ~MKE_CF_NULLBITS) != flags)
+			return false;
+	}
+
+	*first = left;
+	*last = right;
+	for (i = left; i <= *last; )
+	{
+		int32 nullbits = mke_get_nullbits(a + i);
+
+		if (nullbits == MKE_CF_NullFirst)
+			mkqs_swap(a, (*first)++, i++);
+		else if (nullbits == MKE_CF_NullLast)
+			mkqs_swap(a, (*last)--, i);
+		else
+			i++;
+	}
+
+	return true;
+}
+
+/*
+ * Radix sort a range that has just been prepared at an integer level.
+ * Returns false, having done nothing, if mkqs_split_nulls() can't be used.
+ */
+static bool mk_radix_sort(MKEntry *a, int left, int right, int lv, MKContext *ctxt, bool seenNull, bool inWorker)
+{
+	int first;
+	int last;
+
+	if (!mkqs_split_nulls(a, left, right, &first, &last))
+		return false;
+
+	mk_qsort_rec(a, left, first - 1, lv, false, ctxt, seenNull, inWorker);
+	if (first <= last)
+		mk_radix_sort_bytes(a, first, last, lv, 0, ctxt, seenNull, inWorker);
+	mk_qsort_rec(a, last + 1, right, lv, false, ctxt, seenNull, inWorker);
+
+	return true;
+}
+
 void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull)
+{
+	mk_qsort_rec(a, left, right, lv, lvdown, ctxt, seenNull, false);
+}
+
+/*
+ * The body of mk_qsort_impl().
+ *
+ * inWorker is set when this runs in one of the threads of
+ * mk_qsort_parallel().  Those must not process interrupts, which may throw
+ * an error, so they leave that to the backend thread.
+ */
+static void mk_qsort_rec(MKEntry *a, int left, int right, int lv, bool lvdown, MKContext *ctxt, bool seenNull, bool inWorker)
 {
 	int lastInLow;
 	int firstInHigh;
@@ -269,7 +440,8 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	Assert(ctxt);
 	Assert(lv < ctxt->total_lv);
 
-	CHECK_FOR_INTERRUPTS();
+	if (!inWorker)
+		CHECK_FOR_INTERRUPTS();
 
 	if (QueryFinishPending)
 		return;
@@ -281,6 +453,13 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	if(lvdown)
         mk_prepare_array(a, left, right, lv, ctxt);
 
+	/* Large ranges on an integer key are split up by radix first */
+	if (lvdown &&
+		right - left + 1 >= MKQS_RADIX_MIN_ENTRIES &&
+		mk_lvtype_is_integer(ctxt->lvctxt[lv].lvtype) &&
+		mk_radix_sort(a, left, right, lv, ctxt, seenNull, inWorker))
+		return;
+
 	/* 
 	 * According to Bentley & McIlroy [1] (1993), using insert sort for case 
 	 * n < 7 is a significant saving.  However, according to Sedgewick & 
@@ -293,7 +472,7 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	mk_qsort_part3(a, left, right, lv, ctxt, &lastInLow, &firstInHigh);
 
 	/* recurse to left chunk */
-	mk_qsort_impl(a, left, lastInLow, lv, false, ctxt, seenNull);
+	mk_qsort_rec(a, left, lastInLow, lv, false, ctxt, seenNull, inWorker);
 
 	/* recurse to middle (equal) chunk */
 	if(lv < ctxt->total_lv-1)
@@ -301,7 +480,7 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 		/*
 		 * [lastInLow+1,firstInHigh-1] defines the pivot region which was all equal at level lv.  So increase the level and compare that region!
 		 */
-		mk_qsort_impl(a, lastInLow+1, firstInHigh-1, lv+1, true, ctxt, seenNull || mke_is_null(a+lastInLow+1)); /* a + lastInLow + 1 points to the pivot */
+		mk_qsort_rec(a, lastInLow+1, firstInHigh-1, lv+1, true, ctxt, seenNull || mke_is_null(a+lastInLow+1), inWorker); /* a + lastInLow + 1 points to the pivot */
 	}
 	else
 	{
@@ -310,6 +489,9 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 				!seenNull &&
 				!mke_is_null(a+lastInLow+1)) /* a + lastInLow + 1 points to the pivot */
 		{
+			/* mk_qsort_parallel() does not take unique sorts */
+			Assert(!inWorker || (!ctxt->enforceUnique && !ctxt->unique));
+
 			if ( ctxt->enforceUnique )
 			{
 				Datum	values[INDEX_MAX_KEYS];
@@ -342,7 +524,7 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 	}
 
 	/* recurse to right chunk */
-	mk_qsort_impl(a, firstInHigh, right, lv, false, ctxt, seenNull);
+	mk_qsort_rec(a, firstInHigh, right, lv, false, ctxt, seenNull, inWorker);
 
 #ifdef MKQSORT_VERIFY 
 	if(lv == 0)
@@ -350,6 +532,236 @@ void mk_qsort_impl(MKEntry *a, int left, int right, int lv, bool lvdown, MKConte
 #endif
 }
 
+/*
+ * Parallel in-memory sort.
+ *
+ * A large sort on integer keys only can be split up by the first key into
+ * ranges that don't overlap, and those can be sorted independently.  The
+ * backend picks splitters from a sample of the keys, moves the entries into
+ * their ranges, and then it and up to nthreads - 1 threads take the ranges
+ * one by one and sort them.
+ *
+ * The threads only compare and move entries.  Preparing the deeper levels
+ * of integer keys just reads the datum out of the tuple, so nothing they do
+ * allocates memory, looks at the catalogs or can throw an error.  That is
+ * why sorts on other types of keys, which need strxfrm() buffers or fmgr
+ * calls, and unique sorts, which free the duplicates, are sorted by the
+ * backend alone.  Interrupts are processed once the threads are done.
+ */
+#define MKQS_PARALLEL_MIN_ENTRIES 65536
+#define MKQS_PARALLEL_TASKS_PER_THREAD 4
+#define MKQS_PARALLEL_MAX_TASKS (32 * MKQS_PARALLEL_TASKS_PER_THREAD)
+#define MKQS_PARALLEL_SAMPLES_PER_TASK 16
+#define MKQS_THREAD_STACK_SIZE (4 * 1024 * 1024)
+
+typedef struct MKQSParallelState
+{
+	MKEntry *a;
+	MKContext *ctxt;
+
+	/* the ranges to sort, [start, end) */
+	int ntasks;
+	int start[MKQS_PARALLEL_MAX_TASKS];
+	int end[MKQS_PARALLEL_MAX_TASKS];
+
+	/* the next range to hand out, protected by lock */
+	int next_task;
+	pthread_mutex_t lock;
+} MKQSParallelState;
+
+static bool mk_qsort_parallel_ok(MKContext *ctxt)
+{
+	int lv;
+
+	if (ctxt->unique || ctxt->enforceUnique || !ctxt->fetchForPrep)
+		return false;
+
+	for (lv = 0; lv < ctxt->total_lv; lv++)
+	{
+		MKLvContext *lvctxt = ctxt->lvctxt + lv;
+
+		if (!mk_lvtype_is_integer(lvctxt->lvtype) || !lvctxt->typByVal)
+			return false;
+	}
+	return true;
+}
+
+static int mkqs_uint64_cmp(const void *a, const void *b)
+{
+	uint64 ka = *(const uint64 *) a;
+	uint64 kb = *(const uint64 *) b;
+
+	return (ka < kb) ? -1 : ((ka == kb) ? 0 : 1);
+}
+
+/* The range a key falls into: the number of splitters smaller than it */
+static inline int mkqs_task_of(uint64 key, uint64 *splitters, int nsplitters)
+{
+	int lo = 0;
+	int hi = nsplitters;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+
+		if (splitters[mid] < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void mkqs_run_tasks(MKQSParallelState *ps)
+{
+	for (;;)
+	{
+		int task;
+
+		pthread_mutex_lock(&ps->lock);
+		task = ps->next_task++;
+		pthread_mutex_unlock(&ps->lock);
+
+		if (task >= ps->ntasks)
+			break;
+
+		mk_qsort_rec(ps->a, ps->start[task], ps->end[task] - 1, 0, false, ps->ctxt, false, true);
+	}
+}
+
+static void *mkqs_thread_main(void *arg)
+{
+	gp_set_thread_sigmasks();
+	mkqs_run_tasks((MKQSParallelState *) arg);
+	return NULL;
+}
+
+void mk_qsort_parallel(MKEntry *a, int n, MKContext *ctxt, int nthreads)
+{
+	MKLvContext *lvctxt = ctxt->lvctxt;
+	MKQSParallelState *ps;
+	pthread_t threads[32];
+	pthread_attr_t t_atts;
+	uint64 *samples;
+	uint64 *splitters;
+	int nsamples;
+	int nsplitters;
+	int nstarted = 0;
+	int next[MKQS_PARALLEL_MAX_TASKS];
+	int first;
+	int last;
+	int t;
+	int i;
+
+	nthreads = Min(nthreads, lengthof(threads));
+
+	if (nthreads <= 1 || n < MKQS_PARALLEL_MIN_ENTRIES || !mk_qsort_parallel_ok(ctxt))
+	{
+		mk_qsort(a, n, ctxt);
+		return;
+	}
+
+	mk_prepare_array(a, 0, n - 1, 0, ctxt);
+
+	if (!mkqs_split_nulls(a, 0, n - 1, &first, &last))
+	{
+		mk_qsort_impl(a, 0, n - 1, 0, false, ctxt, false);
+		return;
+	}
+	mk_qsort_impl(a, 0, first - 1, 0, false, ctxt, false);
+	mk_qsort_impl(a, last + 1, n - 1, 0, false, ctxt, false);
+	if (last - first + 1 < MKQS_PARALLEL_MIN_ENTRIES)
+	{
+		mk_qsort_impl(a, first, last, 0, false, ctxt, false);
+		return;
+	}
+
+	ps = palloc0(sizeof(MKQSParallelState));
+	ps->a = a;
+	ps->ctxt = ctxt;
+
+	/*
+	 * Pick the splitters from an evenly spaced sample of the keys.  Equal
+	 * splitters are merged, so a key that is very common makes for fewer,
+	 * but not empty, ranges.
+	 */
+	nsamples = nthreads * MKQS_PARALLEL_TASKS_PER_THREAD * MKQS_PARALLEL_SAMPLES_PER_TASK;
+	samples = palloc(nsamples * sizeof(uint64));
+	for (i = 0; i < nsamples; i++)
+		samples[i] = mkqs_radix_key(a + first + (int) ((int64) (last - first) * i / nsamples), lvctxt);
+	qsort(samples, nsamples, sizeof(uint64), mkqs_uint64_cmp);
+
+	splitters = palloc(nthreads * MKQS_PARALLEL_TASKS_PER_THREAD * sizeof(uint64));
+	nsplitters = 0;
+	for (i = MKQS_PARALLEL_SAMPLES_PER_TASK; i < nsamples; i += MKQS_PARALLEL_SAMPLES_PER_TASK)
+	{
+		if (nsplitters == 0 || splitters[nsplitters - 1] != samples[i])
+			splitters[nsplitters++] = samples[i];
+	}
+	ps->ntasks = nsplitters + 1;
+
+	/* Move every entry into its range, following the cycles */
+	for (i = first; i <= last; i++)
+		ps->end[mkqs_task_of(mkqs_radix_key(a + i, lvctxt), splitters, nsplitters)]++;
+	for (t = 0, i = first; t < ps->ntasks; t++)
+	{
+		ps->start[t] = next[t] = i;
+		i += ps->end[t];
+		ps->end[t] = i;
+	}
+	for (t = 0; t < ps->ntasks; t++)
+	{
+		while (next[t] < ps->end[t])
+		{
+			MKEntry tmp = a[next[t]];
+			int tt = mkqs_task_of(mkqs_radix_key(&tmp, lvctxt), splitters, nsplitters);
+
+			while (tt != t)
+			{
+				MKEntry displaced = a[next[tt]];
+
+				a[next[tt]++] = tmp;
+				tmp = displaced;
+				tt = mkqs_task_of(mkqs_radix_key(&tmp, lvctxt), splitters, nsplitters);
+			}
+			a[next[t]++] = tmp;
+		}
+	}
+
+	pfree(samples);
+	pfree(splitters);
+
+	CHECK_FOR_INTERRUPTS();
+
+	/*
+	 * Start the threads.  If we can't start as many as we'd like, we make
+	 * do with the ones we have; the backend sorts the rest itself.
+	 */
+	pthread_mutex_init(&ps->lock, NULL);
+	pthread_attr_init(&t_atts);
+	pthread_attr_setstacksize(&t_atts, Max(PTHREAD_STACK_MIN, MKQS_THREAD_STACK_SIZE));
+	for (t = 0; t < Min(nthreads - 1, ps->ntasks - 1); t++)
+	{
+		if (pthread_create(&threads[nstarted], &t_atts, mkqs_thread_main, ps) != 0)
+			break;
+		nstarted++;
+	}
+	pthread_attr_destroy(&t_atts);
+
+	mkqs_run_tasks(ps);
+
+	for (t = 0; t < nstarted; t++)
+		pthread_join(threads[t], NULL);
+	pthread_mutex_destroy(&ps->lock);
+
+	pfree(ps);
+
+	if (nstarted > 0)
+		SIMPLE_FAULT_INJECTOR("mksort_parallel_threads");
+
+	CHECK_FOR_INTERRUPTS();
+}
+
 #ifdef MKQSORT_VERIFY 
 static int mkqsort_comp_entry_all_lv(MKEntry *a, MKEntry *b, MKContext *mkctxt)
 {
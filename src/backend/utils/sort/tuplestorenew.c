@@ -23,6 +23,8 @@
 #include "access/heapam.h"
 #include "executor/instrument.h"
 #include "storage/buffile.h"
+#include "storage/dsm.h"
+#include "utils/faultinjector.h"
 #include "utils/tuplestorenew.h"
 #include "utils/memutils.h"
 
@@ -63,6 +65,18 @@ typedef struct NTupleStoreLobRef
 	Size size;
 } NTupleStoreLobRef;
 
+/*
+ * A shared tuplestore that is passed to the readers in dynamic shared memory
+ * rather than in workfiles.  The segment holds this header, followed by the
+ * pages in block number order, laid out as they would be in the file.
+ */
+typedef struct NTupleStoreShmHeader
+{
+	long nblocks;		/* number of pages that follow */
+} NTupleStoreShmHeader;
+
+#define NTS_SHM_PAGES_OFFSET MAXALIGN(sizeof(NTupleStoreShmHeader))
+
 /* some convinient macro/inline functions */
 /* page flag bits */
 #define NTS_PAGE_DIRTY 1
@@ -251,6 +265,10 @@ struct NTupleStore
 	BufFile *plobfile;  /* underlying backed file for lobs (entries does not fit one page) */
 	int64     lobbytes;  /* number of bytes written to lob file */
 
+	char *rw_filename;	/* writer: name of the shared files, created on demand */
+	dsm_segment *shm_seg;	/* pages shared in dynamic shared memory, if any */
+	long shm_nblocks;	/* number of pages in shm_seg */
+
 	List *accessors;    /* all current accessors of the store */
 	bool fwacc; 		/* if I had already has a write acc */
 
@@ -393,15 +411,27 @@ static bool ntsReadBlock(NTupleStore *ts, int blockn, NTupleStorePage *page)
 {
 	long diskblockn = blockn - ts->first_ondisk_blockn;
 
-	if(!ts->pfile)
-		return false;
-	
-	Assert(ts->first_ondisk_blockn >= 0);
-	Assert(ts && diskblockn >= 0 && page);
-	if (BufFileSeek(ts->pfile, 0 /* fileno */, diskblockn * BLCKSZ, SEEK_SET) != 0 ||
-		BufFileRead(ts->pfile, page, BLCKSZ) != BLCKSZ)
+	if(ts->shm_seg)
 	{
-		return false;
+		char *pages = (char *) dsm_segment_address(ts->shm_seg) + NTS_SHM_PAGES_OFFSET;
+
+		if(blockn < 0 || blockn >= ts->shm_nblocks)
+			return false;
+
+		memcpy(page, pages + (Size) blockn * BLCKSZ, BLCKSZ);
+	}
+	else
+	{
+		if(!ts->pfile)
+			return false;
+
+		Assert(ts->first_ondisk_blockn >= 0);
+		Assert(ts && diskblockn >= 0 && page);
+		if (BufFileSeek(ts->pfile, 0 /* fileno */, diskblockn * BLCKSZ, SEEK_SET) != 0 ||
+			BufFileRead(ts->pfile, page, BLCKSZ) != BLCKSZ)
+		{
+			return false;
+		}
 	}
 
 	Assert(nts_page_blockn(page) == blockn); 
@@ -695,6 +725,15 @@ ntuplestore_destroy(NTupleStore *ts)
 		ts->work_set = NULL;
 	}
 
+	if (ts->shm_seg)
+	{
+		dsm_detach(ts->shm_seg);
+		ts->shm_seg = NULL;
+	}
+
+	if (ts->rw_filename)
+		pfree(ts->rw_filename);
+
 	pfree(ts);
 }
 
@@ -710,6 +749,10 @@ ntuplestore_create_common(int64 maxBytes, char *operation_name)
 	store->plobfile = NULL;
 	store->lobbytes = 0;
 
+	store->rw_filename = NULL;
+	store->shm_seg = NULL;
+	store->shm_nblocks = 0;
+
 	store->work_set = NULL;
 	store->operation_name = operation_name;
 
@@ -746,6 +789,10 @@ ntuplestore_create_common(int64 maxBytes, char *operation_name)
  *
  *   filename must be a unique name that identifies the share.
  *   filename does not include the pgsql_tmp/ prefix
+ *
+ * The writer creates the files only when it spills, or when it is flushed,
+ * so that a small store can be shared with ntuplestore_flush_shm() without
+ * ever touching the disk.
  */
 NTupleStore *
 ntuplestore_create_readerwriter(const char *filename, int64 maxBytes, bool isWriter)
@@ -760,19 +807,16 @@ ntuplestore_create_readerwriter(const char *filename, int64 maxBytes, bool isWri
 		store = ntuplestore_create_common(maxBytes, "SharedTupleStore");
 		store->rwflag = NTS_IS_WRITER;
 		store->lobbytes = 0;
-		store->work_set = workfile_mgr_create_set(store->operation_name, filename);
-		store->pfile = BufFileCreateNamedTemp(filename,
-											  false /* interXact */,
-											  store->work_set);
-		store->plobfile = BufFileCreateNamedTemp(filenamelob,
-												 false /* interXact */,
-												 store->work_set);
+		store->rw_filename = MemoryContextStrdup(store->mcxt, filename);
 	}
 	else
 	{
 		store = (NTupleStore *) palloc(sizeof(NTupleStore));
 		store->mcxt = CurrentMemoryContext;
 		store->work_set = NULL;
+		store->rw_filename = NULL;
+		store->shm_seg = NULL;
+		store->shm_nblocks = 0;
 
 		store->pfile = BufFileOpenNamedTemp(filename,
 											false /* interXact */);
@@ -786,7 +830,36 @@ ntuplestore_create_readerwriter(const char *filename, int64 maxBytes, bool isWri
 }
 
 /*
- * Initializes a ntuplestore based on existing files.
+ * Initialize the reader of a ntuplestore that was shared with
+ * ntuplestore_flush_shm(), from the segment with the given handle.
+ */
+NTupleStore *
+ntuplestore_create_reader_shm(dsm_handle handle, int64 maxBytes)
+{
+	NTupleStore *store = (NTupleStore *) palloc(sizeof(NTupleStore));
+
+	store->mcxt = CurrentMemoryContext;
+	store->work_set = NULL;
+	store->pfile = NULL;
+	store->plobfile = NULL;
+	store->rw_filename = NULL;
+
+	store->shm_seg = dsm_attach(handle);
+	if (store->shm_seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_INTERNAL_ERROR),
+				 errmsg("could not attach to shared tuplestore segment %u",
+						handle)));
+	store->shm_nblocks =
+		((NTupleStoreShmHeader *) dsm_segment_address(store->shm_seg))->nblocks;
+
+	ntuplestore_init_reader(store, maxBytes);
+	return store;
+}
+
+/*
+ * Initializes a ntuplestore based on existing files, or a shared memory
+ * segment.
  *
  * spill_filename and spill_lob_filename are required to have pgsql_tmp/ part of the name
  */
@@ -794,8 +867,8 @@ static void
 ntuplestore_init_reader(NTupleStore *store, int maxBytes)
 {
 	Assert(NULL != store);
-	Assert(NULL != store->pfile);
-	Assert(NULL != store->plobfile);
+	Assert(NULL != store->shm_seg ||
+		   (NULL != store->pfile && NULL != store->plobfile));
 	
 	store->first_ondisk_blockn = 0;
 	store->rwflag = NTS_IS_READER;
@@ -856,7 +929,9 @@ ntuplestore_flush(NTupleStore *ts)
 	NTupleStorePage *p = ts->first_page;
 
 	Assert(ts->rwflag != NTS_IS_READER || !"Flush attempted for Reader");
-	Assert(ts->pfile);
+
+	/* the readers open the files by name, so they must exist, if empty */
+	ntuplestore_create_spill_files(ts);
 
 	while(p)
 	{
@@ -873,6 +948,78 @@ ntuplestore_flush(NTupleStore *ts)
 	}
 }
 
+/*
+ * Make the contents of the writer of a shared tuplestore available to the
+ * readers.
+ *
+ * If the store never spilled, and its pages take no more than maxBytes, they
+ * are copied into a new dynamic shared memory segment, and its handle is
+ * returned in *handle.  No files are created in that case.  The segment
+ * stays attached until the store is destroyed, so it lives until the writer
+ * is done, and after that, until the last reader is.
+ *
+ * Otherwise this is the same as ntuplestore_flush(), and returns false.
+ */
+bool
+ntuplestore_flush_shm(NTupleStore *ts, int64 maxBytes, dsm_handle *handle)
+{
+	NTupleStorePage *p = NULL;
+	NTupleStoreShmHeader *hdr;
+	char *pages;
+	long nblocks = 0;
+
+	Assert(ts->rwflag == NTS_IS_WRITER);
+	Assert(ts->shm_seg == NULL);
+
+	/*
+	 * A store that didn't spill still has all its pages in memory, in block
+	 * number order.  Only the last one may be empty, and like
+	 * ntuplestore_flush() we leave that out.
+	 */
+	if (ts->pfile == NULL && ts->lobbytes == 0)
+	{
+		for (p = ts->first_page; p != NULL; p = nts_page_next(p))
+		{
+			if (nts_page_slot_cnt(p) == 0)
+				continue;
+			if (nts_page_blockn(p) != nblocks)
+				break;
+			nblocks++;
+		}
+	}
+
+	if (ts->pfile != NULL || ts->lobbytes != 0 || p != NULL ||
+		NTS_SHM_PAGES_OFFSET + (int64) nblocks * BLCKSZ > maxBytes)
+	{
+		ntuplestore_flush(ts);
+		return false;
+	}
+
+	ts->shm_seg = dsm_create(NTS_SHM_PAGES_OFFSET + (Size) nblocks * BLCKSZ);
+
+	hdr = (NTupleStoreShmHeader *) dsm_segment_address(ts->shm_seg);
+	hdr->nblocks = nblocks;
+	pages = (char *) hdr + NTS_SHM_PAGES_OFFSET;
+
+	for (p = ts->first_page; p != NULL; p = nts_page_next(p))
+	{
+		NTupleStorePage *copy;
+
+		if (nts_page_slot_cnt(p) == 0)
+			continue;
+
+		copy = (NTupleStorePage *) (pages + (Size) nts_page_blockn(p) * BLCKSZ);
+		memcpy(copy, p, BLCKSZ);
+		nts_page_set_dirty(copy, false);
+	}
+
+	*handle = dsm_segment_handle(ts->shm_seg);
+
+	SIMPLE_FAULT_INJECTOR("shareinput_flush_shm");
+
+	return true;
+}
+
 NTupleStoreAccessor* 
 ntuplestore_create_accessor(NTupleStore *ts, bool isWriter)
 {
@@ -955,6 +1102,7 @@ static long ntuplestore_put_lob(NTupleStore *nts, char* data, NTupleStoreLobRef
 static long ntuplestore_get_lob(NTupleStore *nts, void *data, NTupleStoreLobRef *lobref)
 {
 	Assert(lobref->start >= 0);
+	Assert(nts->plobfile);
 	long ret = BufFileSeek(nts->plobfile, 0 /* fileno */, lobref->start, SEEK_SET);
 	Assert(ret == 0);
 
@@ -1382,6 +1530,29 @@ ntuplestore_create_spill_files(NTupleStore *nts)
 	}
 
 	Assert(!nts->work_set);
+
+	if (nts->rwflag == NTS_IS_WRITER)
+	{
+		/* the shared files have well-known names, for the readers */
+		char filenamelob[MAXPGPATH];
+
+		snprintf(filenamelob, sizeof(filenamelob), "%s_LOB", nts->rw_filename);
+
+		nts->work_set = workfile_mgr_create_set(nts->operation_name, nts->rw_filename);
+
+		oldcxt = MemoryContextSwitchTo(nts->mcxt);
+
+		nts->pfile = BufFileCreateNamedTemp(nts->rw_filename,
+											false /* interXact */,
+											nts->work_set);
+		nts->plobfile = BufFileCreateNamedTemp(filenamelob,
+											   false /* interXact */,
+											   nts->work_set);
+
+		MemoryContextSwitchTo(oldcxt);
+		return;
+	}
+
 	nts->work_set = workfile_mgr_create_set(nts->operation_name, NULL);
 
 	oldcxt = MemoryContextSwitchTo(nts->mcxt);
@@ -56,6 +56,9 @@
 
 #include <pg_config.h>
 #include "gpfdist_helper.h"
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 #ifdef USE_SSL
 #include <openssl/ssl.h>
 #include <openssl/rand.h>
@@ -79,6 +82,7 @@ struct block_t
 	blockhdr_t 	hdr;
 	int 		bot, top;
 	char*      	data;
+	int			compressed;	/* data is a zstd frame, sent as a 'Z' block */
 };
 
 /*  Get session id for this request */
@@ -124,6 +128,13 @@ static void flush_ssl_buffer(int fd, short event, void* arg);
  not property terminated, then gpfdist encountered some error, and caller
  should check the gpfdist error log.
 
+ X-GP-ZSTD = 1
+ the segment can exchange zstd compressed data. If gpfdist runs with
+ --compress, it answers with the same header, and then
+ - in PROTO 1, data blocks that get smaller are sent as 'Z' blocks in
+   place of 'D' blocks, each holding a single zstd frame of the data
+ - the body of every following POST request is a single zstd frame
+
  **************/
 
 typedef struct gnet_request_t gnet_request_t;
@@ -173,7 +184,9 @@ static struct
 	struct transform* trlist; /* transforms from config file */
 	const char* ssl; /* path to certificates in case we use gpfdist with ssl */
 	int			w; /* The time used for session timeout in seconds */
-} opt = { 8080, 8080, 0, 0, 0, ".", 0, 0, -1, 5, 0, 32768, 0, 256, 0, 0, 0, 0 };
+	int			threads; /* number of threads filling blocks for GET sessions, 0 for none */
+	int			compress; /* exchange zstd compressed data with segments offering it */
+} opt = { 8080, 8080, 0, 0, 0, ".", 0, 0, -1, 5, 0, 32768, 0, 256, 0, 0, 0, 0, 0, 0 };
 
 
 typedef union address
@@ -207,6 +220,19 @@ static struct
 	SSL_CTX 		*server_ctx;/* for SSL */
 #endif
 	int 			wdtimer; /* Kill gpfdist after k seconds of inactivity. 0 to disable. */
+#ifndef WIN32
+	struct fill_worker_t *workers;	/* block filling threads, opt.threads of them */
+	int				notify_pipe[2];	/* written by a worker when it filled a block */
+	struct event	notify_event;
+	struct request_t *waiting;		/* requests waiting for a block to be filled */
+#endif
+#ifdef HAVE_LIBZSTD
+	/* Only used by the event loop, which handles one block or POST body at a time */
+	ZSTD_CCtx*		zstd_cctx;		/* compresses blocks sent to segments */
+	ZSTD_DStream*	zstd_dstream;	/* decompresses POST bodies */
+	char*			zstd_buf;		/* compressed data */
+	int				zstd_bufsize;
+#endif
 } gcb;
 
 /*  A session */
@@ -232,6 +258,7 @@ struct session_t
 	struct timeval 	tm;             /* timeout for struct event */
 	struct event   	ev;             /* event we are watching for this session*/
 	apr_hash_t		*requests;
+	struct session_fill_t *fill;	/* blocks filled ahead by a worker thread, or NULL */
 };
 
 /*  An http request */
@@ -269,6 +296,7 @@ struct request_t
 	int 			gp_proto; 	/* the protocol to use, sent from client */
 	int				is_get;     /* true for GET, false for POST */
 	int				is_final;	/* the final POST request. a signal from client to end session */
+	int				zstd;		/* data is exchanged zstd compressed */
 	int				segid;		/* the segment id of the segdb with the request */
 	int				totalsegs;	/* the total number of segdbs */
 
@@ -282,12 +310,16 @@ struct request_t
 		char*	dbuf;		/* buffer for raw data from a POST request */
 		int 	dbuftop; 	/* # bytes used in dbuf */
 		int 	dbufmax; 	/* size of dbuf[] */
+		size_t	zstd_pending;	/* 0 unless in the middle of a compressed frame */
 	} in;
 
 	block_t	outblock;	/* next block to send out */
 	char*           line_delim_str;
 	int             line_delim_length;
 
+	int				is_waiting;	/* on gcb.waiting for a worker to fill a block */
+	request_t*		next_waiting;	/* next in gcb.waiting */
+
 #ifdef USE_SSL
 	/* SSL related */
 	BIO			*io;		/* for the i.o. */
@@ -349,6 +381,21 @@ static int request_validate(request_t *r);
 static int request_set_path(request_t *r, const char* d, char* p, char* pp, char* path);
 static int request_parse_gp_headers(request_t *r, int opt_g);
 static void free_session_cb(int fd, short event, void* arg);
+#ifndef WIN32
+static void fill_setup(void);
+static void session_fill_start(request_t* r, session_t* session);
+static void session_fill_stop(session_t* session);
+static int session_fill_ready(session_t* session);
+static void request_wait_block(request_t* r);
+static void request_unwait_block(request_t* r);
+static const char* session_get_filled_block(const request_t* r, block_t* retblock);
+#endif
+#ifdef HAVE_LIBZSTD
+static void block_compress(const request_t *r, block_t* b);
+static void zstd_setup(void);
+static int request_decompress_data(request_t *r, const char* buf, int len);
+#endif
+static int request_write_data(request_t *r);
 #ifdef GPFXDIST
 static int request_set_transform(request_t *r);
 #endif
@@ -441,12 +488,12 @@ static void block_fill_header(const request_t *r, block_t* b,
 	gdebug(r, "L %lu", (unsigned long)local_ntohll(len8));
 #endif
 
-	/* DATA: 'D' + len */
-	*p++ = 'D';
+	/* DATA: 'D' + len, or 'Z' + len for compressed data */
+	*p++ = b->compressed ? 'Z' : 'D';
 	len = htonl(b->top-b->bot);
 	memcpy(p, &len, 4);
 	p += 4;
-	gdebug(r, "D %u", (unsigned int)ntohl(len));
+	gdebug(r, "%c %u", b->compressed ? 'Z' : 'D', (unsigned int)ntohl(len));
 	h->htop = p - h->hbyte;
 	if (h->htop > sizeof(h->hbyte))
 		gfatal(NULL, "assert failed, h->htop = %d, max = %d", h->htop,
@@ -454,6 +501,58 @@ static void block_fill_header(const request_t *r, block_t* b,
 	gdebug(r, "header size: %d",h->htop-h->hbot);
 }
 
+#ifdef HAVE_LIBZSTD
+/* data sent to segments is bound by the network, compress it fast */
+#define GPFDIST_ZSTD_COMPRESSION_LEVEL 1
+
+/*
+ * block_compress
+ *
+ * Compress the data of a block to be sent to a segment that accepted zstd.
+ * Blocks that do not get smaller are sent as they are.
+ */
+static void block_compress(const request_t *r, block_t* b)
+{
+	int		n = b->top - b->bot;
+	size_t	size;
+
+	if (n == 0)
+		return;
+
+	size = ZSTD_compressCCtx(gcb.zstd_cctx, gcb.zstd_buf, gcb.zstd_bufsize,
+							 b->data + b->bot, n, GPFDIST_ZSTD_COMPRESSION_LEVEL);
+	if (ZSTD_isError(size))
+	{
+		gwarning(r, "cannot compress block: %s", ZSTD_getErrorName(size));
+		return;
+	}
+
+	if (size >= n)
+		return;
+
+	memcpy(b->data, gcb.zstd_buf, size);
+	b->bot = 0;
+	b->top = size;
+	b->compressed = 1;
+	gdebug(r, "compressed block from %d to %d bytes", n, (int) size);
+}
+
+/*
+ * Set up the zstd contexts of the event loop, and a buffer large enough for
+ * a compressed block.
+ */
+static void zstd_setup(void)
+{
+	gcb.zstd_cctx = ZSTD_createCCtx();
+	gcb.zstd_dstream = ZSTD_createDStream();
+	gcb.zstd_bufsize = ZSTD_compressBound(opt.m);
+	gcb.zstd_buf = malloc(gcb.zstd_bufsize);
+
+	if (!gcb.zstd_cctx || !gcb.zstd_dstream || !gcb.zstd_buf)
+		gfatal(NULL, "out of memory in zstd_setup");
+}
+#endif
+
 static unsigned short get_client_port(address_t *clientInformation)
 {
 	//check the family version of client IP address, so you
@@ -501,7 +600,7 @@ static void usage_error(const char* msg, int print_usage)
 		{
 			fprintf(stderr,
 					"gpfdist -- file distribution web server\n\n"
-						"usage: gpfdist [--ssl <certificates_directory>] [-d <directory>] [-p <http(s)_port>] [-l <log_file>] [-t <timeout>] [-v | -V | -s] [-m <maxlen>] [-w <timeout>]"
+						"usage: gpfdist [--ssl <certificates_directory>] [-d <directory>] [-p <http(s)_port>] [-l <log_file>] [-t <timeout>] [-v | -V | -s] [-m <maxlen>] [-w <timeout>] [--threads <n>] [--compress]"
 #ifdef GPFXDIST
 					    "[-c file]"
 #endif
@@ -527,7 +626,9 @@ static void usage_error(const char* msg, int print_usage)
 					    "        -c file    : configuration file for transformations\n"
 #endif
 						"        --version  : print version information\n"
-						"        -w timeout : timeout in seconds before close target file\n\n");
+						"        -w timeout : timeout in seconds before close target file\n"
+						"        --threads n : number of threads reading data ahead for readers, default is 0\n"
+						"        --compress : compress data exchanged with segments that support it\n\n");
 		}
 	}
 
@@ -590,6 +691,8 @@ static void parse_command_line(int argc, const char* const argv[],
 #endif
 	{ "version", 256, 0, "print version number" },
 	{ NULL, 'w', 1, "wait for session timeout in seconds" },
+	{ "threads", 258, 1, "number of threads filling blocks for read sessions" },
+	{ "compress", 259, 0, "exchange zstd compressed data with segments" },
 	{ 0 } };
 
 	status = apr_getopt_init(&os, pool, argc, argv);
@@ -674,6 +777,24 @@ static void parse_command_line(int argc, const char* const argv[],
 		case 'w':
 			opt.w = atoi(arg);
 			break;
+#ifndef WIN32
+		case 258:
+			opt.threads = atoi(arg);
+			break;
+#else
+		case 258:
+			usage_error("--threads is not supported on this platform", 0);
+			break;
+#endif
+#ifdef HAVE_LIBZSTD
+		case 259:
+			opt.compress = 1;
+			break;
+#else
+		case 259:
+			usage_error("--compress is not supported, gpfdist was built without zstd", 0);
+			break;
+#endif
 		}
 	}
 
@@ -702,6 +823,9 @@ static void parse_command_line(int argc, const char* const argv[],
     if (!is_valid_listen_queue_size(opt.z))
 		usage_error("Error: -z listen queue size must be between 16 and 512 (default is 256)", 0);
 
+	if (!is_valid_thread_count(opt.threads))
+		usage_error("Error: --threads must be between 0 and 64 (default is 0)", 0);
+
     /* get current directory, for ssl directory validation */
     if (0 != apr_filepath_get(&current_directory, APR_FILEPATH_NATIVE, pool))
 		usage_error(apr_psprintf(pool, "Error: cannot access directory '.'\n"
@@ -881,12 +1005,14 @@ static apr_status_t http_ok(request_t* r)
 		"Expires: 0\r\n"
 		"X-GPFDIST-VERSION: " GP_VERSION "\r\n"
 		"X-GP-PROTO: %d\r\n"
+		"%s"
 		"Cache-Control: no-cache\r\n"
 		"Connection: close\r\n\r\n";
 	char buf[1024];
 	int m, n;
 
-	n = apr_snprintf(buf, sizeof(buf), fmt, r->gp_proto);
+	n = apr_snprintf(buf, sizeof(buf), fmt, r->gp_proto,
+					 r->zstd ? "X-GP-ZSTD: 1\r\n" : "");
 	if (n >= sizeof(buf) - 1)
 		gfatal(r, "internal error - buffer overflow during http_ok");
 
@@ -1301,6 +1427,7 @@ session_get_block(const request_t* r, block_t* retblock, char* line_delim_str, i
 	session_t *session = r->session;
 
 	retblock->bot = retblock->top = 0;
+	retblock->compressed = 0;
 
 	if (session->is_error || 0 == session->fstream)
 	{
@@ -1309,6 +1436,11 @@ session_get_block(const request_t* r, block_t* retblock, char* line_delim_str, i
 		return 0;
 	}
 
+#ifndef WIN32
+	if (session->fill)
+		return session_get_filled_block(r, retblock);
+#endif
+
 	gcb.read_bytes -= fstream_get_compressed_position(session->fstream);
 
 	/* read data from our filestream as a chunk with whole data rows */
@@ -1336,6 +1468,11 @@ session_get_block(const request_t* r, block_t* retblock, char* line_delim_str, i
 
 	retblock->top = size;
 
+#ifdef HAVE_LIBZSTD
+	if (r->zstd)
+		block_compress(r, retblock);
+#endif
+
 	/* fill the block header with meta data for the client to parse and use */
 	block_fill_header(r, retblock, &fos);
 
@@ -1350,6 +1487,10 @@ static void session_end(session_t* session, int error)
 	if (error)
 		session->is_error = error;
 
+#ifndef WIN32
+	session_fill_stop(session);
+#endif
+
 	if (session->fstream)
 	{
 		fstream_close(session->fstream);
@@ -1362,6 +1503,10 @@ static void session_free(session_t* session)
 {
 	gprintln(NULL, "free session %s", session->key);
 
+#ifndef WIN32
+	session_fill_stop(session);
+#endif
+
 	if (session->fstream)
 	{
 		fstream_close(session->fstream);
@@ -1626,6 +1771,11 @@ static int session_attach(request_t* r)
 		if (session->tid == 0 || session->path == 0 || session->key == 0)
 			gfatal(r, "out of memory in session_attach");
 
+#ifndef WIN32
+		if (session->is_get && opt.threads > 0)
+			session_fill_start(r, session);
+#endif
+
 		/* insert into hashtable */
 		apr_hash_set(gcb.session.tab, session->key, APR_HASH_KEY_STRING, session);
 
@@ -1720,6 +1870,397 @@ static int session_active_segs_isempty(session_t* session)
 	return 1; /* empty */
 }
 
+#ifndef WIN32
+/*
+ * Block filling threads
+ *
+ * With --threads N, every GET session is handed to one of N worker threads,
+ * round robin, when it is created.  The worker reads whole-row blocks out of
+ * the session's fstream ahead of the requests that send them, so reading,
+ * decompression, transform output and the line delimiter search of many
+ * sessions run in parallel, while the event loop only copies ready blocks
+ * to the sockets.  Requests, sessions and sockets are still only touched by
+ * the event loop; a worker touches nothing but the fstream and the ring of
+ * filled blocks of its sessions, the latter under the worker's lock.
+ *
+ * A request finding no filled block stops watching its socket and waits on
+ * gcb.waiting.  Workers write a byte to gcb.notify_pipe after each block,
+ * which wakes up the event loop to resume the waiting requests.
+ */
+#define GPFDIST_FILL_BLOCKS 16				/* max # blocks filled ahead per session */
+#define GPFDIST_FILL_MEMORY (4*1024*1024)	/* memory to fill ahead per session */
+
+typedef struct fill_block_t fill_block_t;
+struct fill_block_t
+{
+	char*		data;
+	int			size;		/* # bytes of data, 0 at end of data, -1 on error */
+	apr_int64_t	read_bytes;	/* # bytes consumed from the files to fill it */
+	struct fstream_filename_and_offset fos;
+};
+
+typedef struct session_fill_t session_fill_t;
+struct session_fill_t
+{
+	struct fill_worker_t* worker;	/* thread filling the blocks */
+	session_t*		session;
+	session_fill_t*	next;			/* next session of the worker */
+	char*			line_delim_str;
+	int				line_delim_length;
+
+	fill_block_t*	blocks;			/* ring of blocks */
+	int				nblocks;		/* size of the ring */
+	int				head;			/* next block to send */
+	int				count;			/* # filled blocks from head on */
+	int				is_filling;		/* worker is reading into the block after them */
+	int				is_done;		/* end of data or an error was filled */
+	char			error[256];		/* fstream error of a block with size -1 */
+};
+
+typedef struct fill_worker_t fill_worker_t;
+struct fill_worker_t
+{
+	pthread_t		thread;
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond;			/* a block is needed, or one was filled */
+	session_fill_t*	sessions;		/* sessions assigned to this worker */
+	int				notify_errno;	/* failed notification, logged by the event loop */
+};
+
+/* pick the session of a worker with the fewest filled blocks */
+static session_fill_t* fill_worker_next(fill_worker_t* w)
+{
+	session_fill_t* f;
+	session_fill_t* next = NULL;
+
+	for (f = w->sessions; f; f = f->next)
+	{
+		if (f->is_done || f->count == f->nblocks)
+			continue;
+
+		if (!next || f->count < next->count)
+			next = f;
+	}
+
+	return next;
+}
+
+static void* fill_worker_main(void* arg)
+{
+	fill_worker_t*	w = (fill_worker_t*) arg;
+	const int 		whole_rows = 1; /* gpfdist must not read data with partial rows */
+
+	pthread_mutex_lock(&w->lock);
+
+	for (;;)
+	{
+		session_fill_t*	f = fill_worker_next(w);
+		fstream_t*		fstream;
+		fill_block_t*	b;
+		apr_int64_t		pos;
+
+		if (!f)
+		{
+			pthread_cond_wait(&w->cond, &w->lock);
+			continue;
+		}
+
+		/* the block is ours until count covers it, the session until is_filling is reset */
+		f->is_filling = 1;
+		b = &f->blocks[(f->head + f->count) % f->nblocks];
+		fstream = f->session->fstream;
+		pthread_mutex_unlock(&w->lock);
+
+		pos = fstream_get_compressed_position(fstream);
+		b->size = fstream_read(fstream, b->data, opt.m, &b->fos, whole_rows,
+							   f->line_delim_str, f->line_delim_length);
+
+		if (b->size == 0)
+			b->read_bytes = fstream_get_compressed_size(fstream) - pos;
+		else
+			b->read_bytes = fstream_get_compressed_position(fstream) - pos;
+
+		if (b->size < 0)
+			apr_cpystrn(f->error, fstream_get_error(fstream), sizeof(f->error));
+
+		pthread_mutex_lock(&w->lock);
+
+		f->is_filling = 0;
+		f->count++;
+		if (b->size <= 0)
+			f->is_done = 1;
+
+		/* session_fill_stop() may be waiting for us */
+		pthread_cond_broadcast(&w->cond);
+
+		/*
+		 * wake up the event loop, a full pipe already will.  The logging
+		 * functions are not thread safe, leave the error to the event loop.
+		 */
+		if (write(gcb.notify_pipe[1], "", 1) < 0 && errno != EAGAIN)
+			w->notify_errno = errno;
+	}
+
+	return NULL;
+}
+
+/* log the errors the workers could not log themselves */
+static void fill_report_errors(void)
+{
+	int i;
+
+	for (i = 0; i < opt.threads; i++)
+	{
+		fill_worker_t*	w = &gcb.workers[i];
+		int				e;
+
+		pthread_mutex_lock(&w->lock);
+		e = w->notify_errno;
+		w->notify_errno = 0;
+		pthread_mutex_unlock(&w->lock);
+
+		if (e)
+			gwarning(NULL, "failed to notify filled block: %s", strerror(e));
+	}
+}
+
+/* resume the requests waiting for blocks that are filled now */
+static void fill_notify_cb(int fd, short event, void* arg)
+{
+	char		buf[256];
+	request_t*	waiting = gcb.waiting;
+	request_t*	r;
+
+	while (read(fd, buf, sizeof(buf)) > 0)
+		;
+
+	fill_report_errors();
+
+	gcb.waiting = NULL;
+
+	while ((r = waiting) != NULL)
+	{
+		waiting = r->next_waiting;
+		r->next_waiting = NULL;
+		r->is_waiting = 0;
+
+		if (!session_fill_ready(r->session))
+			request_wait_block(r);
+		else if (setup_write(r))
+			request_end(r, 1, 0);
+	}
+}
+
+/* start the block filling threads */
+static void fill_setup(void)
+{
+	int i;
+
+	if (pipe(gcb.notify_pipe) != 0 ||
+		fcntl(gcb.notify_pipe[0], F_SETFL, O_NONBLOCK) != 0 ||
+		fcntl(gcb.notify_pipe[1], F_SETFL, O_NONBLOCK) != 0)
+		gfatal(NULL, "cannot create notification pipe: %s", strerror(errno));
+
+	event_set(&gcb.notify_event, gcb.notify_pipe[0], EV_READ | EV_PERSIST, fill_notify_cb, 0);
+	if (event_add(&gcb.notify_event, 0))
+		gfatal(NULL, "cannot set up event on notification pipe");
+
+	gcb.workers = calloc(opt.threads, sizeof(fill_worker_t));
+	if (!gcb.workers)
+		gfatal(NULL, "out of memory in fill_setup");
+
+	for (i = 0; i < opt.threads; i++)
+	{
+		fill_worker_t* w = &gcb.workers[i];
+
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->cond, NULL);
+
+		if (pthread_create(&w->thread, NULL, fill_worker_main, w))
+			gfatal(NULL, "cannot create block filling thread");
+	}
+
+	gprintln(NULL, "started %d block filling threads", opt.threads);
+}
+
+/* hand a new GET session to a worker thread */
+static void session_fill_start(request_t* r, session_t* session)
+{
+	static int		next_worker = 0;
+	session_fill_t*	f;
+	fill_worker_t*	w;
+	int				i;
+
+	f = pcalloc_safe(r, session->pool, sizeof(session_fill_t), "out of memory in session_fill_start");
+
+	f->nblocks = GPFDIST_FILL_MEMORY / opt.m;
+	if (f->nblocks > GPFDIST_FILL_BLOCKS)
+		f->nblocks = GPFDIST_FILL_BLOCKS;
+	if (f->nblocks < 2)
+		f->nblocks = 2;
+
+	f->blocks = pcalloc_safe(r, session->pool, sizeof(fill_block_t) * f->nblocks,
+							 "out of memory in session_fill_start");
+	for (i = 0; i < f->nblocks; i++)
+		f->blocks[i].data = palloc_safe(r, session->pool, opt.m,
+										"out of memory when allocating buffer: %d bytes", opt.m);
+
+	f->session = session;
+	f->line_delim_str = apr_pstrdup(session->pool, r->line_delim_str);
+	f->line_delim_length = r->line_delim_length;
+
+	w = &gcb.workers[next_worker];
+	next_worker = (next_worker + 1) % opt.threads;
+
+	pthread_mutex_lock(&w->lock);
+	f->worker = w;
+	f->next = w->sessions;
+	w->sessions = f;
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+
+	session->fill = f;
+}
+
+/*
+ * Take a session back from its worker, so that the event loop owns its
+ * fstream again.  Blocks filled but not sent are dropped.
+ */
+static void session_fill_stop(session_t* session)
+{
+	session_fill_t*		f = session->fill;
+	session_fill_t**	p;
+
+	if (!f)
+		return;
+
+	pthread_mutex_lock(&f->worker->lock);
+
+	while (f->is_filling)
+		pthread_cond_wait(&f->worker->cond, &f->worker->lock);
+
+	for (p = &f->worker->sessions; *p != f; p = &(*p)->next)
+		;
+	*p = f->next;
+
+	pthread_mutex_unlock(&f->worker->lock);
+
+	session->fill = NULL;
+
+	/* requests waiting on the session now find it ended, wake them up */
+	if (write(gcb.notify_pipe[1], "", 1) < 0 && errno != EAGAIN)
+		gwarning(NULL, "failed to notify session end: %s", strerror(errno));
+}
+
+/* true if session_get_block() would not have to wait for a worker */
+static int session_fill_ready(session_t* session)
+{
+	session_fill_t*	f = session ? session->fill : NULL;
+	int				ready;
+
+	if (!f)
+		return 1;
+
+	pthread_mutex_lock(&f->worker->lock);
+	ready = (f->count > 0);
+	pthread_mutex_unlock(&f->worker->lock);
+
+	return ready;
+}
+
+/* stop sending until a worker has filled the next block of the session */
+static void request_wait_block(request_t* r)
+{
+	gdebug(r, "waiting for a block to be filled");
+
+	event_del(&r->ev);
+	r->is_waiting = 1;
+	r->next_waiting = gcb.waiting;
+	gcb.waiting = r;
+}
+
+/* take a request that is going away off gcb.waiting */
+static void request_unwait_block(request_t* r)
+{
+	request_t** p;
+
+	if (!r->is_waiting)
+		return;
+
+	for (p = &gcb.waiting; *p; p = &(*p)->next_waiting)
+	{
+		if (*p == r)
+		{
+			*p = r->next_waiting;
+			break;
+		}
+	}
+
+	r->next_waiting = NULL;
+	r->is_waiting = 0;
+}
+
+/*
+ * session_get_filled_block
+ *
+ * session_get_block() of a session whose blocks are filled by a worker.
+ * The caller made sure one is ready.
+ */
+static const char*
+session_get_filled_block(const request_t* r, block_t* retblock)
+{
+	session_t*		session = r->session;
+	session_fill_t*	f = session->fill;
+	fill_block_t*	b;
+	const char*		ferror = 0;
+
+	pthread_mutex_lock(&f->worker->lock);
+	if (f->count == 0)
+		gfatal(r, "internal error - no filled block to send");
+	b = &f->blocks[f->head];
+	pthread_mutex_unlock(&f->worker->lock);
+
+	delay_watchdog_timer();
+	gcb.read_bytes += b->read_bytes;
+
+	if (b->size > 0)
+	{
+		memcpy(retblock->data, b->data, b->size);
+		retblock->top = b->size;
+
+#ifdef HAVE_LIBZSTD
+		if (r->zstd)
+			block_compress(r, retblock);
+#endif
+
+		/* fill the block header with meta data for the client to parse and use */
+		block_fill_header(r, retblock, &b->fos);
+	}
+	else if (b->size < 0)
+		ferror = apr_pstrdup(r->pool, f->error);
+
+	/* give the block back to the worker */
+	pthread_mutex_lock(&f->worker->lock);
+	f->head = (f->head + 1) % f->nblocks;
+	f->count--;
+	pthread_cond_broadcast(&f->worker->cond);
+	pthread_mutex_unlock(&f->worker->lock);
+
+	if (b->size == 0)
+	{
+		gprintln(NULL, "session_get_block: end session due to EOF");
+		session_end(session, 0);
+	}
+	else if (b->size < 0)
+	{
+		gwarning(NULL, "session_get_block end session due to %s", ferror);
+		session_end(session, 1);
+	}
+
+	return ferror;
+}
+#endif
+
 /*
  * do_write
  *
@@ -1744,7 +2285,18 @@ static void do_write(int fd, short event, void* arg)
 		/* get a block (or find a remaining block) */
 		if (r->outblock.top == r->outblock.bot)
 		{
-			const char* ferror = session_get_block(r, &r->outblock, r->line_delim_str, r->line_delim_length);
+			const char* ferror;
+
+#ifndef WIN32
+			/* resumed by fill_notify_cb() once a worker filled the block */
+			if (!session_fill_ready(r->session))
+			{
+				request_wait_block(r);
+				return;
+			}
+#endif
+
+			ferror = session_get_block(r, &r->outblock, r->line_delim_str, r->line_delim_length);
 
 			if (ferror)
 			{
@@ -2884,8 +3436,96 @@ void percent_encoding_to_char(char* p, char* pp, char* path)
 	*p = 0;
 }
 
+/*
+ * request_write_data
+ *
+ * Write the data rows in the buffer of a POST request to the session's file.
+ * Only whole rows are written, what is left of the last row is moved to the
+ * front of the buffer. Returns -1 after ending the request on a write error.
+ */
+static int request_write_data(request_t *r)
+{
+	session_t *session = r->session;
+	int wrote;
+
+	/* only write up to end of last row */
+	wrote = fstream_write(session->fstream, r->in.dbuf, r->in.dbuftop, 1, r->line_delim_str, r->line_delim_length);
+	gdebug(r, "wrote %d bytes to file", wrote);
+	delay_watchdog_timer();
+
+	if (wrote == -1)
+	{
+		/* write error */
+		gwarning(r, "handle_post_request, write error: %s", fstream_get_error(session->fstream));
+		http_error(r, FDIST_INTERNAL_ERROR, fstream_get_error(session->fstream));
+		request_end(r, 1, 0);
+		return -1;
+	}
+	else if(wrote == r->in.dbuftop)
+	{
+		/* wrote the whole buffer. clean it for next round */
+		r->in.dbuftop = 0;
+	}
+	else
+	{
+		/* wrote up to last line, some data left over in buffer. move to front */
+		int bytes_left_over = r->in.dbuftop - wrote;
+
+		memmove(r->in.dbuf, r->in.dbuf + wrote, bytes_left_over);
+		r->in.dbuftop = bytes_left_over;
+	}
+
+	return 0;
+}
+
+#ifdef HAVE_LIBZSTD
+/*
+ * request_decompress_data
+ *
+ * Decompress len bytes of the zstd compressed body of a POST request into its
+ * buffer, writing out the buffer each time it fills up. Returns -1 after
+ * ending the request on error.
+ */
+static int request_decompress_data(request_t *r, const char* buf, int len)
+{
+	ZSTD_inBuffer in = { buf, len, 0 };
+
+	for (;;)
+	{
+		ZSTD_outBuffer out = { r->in.dbuf, r->in.dbufmax, r->in.dbuftop };
+		size_t ret = ZSTD_decompressStream(gcb.zstd_dstream, &out, &in);
+
+		if (ZSTD_isError(ret))
+		{
+			gwarning(r, "handle_post_request, cannot decompress data: %s", ZSTD_getErrorName(ret));
+			http_error(r, FDIST_BAD_REQUEST, "invalid compressed data");
+			request_end(r, 1, 0);
+			return -1;
+		}
+
+		r->in.dbuftop = out.pos;
+		r->in.zstd_pending = ret;
+
+		/* a full buffer may leave decompressed data behind in the stream */
+		if (r->in.dbuftop == r->in.dbufmax)
+		{
+			if (request_write_data(r) < 0)
+				return -1;
+		}
+		else if (in.pos == in.size)
+			break;
+	}
+
+	return 0;
+}
+#endif
+
 static void handle_get_request(request_t *r)
 {
+	/* only PROTO-1 can tell compressed blocks apart */
+	if (r->gp_proto != 1)
+		r->zstd = 0;
+
 	/* setup to receive EV_WRITE events to write to socket */
 	if (setup_write(r))
 	{
@@ -3000,6 +3640,17 @@ static void handle_post_request(request_t *r, int header_end)
 	r->in.dbuftop = 0;
 	r->in.dbuf = palloc_safe(r, r->pool, r->in.dbufmax, "out of memory when allocating r->in.dbuf: %d bytes", r->in.dbufmax);
 
+#ifdef HAVE_LIBZSTD
+	if (r->zstd)
+	{
+		size_t ret = ZSTD_initDStream(gcb.zstd_dstream);
+
+		if (ZSTD_isError(ret))
+			gfatal(r, "cannot initialize zstd stream: %s", ZSTD_getErrorName(ret));
+		r->in.zstd_pending = 0;
+	}
+#endif
+
 	/* if some data come along with the request, copy it first */
 	data_start = strstr(r->in.hbuf, "\r\n\r\n");
 	if(data_start)
@@ -3008,6 +3659,16 @@ static void handle_post_request(request_t *r, int header_end)
 		data_bytes_in_req = (r->in.hbuf + r->in.hbuftop) - data_start;
 	}
 
+#ifdef HAVE_LIBZSTD
+	if(data_bytes_in_req > 0 && r->zstd)
+	{
+		/* compressed data is decompressed into dbuf as it comes */
+		r->in.davailable -= data_bytes_in_req;
+		if (request_decompress_data(r, data_start, data_bytes_in_req) < 0)
+			return;
+	}
+	else
+#endif
 	if(data_bytes_in_req > 0)
 	{
 		/* we have data after the request headers. consume it */
@@ -3039,15 +3700,25 @@ static void handle_post_request(request_t *r, int header_end)
 	{
 		size_t want;
 		ssize_t n;
+		char* buf = r->in.dbuf + r->in.dbuftop;
 		size_t buf_space_left = r->in.dbufmax - r->in.dbuftop;
 
+#ifdef HAVE_LIBZSTD
+		/* compressed data is received separately, then decompressed into dbuf */
+		if (r->zstd)
+		{
+			buf = gcb.zstd_buf;
+			buf_space_left = gcb.zstd_bufsize;
+		}
+#endif
+
 		if (r->in.davailable > buf_space_left)
 			want = buf_space_left;
 		else
 			want = r->in.davailable;
 
 		/* read from socket into data buf */
-		n = gpfdist_receive(r, r->in.dbuf + r->in.dbuftop, want);
+		n = gpfdist_receive(r, buf, want);
 
 		if (n < 0)
 		{
@@ -3080,42 +3751,45 @@ static void handle_post_request(request_t *r, int header_end)
 			r->bytes += n;
 			r->last = apr_time_now();
 			r->in.davailable -= n;
+
+#ifdef HAVE_LIBZSTD
+			if (r->zstd)
+			{
+				if (request_decompress_data(r, buf, n) < 0)
+					return;
+				continue;
+			}
+#endif
+
 			r->in.dbuftop += n;
 
 			/* if filled our buffer or no more data expected, write it */
 			if (r->in.dbufmax == r->in.dbuftop || r->in.davailable == 0)
 			{
-				/* only write up to end of last row */
-				wrote = fstream_write(session->fstream, r->in.dbuf, r->in.dbuftop, 1, r->line_delim_str, r->line_delim_length);
-				gdebug(r, "wrote %d bytes to file", wrote);
-				delay_watchdog_timer();
-
-				if (wrote == -1)
-				{
-					/* write error */
-					gwarning(r, "handle_post_request, write error: %s", fstream_get_error(session->fstream));
-					http_error(r, FDIST_INTERNAL_ERROR, fstream_get_error(session->fstream));
-					request_end(r, 1, 0);
+				if (request_write_data(r) < 0)
 					return;
-				}
-				else if(wrote == r->in.dbuftop)
-				{
-					/* wrote the whole buffer. clean it for next round */
-					r->in.dbuftop = 0;
-				}
-				else
-				{
-					/* wrote up to last line, some data left over in buffer. move to front */
-					int bytes_left_over = r->in.dbuftop - wrote;
-
-					memmove(r->in.dbuf, r->in.dbuf + wrote, bytes_left_over);
-					r->in.dbuftop = bytes_left_over;
-				}
 			}
 		}
 
 	}
 
+#ifdef HAVE_LIBZSTD
+	if (r->zstd)
+	{
+		if (r->in.zstd_pending != 0)
+		{
+			gwarning(r, "handle_post_request, compressed data ends in the middle of a frame");
+			http_error(r, FDIST_BAD_REQUEST, "invalid compressed data");
+			request_end(r, 1, 0);
+			return;
+		}
+
+		/* write out the rows decompressed last */
+		if (r->in.dbuftop > 0 && request_write_data(r) < 0)
+			return;
+	}
+#endif
+
 	session->seq_segs[r->segid] = r->seq;
 
 done_processing_request:
@@ -3299,6 +3973,8 @@ static int request_parse_gp_headers(request_t *r, int opt_g)
 		else if (0 == strcasecmp("X-GP-TRANSFORM", r->in.req->hname[i]))
 			r->trans.name = r->in.req->hvalue[i];
 #endif
+		else if (0 == strcasecmp("X-GP-ZSTD", r->in.req->hname[i]))
+			r->zstd = opt.compress && 0 == strcmp("1", r->in.req->hvalue[i]);
 		else if (0 == strcasecmp("X-GP-SEQ", r->in.req->hname[i]))
 		{
 			r->seq = atol(r->in.req->hvalue[i]);
@@ -3553,6 +4229,16 @@ int gpfdist_init(int argc, const char* const argv[])
     signal_register();
 	http_setup();
 
+#ifndef WIN32
+	if (opt.threads > 0)
+		fill_setup();
+#endif
+
+#ifdef HAVE_LIBZSTD
+	if (opt.compress)
+		zstd_setup();
+#endif
+
 #ifdef USE_SSL
 	if (opt.ssl)
 		printf("Serving HTTPS on port %d, directory %s\n", opt.p, opt.d);
@@ -4293,6 +4979,9 @@ static void do_close(int fd, short event, void *arg)
  */
 static void request_cleanup(request_t *r)
 {
+#ifndef WIN32
+	request_unwait_block(r);
+#endif
 	request_shutdown_sock(r);
 	setup_do_close(r);
 }
@@ -0,0 +1,101 @@
+/*------------------------------------------------------------------------------
+ *
+ * appendonly_zonemap.h
+ *   per-block min/max summaries (zone maps) for append-only tables.
+ *
+ * A zone map entry records, for a single append-only storage block, the
+ * minimum and maximum value of a handful of fixed-width columns.  Entries
+ * are kept in a shared memory cache keyed by the block's position in its
+ * segment file.  They are produced when a block is written by
+ * appendonly_insert(), or when a block without an entry is read in full by
+ * a scan that could have used one.  Scans then consult the cache after
+ * reading a block header, and skip the block without decompressing it when
+ * its summary proves that no row can satisfy the scan's quals.
+ *
+ * Blocks in an append-only segment file are never modified in place, and
+ * every block carries the first row number assigned to it from
+ * gp_fastsequence, which is never reused for a segment file.  An entry is
+ * only trusted if the block's first row number and row count match what
+ * was recorded, so stale entries left behind by aborted inserts, TRUNCATE
+ * or compaction are simply ignored.
+ *
+ * Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/access/appendonly_zonemap.h
+ *
+ *------------------------------------------------------------------------------
+ */
+#ifndef APPENDONLY_ZONEMAP_H
+#define APPENDONLY_ZONEMAP_H
+
+#include "access/memtup.h"
+#include "access/skey.h"
+#include "executor/tuptable.h"
+#include "fmgr.h"
+#include "nodes/pg_list.h"
+#include "storage/relfilenode.h"
+#include "utils/relcache.h"
+
+/*
+ * Maximum number of columns summarized per block.  Only the first
+ * AOZONEMAP_MAX_COLUMNS pass-by-value columns with a default btree
+ * operator class are summarized.
+ */
+#define AOZONEMAP_MAX_COLUMNS 8
+
+/*
+ * GUC variables
+ */
+extern int	gp_appendonly_zonemap_entries;
+extern bool gp_appendonly_zonemap_scan;
+
+/*
+ * Accumulates the summary of the block currently being written or read.
+ */
+typedef struct AppendOnlyZoneMapBuilder
+{
+	int			ncols;			/* 0 if nothing to summarize */
+	AttrNumber	attnum[AOZONEMAP_MAX_COLUMNS];
+	FmgrInfo   *cmpfn[AOZONEMAP_MAX_COLUMNS];	/* btree comparison support */
+
+	int			nrows;			/* rows added since the last reset */
+	bool		hasvalue[AOZONEMAP_MAX_COLUMNS];
+	Datum		minval[AOZONEMAP_MAX_COLUMNS];
+	Datum		maxval[AOZONEMAP_MAX_COLUMNS];
+} AppendOnlyZoneMapBuilder;
+
+extern Size AppendOnlyZoneMapShmemSize(void);
+extern void AppendOnlyZoneMapShmemInit(void);
+
+extern void AppendOnlyZoneMapBuilder_Init(AppendOnlyZoneMapBuilder *builder,
+							  Relation rel);
+extern void AppendOnlyZoneMapBuilder_Reset(AppendOnlyZoneMapBuilder *builder);
+extern void AppendOnlyZoneMapBuilder_AddMemTuple(AppendOnlyZoneMapBuilder *builder,
+									 MemTuple tuple,
+									 MemTupleBinding *mt_bind);
+extern void AppendOnlyZoneMapBuilder_AddSlot(AppendOnlyZoneMapBuilder *builder,
+								 TupleTableSlot *slot);
+
+extern void AppendOnlyZoneMap_Record(AppendOnlyZoneMapBuilder *builder,
+						 RelFileNode *node,
+						 int segno,
+						 int64 fileOffset,
+						 int64 firstRowNum,
+						 int rowCount);
+extern bool AppendOnlyZoneMap_BlockMayMatch(RelFileNode *node,
+								int segno,
+								int64 fileOffset,
+								int64 firstRowNum,
+								int rowCount,
+								int nkeys,
+								ScanKey keys,
+								bool *found);
+
+extern ScanKey AppendOnlyZoneMap_BuildScanKeys(Relation rel,
+								List *qual,
+								Index scanrelid,
+								int *nkeys);
+
+#endif   /* APPENDONLY_ZONEMAP_H */
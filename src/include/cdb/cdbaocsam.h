@@ -71,6 +71,61 @@ typedef struct AOCSInsertDescData
 
 typedef AOCSInsertDescData *AOCSInsertDesc;
 
+/*
+ * Batch qual evaluation
+ *
+ * Simple "column op constant" quals on integer-like columns can be handed to
+ * the scan with aocs_set_batch_quals().  aocs_getnext() then reads the values
+ * of the qual columns for up to AOCS_BATCH_SIZE rows at a time, evaluates the
+ * quals in tight loops over those arrays into a selection vector, and only
+ * fetches the other projected columns of the selected rows.  Rejected rows
+ * never reach a slot or ExecQual.  See aocs_batch.c.
+ */
+#define AOCS_BATCH_SIZE 1024
+
+typedef enum AOCSBatchQualType
+{
+	AOCSBATCH_INT16,
+	AOCSBATCH_INT32,
+	AOCSBATCH_INT64
+} AOCSBatchQualType;
+
+typedef struct AOCSBatchQual
+{
+	int			attno;			/* column number, starting from 0 */
+	AOCSBatchQualType type;		/* how the values compare */
+	StrategyNumber strategy;	/* btree strategy of the operator */
+	Datum		constval;		/* the constant, of the column's type */
+} AOCSBatchQual;
+
+typedef struct AOCSBatch
+{
+	int			nquals;
+	AOCSBatchQual *quals;
+
+	/* projected columns, split into those of the quals and the others */
+	int		   *key_atts;
+	int			num_key_atts;
+	int		   *other_atts;
+	int			num_other_atts;
+
+	/* values of the key columns, AOCS_BATCH_SIZE per column */
+	Datum	   *values;
+	bool	   *isnull;
+	int64	   *rownums;		/* row number of each row, -1 if unknown */
+
+	int			nrows;			/* # rows read into the batch */
+	int			next;			/* next row of the batch to return */
+	bool		seg_done;		/* the current segment file has no more rows */
+
+	/* rows satisfying all the quals, in order */
+	uint16	   *sel;
+	int			nsel;
+	int			nextsel;		/* next entry of sel to return */
+} AOCSBatch;
+
+extern bool gp_aocs_batch_quals;
+
 /*
  * used for scan of append only relations using BufferedRead and VarBlocks
  */
@@ -126,6 +181,9 @@ typedef struct AOCSScanDescData
 
 	AppendOnlyVisimap visibilityMap;
 
+	/* Batch qual evaluation, NULL unless aocs_set_batch_quals() was called */
+	AOCSBatch  *batch;
+
 }	AOCSScanDescData;
 
 typedef AOCSScanDescData *AOCSScanDesc;
@@ -212,6 +270,7 @@ extern void aocs_rescan(AOCSScanDesc scan);
 extern void aocs_endscan(AOCSScanDesc scan);
 
 extern bool aocs_getnext(AOCSScanDesc scan, ScanDirection direction, TupleTableSlot *slot);
+extern void aocs_set_batch_quals(AOCSScanDesc scan, int nquals, AOCSBatchQual *quals);
 extern AOCSInsertDesc aocs_insert_init(Relation rel, int segno, bool update_mode);
 extern Oid aocs_insert_values(AOCSInsertDesc idesc, Datum *d, bool *null, AOTupleId *aoTupleId);
 static inline Oid aocs_insert(AOCSInsertDesc idesc, TupleTableSlot *slot)
@@ -266,4 +325,9 @@ extern void aocs_addcol_emptyvpe(
 		int32 nseg, int num_newcols);
 extern void aocs_addcol_setfirstrownum(AOCSAddColumnDesc desc,
 		int64 firstRowNum);
+
+/* in aocs_batch.c */
+extern AOCSBatchQual *aocs_batch_build_quals(Relation rel, List *qual,
+					   Index scanrelid, int *nquals, bool *used);
+extern void aocs_batch_eval_quals(AOCSBatch *batch);
 #endif   /* AOCSAM_H */
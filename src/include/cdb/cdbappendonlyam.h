@@ -25,6 +25,7 @@
 #include "access/xlogutils.h"
 #include "access/xlog.h"
 #include "access/appendonly_visimap.h"
+#include "access/appendonly_zonemap.h"
 #include "executor/tuptable.h"
 #include "nodes/primnodes.h"
 #include "nodes/bitmapset.h"
@@ -107,6 +108,9 @@ typedef struct AppendOnlyInsertDescData
 	/* The block directory for the appendonly relation. */
 	AppendOnlyBlockDirectory blockDirectory;
 
+	/* Summary of the rows in the current block, see appendonly_zonemap.h */
+	AppendOnlyZoneMapBuilder zoneMapBuilder;
+
 	bool update_mode;
 } AppendOnlyInsertDescData;
 
@@ -133,6 +137,7 @@ typedef struct AppendOnlyExecutorReadBlock
 	int64			totalRowsScannned;
 
 	int64			blockFirstRowNum;
+	bool			hasFirstRowNum;	/* block header stores firstRowNum */
 	int64			headerOffsetInFile;
 	uint8			*dataBuffer;
 	int32			dataLen;
@@ -221,6 +226,18 @@ typedef struct AppendOnlyScanDescData
 	 */ 
 	AppendOnlyVisimap visibilityMap;
 
+	/*
+	 * Zone map support.  Blocks whose summary shows that no row can satisfy
+	 * aos_zonemap_keys are skipped without reading their contents.  Blocks
+	 * that have no summary yet are summarized while they are scanned.
+	 */
+	int			aos_zonemap_nkeys;
+	ScanKey		aos_zonemap_keys;
+	AppendOnlyZoneMapBuilder aos_zonemap_builder;
+	bool		aos_zonemap_building;	/* summarizing the current block? */
+	int64		aos_zonemap_firstRowNum;	/* firstRowNum of that block */
+	int64		aos_zonemap_skipped;	/* number of blocks skipped */
+
 }	AppendOnlyScanDescData;
 
 typedef AppendOnlyScanDescData *AppendOnlyScanDesc;
@@ -336,6 +353,8 @@ extern AppendOnlyScanDesc appendonly_beginrangescan(Relation relation,
 		int *segfile_no_arr, int segfile_count,
 		int nkeys, ScanKey keys);
 extern void appendonly_rescan(AppendOnlyScanDesc scan, ScanKey key);
+extern void appendonly_set_zonemap_keys(AppendOnlyScanDesc scan,
+										int nkeys, ScanKey keys);
 extern void appendonly_endscan(AppendOnlyScanDesc scan);
 extern bool appendonly_getnext(AppendOnlyScanDesc scan,
 							   ScanDirection direction,
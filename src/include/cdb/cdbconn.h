@@ -16,6 +16,7 @@
 #ifndef CDBCONN_H
 #define CDBCONN_H
 
+#include "cdb/cdbplancache.h"
 
 /* --------------------------------------------------------------------------------------------------
  * Structure for segment database definition and working values
@@ -53,6 +54,21 @@ typedef struct SegmentDatabaseDescriptor
     char                   *whoami;         /* QE identifier for msgs */
 	bool					isWriter;
 	int						identifier;		/* unique identifier in the cdbcomponent segment pool */
+
+	/*
+	 * True while a connection started by cdbgang_prewarmQEs_async() has not
+	 * been completed yet.  pollingStatus is what PQconnectPoll() last
+	 * returned for it.
+	 */
+	bool					connecting;
+	PostgresPollingStatusType pollingStatus;
+
+	/*
+	 * The plans the QE keeps in its plan cache, valid if
+	 * cachedPlansGeneration is current.  See cdbplancache.c.
+	 */
+	QEPlanCacheList			cachedPlans;
+	uint32					cachedPlansGeneration;
 } SegmentDatabaseDescriptor;
 
 SegmentDatabaseDescriptor *
@@ -51,6 +51,7 @@ typedef struct DispatcherInternalFuncs
 	bool (*checkForCancel)(struct CdbDispatcherState *ds);
 	int (*getWaitSocketFd)(struct CdbDispatcherState *ds);
 	void* (*makeDispatchParams)(int maxSlices, int largestGangSize, char *queryText, int queryTextLen);
+	void (*setQueryText)(void *dispatchParams, char *queryText, int queryTextLen);
 	void (*checkResults)(struct CdbDispatcherState *ds, DispatchWaitMode waitMode);
 	void (*dispatchToGang)(struct CdbDispatcherState *ds, struct Gang *gp, int sliceIndex);
 	void (*waitDispatchFinish)(struct CdbDispatcherState *ds);
@@ -164,6 +165,16 @@ cdbdisp_makeDispatchParams(CdbDispatcherState *ds,
 						   char *queryText,
 						   int queryTextLen);
 
+/*
+ * Replace the query text that the following cdbdisp_dispatchToGang() calls
+ * send.  The text must live as long as the dispatcher state, e.g. in
+ * DispatcherContext.
+ */
+void
+cdbdisp_setDispatchQueryText(CdbDispatcherState *ds,
+							 char *queryText,
+							 int queryTextLen);
+
 bool cdbdisp_checkForCancel(CdbDispatcherState * ds);
 int cdbdisp_getWaitSocketFd(CdbDispatcherState *ds);
 
@@ -20,6 +20,7 @@
 #include "utils/portal.h"
 
 struct Port;
+struct Query;
 struct QueryDesc;
 struct DirectDispatchInfo;
 struct EState;
@@ -81,6 +82,8 @@ extern Gang *AllocateGang(struct CdbDispatcherState *ds, enum GangType type, Lis
 extern void RecycleGang(Gang *gp, bool forceDestroy);
 extern void DisconnectAndDestroyAllGangs(bool resetSession);
 extern void DisconnectAndDestroyUnusedQEs(void);
+extern void PrewarmSessionQEs(void);
+extern void PrewarmWriterGangForQuery(struct Query *query);
 
 extern void CheckForResetSession(void);
 
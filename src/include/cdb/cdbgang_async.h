@@ -18,5 +18,6 @@
 #include "cdb/cdbgang.h"
 
 extern Gang *cdbgang_createGang_async(List *segments, SegmentType segmentType);
+extern void cdbgang_prewarmQEs_async(int qesPerSegment);
 
 #endif
@@ -31,6 +31,7 @@ struct CdbProcess;                          /* #include "nodes/execnodes.h" */
 struct Slice;                               /* #include "nodes/execnodes.h" */
 struct SliceTable;                          /* #include "nodes/execnodes.h" */
 struct EState;                              /* #include "nodes/execnodes.h" */
+struct ShmICConn;                           /* #include "cdb/ic_shm.h" */
 
 typedef struct icpkthdr
 {
@@ -304,6 +305,12 @@ struct MotionConn
 	 * all the remap information.
 	 */
 	TupleRemapper	*remapper;
+
+	/*
+	 * shared memory ring used instead of the network for a peer on the same
+	 * host, or NULL.
+	 */
+	struct ShmICConn *shm;
 };
 
 /*
@@ -342,6 +349,9 @@ typedef struct ChunkTransportStateEntry
 
 	bool		sendingEos;
 
+	/* number of connections passing packets through shared memory */
+	int			numShmConns;
+
 	/* Statistics info for this motion on the interconnect level */
 	uint64 stat_total_ack_time;
 	uint64 stat_count_acks;
@@ -412,6 +422,13 @@ typedef struct MotionNodeEntry
 	 */
 	SerTupInfo      ser_tup_info;
 
+	/*
+	 * Column-wise batches of tuples waiting to be sent, one per route and
+	 * one for broadcasts, if gp_motion_batch_size is set.
+	 */
+	SerTupBatch   **send_batches;
+	int             num_send_batches;
+
 	/*
 	 * If preserve_order is false, this is used to hold completed tuples that
 	 * have not yet been consumed.  If preserve_order is true, this is NULL.
@@ -0,0 +1,60 @@
+/*-------------------------------------------------------------------------
+ *
+ * cdbplancache.h
+ *	  Caching of dispatched plans on the QEs.
+ *
+ * Portions Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/cdb/cdbplancache.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CDBPLANCACHE_H
+#define CDBPLANCACHE_H
+
+#include "nodes/plannodes.h"
+
+/*
+ * Number of plans each QE keeps.  The QD mirrors the contents of every QE's
+ * cache, so this must be the same on both sides and is not configurable.
+ */
+#define QE_PLAN_CACHE_SIZE		16
+
+/*
+ * Total size of the plans each QE keeps, counted as their serialized size
+ * before compression, which is about what they take deserialized.  The least
+ * recently used plans are dropped to make room for a new one, and a plan
+ * bigger than this is not cached at all.
+ */
+#define QE_PLAN_CACHE_MAX_BYTES	(8 * 1024 * 1024)
+
+/*
+ * The fingerprints of the plans a QE keeps, most recently used first, and
+ * their sizes.  The QE has one, and the QD a copy of it for every QE.
+ */
+typedef struct QEPlanCacheList
+{
+	int			count;
+	Size		totalSize;
+	uint64		fingerprints[QE_PLAN_CACHE_SIZE];
+	int			sizes[QE_PLAN_CACHE_SIZE];
+} QEPlanCacheList;
+
+struct SegmentDatabaseDescriptor;
+
+/* QD side */
+extern uint64 QEPlanCacheFingerprint(const char *splan, int len);
+extern bool QEPlanCacheFits(int size);
+extern bool QEPlanCacheHasPlan(struct SegmentDatabaseDescriptor *segdbDesc,
+				   uint64 fingerprint);
+extern void QEPlanCacheRemember(struct SegmentDatabaseDescriptor *segdbDesc,
+					uint64 fingerprint, int size);
+extern void QEPlanCacheForgetAll(void);
+
+/* QE side */
+extern void QEPlanCacheStore(uint64 fingerprint, int size, PlannedStmt *plan);
+extern PlannedStmt *QEPlanCacheLookup(uint64 fingerprint);
+
+#endif   /* CDBPLANCACHE_H */
@@ -21,6 +21,8 @@
 #include "nodes/nodes.h"
 
 extern char *serializeNode(Node *node, int *size, int *uncompressed_size);
+extern char *compressSerializedNode(char *pszNode, int uncompressed_size, int *size);
 extern Node *deserializeNode(const char *strNode, int size);
+extern int serializedNodeSize(const char *strNode, int size);
 
 #endif   /* CDBSRLZ_H */
@@ -159,6 +159,19 @@ extern int qdPostmasterPort;
 /*How many gangs to keep around from stmt to stmt.*/
 extern int			gp_cached_gang_threshold;
 
+/*
+ * How many QEs per segment to start connecting when a session starts, before
+ * its first query.  See PrewarmSessionQEs().
+ */
+extern int			gp_prewarm_segworkers;
+
+/*
+ * Start connecting the writer gang of a session that has no QEs before
+ * planning a query that needs one, rather than after.  See
+ * PrewarmWriterGangForQuery().
+ */
+extern bool gp_overlap_gang_creation;
+
 /*
  * gp_reject_percent_threshold
  *
@@ -330,6 +343,19 @@ extern int	Gp_max_packet_size;	/* GUC var */
 #define MIN_PACKET_SIZE 512
 #define MAX_PACKET_SIZE 65507 /* Max payload for IPv4/UDP (subtract 20 more for IPv6 without extensions) */
 
+/*
+ * Parameter gp_motion_batch_size
+ *
+ * When greater than 0, motion senders pack up to this many tuples of a
+ * motion whose attributes are all fixed width into one column-wise batch,
+ * which is sent as a single tuple chunk.  A batch never grows larger than
+ * a tuple chunk, so wide tuples get smaller batches.  0 sends tuples one
+ * at a time.
+ *
+ * Receivers recognize batches whatever their own setting is.
+ */
+extern int	gp_motion_batch_size;
+
 /*
  * Support for multiple "types" of interconnect
  */
@@ -371,6 +397,19 @@ extern int	Gp_interconnect_queue_depth;
  *
  */
 extern int	Gp_interconnect_snd_queue_depth;
+
+/*
+ * Parameter Gp_interconnect_io_batch_size
+ *
+ * The run-time parameter Gp_interconnect_io_batch_size controls the
+ * maximum number of packets sent or received with a single system call,
+ * where sendmmsg()/recvmmsg() are available.  1 sends and receives one
+ * packet per call.
+ *
+ * This guc is specific to the UDP-interconnect.
+ *
+ */
+extern int	Gp_interconnect_io_batch_size;
 extern int	Gp_interconnect_timer_period;
 extern int	Gp_interconnect_timer_checking_period;
 extern int	Gp_interconnect_default_rtt;
@@ -407,6 +446,14 @@ extern bool gp_interconnect_log_stats;
 
 extern bool gp_interconnect_cache_future_packets;
 
+/*
+ * Parameter gp_interconnect_shm
+ *
+ * Pass the packets of UDP interconnect connections between QEs on the same
+ * host through shared memory instead of the network.
+ */
+extern bool gp_interconnect_shm;
+
 #define UNDEF_SEGMENT -2
 
 /*
@@ -556,6 +603,12 @@ extern bool gp_adjust_selectivity_for_outerjoins;
 extern int gp_hashjoin_tuples_per_bucket;
 extern int gp_hashagg_groups_per_bucket;
 
+/*
+ * Push a bloom filter built from a hash join's inner side down to the
+ * sequential scan feeding its outer side.
+ */
+extern bool gp_enable_runtime_filter;
+
 /*
  * Damping of selectivities of clauses which pertain to the same base
  * relation; compensates for undetected correlation
@@ -706,6 +759,12 @@ extern bool gp_enable_sort_distinct;
 extern bool gp_enable_mk_sort;
 extern bool gp_enable_motion_mk_sort;
 
+/*
+ * Number of threads, counting the backend itself, that may sort a large
+ * in-memory multi-key sort (see mk_qsort_parallel()).
+ */
+extern int gp_mk_sort_threads;
+
 #ifdef USE_ASSERT_CHECKING
 extern bool gp_mk_sort_check;
 #endif
@@ -735,15 +794,44 @@ extern bool gp_cte_sharing;
 /* Enable RECURSIVE clauses in common table expressions */
 extern bool gp_recursive_cte;
 
+/*
+ * Largest result of a cross-slice shared scan, in kB, that is passed to its
+ * readers in dynamic shared memory instead of workfiles; 0 to always use
+ * workfiles.
+ */
+extern int gp_shareinput_shm_kb;
+
 /* Priority for the segworkers relative to the postmaster's priority */
 extern int gp_segworker_relative_priority;
 
 /*  Max size of dispatched plans; 0 if no limit */
 extern int gp_max_plan_size;
 
+/*
+ * Dispatch to each gang a copy of the plan that leaves out the subtrees
+ * below Motions that the gang neither sends from nor lies beneath, and the
+ * subplans that are only used there.  Relies on the QEs pruning alien plan
+ * nodes (execute_pruned_plan), and falls back to the whole plan otherwise.
+ */
+extern bool gp_dispatch_plan_fragments;
+
+/*
+ * Have the QEs keep the last few plans they were sent.  A plan that all QEs
+ * of a gang already have is dispatched by its fingerprint only, see
+ * cdbplancache.c.
+ */
+extern bool gp_qe_plan_cache;
+
 /* If we use two stage hashagg, we can stream the bottom half */
 extern bool gp_hashagg_streambottom;
 
+/*
+ * A streaming bottom hashagg whose hash table fills up with fewer than this
+ * many input rows per group stops aggregating, and passes the rest of its
+ * input up one row at a time.  0 disables it.
+ */
+extern double gp_hashagg_stream_min_reduction;
+
 /* The default number of batches to use when the hybrid hashed aggregation
  * algorithm (re-)spills in-memory groups to disk.
  */
@@ -0,0 +1,43 @@
+/*-------------------------------------------------------------------------
+ * ic_shm.h
+ *	  Shared memory transport for interconnect connections between QEs on
+ *	  the same host.
+ *
+ * Portions Copyright (c) 2018-Present Pivotal Software, Inc.
+ *
+ *
+ * IDENTIFICATION
+ *	    src/include/cdb/ic_shm.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef IC_SHM_H
+#define IC_SHM_H
+
+#include "cdb/cdbinterconnect.h"
+
+/* Number of packets a connection's ring holds */
+#define SHMIC_RING_SLOTS		16
+
+typedef struct ShmICConn ShmICConn;
+
+extern bool ShmICSameHost(struct CdbProcess *self, struct CdbProcess *peer);
+extern struct CdbProcess *ShmICLocalProcess(List *processes);
+
+extern ShmICConn *ShmICAttach(int motNodeId, int sndPid, int rcvPid,
+			bool isSender);
+extern void ShmICDetach(ShmICConn *shm);
+extern void ShmICCleanup(void);
+
+/* sender side */
+extern bool ShmICSend(ShmICConn *shm, icpkthdr *pkt, bool *wakeReceiver);
+extern void ShmICWaitForReceiver(ShmICConn *shm);
+
+/* receiver side */
+extern icpkthdr *ShmICPeek(ShmICConn *shm);
+extern void ShmICRelease(ShmICConn *shm);
+extern bool ShmICPrepareWait(ShmICConn *shm);
+extern void ShmICEndWait(ShmICConn *shm);
+extern void ShmICRequestStop(ShmICConn *shm);
+
+#endif   /* IC_SHM_H */
@@ -60,8 +60,33 @@ typedef struct SerTupInfo
 
 	/* true if tupdesc contains record types */
 	bool		has_record_types;
+
+	/* true if tuples may be sent in column-wise batches */
+	bool		batchable;
+
+	/* Tuples formed from the last batch received, see GetNextBatchTuple() */
+	GenericTuple *batch_tuples;
+	int			batch_ntuples;
+	int			batch_next;
+	int			batch_maxtuples;
 }	SerTupInfo;
 
+/*
+ * Tuples of one route waiting to be sent as a column-wise batch.
+ *
+ * The non-NULL values of each attribute are packed one after the other,
+ * typlen bytes each, and a bitmap records which rows have a value.
+ */
+typedef struct SerTupBatch
+{
+	int			ntuples;		/* tuples in the batch */
+	int			capacity;		/* tuples the batch can take */
+	int		   *nvalues;		/* number of non-NULL values per attribute */
+	char	  **values;			/* packed non-NULL values per attribute */
+	bits8	  **nulls;			/* per attribute bitmap, set if not NULL */
+	bool	   *hasnulls;		/* does the attribute have any NULLs? */
+}	SerTupBatch;
+
 /*
  * forward declaration to avoid #including cdbmotion.h here, which would create a circular
  * dependency
@@ -84,6 +109,18 @@ extern void SerializeRecordCacheIntoChunks(SerTupInfo *pSerInfo,
 /* Convert a HeapTuple into chunks directly in a set of transport buffers */
 extern int SerializeTuple(TupleTableSlot *tuple, SerTupInfo *pSerInfo, struct directTransportBuffer *b, TupleChunkList tcList, int16 targetRoute);
 
+/* Set up a batch for sending tuples column-wise, NULL if not worthwhile */
+extern SerTupBatch *CreateTupleBatch(SerTupInfo *pSerInfo);
+
+/* Add a tuple to a batch, returns true if the batch is full */
+extern bool AddTupleToBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, TupleTableSlot *slot);
+
+/* Convert a batch into chunks, or directly into a transport buffer */
+extern int SerializeTupleBatch(SerTupInfo *pSerInfo, SerTupBatch *batch, struct directTransportBuffer *b, TupleChunkList tcList, int16 targetRoute);
+
+/* Return the next tuple of the batch last seen by CvtChunksToTup() */
+extern GenericTuple GetNextBatchTuple(SerTupInfo *pSerInfo);
+
 /* Deserialize a HeapTuple's data from a byte-array. */
 extern HeapTuple DeserializeTuple(SerTupInfo * pSerInfo, StringInfo serialTup);
 
@@ -244,6 +244,7 @@ typedef struct CopyStateData
 	bool          skip_ext_partition;  /* skip external partition */
 
 	bool		on_segment; /* QE save data files locally */
+	bool		forward_lines;	/* QD forwards unparsed lines to the QEs */
 	bool		ignore_extra_line; /* Don't count CSV header or binary trailer in
 									  "processed" line number for on_segment mode*/
 	ProgramPipes	*program_pipes; /* COPY PROGRAM pipes for data and stderr */
@@ -194,6 +194,7 @@ typedef struct HashAggTable
 	double mem_for_metadata; /* Current memory usage for metadata */
 	double mem_wanted; /* The desirable work_mem */
 	double mem_used; /* The maximum amount of used memory. */
+	double mem_borrowed; /* Part of max_mem lent by the resource group */
 	
 	uint32 num_reloads; /* number of times reloading a batch file */
 	uint32 num_batches; /* number of batch files */
@@ -209,6 +210,14 @@ typedef struct HashAggTable
 	bool expandable;  /* hash table buckets still have space to grow */
 	struct TupleTableSlot *prev_slot; /* a slot that is read previously. */
 
+	/*
+	 * Streaming only: the hash table reduced its input too little, so the
+	 * remaining input is passed through one row per output group.
+	 */
+	bool passthrough;
+	uint64 num_passthrough_tuples; /* number of input tuples passed through */
+	AggStatePerGroup passthrough_aggs; /* transition values of the current row */
+
 	/* Statistics used for EXPLAIN ANALYZE */
 	CdbExplain_Agg      chainlength;
 	uint64 total_buckets; /* total of nbuckets across spills and reloads */
@@ -110,6 +110,41 @@ typedef struct HashSkewBucket
 #define SKEW_MIN_OUTER_FRACTION  0.01
 
 
+/*
+ * Runtime filter
+ *
+ * When gp_enable_runtime_filter is set and the outer input of an inner or
+ * semi hash join is a sequential scan in the same slice, or a dynamic one
+ * that hands the filter on to each partition's scan, the join builds a
+ * bloom filter over the hash values of all inner tuples while it builds the
+ * hash table, and hands it down to the scan.  The scan computes the same
+ * hash value from its own tuple and drops those whose value is definitely
+ * not in the filter, before the scan quals are evaluated and before the
+ * tuple travels up through the plan.  False positives are harmless: the
+ * join's hash table probe still decides what matches.
+ *
+ * The filter lives in the per-query context, as it must outlive any one
+ * hash table when the join is rescanned.
+ */
+typedef struct HashJoinRuntimeFilter
+{
+	bool		active;			/* bits describe a completely built table */
+	bool		keepNulls;		/* NULL keys hash as zero instead of failing */
+	int			nkeys;			/* number of hash keys */
+	AttrNumber *attnos;			/* scan tuple attribute of each outer key */
+	FmgrInfo   *hashfunctions;	/* outer hash function of each key */
+	bool	   *hashStrict;		/* is each hash join operator strict? */
+
+	uint64	   *bits;			/* the bloom filter */
+	uint32		nbits;			/* size of bits, a power of 2 */
+
+	/* Statistics for EXPLAIN ANALYZE */
+	double		nprobed;		/* # scan tuples checked */
+	double		nrejected;		/* # scan tuples dropped */
+	bool		ineffective;	/* turned off because it rejected too little */
+} HashJoinRuntimeFilter;
+
+
 /* Statistics collection workareas for EXPLAIN ANALYZE */
 typedef struct HashJoinBatchStats
 {
@@ -198,6 +233,8 @@ typedef struct HashJoinTableData
 	Size		spacePeak;		/* peak space used */
 	Size		spaceUsedSkew;	/* skew hash table's current space usage */
 	Size		spaceAllowedSkew;		/* upper limit for skew hashtable */
+	Size		spaceBorrowed;	/* part of spaceAllowed lent by the resource
+								 * group, see ExecHashTableBorrowSpace() */
 
 	MemoryContext hashCxt;		/* context for whole-hash-join storage */
 	MemoryContext batchCxt;		/* context for this-batch-only storage */
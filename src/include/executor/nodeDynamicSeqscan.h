@@ -20,5 +20,7 @@ extern DynamicSeqScanState *ExecInitDynamicSeqScan(DynamicSeqScan *node, EState
 extern TupleTableSlot *ExecDynamicSeqScan(DynamicSeqScanState *node);
 extern void ExecEndDynamicSeqScan(DynamicSeqScanState *node);
 extern void ExecReScanDynamicSeqScan(DynamicSeqScanState *node);
+extern void ExecDynamicSeqScanSetRuntimeFilter(DynamicSeqScanState *node,
+							struct HashJoinRuntimeFilter *filter);
 
 #endif
@@ -62,6 +62,16 @@ extern void ExecHashTableExplainInit(HashState *hashState, HashJoinState *hjstat
                                      HashJoinTable  hashtable);
 extern void ExecHashTableExplainBatchEnd(HashState *hashState, HashJoinTable hashtable);
 
+extern HashJoinRuntimeFilter *ExecHashRuntimeFilterCreate(int nkeys, double ntuples);
+extern void ExecHashRuntimeFilterReset(HashJoinRuntimeFilter *filter);
+extern void ExecHashRuntimeFilterFinish(HashJoinRuntimeFilter *filter,
+							HashJoinTable hashtable);
+extern bool ExecHashRuntimeFilterRejects(HashJoinRuntimeFilter *filter,
+							 struct TupleTableSlot *slot,
+							 ExprContext *econtext);
+extern void ExecHashRuntimeFilterExplain(HashJoinRuntimeFilter *filter,
+							 struct StringInfoData *buf);
+
 static inline int
 ExecHashRowSize(int tupwidth)
 {
@@ -22,5 +22,7 @@ extern SeqScanState *ExecInitSeqScanForPartition(SeqScan *node, EState *estate,
 extern TupleTableSlot *ExecSeqScan(SeqScanState *node);
 extern void ExecEndSeqScan(SeqScanState *node);
 extern void ExecReScanSeqScan(SeqScanState *node);
+extern void ExecSeqScanSetRuntimeFilter(SeqScanState *node,
+							struct HashJoinRuntimeFilter *filter);
 
 #endif   /* NODESEQSCAN_H */
@@ -650,6 +650,35 @@ namespace gpdb {
 	// table has been changed?)
 	bool MDCacheNeedsReset(void);
 
+	// kinds of metadata cache objects that can be evicted individually
+	enum MDCacheObjectKind
+	{
+		MDCacheObjectRelation,	// relation or index, with its statistics
+		MDCacheObjectGPDB,		// type, operator, function, aggregate or check constraint
+		MDCacheObjectCast		// cast between two types
+	};
+
+	// a metadata cache object to evict
+	struct MDCacheObjectRef
+	{
+		MDCacheObjectKind kind;
+		Oid oid;				// object OID, or cast source type
+		Oid oid2;				// cast target type
+		int ncolstats;			// number of column statistics positions of a relation
+	};
+
+	// remember which catalog entries the metadata cache objects were built from
+	void MDCacheTrackRelation(Oid relid, bool evict_all);
+
+	void MDCacheTrackColStats(Oid relid, AttrNumber attno, int pos);
+
+	void MDCacheTrackObject(int cacheid, Oid oid);
+
+	void MDCacheTrackCast(Oid src_type, Oid dest_type);
+
+	// next metadata cache object whose catalog entries have changed
+	bool MDCacheNextInvalidObject(MDCacheObjectRef *ref);
+
 	// functions for tracking ORCA memory consumption
 	void *OptimizerAlloc(size_t size);
 
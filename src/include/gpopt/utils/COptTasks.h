@@ -132,6 +132,14 @@ class COptTasks
 		static
 		COptimizerConfig *CreateOptimizerConfig(CMemoryPool *mp, ICostModel *cost_model);
 
+		// evict an object from the metadata cache
+		static
+		void EvictMDCacheObject(IMDId *mdid);
+
+		// evict the metadata cache objects whose catalog entries have changed
+		static
+		void EvictInvalidMDCacheObjects(CMemoryPool *mp);
+
 		// optimize a query to a physical DXL
 		static
 		void* OptimizeTask(void *ptr);
@@ -1683,6 +1683,9 @@ typedef struct SeqScanState
 	/* extra state for AOCS scans */
 	bool	   *ss_aocs_proj;
 	int			ss_aocs_ncol;
+
+	/* runtime filter pushed down by the parent hash join, or NULL */
+	struct HashJoinRuntimeFilter *ss_runtimefilter;
 } SeqScanState;
 
 /*
@@ -2226,7 +2229,8 @@ typedef struct DynamicSeqScanState
 	 */
 	MemoryContext partitionMemoryContext;
 
-
+	/* runtime filter pushed down by the parent hash join, or NULL */
+	struct HashJoinRuntimeFilter *ss_runtimefilter;
 } DynamicSeqScanState;
 
 /* ----------------------------------------------------------------
@@ -2382,6 +2386,9 @@ typedef struct HashJoinState
 	/* set if the operator created workfiles */
 	bool workfiles_created;
 	bool reuse_hashtable; /* Do we need to preserve hash table to support rescan */
+
+	/* runtime filter pushed down to the outer scan, or NULL */
+	struct HashJoinRuntimeFilter *hj_RuntimeFilter;
 } HashJoinState;
 
 
@@ -2451,7 +2458,8 @@ typedef struct ShareInputScanState
 
 /* XXX Should move into buf file */
 extern void *shareinput_reader_waitready(int share_id, PlanGenerator planGen);
-extern void *shareinput_writer_notifyready(int share_id, int nsharer_xslice_notify_ready, PlanGenerator planGen);
+extern void *shareinput_writer_notifyready(int share_id, int nsharer_xslice_notify_ready, PlanGenerator planGen,
+										   struct NTupleStore *matstore);
 extern void shareinput_reader_notifydone(void *, int share_id);
 extern void shareinput_writer_waitdone(void *, int share_id, int nsharer_xslice_wait_done);
 extern void shareinput_create_bufname_prefix(char* p, int size, int share_id);
@@ -2501,6 +2509,7 @@ typedef enum HashAggStatus
 	HASHAGG_IN_A_PASS,
 	HASHAGG_BETWEEN_PASSES,
 	HASHAGG_STREAMING,
+	HASHAGG_PASSTHROUGH,
 	HASHAGG_END_OF_PASSES
 } HashAggStatus;
 
@@ -2685,6 +2694,7 @@ typedef struct HashState
 	bool		hs_keepnull;	/* Keep nulls */
 	bool		hs_quit_if_hashkeys_null;	/* quit building hash table if hashkeys are all null */
 	bool		hs_hashkeys_null;	/* found an instance wherein hashkeys are all null */
+	struct HashJoinRuntimeFilter *hs_runtimefilter;	/* parent's runtime filter to fill */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
 } HashState;
 
@@ -552,6 +552,7 @@ extern char  *gp_default_storage_options;
 
 /* copy GUC */
 extern bool gp_enable_segment_copy_checking;
+extern bool gp_enable_segment_copy_parsing;
 
 extern int writable_external_table_bufsize;
 
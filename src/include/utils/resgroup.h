@@ -94,6 +94,8 @@ extern bool						gp_log_resgroup_memory;
 extern int						gp_resgroup_memory_policy_auto_fixed_mem;
 extern bool						gp_resgroup_print_operator_memory_limits;
 extern int						memory_spill_ratio;
+extern bool						gp_resource_group_fast_admission;
+extern bool						gp_resgroup_borrow_shared_memory;
 
 extern int gp_resource_group_cpu_priority;
 extern double gp_resource_group_cpu_limit;
@@ -175,6 +177,9 @@ extern void ResGroupDumpMemoryInfo(void);
 extern bool ResGroupReserveMemory(int32 memoryChunks, int32 overuseChunks, bool *waiverUsed);
 /* Update the memory usage of resource group */
 extern void ResGroupReleaseMemory(int32 memoryChunks);
+/* Lend shared memory to operators that would spill otherwise */
+extern int64 ResGroupBorrowSpillMemory(int64 bytes);
+extern void ResGroupReturnSpillMemory(int64 bytes);
 
 extern void ResGroupDropFinish(const ResourceGroupCallbackContext *callbackCtx,
 							   bool isCommit);
@@ -218,11 +218,19 @@ extern void tupsort_prepare(MKEntry *a, struct MKContext *ctxt, int lv);
 typedef enum MKLvType
 {
     MKLV_TYPE_NONE,  /* this level has not yet been assigned a type: todo: verify meaning */
-    MKLV_TYPE_INT32, /* this level contains int32 values */
+    MKLV_TYPE_INT32, /* this level contains int32 values (also int2 and date) */
+    MKLV_TYPE_INT64, /* this level contains int64 values (also timestamp and timestamptz) */
     MKLV_TYPE_CHAR,  /* this level contains char (blank padded) values */
     MKLV_TYPE_TEXT,  /* this level contains text values */
+    MKLV_TYPE_TEXT_ABBREV, /* text values in C collation; the entries hold the first 8 bytes only */
 } MKLvType;
 
+/* Levels whose keys can be split up by mk_qsort's radix pass */
+static inline bool mk_lvtype_is_integer(MKLvType lvtype)
+{
+    return lvtype == MKLV_TYPE_INT32 || lvtype == MKLV_TYPE_INT64;
+}
+
 typedef struct MKLvContext
 {
 	/* Is the type of datums in this level passed by value instead of reference */
@@ -332,6 +340,7 @@ static inline void mk_qsort(MKEntry* a, int n, MKContext *ctxt)
 {
     mk_qsort_impl(a, 0, n-1, 0, true, ctxt, false);
 }
+extern void mk_qsort_parallel(MKEntry *a, int n, MKContext *ctxt, int nthreads);
 
 /* MK Heap stuff */
 typedef bool (*MKFlagPtrReader) (void *ctxt, MKEntry *e);
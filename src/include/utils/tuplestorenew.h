@@ -7,6 +7,7 @@
 #define TUPSTORE_NEW_H
 
 #include "executor/tuptable.h"
+#include "storage/dsm.h"
 #include "utils/workfile_mgr.h"
 
 typedef struct NTupleStorePos
@@ -27,8 +28,10 @@ void ntuplestore_setinstrument(NTupleStore* ts, struct Instrumentation *ins);
 /* Tuple store method */
 extern NTupleStore *ntuplestore_create(int64 maxBytes, char *operation_name);
 extern NTupleStore *ntuplestore_create_readerwriter(const char* filename, int64 maxBytes, bool isWriter);
+extern NTupleStore *ntuplestore_create_reader_shm(dsm_handle handle, int64 maxBytes);
 extern bool ntuplestore_is_readerwriter_reader(NTupleStore* nts);
 extern void ntuplestore_flush(NTupleStore *ts);
+extern bool ntuplestore_flush_shm(NTupleStore *ts, int64 maxBytes, dsm_handle *handle);
 extern void ntuplestore_destroy(NTupleStore *ts);
 
 /* Tuple store accessor method 
@@ -40,6 +40,12 @@ typedef int64 EventVersion;
 
 extern int runaway_detector_activation_percent;
 
+/*
+ * Number of vmem chunks each process reserves from the segment at once, and
+ * keeps around when it frees them. 1 makes every chunk go to the segment.
+ */
+extern int gp_vmem_lease_chunks;
+
 extern int32 VmemTracker_ConvertVmemChunksToMB(int chunks);
 extern int32 VmemTracker_ConvertVmemMBToChunks(int mb);
 extern int64 VmemTracker_ConvertVmemChunksToBytes(int chunks);
@@ -61,12 +67,14 @@ extern void VmemTracker_Shutdown(void);
 extern void VmemTracker_ResetMaxVmemReserved(void);
 extern MemoryAllocationStatus VmemTracker_ReserveVmem(int64 newly_requested);
 extern void VmemTracker_ReleaseVmem(int64 to_be_freed_requested);
+extern void VmemTracker_ReturnLease(void);
 extern void VmemTracker_RequestWaiver(int64 waiver_bytes);
 extern void VmemTracker_ResetWaiver(void);
 extern int64 VmemTracker_Fault(int32 reason, int64 arg);
 
 extern int32 RedZoneHandler_GetRedZoneLimitChunks(void);
 extern int32 RedZoneHandler_GetRedZoneLimitMB(void);
+extern int32 RedZoneHandler_GetSessionVmemChunks(void);
 extern bool RedZoneHandler_IsVmemRedZone(void);
 extern void RedZoneHandler_DetectRunawaySession(void);
 extern void RunawayCleaner_RunawayCleanupDoneForSession(void);
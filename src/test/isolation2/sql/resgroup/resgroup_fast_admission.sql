@@ -0,0 +1,38 @@
+-- test the slots that are parked by finished transactions for the next ones
+DROP ROLE IF EXISTS role_fast_admission;
+-- start_ignore
+DROP RESOURCE GROUP rg_fast_admission;
+-- end_ignore
+CREATE RESOURCE GROUP rg_fast_admission WITH (concurrency=1, cpu_rate_limit=20, memory_limit=20);
+CREATE ROLE role_fast_admission RESOURCE GROUP rg_fast_admission;
+
+-- a parked slot is not counted as running
+1:SET ROLE role_fast_admission;
+1:SELECT 1;
+SELECT r.rsgname, num_running, num_queueing, num_queued, num_executed FROM gp_toolkit.gp_resgroup_status s, pg_resgroup r WHERE s.groupid=r.oid AND r.rsgname='rg_fast_admission';
+
+-- the next transaction takes it over, and the concurrency limit still holds
+2:SET ROLE role_fast_admission;
+2:BEGIN;
+3:SET ROLE role_fast_admission;
+3&:BEGIN;
+SELECT r.rsgname, num_running, num_queueing, num_queued, num_executed FROM gp_toolkit.gp_resgroup_status s, pg_resgroup r WHERE s.groupid=r.oid AND r.rsgname='rg_fast_admission';
+2:END;
+3<:
+3:END;
+SELECT r.rsgname, num_running, num_queueing, num_queued, num_executed FROM gp_toolkit.gp_resgroup_status s, pg_resgroup r WHERE s.groupid=r.oid AND r.rsgname='rg_fast_admission';
+
+-- a parked slot is given back when the concurrency is lowered
+ALTER RESOURCE GROUP rg_fast_admission SET CONCURRENCY 0;
+1&:SELECT 1;
+SELECT r.rsgname, num_running, num_queueing, num_queued, num_executed FROM gp_toolkit.gp_resgroup_status s, pg_resgroup r WHERE s.groupid=r.oid AND r.rsgname='rg_fast_admission';
+ALTER RESOURCE GROUP rg_fast_admission SET CONCURRENCY 1;
+1<:
+SELECT r.rsgname, num_running, num_queueing, num_queued, num_executed FROM gp_toolkit.gp_resgroup_status s, pg_resgroup r WHERE s.groupid=r.oid AND r.rsgname='rg_fast_admission';
+
+-- and it does not prevent dropping the group
+1q:
+2q:
+3q:
+DROP ROLE role_fast_admission;
+DROP RESOURCE GROUP rg_fast_admission;
@@ -0,0 +1,64 @@
+-- Hash joins, hash aggregates and sorts that run out of their operator
+-- memory borrow the free shared memory of their resource group, and do
+-- not spill as long as it lasts.
+-- start_matchsubs
+-- m/INSERT \d+/
+-- s/INSERT \d+/INSERT/
+-- end_matchsubs
+create schema borrow_spill;
+set search_path to borrow_spill;
+
+-- start_ignore
+create language plpythonu;
+-- end_ignore
+
+-- whether any operator of the query spilled to workfiles
+create or replace function borrow_spill.is_workfile_created(explain_query text)
+returns bool as
+$$
+import re
+rv = plpy.execute(explain_query)
+p = re.compile('.+ Workfile: \(([\d]+) spilling\)')
+for i in range(len(rv)):
+    m = p.match(rv[i]['QUERY PLAN'])
+    if m and int(m.group(1)) > 0:
+        return True
+return False
+$$
+language plpythonu;
+
+create table test_borrow (i1 int, i2 int, i3 int, i4 int);
+insert into test_borrow select i,i,i%1000,i from
+	(select generate_series(1, nsegments * 15000) as i from
+	(select count(*) as nsegments from gp_segment_configuration where role='p' and content >= 0) foo) bar;
+
+-- start_ignore
+DROP ROLE IF EXISTS role_borrow_test;
+DROP RESOURCE GROUP rg_borrow_test;
+-- end_ignore
+CREATE RESOURCE GROUP rg_borrow_test WITH
+(concurrency=2, cpu_rate_limit=10, memory_limit=30, memory_shared_quota=80, memory_spill_ratio=1);
+CREATE ROLE role_borrow_test SUPERUSER RESOURCE GROUP rg_borrow_test;
+SET ROLE TO role_borrow_test;
+
+-- the operators spill when they may not borrow
+set gp_resgroup_borrow_shared_memory=off;
+select * from borrow_spill.is_workfile_created('explain analyze select max(i1) from test_borrow group by i2;');
+select * from borrow_spill.is_workfile_created('explain analyze select t1.* from test_borrow as t1 right join test_borrow as t2 on t1.i1=t2.i2;');
+select * from borrow_spill.is_workfile_created('explain analyze select i1,i2 from test_borrow order by i2;');
+
+-- and stay in memory when they may
+reset gp_resgroup_borrow_shared_memory;
+select * from borrow_spill.is_workfile_created('explain analyze select max(i1) from test_borrow group by i2;');
+select * from borrow_spill.is_workfile_created('explain analyze select t1.* from test_borrow as t1 right join test_borrow as t2 on t1.i1=t2.i2;');
+select * from borrow_spill.is_workfile_created('explain analyze select i1,i2 from test_borrow order by i2;');
+select count(*), avg(i3) from (select t1.* from test_borrow as t1 right join test_borrow as t2 on t1.i1=t2.i2) foo;
+
+-- everything lent has been given back
+select memory_shared_used from gp_toolkit.gp_resgroup_status_per_segment
+ where rsgname='rg_borrow_test' and segment_id=0;
+
+RESET ROLE;
+drop schema borrow_spill cascade;
+DROP ROLE role_borrow_test;
+DROP RESOURCE GROUP rg_borrow_test;
@@ -0,0 +1,48 @@
+--
+-- Skipping append-only blocks using per-block min/max summaries (zone maps).
+-- Every query must return the same result with and without them.
+--
+create table ao_zonemap (id int4, d date, v text)
+  with (appendonly=true, blocksize=8192) distributed by (id);
+
+-- Rows are loaded in date order, so each block covers a narrow date range.
+insert into ao_zonemap
+  select i, '2018-01-01'::date + (i / 1000), repeat('x', 40)
+  from generate_series(1, 20000) i;
+insert into ao_zonemap values (20001, null, 'null date');
+
+set gp_appendonly_zonemap_scan = on;
+select count(*) from ao_zonemap where d < '2018-01-03';
+select count(*) from ao_zonemap where '2018-01-03' > d;
+select count(*) from ao_zonemap where d = '2018-01-05';
+select count(*) from ao_zonemap where d >= '2018-01-20';
+select count(*) from ao_zonemap where d > '2018-01-05' and d <= '2018-01-06';
+select count(*) from ao_zonemap where d < '2017-01-01';
+select count(*) from ao_zonemap where d is null;
+select count(*) from ao_zonemap where id <= 10 and d < '2018-01-02';
+
+-- Deleted rows are hidden by the visibility map, not by the zone map.
+delete from ao_zonemap where id between 1 and 500;
+select count(*) from ao_zonemap where d < '2018-01-03';
+
+-- A fault that is hit every time a block is skipped shows that the zone map
+-- is actually used, on the first segment.
+select gp_inject_fault('ao_zonemap_skip_block', 'reset', 2);
+select gp_inject_fault('ao_zonemap_skip_block', 'skip', 2);
+select count(*) from ao_zonemap where d >= '2018-01-20';
+select gp_inject_fault('ao_zonemap_skip_block', 'status', 2);
+
+set gp_appendonly_zonemap_scan = off;
+select count(*) from ao_zonemap where d < '2018-01-03';
+select count(*) from ao_zonemap where d = '2018-01-05';
+select count(*) from ao_zonemap where d >= '2018-01-20';
+
+-- With zone maps turned off, no block is skipped.
+select gp_inject_fault('ao_zonemap_skip_block', 'reset', 2);
+select gp_inject_fault('ao_zonemap_skip_block', 'skip', 2);
+select count(*) from ao_zonemap where d >= '2018-01-20';
+select gp_inject_fault('ao_zonemap_skip_block', 'status', 2);
+select gp_inject_fault('ao_zonemap_skip_block', 'reset', 2);
+
+reset gp_appendonly_zonemap_scan;
+drop table ao_zonemap;
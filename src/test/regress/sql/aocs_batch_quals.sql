@@ -0,0 +1,33 @@
+--
+-- Evaluating simple comparisons of column-oriented table scans over batches
+-- of column values.  Every query must return the same result with and
+-- without them.
+--
+create table aocs_batch_quals (id int4, k int8, s int2, d date, v text)
+  with (appendonly=true, orientation=column) distributed by (id);
+insert into aocs_batch_quals
+  select i, i * 10, (i % 100)::int2, '2018-01-01'::date + (i / 1000), 'row ' || i
+  from generate_series(1, 5000) i;
+insert into aocs_batch_quals values (5001, null, null, null, 'nulls');
+
+set gp_aocs_batch_quals = on;
+select count(*) from aocs_batch_quals where id <= 100;
+select count(*) from aocs_batch_quals where 100 >= id;
+select count(*) from aocs_batch_quals where k > 45000;
+select count(*) from aocs_batch_quals where s = 7;
+select count(*) from aocs_batch_quals where d = '2018-01-03';
+select count(*) from aocs_batch_quals where k is null;
+select count(*) from aocs_batch_quals where id < 10 and v like 'row%';
+select id, k, s, v from aocs_batch_quals where id between 1000 and 1002 order by id;
+select count(*), sum(id) from aocs_batch_quals where s < 3 and d >= '2018-01-04';
+
+-- Deleted rows are still hidden by the visibility map.
+delete from aocs_batch_quals where id between 1 and 50;
+select count(*) from aocs_batch_quals where id <= 100;
+
+set gp_aocs_batch_quals = off;
+select count(*) from aocs_batch_quals where id <= 100;
+select count(*), sum(id) from aocs_batch_quals where s < 3 and d >= '2018-01-04';
+
+reset gp_aocs_batch_quals;
+drop table aocs_batch_quals;
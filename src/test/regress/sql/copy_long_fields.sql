@@ -0,0 +1,18 @@
+--
+-- COPY FROM with lines and fields longer than the blocks that the parser
+-- scans at a time, with escapes, quotes and delimiters at various offsets.
+--
+CREATE TABLE copy_long_fields (a int, b text, c text) DISTRIBUTED BY (a);
+COPY copy_long_fields FROM stdin DELIMITER '|';
+1|xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx|yyyyyyyyyyyyyyyyyyyy
+2|abcdefghijklmno\\pqrstuvwxyz0123|\N
+3|0123456789abcdef\101xyz|0123456789abcdef\|0123
+\.
+COPY copy_long_fields FROM stdin CSV;
+4,"a quoted field that is longer than sixteen bytes, with a comma","and ""doubled"" quotes past the first block"
+5,unquoted field longer than sixteen bytes,"a quoted field
+with a newline in it, far from the start"
+\.
+SELECT a, length(b), b FROM copy_long_fields ORDER BY a;
+SELECT a, length(c), replace(c, E'\n', ' / ') AS c FROM copy_long_fields ORDER BY a;
+DROP TABLE copy_long_fields;
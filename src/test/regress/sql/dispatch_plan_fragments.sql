@@ -0,0 +1,33 @@
+--
+-- Test dispatching to each gang only the part of the plan it executes
+--
+set gp_dispatch_plan_fragments = on;
+
+create table pf_t1 (a int, b int) distributed by (a);
+create table pf_t2 (a int, b int) distributed by (a);
+insert into pf_t1 select i, i % 10 from generate_series(1, 100) i;
+insert into pf_t2 select i, i % 5 from generate_series(1, 50) i;
+
+-- both sides redistributed for the join
+select count(*) from pf_t1 join pf_t2 on pf_t1.b = pf_t2.b;
+
+-- slices stacked on top of each other
+select pf_t2.b, count(*) from pf_t1 join pf_t2 on pf_t1.b = pf_t2.a
+group by pf_t2.b order by pf_t2.b;
+
+-- an initPlan, whose value is used in a slice below the root
+select count(*) from pf_t1 where b = (select max(b) from pf_t2);
+
+-- a correlated subquery
+select count(*) from pf_t1
+where a > (select count(*) from pf_t2 where pf_t2.b = pf_t1.b);
+
+-- a gang writing the result of a join
+create table pf_t3 (a int, b int) distributed by (b);
+insert into pf_t3 select pf_t1.a, pf_t2.b from pf_t1 join pf_t2 on pf_t1.a = pf_t2.a;
+select count(*), sum(a), sum(b) from pf_t3;
+
+reset gp_dispatch_plan_fragments;
+drop table pf_t1;
+drop table pf_t2;
+drop table pf_t3;
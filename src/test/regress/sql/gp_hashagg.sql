@@ -89,3 +89,25 @@ set enable_sort=off;
 -- use a Sort + Group, because nohash_int type is not hashable.
 select normal_int from hashagg_test2 group by normal_int;
 select nohash_int from hashagg_test2 group by nohash_int;
+
+-- The streaming bottom stage of a two stage hashagg whose hash table barely
+-- reduces its input passes the rest of it through. The results must not
+-- change.
+create table hashagg_passthrough(a int, b int) distributed by (a);
+insert into hashagg_passthrough select g, g % 50000 from generate_series(1, 100000) g;
+set gp_eager_two_phase_agg = on;
+set statement_mem = '1000kB';
+-- The fault is hit when the first segment starts passing its input through.
+select gp_inject_fault('hashagg_stream_passthrough', 'reset', 2);
+select gp_inject_fault('hashagg_stream_passthrough', 'skip', 2);
+select count(*), sum(cnt), sum(sb) from (select b, count(*) cnt, sum(b) sb from hashagg_passthrough group by b) s;
+select gp_inject_fault('hashagg_stream_passthrough', 'status', 2);
+set gp_hashagg_stream_min_reduction = 0;
+select gp_inject_fault('hashagg_stream_passthrough', 'reset', 2);
+select gp_inject_fault('hashagg_stream_passthrough', 'skip', 2);
+select count(*), sum(cnt), sum(sb) from (select b, count(*) cnt, sum(b) sb from hashagg_passthrough group by b) s;
+select gp_inject_fault('hashagg_stream_passthrough', 'status', 2);
+select gp_inject_fault('hashagg_stream_passthrough', 'reset', 2);
+reset gp_hashagg_stream_min_reduction;
+reset statement_mem;
+reset gp_eager_two_phase_agg;
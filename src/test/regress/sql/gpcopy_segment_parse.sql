@@ -0,0 +1,51 @@
+--
+-- COPY FROM into tables that the master doesn't need to look at the rows
+-- for. The master only splits the input into lines, and the segments parse
+-- them (gp_enable_segment_copy_parsing).
+--
+CREATE TABLE copy_seg_parse_rand (a int, b text) DISTRIBUTED RANDOMLY;
+CREATE TABLE copy_seg_parse_repl (a int, b text) DISTRIBUTED REPLICATED;
+CREATE TABLE copy_seg_parse_ao (a int, b text DEFAULT 'dflt')
+  WITH (appendonly=true) DISTRIBUTED RANDOMLY;
+
+-- Enough lines for several blocks, so that they get spread out.
+COPY copy_seg_parse_rand (a) FROM PROGRAM 'seq 1 100000';
+SELECT count(*), sum(a), count(DISTINCT gp_segment_id) > 1 AS spread
+  FROM copy_seg_parse_rand;
+
+-- Header, and a quoted newline in CSV
+COPY copy_seg_parse_rand FROM stdin CSV HEADER;
+a,b
+100001,"two
+lines"
+100002,plain
+\.
+SELECT * FROM copy_seg_parse_rand WHERE b IS NOT NULL ORDER BY a;
+
+-- Errors are reported with the line number in the input
+COPY copy_seg_parse_rand FROM stdin;
+100003	three
+four	4
+\.
+SELECT count(*) FROM copy_seg_parse_rand;
+
+-- Every replica gets all of the rows
+COPY copy_seg_parse_repl (a) FROM PROGRAM 'seq 1 20000';
+SELECT count(*) FROM copy_seg_parse_repl;
+SELECT count(DISTINCT c) AS same_on_all FROM
+  (SELECT count(*) AS c FROM gp_dist_random('copy_seg_parse_repl')
+    GROUP BY gp_segment_id) s;
+
+-- The segments evaluate the defaults
+COPY copy_seg_parse_ao (a) FROM PROGRAM 'seq 1 1000';
+SELECT count(*), min(b), max(b) FROM copy_seg_parse_ao;
+
+-- The same, with the master parsing the rows
+SET gp_enable_segment_copy_parsing = off;
+COPY copy_seg_parse_ao (a) FROM PROGRAM 'seq 1 1000';
+SELECT count(*), min(b), max(b) FROM copy_seg_parse_ao;
+RESET gp_enable_segment_copy_parsing;
+
+DROP TABLE copy_seg_parse_rand;
+DROP TABLE copy_seg_parse_repl;
+DROP TABLE copy_seg_parse_ao;
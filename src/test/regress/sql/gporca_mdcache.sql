@@ -0,0 +1,26 @@
+--
+-- Check that the metadata cache of the ORCA optimizer notices DDL that
+-- happens between two queries. The cache only evicts the objects whose
+-- catalog entries were invalidated, so a query planned after the DDL must
+-- see the new distribution and columns rather than the cached ones.
+--
+set optimizer_trace_fallback = on;
+
+create table orca_mdcache (a int, b int) distributed by (a);
+insert into orca_mdcache select i % 5, i from generate_series(1, 100) i;
+select a, count(*) from orca_mdcache group by a order by a;
+
+-- With a stale distribution key the grouping would not be redistributed,
+-- and each value of a would come back once per segment.
+alter table orca_mdcache set distributed by (b);
+select a, count(*) from orca_mdcache group by a order by a;
+
+alter table orca_mdcache add column c int default 7;
+select a, count(*), sum(c) from orca_mdcache group by a order by a;
+
+alter table orca_mdcache drop column b;
+select count(*), sum(a), sum(c) from orca_mdcache;
+select * from orca_mdcache where a = 4 limit 2;
+
+reset optimizer_trace_fallback;
+drop table orca_mdcache;
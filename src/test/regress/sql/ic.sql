@@ -177,6 +177,23 @@ SET gp_interconnect_queue_depth TO -1; -- ERROR
 SET gp_interconnect_queue_depth TO 0; -- ERROR
 SET gp_interconnect_queue_depth TO 4097; -- ERROR
 
+-- Column-wise batches of fixed-width tuples
+SET gp_motion_batch_size TO 100;
+CREATE TABLE batch_table (a INT, b INT8, c FLOAT8, d INT2, e DATE) DISTRIBUTED BY (a);
+INSERT INTO batch_table
+  SELECT i, i % 3, (i % 100) / 4.0, CASE WHEN i % 7 = 0 THEN NULL ELSE i % 5 END, '2000-01-01'::date + i % 10
+  FROM generate_series(1, 10000) i;
+-- Gather
+SELECT * FROM batch_table WHERE a <= 10 ORDER BY a;
+-- Gather, preserving order
+SELECT COUNT(*) AS count, COUNT(d) AS count_d, SUM(c) AS sum_c, SUM(d) AS sum_d, MAX(e) AS max_e
+  FROM (SELECT * FROM batch_table ORDER BY a LIMIT 10000) foo;
+-- Redistribute
+SELECT COUNT(*) AS count, SUM(t.a) AS sum_a, SUM(t.c) AS sum_c, COUNT(t.d) AS count_d
+  FROM batch_table t JOIN batch_table u ON t.b = u.a;
+RESET gp_motion_batch_size;
+DROP TABLE batch_table;
+
 -- Cleanup
 DROP TABLE small_table;
 DROP TABLE a;
@@ -0,0 +1,42 @@
+--
+-- Interconnect test case: gp_interconnect_io_batch_size
+-- Sending and receiving one packet per system call instead of a batch
+-- must not change the results of queries with motions.
+--
+
+-- Create a table
+CREATE TEMP TABLE ic_table(dkey INT, jkey INT, tval TEXT) DISTRIBUTED BY (dkey);
+INSERT INTO ic_table SELECT i, i % 1000, repeat('x', i % 100) FROM generate_series(1, 100000) i;
+
+-- Results with the default value
+SHOW gp_interconnect_io_batch_size;
+-- Redistribute motion, aggregated above a gather motion
+SELECT COUNT(*) AS ngroups, SUM(cnt) AS sum_cnt, SUM(len) AS sum_len
+  FROM (SELECT a.jkey, COUNT(*) AS cnt, SUM(length(b.tval)) AS len
+          FROM ic_table a JOIN ic_table b ON a.jkey = b.dkey
+         GROUP BY a.jkey) foo;
+-- Join on columns neither table is distributed by
+SELECT COUNT(*) AS count
+  FROM ic_table a JOIN ic_table b ON a.jkey = b.jkey
+ WHERE b.dkey <= 1000;
+-- Gather every row in order
+SELECT COUNT(*) AS count, SUM(length(tval)) AS sum_len
+  FROM (SELECT tval FROM ic_table ORDER BY dkey LIMIT 100000) foo;
+
+-- The same queries must return the same results
+SET gp_interconnect_io_batch_size = 1;
+SHOW gp_interconnect_io_batch_size;
+-- Redistribute motion, aggregated above a gather motion
+SELECT COUNT(*) AS ngroups, SUM(cnt) AS sum_cnt, SUM(len) AS sum_len
+  FROM (SELECT a.jkey, COUNT(*) AS cnt, SUM(length(b.tval)) AS len
+          FROM ic_table a JOIN ic_table b ON a.jkey = b.dkey
+         GROUP BY a.jkey) foo;
+-- Join on columns neither table is distributed by
+SELECT COUNT(*) AS count
+  FROM ic_table a JOIN ic_table b ON a.jkey = b.jkey
+ WHERE b.dkey <= 1000;
+-- Gather every row in order
+SELECT COUNT(*) AS count, SUM(length(tval)) AS sum_len
+  FROM (SELECT tval FROM ic_table ORDER BY dkey LIMIT 100000) foo;
+
+RESET gp_interconnect_io_batch_size;
@@ -0,0 +1,59 @@
+--
+-- Interconnect test case: gp_interconnect_shm
+-- Connections between QEs on the same host pass their packets through a
+-- ring of 16 packet-sized slots in shared memory, the others use the
+-- network.
+--
+
+-- Rows much larger than a ring, so that every one of them wraps around it
+CREATE TEMP TABLE ic_shm(dkey INT, jkey INT, tval TEXT) DISTRIBUTED BY (dkey);
+ALTER TABLE ic_shm ALTER COLUMN tval SET STORAGE EXTERNAL;
+INSERT INTO ic_shm
+  SELECT i, i % 4, (SELECT string_agg(md5((i * 100000 + j)::text), '')
+                      FROM generate_series(1, 10000) j)
+    FROM generate_series(1, 20) i;
+
+-- Results over the network
+SHOW gp_interconnect_shm;
+SELECT COUNT(*) AS count, SUM(length(a.tval) + length(b.tval)) AS sum_len,
+       bool_and(right(a.tval, 32) = md5((a.dkey * 100000 + 10000)::text) AND
+                right(b.tval, 32) = md5((b.dkey * 100000 + 10000)::text)) AS intact
+  FROM ic_shm a JOIN ic_shm b ON a.jkey = b.jkey;
+
+SET gp_interconnect_shm = on;
+SHOW gp_interconnect_shm;
+
+-- The motions between the segments fill their rings, and the rows must
+-- come out the same.
+select gp_inject_fault('interconnect_shm_ring_full', 'reset', 2);
+select gp_inject_fault('interconnect_shm_ring_full', 'skip', 2);
+SELECT COUNT(*) AS count, SUM(length(a.tval) + length(b.tval)) AS sum_len,
+       bool_and(right(a.tval, 32) = md5((a.dkey * 100000 + 10000)::text) AND
+                right(b.tval, 32) = md5((b.dkey * 100000 + 10000)::text)) AS intact
+  FROM ic_shm a JOIN ic_shm b ON a.jkey = b.jkey;
+select gp_inject_fault('interconnect_shm_ring_full', 'status', 2);
+
+-- Connections to the master always use the network, so a query whose only
+-- motion is a gather doesn't attach to any shared memory.
+select gp_inject_fault('interconnect_shm_attach', 'reset', 2);
+select gp_inject_fault('interconnect_shm_attach', 'skip', 2);
+SELECT COUNT(*) AS count, SUM(length(tval)) AS sum_len FROM ic_shm;
+select gp_inject_fault('interconnect_shm_attach', 'status', 2);
+select gp_inject_fault('interconnect_shm_attach', 'reset', 2);
+
+-- A sender that is cancelled while its ring is full tears its connections
+-- down, and the next query sets up new ones.
+select gp_inject_fault('interconnect_shm_ring_full', 'reset', 2);
+select gp_inject_fault('interconnect_shm_ring_full', 'interrupt', 2);
+SELECT COUNT(*) AS count, SUM(length(a.tval) + length(b.tval)) AS sum_len,
+       bool_and(right(a.tval, 32) = md5((a.dkey * 100000 + 10000)::text) AND
+                right(b.tval, 32) = md5((b.dkey * 100000 + 10000)::text)) AS intact
+  FROM ic_shm a JOIN ic_shm b ON a.jkey = b.jkey;
+select gp_inject_fault('interconnect_shm_ring_full', 'status', 2);
+select gp_inject_fault('interconnect_shm_ring_full', 'reset', 2);
+SELECT COUNT(*) AS count, SUM(length(a.tval) + length(b.tval)) AS sum_len,
+       bool_and(right(a.tval, 32) = md5((a.dkey * 100000 + 10000)::text) AND
+                right(b.tval, 32) = md5((b.dkey * 100000 + 10000)::text)) AS intact
+  FROM ic_shm a JOIN ic_shm b ON a.jkey = b.jkey;
+
+RESET gp_interconnect_shm;
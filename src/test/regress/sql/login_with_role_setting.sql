@@ -0,0 +1,15 @@
+--
+-- Log in as a new role that has a setting of its own.
+--
+-- Included by tests of settings that take effect when a session starts.
+-- Set these psql variables first:
+--   test_role          name of the role to create
+--   test_role_setting  setting to give it, as for ALTER ROLE ... SET
+--   test_role_tables   tables it is granted access to
+-- test_orig_user is set to the user to switch back to.
+--
+create role :test_role login;
+grant all on :test_role_tables to :test_role;
+alter role :test_role set :test_role_setting;
+select current_user as test_orig_user \gset
+\c - :test_role
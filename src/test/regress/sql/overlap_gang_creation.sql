@@ -0,0 +1,58 @@
+--
+-- Test starting the writer gang of a session while its first query is
+-- being planned
+--
+create table overlap_t1 (a int, b int) distributed by (a);
+create table overlap_t2 (a int, b int) distributed replicated;
+insert into overlap_t1 select i, i % 10 from generate_series(1, 100) i;
+insert into overlap_t2 select i, i from generate_series(1, 10) i;
+
+-- a gang that gets a writer started ahead of it hits this fault on the QD
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+
+\set test_role overlap_role
+\set test_role_setting 'gp_overlap_gang_creation = on'
+\set test_role_tables 'overlap_t1, overlap_t2'
+\i sql/login_with_role_setting.sql
+
+-- a query that only reads the catalog doesn't need segments
+select count(*) > 0 from pg_class where relname = 'overlap_t1';
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+select count(*) from overlap_t1 x join overlap_t2 y on x.b = y.a;
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+
+-- nor does one without any tables, but a write does
+\c - :test_role
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+select 1 + 1;
+insert into overlap_t1 values (101, 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+select count(*) from overlap_t1 where b = 1;
+
+-- replicated tables and gp_dist_random() live on the segments too
+\c - :test_role
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+select count(*) from overlap_t2;
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+\c - :test_role
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+select count(*) from gp_dist_random('gp_id');
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+
+-- and so does the plan of a prepared statement, planned at first execution
+\c - :test_role
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+prepare overlap_q(int) as select count(*) from overlap_t1 where a > $1;
+execute overlap_q(50);
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+
+\c - :test_orig_user
+drop table overlap_t1;
+drop table overlap_t2;
+drop role overlap_role;
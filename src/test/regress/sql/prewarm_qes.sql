@@ -0,0 +1,37 @@
+--
+-- Test pre-warming the QEs of a new session
+--
+create table prewarm_t1 (a int, b int) distributed by (a);
+insert into prewarm_t1 select i, i % 10 from generate_series(1, 100) i;
+
+-- a gang that gets a pre-warmed QE hits this fault on the QD
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+
+\set test_role prewarm_role
+\set test_role_setting 'gp_prewarm_segworkers = 3'
+\set test_role_tables prewarm_t1
+\i sql/login_with_role_setting.sql
+show gp_prewarm_segworkers;
+
+-- the first query uses the writer and readers that were started at login
+select count(*) from prewarm_t1 x join prewarm_t1 y on x.b = y.a;
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+
+-- a SET reaches the pre-warmed QEs, whether they were used yet or not
+set gp_cached_segworkers_threshold = 10;
+set extra_float_digits = 2;
+select distinct current_setting('extra_float_digits') from gp_dist_random('gp_id');
+select count(*) from prewarm_t1 x join prewarm_t1 y on x.b = y.b join prewarm_t1 z on y.a = z.b;
+
+-- sessions of other users are not affected
+\c - :test_orig_user
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'skip', 1);
+show gp_prewarm_segworkers;
+select count(*) from prewarm_t1 x join prewarm_t1 y on x.b = y.a;
+select gp_inject_fault('create_gang_prewarmed_qe', 'status', 1);
+select gp_inject_fault('create_gang_prewarmed_qe', 'reset', 1);
+
+drop table prewarm_t1;
+drop role prewarm_role;
@@ -0,0 +1,47 @@
+--
+-- Test caching of dispatched plans on the QEs
+--
+set gp_qe_plan_cache = on;
+
+create table pc_t1 (a int, b int) distributed by (a);
+create table pc_t2 (a int, b int) distributed by (a);
+insert into pc_t1 select i, i % 10 from generate_series(1, 100) i;
+insert into pc_t2 select i, i % 5 from generate_series(1, 50) i;
+
+-- after a few executions, the same generic plan is dispatched every time
+prepare pc_q(int) as
+select count(*) from pc_t1 join pc_t2 on pc_t1.b = pc_t2.b where pc_t1.a > $1;
+execute pc_q(0);
+execute pc_q(50);
+execute pc_q(90);
+execute pc_q(0);
+execute pc_q(50);
+execute pc_q(90);
+execute pc_q(0);
+
+-- the QEs run the plan they have cached, without being sent it again
+select gp_inject_fault('qe_plan_cache_hit', 'reset', 2);
+select gp_inject_fault('qe_plan_cache_hit', 'skip', 2);
+execute pc_q(0);
+select gp_inject_fault('qe_plan_cache_hit', 'status', 2);
+select gp_inject_fault('qe_plan_cache_hit', 'reset', 2);
+
+-- a cached plan sees new data
+insert into pc_t2 values (51, 1);
+execute pc_q(90);
+
+-- and is replaced after the table changes
+alter table pc_t2 add column c int;
+execute pc_q(0);
+execute pc_q(0);
+
+-- together with plan fragments
+set gp_dispatch_plan_fragments = on;
+execute pc_q(50);
+execute pc_q(50);
+reset gp_dispatch_plan_fragments;
+
+deallocate pc_q;
+reset gp_qe_plan_cache;
+drop table pc_t1;
+drop table pc_t2;
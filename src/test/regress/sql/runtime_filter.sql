@@ -0,0 +1,76 @@
+--
+-- Runtime filters pushed from a hash join's inner side down to the
+-- sequential scan on its outer side.  Every query must return the same
+-- result with and without them.
+--
+set optimizer = off;
+
+create table rf_fact (id int, dim_id int, val int) distributed by (dim_id);
+create table rf_dim (id int, name text) distributed by (id);
+
+insert into rf_fact select i, i % 1000, i from generate_series(1, 100000) i;
+insert into rf_fact values (100001, null, 0);
+insert into rf_dim select i, 'dim' || i from generate_series(10, 1000, 10) i;
+analyze rf_fact;
+analyze rf_dim;
+
+-- Returns the lines of EXPLAIN ANALYZE output that mention the filter.
+create or replace function rf_explain_analyze(query text) returns setof text as
+$$
+declare
+  explainrow text;
+begin
+  for explainrow in execute 'EXPLAIN ANALYZE ' || query
+  loop
+    if explainrow like '%Runtime filter rejected%' then
+      return next explainrow;
+    end if;
+  end loop;
+end;
+$$ language plpgsql;
+
+set gp_enable_runtime_filter = on;
+
+select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id;
+select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id where f.val % 3 = 0;
+select count(*) from rf_fact f where f.dim_id in (select id from rf_dim);
+
+-- Joins that must keep unmatched outer rows do not use the filter.
+select count(*) from rf_fact f left join rf_dim d on f.dim_id = d.id;
+select count(*) from rf_fact f where not exists (select 1 from rf_dim d where d.id = f.dim_id);
+select count(*) from rf_fact f where f.dim_id not in (select id from rf_dim);
+
+-- The scan reports how many rows the filter rejected.
+select count(*) > 0 from rf_explain_analyze('select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id');
+select count(*) > 0 from rf_explain_analyze('select count(*) from rf_fact f left join rf_dim d on f.dim_id = d.id');
+
+set gp_enable_runtime_filter = off;
+
+select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id;
+select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id where f.val % 3 = 0;
+select count(*) from rf_fact f where f.dim_id in (select id from rf_dim);
+select count(*) > 0 from rf_explain_analyze('select count(*) from rf_fact f join rf_dim d on f.dim_id = d.id');
+
+reset gp_enable_runtime_filter;
+reset optimizer;
+
+-- With ORCA, a partitioned outer table is read by a dynamic scan, which
+-- hands the filter on to the scan of each partition.  The planner scans
+-- the partitions under an Append, which gets no filter.
+create table rf_fact_part (id int, dim_id int, val int) distributed by (dim_id)
+  partition by range (val) (start (0) end (100001) every (20000));
+insert into rf_fact_part select * from rf_fact;
+analyze rf_fact_part;
+
+set gp_enable_runtime_filter = on;
+
+select count(*) from rf_fact_part f join rf_dim d on f.dim_id = d.id;
+select count(*) from rf_fact_part f join rf_dim d on f.dim_id = d.id where f.val % 3 = 0;
+select count(*) > 0 from rf_explain_analyze('select count(*) from rf_fact_part f join rf_dim d on f.dim_id = d.id');
+
+reset gp_enable_runtime_filter;
+drop table rf_fact_part;
+
+drop function rf_explain_analyze(text);
+drop table rf_fact;
+drop table rf_dim;
@@ -34,3 +34,42 @@ SELECT *,
         SELECT 1 FROM cte c1, cte c2
         )
         FROM bar;
+
+--
+-- Cross-slice shared scans pass small results to their readers in shared
+-- memory, and larger ones in workfiles. Both must give the same result.
+-- The shareinput_flush_shm fault shows which of the two the writer used.
+--
+SET gp_cte_sharing = on;
+
+CREATE TABLE shm_share (a int, b int) DISTRIBUTED BY (a);
+INSERT INTO shm_share SELECT i, i % 100 FROM generate_series(1, 1000) i;
+ANALYZE shm_share;
+
+select gp_inject_fault('shareinput_flush_shm', 'reset', 2);
+select gp_inject_fault('shareinput_flush_shm', 'skip', 2);
+WITH cte AS (SELECT * FROM shm_share)
+SELECT count(*) AS n, sum(c1.a) AS sa, sum(c2.b) AS sb
+FROM cte c1 JOIN cte c2 ON c1.a = c2.b;
+select gp_inject_fault('shareinput_flush_shm', 'status', 2);
+
+SET gp_shareinput_shm_kb = 1;
+select gp_inject_fault('shareinput_flush_shm', 'reset', 2);
+select gp_inject_fault('shareinput_flush_shm', 'skip', 2);
+WITH cte AS (SELECT * FROM shm_share)
+SELECT count(*) AS n, sum(c1.a) AS sa, sum(c2.b) AS sb
+FROM cte c1 JOIN cte c2 ON c1.a = c2.b;
+select gp_inject_fault('shareinput_flush_shm', 'status', 2);
+
+SET gp_shareinput_shm_kb = 0;
+select gp_inject_fault('shareinput_flush_shm', 'reset', 2);
+select gp_inject_fault('shareinput_flush_shm', 'skip', 2);
+WITH cte AS (SELECT * FROM shm_share)
+SELECT count(*) AS n, sum(c1.a) AS sa, sum(c2.b) AS sb
+FROM cte c1 JOIN cte c2 ON c1.a = c2.b;
+select gp_inject_fault('shareinput_flush_shm', 'status', 2);
+
+select gp_inject_fault('shareinput_flush_shm', 'reset', 2);
+RESET gp_shareinput_shm_kb;
+RESET gp_cte_sharing;
+DROP TABLE shm_share;
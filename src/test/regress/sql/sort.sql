@@ -124,3 +124,51 @@ select * from colltest order by t COLLATE "C" NULLS FIRST;
 set gp_enable_motion_mk_sort=off;
 select * from colltest order by t COLLATE "C";
 select * from colltest order by t COLLATE "C" NULLS FIRST;
+
+-- Large sorts on integer keys are split up by radix first, and text in C
+-- collation is compared by its first 8 bytes first.  Check that they come
+-- out in the same order as when sorting on numeric or on bytes.
+set gp_enable_mk_sort = on;
+create table sort_radix as
+  select i,
+         case when i % 97 = 0 then null else (i * 7919) % 5003 - 2500 end as k4,
+         case when i % 89 = 0 then null else ((i * 104729) % 100003 - 50000)::int8 * 1000000007 end as k8,
+         ((i * 31) % 200 - 100)::int2 as k2,
+         case when i % 3 = 0 then 'x' || (i % 7)
+              else 'a common prefix ' || ((i * 13) % 1000) end as t
+  from generate_series(1, 20000) i distributed by (i);
+select count(*) from
+  (select k8, row_number() over (order by k8) as rn from sort_radix) a
+  join (select k8, row_number() over (order by k8::numeric) as rn from sort_radix) b using (rn)
+  where a.k8 is distinct from b.k8;
+select count(*) from
+  (select k4, k8, row_number() over (order by k4 desc nulls first, k8) as rn from sort_radix) a
+  join (select k4, k8, row_number() over (order by k4::numeric desc nulls first, k8::numeric) as rn from sort_radix) b using (rn)
+  where a.k4 is distinct from b.k4 or a.k8 is distinct from b.k8;
+select count(*) from
+  (select k2, k4, row_number() over (order by k2, k4 desc) as rn from sort_radix) a
+  join (select k2, k4, row_number() over (order by k2::numeric, k4::numeric desc) as rn from sort_radix) b using (rn)
+  where a.k2 is distinct from b.k2 or a.k4 is distinct from b.k4;
+select count(*) from
+  (select t, row_number() over (order by t collate "C") as rn from sort_radix) a
+  join (select t, row_number() over (order by convert_to(t, 'UTF8')) as rn from sort_radix) b using (rn)
+  where a.t is distinct from b.t;
+select count(*) from
+  (select t, k4, row_number() over (order by t collate "C" desc, k4) as rn from sort_radix) a
+  join (select t, k4, row_number() over (order by convert_to(t, 'UTF8') desc, k4::numeric) as rn from sort_radix) b using (rn)
+  where a.t is distinct from b.t or a.k4 is distinct from b.k4;
+drop table sort_radix;
+-- Large in-memory sorts on integer keys can be sorted by several threads.
+-- The fault shows that the threads did run.
+select gp_inject_fault('mksort_parallel_threads', 'reset', 1);
+select gp_inject_fault('mksort_parallel_threads', 'skip', 1);
+set gp_mk_sort_threads = 4;
+select count(*) from
+  (select k, j, row_number() over (order by k desc, j) as rn
+   from (select (i * 7919) % 50021 as k, (i % 13)::int8 as j from generate_series(1, 100000) i) s) a
+  join (select k, j, row_number() over (order by k::numeric desc, j::numeric) as rn
+   from (select (i * 7919) % 50021 as k, (i % 13)::int8 as j from generate_series(1, 100000) i) s) b using (rn)
+  where a.k is distinct from b.k or a.j is distinct from b.j;
+select gp_inject_fault('mksort_parallel_threads', 'status', 1);
+reset gp_mk_sort_threads;
+select gp_inject_fault('mksort_parallel_threads', 'reset', 1);